@@ -35,6 +35,7 @@
 #include <terminal/terminal-private.h>
 #include <terminal/terminal-gdbus.h>
 #include <terminal/terminal-preferences-dialog.h>
+#include <terminal/terminal-pty-holder.h>
 
 
 
@@ -182,7 +183,7 @@ main (int argc, char **argv)
 
   /* initialize options */
   options.disable_server = options.show_version = options.show_colors = options.show_help =
-      options.show_preferences = 0;
+      options.show_preferences = options.pty_holder = 0;
 
   /* install required signal handlers */
   signal (SIGPIPE, SIG_IGN);
@@ -228,6 +229,11 @@ main (int argc, char **argv)
       usage ();
       return EXIT_SUCCESS;
     }
+  else if (G_UNLIKELY (options.pty_holder))
+    {
+      /* started by a terminal to keep its shells, see misc-pty-holder */
+      return terminal_pty_holder_main ();
+    }
   else if (G_UNLIKELY (options.show_preferences))
     {
       GtkWidget *dialog;
@@ -31,10 +31,15 @@
 #ifdef HAVE_MEMORY_H
 #include <memory.h>
 #endif
+#ifdef HAVE_SIGNAL_H
+#include <signal.h>
+#endif
 #ifdef HAVE_STRING_H
 #include <string.h>
 #endif
 
+#include <glib/gstdio.h>
+#include <glib-unix.h>
 #include <libxfce4ui/libxfce4ui.h>
 
 #ifdef GDK_WINDOWING_X11
@@ -44,8 +49,14 @@
 
 #include <terminal/terminal-app.h>
 #include <terminal/terminal-config.h>
+#include <terminal/terminal-font-warm-up.h>
+#include <terminal/terminal-journal.h>
 #include <terminal/terminal-preferences.h>
 #include <terminal/terminal-private.h>
+#include <terminal/terminal-pty-holder.h>
+#include <terminal/terminal-session.h>
+#include <terminal/terminal-system-font.h>
+#include <terminal/terminal-util.h>
 #include <terminal/terminal-window.h>
 #include <terminal/terminal-window-dropdown.h>
 
@@ -79,8 +90,15 @@ static void     terminal_app_window_destroyed         (GtkWidget          *windo
                                                        TerminalApp        *app);
 static void     terminal_app_save_yourself            (XfceSMClient       *client,
                                                        TerminalApp        *app);
+static void     terminal_app_session_quit             (XfceSMClient       *client,
+                                                       TerminalApp        *app);
+static void     terminal_app_journal_stop             (TerminalApp        *app);
+static gboolean terminal_app_terminate                (gpointer            user_data);
+static void     terminal_app_warm_up_start            (TerminalApp        *app);
+static void     terminal_app_warm_up_finished         (gpointer            user_data);
 static void     terminal_app_open_window              (TerminalApp        *app,
                                                        TerminalWindowAttr *attr);
+static GSList  *terminal_app_pty_holder_attrs         (void);
 
 
 
@@ -97,13 +115,24 @@ struct _TerminalApp
   gchar               *initial_menu_bar_accel;
   GSList              *windows;
 
+  /* the file the session manager restarts us with, kept as long as
+   * the session manager may still use it */
+  gchar               *session_file;
+  guint                session_quit : 1;
+
+  /* crash-recovery journal of the windows */
+  TerminalJournal     *journal;
+  guint                journal_started : 1;
+  guint                terminate_ids[3];
+
   guint                accel_map_load_id;
   guint                accel_map_save_id;
   GtkAccelMap         *accel_map;
   GSList              *tab_key_accels;
-};
-
 
+  guint                warm_up_id;
+  guint                warmed_up : 1;
+};
 
 GQuark
 terminal_error_quark (void)
@@ -159,10 +188,19 @@ terminal_app_finalize (GObject *object)
 {
   TerminalApp *app = TERMINAL_APP (object);
   GSList      *lp;
+  guint        n;
 
   /* stop accel map stuff */
   if (G_UNLIKELY (app->accel_map_load_id != 0))
     g_source_remove (app->accel_map_load_id);
+
+  if (G_UNLIKELY (app->warm_up_id != 0))
+    g_source_remove (app->warm_up_id);
+
+  for (n = 0; n < G_N_ELEMENTS (app->terminate_ids); n++)
+    if (app->terminate_ids[n] != 0)
+      g_source_remove (app->terminate_ids[n]);
+
   if (app->accel_map != NULL)
     g_object_unref (G_OBJECT (app->accel_map));
   if (G_UNLIKELY (app->accel_map_save_id != 0))
@@ -181,6 +219,9 @@ terminal_app_finalize (GObject *object)
     }
   g_slist_free (app->windows);
 
+  /* a clean exit leaves nothing to recover */
+  terminal_app_journal_stop (app);
+
   g_signal_handlers_disconnect_by_func (G_OBJECT (app->preferences), G_CALLBACK (terminal_app_update_accels), app);
   g_object_unref (G_OBJECT (app->preferences));
 
@@ -190,6 +231,15 @@ terminal_app_finalize (GObject *object)
   if (app->session_client != NULL)
     g_object_unref (G_OBJECT (app->session_client));
 
+  /* unless the session manager quit us, it will not restart us with
+   * the session file: the user closed the last window */
+  if (app->session_file != NULL)
+    {
+      if (!app->session_quit)
+        g_unlink (app->session_file);
+      g_free (app->session_file);
+    }
+
   for (lp = app->tab_key_accels; lp != NULL; lp = lp->next)
     g_free (((TerminalAccel*) lp->data)->path);
   g_slist_free_full (app->tab_key_accels, g_free);
@@ -255,7 +305,7 @@ terminal_app_update_windows_accels (gpointer user_data)
 
   for (lp = app->windows; lp != NULL; lp = lp->next)
     {
-      terminal_window_rebuild_tabs_menu (TERMINAL_WINDOW (lp->data));
+      terminal_window_update_tabs_menu_accels (TERMINAL_WINDOW (lp->data));
       terminal_window_update_tab_key_accels (TERMINAL_WINDOW (lp->data), app->tab_key_accels);
     }
 
@@ -374,6 +424,10 @@ terminal_app_take_window (TerminalApp *app,
 
   g_signal_connect (G_OBJECT (window), "destroy",
                     G_CALLBACK (terminal_app_window_destroyed), app);
+
+  /* drop-down windows are not restored, like in the session */
+  if (app->journal != NULL && !TERMINAL_IS_WINDOW_DROPDOWN (window))
+    terminal_journal_add_window (app->journal, TERMINAL_WINDOW (window));
   g_signal_connect (G_OBJECT (window), "new-window",
                     G_CALLBACK (terminal_app_new_window), app);
   g_signal_connect (G_OBJECT (window), "new-window-with-screen",
@@ -564,9 +618,14 @@ terminal_app_save_yourself (XfceSMClient *client,
                             TerminalApp  *app)
 {
   GSList               *result = NULL;
+  GSList               *window_attrs = NULL;
   GSList               *lp;
   const gchar * const  *oargv;
+  const gchar          *client_id;
+  GError               *error = NULL;
   gchar               **argv;
+  gchar                *name;
+  gchar                *filename;
   gint                  argc;
   gint                  n;
 
@@ -579,6 +638,7 @@ terminal_app_save_yourself (XfceSMClient *client,
       if (n++ != 0)
         result = g_slist_append (result, g_strdup ("--window"));
       result = g_slist_concat (result, terminal_window_get_restart_command (lp->data));
+      window_attrs = g_slist_prepend (window_attrs, terminal_window_get_session_attr (lp->data));
     }
 
   /* no windows were saved - this can happen if there is only a dropdown window
@@ -586,6 +646,31 @@ terminal_app_save_yourself (XfceSMClient *client,
   if (result == NULL)
     return;
 
+  /* the session file holds what does not fit on the command line, like
+   * the scrollback; the command line is used if it cannot be loaded */
+  client_id = xfce_sm_client_get_client_id (client);
+  name = g_strdup_printf ("session-%s.bin", client_id != NULL ? client_id : "default");
+  filename = g_build_filename (g_get_user_cache_dir (), "xfce4", "terminal", name, NULL);
+  window_attrs = g_slist_reverse (window_attrs);
+  if (terminal_session_save (window_attrs, filename, &error))
+    {
+      result = g_slist_append (result, g_strdup_printf ("--session-file=%s", filename));
+
+      /* the file of the previous session is replaced by this one */
+      if (app->session_file != NULL && strcmp (app->session_file, filename) != 0)
+        g_unlink (app->session_file);
+      g_free (app->session_file);
+      app->session_file = filename;
+    }
+  else
+    {
+      g_printerr (_("Failed to save the session: %s\n"), error->message);
+      g_error_free (error);
+      g_free (filename);
+    }
+  g_slist_free_full (window_attrs, (GDestroyNotify) terminal_window_attr_free);
+  g_free (name);
+
   argc = g_slist_length (result) + 1;
   argv = g_new (gchar*, argc + 1);
   for (lp = result, n = 1; n < argc && lp != NULL; lp = lp->next, ++n)
@@ -611,6 +696,92 @@ terminal_app_save_yourself (XfceSMClient *client,
 
 
 
+static void
+terminal_app_session_quit (XfceSMClient *client,
+                           TerminalApp  *app)
+{
+  /* the session manager restarts us with the saved session, it may
+   * kill us before we get to clean up */
+  app->session_quit = TRUE;
+  terminal_app_journal_stop (app);
+
+  gtk_main_quit ();
+}
+
+
+
+static void
+terminal_app_journal_stop (TerminalApp *app)
+{
+  if (app->journal != NULL)
+    {
+      terminal_journal_free (app->journal);
+      app->journal = NULL;
+    }
+}
+
+
+
+static gboolean
+terminal_app_terminate (gpointer user_data)
+{
+  TerminalApp *app = TERMINAL_APP (user_data);
+  guint        n;
+
+  /* quit once, whichever signal comes first */
+  for (n = 0; n < G_N_ELEMENTS (app->terminate_ids); n++)
+    {
+      g_source_remove (app->terminate_ids[n]);
+      app->terminate_ids[n] = 0;
+    }
+
+  /* asked to quit or hung up, not crashed: leave no journal to recover */
+  terminal_app_journal_stop (app);
+
+  gtk_main_quit ();
+
+  return FALSE;
+}
+
+
+
+static GSList *
+terminal_app_pty_holder_attrs (void)
+{
+  TerminalWindowAttr *win_attr;
+  TerminalTabAttr    *tab_attr;
+  GSList             *ids, *lp;
+  GError             *error = NULL;
+
+  ids = terminal_pty_holder_attach (&error);
+  if (G_UNLIKELY (error != NULL))
+    {
+      g_printerr (_("Failed to attach to the pty holder: %s\n"), error->message);
+      g_error_free (error);
+    }
+
+  if (ids == NULL)
+    return NULL;
+
+  /* one window with a tab for each session */
+  win_attr = terminal_window_attr_new ();
+  g_slist_free_full (win_attr->tabs, (GDestroyNotify) terminal_tab_attr_free);
+  win_attr->tabs = NULL;
+
+  for (lp = ids; lp != NULL; lp = lp->next)
+    {
+      tab_attr = terminal_tab_attr_new ();
+      tab_attr->holder_id = GPOINTER_TO_UINT (lp->data);
+      win_attr->tabs = g_slist_append (win_attr->tabs, tab_attr);
+    }
+
+  g_slist_free (ids);
+
+  return g_slist_prepend (NULL, win_attr);
+}
+
+
+
 static GdkDisplay *
 terminal_app_find_display (const gchar *display_name,
                            gint        *screen_num)
@@ -713,6 +884,67 @@ terminal_app_find_screen_by_name (const gchar *display_name)
 
 
 
+static void
+terminal_app_warm_up_start (TerminalApp *app)
+{
+  TerminalSystemFont *system_font;
+  GtkWidget          *window = NULL;
+  GSList             *lp;
+  gboolean            font_use_system;
+  gchar              *font_name = NULL;
+
+  if (app->warmed_up || app->warm_up_id != 0)
+    return;
+
+#ifdef G_ENABLE_DEBUG
+  /* allows comparing the first frame times without the warm-up */
+  if (g_getenv ("XFCE4_TERMINAL_NO_WARM_UP") != NULL)
+    return;
+#endif
+
+  /* draw like the terminals of the windows just opened */
+  for (lp = app->windows; lp != NULL && window == NULL; lp = lp->next)
+    if (gtk_widget_get_realized (GTK_WIDGET (lp->data)))
+      window = lp->data;
+  if (window == NULL)
+    return;
+
+  g_object_get (G_OBJECT (app->preferences),
+                "font-use-system", &font_use_system,
+                "font-name", &font_name,
+                NULL);
+
+  if (font_use_system)
+    {
+      system_font = terminal_system_font_get ();
+      if (terminal_system_font_get_name (system_font) != NULL)
+        {
+          g_free (font_name);
+          font_name = g_strdup (terminal_system_font_get_name (system_font));
+        }
+      g_object_unref (G_OBJECT (system_font));
+    }
+
+  if (IS_STRING (font_name))
+    {
+      app->warm_up_id = terminal_font_warm_up (window, terminal_util_get_font_description (font_name),
+                                               terminal_app_warm_up_finished, app);
+      app->warmed_up = app->warm_up_id != 0;
+    }
+
+  g_free (font_name);
+}
+
+
+
+static void
+terminal_app_warm_up_finished (gpointer user_data)
+{
+  TERMINAL_APP (user_data)->warm_up_id = 0;
+}
+
+
+
 static void
 terminal_app_open_window (TerminalApp        *app,
                           TerminalWindowAttr *attr)
@@ -938,8 +1170,9 @@ terminal_app_open_window (TerminalApp        *app,
     {
       /* save window geometry to prevent overriding */
       terminal_window_set_grid_size (TERMINAL_WINDOW (window), width, height);
-      terminal_screen_force_resize_window (terminal_window_get_active (TERMINAL_WINDOW (window)),
-                                           GTK_WINDOW (window), width, height);
+      terminal_window_queue_resize (TERMINAL_WINDOW (window),
+                                    terminal_window_get_active (TERMINAL_WINDOW (window)),
+                                    width, height);
 
       if (reuse_window)
         gtk_window_present (GTK_WINDOW (window));
@@ -966,6 +1199,11 @@ terminal_app_process (TerminalApp  *app,
                       GError      **error)
 {
   GSList             *attrs, *lp;
+  GSList             *session_attrs;
+  GSList             *recovered, *held;
+  gboolean            use_holder;
+  gboolean            recover;
+  gboolean            restored = FALSE;
   gchar              *sm_client_id = NULL;
   TerminalWindowAttr *attr;
   GError             *err = NULL;
@@ -1001,7 +1239,7 @@ terminal_app_process (TerminalApp  *app,
           g_signal_connect (G_OBJECT (app->session_client), "save-state",
                             G_CALLBACK (terminal_app_save_yourself), app);
           g_signal_connect (G_OBJECT (app->session_client), "quit",
-                            G_CALLBACK (gtk_main_quit), NULL);
+                            G_CALLBACK (terminal_app_session_quit), app);
         }
       else
         {
@@ -1010,6 +1248,76 @@ terminal_app_process (TerminalApp  *app,
         }
     }
 
+  /* a saved session replaces the windows from the command line */
+  for (lp = attrs; lp != NULL; lp = lp->next)
+    {
+      attr = lp->data;
+      if (attr->session_file == NULL)
+        continue;
+
+      session_attrs = terminal_session_load (attr->session_file, &err);
+      if (G_LIKELY (session_attrs != NULL))
+        {
+          /* removed once a new session file replaces it */
+          if (app->session_file == NULL)
+            app->session_file = g_strdup (attr->session_file);
+
+          g_slist_free_full (attrs, (GDestroyNotify) terminal_window_attr_free);
+          attrs = session_attrs;
+          restored = TRUE;
+        }
+      else
+        {
+          g_printerr (_("Failed to restore the session: %s\n"), err->message);
+          g_clear_error (&err);
+        }
+
+      break;
+    }
+
+  if (G_UNLIKELY (!app->journal_started))
+    {
+      /* bring back the windows of a crashed instance, then start
+       * journaling our own; a restored session already brings back
+       * the windows, journals are left for the next start */
+      app->journal_started = TRUE;
+      g_object_get (G_OBJECT (app->preferences), "misc-recover-windows", &recover, NULL);
+      recovered = (recover && !restored) ? terminal_journal_recover () : NULL;
+
+      /* shells kept alive by the pty holder replace the journal, they
+       * still run and bring their own output */
+      g_object_get (G_OBJECT (app->preferences), "misc-pty-holder", &use_holder, NULL);
+      if (use_holder)
+        {
+          held = terminal_app_pty_holder_attrs ();
+          if (held != NULL)
+            {
+              g_slist_free_full (recovered, (GDestroyNotify) terminal_window_attr_free);
+              recovered = held;
+            }
+        }
+
+      attrs = g_slist_concat (recovered, attrs);
+
+      if (recover)
+        {
+          app->journal = terminal_journal_new (&err);
+          if (G_UNLIKELY (app->journal == NULL))
+            {
+              g_printerr (_("Failed to create the recovery journal: %s\n"), err->message);
+              g_clear_error (&err);
+            }
+          else
+            {
+              /* the usual ways to end a terminal, only a crash or a kill
+               * leaves the journal behind */
+              app->terminate_ids[0] = g_unix_signal_add (SIGTERM, terminal_app_terminate, app);
+              app->terminate_ids[1] = g_unix_signal_add (SIGHUP, terminal_app_terminate, app);
+              app->terminate_ids[2] = g_unix_signal_add (SIGINT, terminal_app_terminate, app);
+            }
+        }
+    }
+
   for (lp = attrs; lp != NULL; lp = lp->next)
     {
       attr = lp->data;
@@ -1021,5 +1329,24 @@ terminal_app_process (TerminalApp  *app,
   g_slist_free (attrs);
   g_free (sm_client_id);
 
+  /* load the fonts for the next windows while the server is idle */
+  terminal_app_warm_up_start (app);
+
   return TRUE;
 }
+
+
+
+/**
+ * terminal_app_get_windows:
+ * @app : A #TerminalApp.
+ *
+ * Return value: The windows of @app, newest first. The list is owned
+ *               by @app and should not be modified.
+ **/
+GSList *
+terminal_app_get_windows (TerminalApp *app)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_APP (app), NULL);
+  return app->windows;
+}
@@ -59,6 +59,8 @@ gboolean     terminal_app_process             (TerminalApp        *app,
                                                gint                argc,
                                                GError            **error);
 
+GSList      *terminal_app_get_windows         (TerminalApp        *app);
+
 G_END_DECLS
 
 #endif /* !TERMINAL_APP_H */
@@ -0,0 +1,654 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <glib-unix.h>
+
+#include <terminal/terminal-child-writer.h>
+
+/* bytes handed to vte per main loop iteration */
+#define CHUNK_SIZE (16 * 1024)
+
+/* minimum number of bytes between two progress signals */
+#define PROGRESS_STEP (256 * 1024)
+
+
+
+typedef struct _WriterBuffer WriterBuffer;
+
+
+
+static void     terminal_child_writer_dispose  (GObject             *object);
+static void     terminal_child_writer_finalize (GObject             *object);
+static void     terminal_child_writer_schedule (TerminalChildWriter *writer);
+static gboolean terminal_child_writer_write    (gint                 fd,
+                                                GIOCondition         condition,
+                                                gpointer             user_data);
+static gsize    terminal_child_writer_pastify  (const gchar         *text,
+                                                const gchar         *start,
+                                                const gchar         *end,
+                                                gchar               *chunk);
+#if VTE_CHECK_VERSION (0, 68, 0)
+static void     terminal_child_writer_commit   (VteTerminal         *terminal,
+                                                const gchar         *text,
+                                                guint                size,
+                                                GString             *committed);
+static void     terminal_child_writer_paste    (TerminalChildWriter *writer,
+                                                const gchar         *text,
+                                                gsize                length,
+                                                gboolean             more);
+#endif
+static void     terminal_child_writer_finish   (TerminalChildWriter *writer,
+                                                gboolean             cancelled);
+static void     writer_buffer_free             (gpointer             data);
+
+
+
+enum
+{
+  PROGRESS,
+  FINISHED,
+  LAST_SIGNAL
+};
+
+struct _TerminalChildWriterClass
+{
+  GObjectClass parent_class;
+};
+
+struct _TerminalChildWriter
+{
+  GObject      parent_instance;
+
+  VteTerminal *terminal;
+
+  /* queue of WriterBuffers, the head is being written */
+  GQueue       buffers;
+  gsize        offset;
+
+  /* pasted text with its newlines translated and controls dropped */
+  gchar       *chunk;
+
+  /* end marker of the bracketed paste being written, and whether
+   * vte pasted the first chunk of the text */
+  gchar       *paste_end;
+  gboolean     paste_started;
+
+  /* bytes since the writer was last idle */
+  guint64      written;
+  guint64      total;
+  guint64      progress_written;
+
+  /* producers that still push more data, see terminal_child_writer_hold() */
+  guint        holds;
+
+  guint        watch_id;
+};
+
+struct _WriterBuffer
+{
+  GBytes      *bytes;
+  const gchar *data;
+  gsize        length;
+  gboolean     paste;
+};
+
+
+
+static guint writer_signals[LAST_SIGNAL];
+
+
+
+G_DEFINE_TYPE (TerminalChildWriter, terminal_child_writer, G_TYPE_OBJECT)
+
+
+
+static void
+terminal_child_writer_class_init (TerminalChildWriterClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->dispose = terminal_child_writer_dispose;
+  gobject_class->finalize = terminal_child_writer_finalize;
+
+  /**
+   * TerminalChildWriter::progress
+   *
+   * Emitted every few hundred kilobytes written to the child.
+   **/
+  writer_signals[PROGRESS] =
+    g_signal_new (I_("progress"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
+
+  /**
+   * TerminalChildWriter::finished
+   *
+   * Emitted when all queued data was written, or with %TRUE if the
+   * remaining data was dropped.
+   **/
+  writer_signals[FINISHED] =
+    g_signal_new (I_("finished"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__BOOLEAN,
+                  G_TYPE_NONE, 1, G_TYPE_BOOLEAN);
+}
+
+
+
+static void
+terminal_child_writer_init (TerminalChildWriter *writer)
+{
+  g_queue_init (&writer->buffers);
+}
+
+
+
+static void
+terminal_child_writer_dispose (GObject *object)
+{
+  TerminalChildWriter *writer = TERMINAL_CHILD_WRITER (object);
+
+  if (writer->watch_id != 0)
+    {
+      g_source_remove (writer->watch_id);
+      writer->watch_id = 0;
+    }
+
+  if (writer->terminal != NULL)
+    {
+      g_object_remove_weak_pointer (G_OBJECT (writer->terminal), (gpointer) &writer->terminal);
+      writer->terminal = NULL;
+    }
+
+  (*G_OBJECT_CLASS (terminal_child_writer_parent_class)->dispose) (object);
+}
+
+
+
+static void
+terminal_child_writer_finalize (GObject *object)
+{
+  TerminalChildWriter *writer = TERMINAL_CHILD_WRITER (object);
+
+  while (!g_queue_is_empty (&writer->buffers))
+    writer_buffer_free (g_queue_pop_head (&writer->buffers));
+  g_free (writer->paste_end);
+  g_free (writer->chunk);
+
+  (*G_OBJECT_CLASS (terminal_child_writer_parent_class)->finalize) (object);
+}
+
+
+
+static void
+terminal_child_writer_schedule (TerminalChildWriter *writer)
+{
+  VtePty *pty = NULL;
+  gint    fd = -1;
+
+  if (writer->watch_id != 0 || g_queue_is_empty (&writer->buffers))
+    return;
+
+  if (G_LIKELY (writer->terminal != NULL))
+    pty = vte_terminal_get_pty (writer->terminal);
+  if (G_LIKELY (pty != NULL))
+    fd = vte_pty_get_fd (pty);
+
+  if (G_UNLIKELY (fd == -1))
+    {
+      /* no child to write to */
+      terminal_child_writer_finish (writer, TRUE);
+      return;
+    }
+
+  /* only hand the next chunk to vte once the pty accepts more input, so
+   * a child that stops reading stalls the writer instead of growing the
+   * outgoing buffer of vte; the low priority keeps input and redraws
+   * ahead of the writer */
+  writer->watch_id = g_unix_fd_add_full (G_PRIORITY_DEFAULT_IDLE, fd, G_IO_OUT,
+                                         terminal_child_writer_write, writer, NULL);
+}
+
+
+
+static gboolean
+terminal_child_writer_write (gint         fd,
+                             GIOCondition condition,
+                             gpointer     user_data)
+{
+  TerminalChildWriter *writer = TERMINAL_CHILD_WRITER (user_data);
+  WriterBuffer        *buffer;
+  const gchar         *start, *end;
+  gsize                length;
+  guint                watch_id = writer->watch_id;
+
+  if (G_UNLIKELY ((condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) != 0
+                  || writer->terminal == NULL))
+    {
+      writer->watch_id = 0;
+      terminal_child_writer_finish (writer, TRUE);
+      return FALSE;
+    }
+
+  buffer = g_queue_peek_head (&writer->buffers);
+  terminal_assert (buffer != NULL);
+
+  start = buffer->data + writer->offset;
+  end = start + MIN (CHUNK_SIZE, buffer->length - writer->offset);
+
+  /* never split a multibyte character */
+  if (end < buffer->data + buffer->length)
+    while (end > start + 1 && (*end & 0xc0) == 0x80)
+      end--;
+
+  if (buffer->paste)
+    {
+      if (writer->chunk == NULL)
+        writer->chunk = g_malloc (CHUNK_SIZE + 1);
+      length = terminal_child_writer_pastify (buffer->data, start, end, writer->chunk);
+#if VTE_CHECK_VERSION (0, 68, 0)
+      if (!writer->paste_started)
+        {
+          /* a chunk of only controls would be an empty paste */
+          if (length > 0)
+            terminal_child_writer_paste (writer, writer->chunk, length,
+                                         end < buffer->data + buffer->length);
+        }
+      else
+#endif
+        vte_terminal_feed_child (writer->terminal, writer->chunk, length);
+    }
+  else
+    {
+      vte_terminal_feed_child (writer->terminal, start, end - start);
+    }
+
+  writer->offset += end - start;
+  writer->written += end - start;
+
+  if (writer->offset == buffer->length)
+    {
+      if (writer->paste_end != NULL)
+        {
+          vte_terminal_feed_child (writer->terminal, writer->paste_end, strlen (writer->paste_end));
+          g_free (writer->paste_end);
+          writer->paste_end = NULL;
+        }
+
+      writer_buffer_free (g_queue_pop_head (&writer->buffers));
+      writer->offset = 0;
+      writer->paste_started = FALSE;
+    }
+
+  if (g_queue_is_empty (&writer->buffers))
+    {
+      /* wait for the rest if a producer holds the writer */
+      writer->watch_id = 0;
+      if (writer->holds == 0)
+        terminal_child_writer_finish (writer, FALSE);
+      return FALSE;
+    }
+
+  if (writer->written - writer->progress_written >= PROGRESS_STEP)
+    {
+      writer->progress_written = writer->written;
+      g_signal_emit (G_OBJECT (writer), writer_signals[PROGRESS], 0);
+    }
+
+  /* a handler may have cancelled the writer */
+  return writer->watch_id == watch_id;
+}
+
+
+
+static gsize
+terminal_child_writer_pastify (const gchar *text,
+                               const gchar *start,
+                               const gchar *end,
+                               gchar       *chunk)
+{
+  const guchar *p;
+  gsize         length = 0;
+
+  for (p = (const guchar *) start; p < (const guchar *) end; p++)
+    {
+      if (*p == '\n')
+        {
+          /* like vte, send \r\n and \n as \r; the look back is in the
+           * whole text, so a pair is never split over two chunks */
+          if ((const gchar *) p == text || p[-1] != '\r')
+            chunk[length++] = '\r';
+        }
+      else if ((*p < 0x20 && *p != '\t' && *p != '\r') || *p == 0x7f)
+        {
+          /* like vte, drop the other C0 controls and DEL; an escape in
+           * the text could end a bracketed paste early */
+        }
+      else if (*p == 0xc2 && p + 1 < (const guchar *) end && p[1] >= 0x80 && p[1] <= 0x9f)
+        {
+          /* and the C1 controls, a chunk never splits a character */
+          p++;
+        }
+      else
+        {
+          chunk[length++] = *p;
+        }
+    }
+
+  chunk[length] = '\0';
+
+  return length;
+}
+
+
+
+#if VTE_CHECK_VERSION (0, 68, 0)
+static void
+terminal_child_writer_commit (VteTerminal *terminal,
+                              const gchar *text,
+                              guint        size,
+                              GString     *committed)
+{
+  g_string_append_len (committed, text, size);
+}
+
+
+
+static void
+terminal_child_writer_paste (TerminalChildWriter *writer,
+                             const gchar         *text,
+                             gsize                length,
+                             gboolean             more)
+{
+  GString *committed;
+  gulong   signal_id;
+  gsize    marker_length;
+
+  terminal_assert (writer->paste_end == NULL);
+
+  writer->paste_started = TRUE;
+
+  /* vte does not tell if the child enabled bracketed paste mode, so the
+   * first chunk goes through its paste function, which brackets it in
+   * the form the child asked for */
+  committed = g_string_sized_new (length + 16);
+  signal_id = g_signal_connect (G_OBJECT (writer->terminal), "commit",
+                                G_CALLBACK (terminal_child_writer_commit), committed);
+  vte_terminal_paste_text (writer->terminal, text);
+  g_signal_handler_disconnect (G_OBJECT (writer->terminal), signal_id);
+
+  /* with the markers known, the rest of the text is one more paste */
+  if (more && committed->len > length && (committed->len - length) % 2 == 0
+      && g_str_has_suffix (committed->str, "201~"))
+    {
+      marker_length = (committed->len - length) / 2;
+      writer->paste_end = g_strdup (committed->str + committed->len - marker_length);
+      vte_terminal_feed_child (writer->terminal, committed->str, marker_length);
+    }
+
+  g_string_free (committed, TRUE);
+}
+#endif
+
+
+
+static void
+terminal_child_writer_finish (TerminalChildWriter *writer,
+                              gboolean             cancelled)
+{
+  if (writer->watch_id != 0)
+    {
+      g_source_remove (writer->watch_id);
+      writer->watch_id = 0;
+    }
+
+  /* never leave the child in a paste */
+  if (writer->paste_end != NULL)
+    {
+      if (writer->terminal != NULL)
+        vte_terminal_feed_child (writer->terminal, writer->paste_end, strlen (writer->paste_end));
+      g_free (writer->paste_end);
+      writer->paste_end = NULL;
+    }
+
+  while (!g_queue_is_empty (&writer->buffers))
+    writer_buffer_free (g_queue_pop_head (&writer->buffers));
+  writer->offset = 0;
+  writer->paste_started = FALSE;
+
+  g_signal_emit (G_OBJECT (writer), writer_signals[FINISHED], 0, cancelled);
+
+  writer->written = 0;
+  writer->total = 0;
+  writer->progress_written = 0;
+}
+
+
+
+static void
+writer_buffer_free (gpointer data)
+{
+  WriterBuffer *buffer = data;
+
+  g_bytes_unref (buffer->bytes);
+  g_slice_free (WriterBuffer, buffer);
+}
+
+
+
+/**
+ * terminal_child_writer_new:
+ * @terminal : A #VteTerminal.
+ *
+ * Creates a writer that sends data to the child of @terminal in small
+ * chunks from the main loop, at the pace the child reads its input.
+ *
+ * Return value: A new #TerminalChildWriter.
+ **/
+TerminalChildWriter*
+terminal_child_writer_new (VteTerminal *terminal)
+{
+  TerminalChildWriter *writer;
+
+  terminal_return_val_if_fail (VTE_IS_TERMINAL (terminal), NULL);
+
+  writer = g_object_new (TERMINAL_TYPE_CHILD_WRITER, NULL);
+  writer->terminal = terminal;
+  g_object_add_weak_pointer (G_OBJECT (terminal), (gpointer) &writer->terminal);
+
+  return writer;
+}
+
+
+
+/**
+ * terminal_child_writer_push:
+ * @writer : A #TerminalChildWriter.
+ * @data   : Data to write, the writer takes ownership.
+ * @length : Number of bytes in @data.
+ * @paste  : %TRUE to send @data as pasted text.
+ *
+ * Like terminal_child_writer_push_bytes(), for data allocated with
+ * g_malloc().
+ **/
+void
+terminal_child_writer_push (TerminalChildWriter *writer,
+                            gchar               *data,
+                            gsize                length,
+                            gboolean             paste)
+{
+  GBytes *bytes;
+
+  terminal_return_if_fail (TERMINAL_IS_CHILD_WRITER (writer));
+  terminal_return_if_fail (data != NULL);
+
+  bytes = g_bytes_new_take (data, length);
+  terminal_child_writer_push_bytes (writer, bytes, paste);
+  g_bytes_unref (bytes);
+}
+
+
+
+/**
+ * terminal_child_writer_push_bytes:
+ * @writer : A #TerminalChildWriter.
+ * @bytes  : Data to write, the writer takes a reference.
+ * @paste  : %TRUE to send @bytes as pasted text.
+ *
+ * Queues @bytes after everything pushed before. Pasted text gets its
+ * newlines sent as carriage returns and its other control characters
+ * dropped. If the child enabled bracketed paste mode, the first chunk is
+ * one paste and the rest of the text a second one, however many chunks
+ * it takes. With VTE older than 0.68 pasted text is never bracketed.
+ **/
+void
+terminal_child_writer_push_bytes (TerminalChildWriter *writer,
+                                  GBytes              *bytes,
+                                  gboolean             paste)
+{
+  WriterBuffer *buffer;
+  gsize         length;
+
+  terminal_return_if_fail (TERMINAL_IS_CHILD_WRITER (writer));
+  terminal_return_if_fail (bytes != NULL);
+
+  if (G_UNLIKELY (g_bytes_get_size (bytes) == 0))
+    return;
+
+  buffer = g_slice_new (WriterBuffer);
+  buffer->bytes = g_bytes_ref (bytes);
+  buffer->data = g_bytes_get_data (bytes, &length);
+  buffer->length = length;
+  buffer->paste = paste;
+  g_queue_push_tail (&writer->buffers, buffer);
+
+  writer->total += length;
+
+  terminal_child_writer_schedule (writer);
+}
+
+
+
+/**
+ * terminal_child_writer_hold:
+ * @writer : A #TerminalChildWriter.
+ *
+ * Tells @writer more data is going to be pushed, so it does not emit
+ * "finished" when it runs out of data before that. Every call has to
+ * be balanced by terminal_child_writer_release().
+ **/
+void
+terminal_child_writer_hold (TerminalChildWriter *writer)
+{
+  terminal_return_if_fail (TERMINAL_IS_CHILD_WRITER (writer));
+  writer->holds++;
+}
+
+
+
+/**
+ * terminal_child_writer_release:
+ * @writer : A #TerminalChildWriter.
+ *
+ * Undoes a terminal_child_writer_hold(). If this was the last hold and
+ * all data was written, "finished" is emitted now.
+ **/
+void
+terminal_child_writer_release (TerminalChildWriter *writer)
+{
+  terminal_return_if_fail (TERMINAL_IS_CHILD_WRITER (writer));
+  terminal_return_if_fail (writer->holds > 0);
+
+  /* nothing pushed since the writer was last idle or cancelled */
+  if (--writer->holds == 0 && g_queue_is_empty (&writer->buffers) && writer->total > 0)
+    terminal_child_writer_finish (writer, FALSE);
+}
+
+
+
+/**
+ * terminal_child_writer_cancel:
+ * @writer : A #TerminalChildWriter.
+ *
+ * Drops all data that was not written yet.
+ **/
+void
+terminal_child_writer_cancel (TerminalChildWriter *writer)
+{
+  terminal_return_if_fail (TERMINAL_IS_CHILD_WRITER (writer));
+
+  if (terminal_child_writer_is_busy (writer))
+    terminal_child_writer_finish (writer, TRUE);
+}
+
+
+
+/**
+ * terminal_child_writer_is_busy:
+ * @writer : A #TerminalChildWriter.
+ *
+ * Return value: %TRUE if there is data left to write, or more data
+ *               is going to be pushed.
+ **/
+gboolean
+terminal_child_writer_is_busy (TerminalChildWriter *writer)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_CHILD_WRITER (writer), FALSE);
+  return !g_queue_is_empty (&writer->buffers) || writer->holds > 0;
+}
+
+
+
+/**
+ * terminal_child_writer_get_written:
+ * @writer : A #TerminalChildWriter.
+ *
+ * Return value: Bytes written since the writer was last idle.
+ **/
+guint64
+terminal_child_writer_get_written (TerminalChildWriter *writer)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_CHILD_WRITER (writer), 0);
+  return writer->written;
+}
+
+
+
+/**
+ * terminal_child_writer_get_total:
+ * @writer : A #TerminalChildWriter.
+ *
+ * Return value: Bytes pushed since the writer was last idle.
+ **/
+guint64
+terminal_child_writer_get_total (TerminalChildWriter *writer)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_CHILD_WRITER (writer), 0);
+  return writer->total;
+}
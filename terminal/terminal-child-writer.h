@@ -0,0 +1,61 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_CHILD_WRITER_H
+#define TERMINAL_CHILD_WRITER_H
+
+#include <gtk/gtk.h>
+#include <terminal/terminal-private.h>
+
+G_BEGIN_DECLS
+
+#define TERMINAL_TYPE_CHILD_WRITER            (terminal_child_writer_get_type ())
+#define TERMINAL_CHILD_WRITER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TERMINAL_TYPE_CHILD_WRITER, TerminalChildWriter))
+#define TERMINAL_CHILD_WRITER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), TERMINAL_TYPE_CHILD_WRITER, TerminalChildWriterClass))
+#define TERMINAL_IS_CHILD_WRITER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TERMINAL_TYPE_CHILD_WRITER))
+#define TERMINAL_IS_CHILD_WRITER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), TERMINAL_TYPE_CHILD_WRITER))
+#define TERMINAL_CHILD_WRITER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), TERMINAL_TYPE_CHILD_WRITER, TerminalChildWriterClass))
+
+typedef struct _TerminalChildWriterClass TerminalChildWriterClass;
+typedef struct _TerminalChildWriter      TerminalChildWriter;
+
+GType                terminal_child_writer_get_type    (void) G_GNUC_CONST;
+
+TerminalChildWriter *terminal_child_writer_new         (VteTerminal         *terminal);
+
+void                 terminal_child_writer_push        (TerminalChildWriter *writer,
+                                                        gchar               *data,
+                                                        gsize                length,
+                                                        gboolean             paste);
+
+void                 terminal_child_writer_push_bytes  (TerminalChildWriter *writer,
+                                                        GBytes              *bytes,
+                                                        gboolean             paste);
+
+void                 terminal_child_writer_hold        (TerminalChildWriter *writer);
+
+void                 terminal_child_writer_release     (TerminalChildWriter *writer);
+
+void                 terminal_child_writer_cancel      (TerminalChildWriter *writer);
+
+gboolean             terminal_child_writer_is_busy     (TerminalChildWriter *writer);
+
+guint64              terminal_child_writer_get_written (TerminalChildWriter *writer);
+
+guint64              terminal_child_writer_get_total   (TerminalChildWriter *writer);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_CHILD_WRITER_H */
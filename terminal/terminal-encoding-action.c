@@ -44,8 +44,12 @@ enum
 
 static void       terminal_encoding_action_finalize         (GObject                *object);
 static GtkWidget *terminal_encoding_action_create_menu_item (GtkAction              *action);
+static void       terminal_encoding_action_activated        (GSimpleAction          *charset_action,
+                                                             GVariant               *parameter,
+                                                             TerminalEncodingAction *action);
 static void       terminal_encoding_action_menu_shown       (GtkWidget              *menu,
                                                              TerminalEncodingAction *action);
+static GtkWidget *terminal_encoding_action_item_label       (GtkWidget              *item);
 
 
 
@@ -56,10 +60,25 @@ struct _TerminalEncodingActionClass
 
 struct _TerminalEncodingAction
 {
-  GtkAction  parent_instance;
-  gchar     *current;
+  GtkAction           parent_instance;
+  gchar              *current;
+
+  /* radio state of the menu, the charset or "" for the default */
+  GSimpleActionGroup *action_group;
+  GSimpleAction      *charset_action;
+
+  /* shared model plus a section for a charset not in the list */
+  GMenu              *menu;
+  GMenu              *custom;
 };
 
+typedef struct
+{
+  const gchar *charset;
+  GtkTreeIter *iter;
+  gboolean     found;
+} EncodingLookup;
+
 
 
 /* group names for the charsets below, order matters! */
@@ -140,8 +159,14 @@ static const gchar *terminal_encodings_charsets[][8] =
 
 
 
-static guint  encoding_action_signals[LAST_SIGNAL];
-static GQuark encoding_action_quark = 0;
+static guint         encoding_action_signals[LAST_SIGNAL];
+
+/* built on first use and shared by all windows */
+static GMenuModel          *encoding_menu_model = NULL;
+static GtkTreeStore        *encoding_tree_store = NULL;
+
+/* the one row of the store for a charset not in the list */
+static GtkTreeRowReference *encoding_tree_custom = NULL;
 
 
 
@@ -165,8 +190,6 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 G_GNUC_END_IGNORE_DEPRECATIONS
   gtkaction_class->create_menu_item = terminal_encoding_action_create_menu_item;
 
-  encoding_action_quark = g_quark_from_static_string ("encoding-action-quark");
-
   encoding_action_signals[ENCODING_CHANGED] =
     g_signal_new (I_("encoding-changed"),
                   G_TYPE_FROM_CLASS (klass),
@@ -181,7 +204,15 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 static void
 terminal_encoding_action_init (TerminalEncodingAction *action)
 {
+  action->charset_action = g_simple_action_new_stateful ("charset", G_VARIANT_TYPE_STRING,
+                                                         g_variant_new_string (""));
+  g_signal_connect (G_OBJECT (action->charset_action), "activate",
+      G_CALLBACK (terminal_encoding_action_activated), action);
 
+  action->action_group = g_simple_action_group_new ();
+  g_action_map_add_action (G_ACTION_MAP (action->action_group), G_ACTION (action->charset_action));
+
+  action->custom = g_menu_new ();
 }
 
 
@@ -192,12 +223,91 @@ terminal_encoding_action_finalize (GObject *object)
   TerminalEncodingAction *action = TERMINAL_ENCODING_ACTION (object);
 
   g_free (action->current);
+  g_object_unref (G_OBJECT (action->charset_action));
+  g_object_unref (G_OBJECT (action->action_group));
+  g_object_unref (G_OBJECT (action->custom));
+  if (action->menu != NULL)
+    g_object_unref (G_OBJECT (action->menu));
 
   (*G_OBJECT_CLASS (terminal_encoding_action_parent_class)->finalize) (object);
 }
 
 
 
+static GMenuModel *
+terminal_encoding_menu_model_get (void)
+{
+  GMenu       *menu, *submenu;
+  GMenuItem   *item;
+  const gchar *charset;
+  gchar       *default_label;
+  guint        n, k;
+
+  if (G_LIKELY (encoding_menu_model != NULL))
+    return encoding_menu_model;
+
+  menu = g_menu_new ();
+
+  /* action to reset to the default */
+  g_get_charset (&charset);
+  default_label = g_strdup_printf (_("Default (%s)"), charset);
+  item = g_menu_item_new (default_label, NULL);
+  g_menu_item_set_action_and_target_value (item, "encoding.charset", g_variant_new_string (""));
+  g_menu_append_item (menu, item);
+  g_object_unref (G_OBJECT (item));
+  g_free (default_label);
+
+  /*add the groups */
+  for (n = 0; n < G_N_ELEMENTS (terminal_encodings_names); n++)
+    {
+      /* submenu with charset */
+      submenu = g_menu_new ();
+      for (k = 0; k < G_N_ELEMENTS (*terminal_encodings_charsets); k++)
+        {
+          charset = terminal_encodings_charsets[n][k];
+          if (charset == NULL)
+            break;
+
+          item = g_menu_item_new (charset, NULL);
+          g_menu_item_set_action_and_target_value (item, "encoding.charset", g_variant_new_string (charset));
+          g_menu_append_item (submenu, item);
+          g_object_unref (G_OBJECT (item));
+        }
+
+      /* category item */
+      g_menu_append_submenu (menu, _(terminal_encodings_names[n]), G_MENU_MODEL (submenu));
+      g_object_unref (G_OBJECT (submenu));
+    }
+
+  encoding_menu_model = G_MENU_MODEL (menu);
+
+  return encoding_menu_model;
+}
+
+
+
+static gint
+terminal_encoding_group (const gchar *charset)
+{
+  guint n, k;
+
+  if (charset == NULL)
+    return -1;
+
+  for (n = 0; n < G_N_ELEMENTS (terminal_encodings_charsets); n++)
+    for (k = 0; k < G_N_ELEMENTS (*terminal_encodings_charsets); k++)
+      {
+        if (terminal_encodings_charsets[n][k] == NULL)
+          break;
+        if (strcmp (terminal_encodings_charsets[n][k], charset) == 0)
+          return n;
+      }
+
+  return -1;
+}
+
+
+
 static GtkWidget *
 terminal_encoding_action_create_menu_item (GtkAction *action)
 {
@@ -211,8 +321,11 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
   item = (*GTK_ACTION_CLASS (terminal_encoding_action_parent_class)->create_menu_item) (action);
 G_GNUC_END_IGNORE_DEPRECATIONS
 
-  /* associate an empty submenu with the item (will be filled when shown) */
+  /* associate an empty submenu with the item (bound to the model when
+   * first shown) */
   menu = gtk_menu_new ();
+  gtk_widget_insert_action_group (menu, "encoding",
+                                  G_ACTION_GROUP (TERMINAL_ENCODING_ACTION (action)->action_group));
   g_signal_connect (G_OBJECT (menu), "show", G_CALLBACK (terminal_encoding_action_menu_shown), action);
   gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), menu);
 
@@ -222,20 +335,19 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 
 
 static void
-terminal_encoding_action_activated (GtkWidget              *item,
-                                    TerminalEncodingAction *encoding_action)
+terminal_encoding_action_activated (GSimpleAction          *charset_action,
+                                    GVariant               *parameter,
+                                    TerminalEncodingAction *action)
 {
   const gchar *charset;
 
-  terminal_return_if_fail (GTK_IS_CHECK_MENU_ITEM (item));
-
-  if (!gtk_check_menu_item_get_active (GTK_CHECK_MENU_ITEM (item)))
-    return;
+  g_simple_action_set_state (charset_action, parameter);
 
   /* menu charset or null to reset */
-  charset = g_object_get_qdata (G_OBJECT (item), encoding_action_quark);
-  g_signal_emit (G_OBJECT (encoding_action),
-                 encoding_action_signals[ENCODING_CHANGED], 0, charset);
+  charset = g_variant_get_string (parameter, NULL);
+  g_signal_emit (G_OBJECT (action),
+                 encoding_action_signals[ENCODING_CHANGED], 0,
+                 *charset != '\0' ? charset : NULL);
 }
 
 
@@ -244,103 +356,80 @@ static void
 terminal_encoding_action_menu_shown (GtkWidget              *menu,
                                      TerminalEncodingAction *action)
 {
-  GList         *children;
-  guint          n, k;
-  GtkWidget     *item;
-  GtkWidget     *item2;
-  GtkWidget     *submenu;
-  const gchar   *charset;
-  GSList        *groups = NULL;
-  gboolean       found;
+  GList         *children, *li;
   GtkWidget     *label;
-  GtkWidget     *bold_item = NULL;
   PangoAttrList *attrs;
   const gchar   *default_charset;
-  gchar         *default_label;
+  gint           group = -1;
+  gint           n = 0;
 
   terminal_return_if_fail (TERMINAL_IS_ENCODING_ACTION (action));
   terminal_return_if_fail (GTK_IS_MENU_SHELL (menu));
 
-  /* drop all existing children of the menu first */
-  children = gtk_container_get_children (GTK_CONTAINER (menu));
-  g_list_free_full (children, (GDestroyNotify) gtk_widget_destroy);
+  /* the items are created once, the active one follows the state
+   * of the charset action */
+  if (g_object_get_data (G_OBJECT (menu), "encoding-bound") == NULL)
+    {
+      if (action->menu == NULL)
+        {
+          action->menu = g_menu_new ();
+          g_menu_append_section (action->menu, NULL, terminal_encoding_menu_model_get ());
+          g_menu_append_section (action->menu, NULL, G_MENU_MODEL (action->custom));
+        }
 
-  g_get_charset (&default_charset);
-  found = (action->current == NULL
-           || g_strcmp0 (default_charset, action->current) == 0);
+      gtk_menu_shell_bind_model (GTK_MENU_SHELL (menu), G_MENU_MODEL (action->menu), NULL, TRUE);
+      g_object_set_data (G_OBJECT (menu), "encoding-bound", GINT_TO_POINTER (TRUE));
+    }
 
-  /* action to reset to the default */
-  default_label = g_strdup_printf (_("Default (%s)"), default_charset);
-  item = gtk_radio_menu_item_new_with_label (groups, default_label);
-  groups = gtk_radio_menu_item_get_group (GTK_RADIO_MENU_ITEM (item));
-  gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
-  gtk_check_menu_item_set_active (GTK_CHECK_MENU_ITEM (item), found);
-  g_signal_connect (G_OBJECT (item), "activate",
-      G_CALLBACK (terminal_encoding_action_activated), action);
-  g_free (default_label);
+  /* menu models have no text attributes, so the group of the active
+   * charset is made bold on the items: the default item comes first,
+   * followed by the groups in order */
+  g_get_charset (&default_charset);
+  if (g_strcmp0 (action->current, default_charset) != 0)
+    group = terminal_encoding_group (action->current);
+  attrs = pango_attr_list_new ();
+  pango_attr_list_insert (attrs, pango_attr_weight_new (PANGO_WEIGHT_BOLD));
 
-  /*add the groups */
-  for (n = 0; n < G_N_ELEMENTS (terminal_encodings_names); n++)
+  children = gtk_container_get_children (GTK_CONTAINER (menu));
+  for (li = children; li != NULL; li = li->next)
     {
-      /* category item */
-      item = gtk_menu_item_new_with_label (_(terminal_encodings_names[n]));
-      gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
-
-      submenu = gtk_menu_new ();
-      gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), submenu);
+      if (GTK_IS_SEPARATOR_MENU_ITEM (li->data))
+        continue;
 
-      /* submenu with charset */
-      for (k = 0; k < G_N_ELEMENTS (*terminal_encodings_charsets); k++)
-        {
-          charset = terminal_encodings_charsets[n][k];
-          if (charset == NULL)
-            break;
+      label = terminal_encoding_action_item_label (li->data);
+      if (label != NULL)
+        gtk_label_set_attributes (GTK_LABEL (label), n == group + 1 && group != -1 ? attrs : NULL);
+      n++;
+    }
+  g_list_free (children);
 
-          item2 = gtk_radio_menu_item_new_with_label (groups, charset);
-          groups = gtk_radio_menu_item_get_group (GTK_RADIO_MENU_ITEM (item2));
-          gtk_menu_shell_append (GTK_MENU_SHELL (submenu), item2);
-          g_object_set_qdata (G_OBJECT (item2), encoding_action_quark, (gchar *) charset);
+  pango_attr_list_unref (attrs);
+}
 
-          if (!found
-              && strcmp (action->current, charset) == 0)
-            {
-              gtk_check_menu_item_set_active (GTK_CHECK_MENU_ITEM (item2), TRUE);
 
-              found = TRUE;
-              bold_item = item;
-            }
 
-          g_signal_connect (G_OBJECT (item2), "activate",
-              G_CALLBACK (terminal_encoding_action_activated), action);
-        }
-    }
+static GtkWidget *
+terminal_encoding_action_item_label (GtkWidget *item)
+{
+  GtkWidget *child;
+  GtkWidget *label = NULL;
+  GList     *children, *li;
 
-  if (!found)
-    {
-      /* add an action with the unknown charset */
-      item2 = gtk_radio_menu_item_new_with_label (groups, action->current);
-      groups = gtk_radio_menu_item_get_group (GTK_RADIO_MENU_ITEM (item2));
-      g_object_set_qdata_full (G_OBJECT (item2), encoding_action_quark,
-                               g_strdup (action->current), g_free);
-      gtk_menu_shell_append (GTK_MENU_SHELL (submenu), item2);
-      gtk_check_menu_item_set_active (GTK_CHECK_MENU_ITEM (item2), TRUE);
-      g_signal_connect (G_OBJECT (item2), "activate",
-        G_CALLBACK (terminal_encoding_action_activated), action);
-
-      /* other group */
-      bold_item = item;
-    }
+  /* the label of a model menu item, alone or in a box next to an icon */
+  child = gtk_bin_get_child (GTK_BIN (item));
+  if (child == NULL || GTK_IS_LABEL (child))
+    return child;
 
-  if (bold_item != NULL)
+  if (GTK_IS_CONTAINER (child))
     {
-      attrs = pango_attr_list_new ();
-      pango_attr_list_insert (attrs, pango_attr_weight_new (PANGO_WEIGHT_BOLD));
-      label = gtk_bin_get_child (GTK_BIN (bold_item));
-      gtk_label_set_attributes (GTK_LABEL (label), attrs);
-      pango_attr_list_unref (attrs);
+      children = gtk_container_get_children (GTK_CONTAINER (child));
+      for (li = children; li != NULL && label == NULL; li = li->next)
+        if (GTK_IS_LABEL (li->data))
+          label = li->data;
+      g_list_free (children);
     }
 
-  gtk_widget_show_all (menu);
+  return label;
 }
 
 
@@ -366,11 +455,34 @@ terminal_encoding_action_set_charset (GtkAction   *gtkaction,
                                       const gchar *charset)
 {
   TerminalEncodingAction *action = TERMINAL_ENCODING_ACTION (gtkaction);
+  const gchar            *default_charset;
+  GMenuItem              *item;
 
   terminal_return_if_fail (TERMINAL_IS_ENCODING_ACTION (action));
 
+  if (g_strcmp0 (action->current, charset) == 0)
+    return;
+
   g_free (action->current);
   action->current = g_strdup (charset);
+
+  /* the default charset is shown as the default item */
+  g_get_charset (&default_charset);
+  if (charset == NULL || g_strcmp0 (charset, default_charset) == 0)
+    charset = "";
+
+  g_simple_action_set_state (action->charset_action, g_variant_new_string (charset));
+
+  /* an unknown charset gets its own item below the list */
+  if (g_menu_model_get_n_items (G_MENU_MODEL (action->custom)) > 0)
+    g_menu_remove_all (action->custom);
+  if (*charset != '\0' && terminal_encoding_group (charset) == -1)
+    {
+      item = g_menu_item_new (charset, NULL);
+      g_menu_item_set_action_and_target_value (item, "encoding.charset", g_variant_new_string (charset));
+      g_menu_append_item (action->custom, item);
+      g_object_unref (G_OBJECT (item));
+    }
 }
 
 
@@ -379,19 +491,40 @@ terminal_encoding_action_set_charset (GtkAction   *gtkaction,
 
 
 
-GtkTreeModel *
-terminal_encoding_model_new (const gchar *current,
-                             GtkTreeIter *current_iter)
+static gboolean
+terminal_encoding_model_lookup (GtkTreeModel   *model,
+                                GtkTreePath    *path,
+                                GtkTreeIter    *iter,
+                                EncodingLookup *lookup)
+{
+  gchar *value;
+
+  gtk_tree_model_get (model, iter, ENCODING_COLUMN_VALUE, &value, -1);
+  lookup->found = (g_strcmp0 (value, lookup->charset) == 0);
+  g_free (value);
+
+  if (lookup->found)
+    *lookup->iter = *iter;
+
+  return lookup->found;
+}
+
+
+
+static GtkTreeStore *
+terminal_encoding_model_get (void)
 {
   GtkTreeStore *store;
   guint         n;
   guint         k;
   GtkTreeIter   parent;
   const gchar  *charset;
-  gboolean      found;
   GtkTreeIter   iter;
   gchar        *default_label;
 
+  if (G_LIKELY (encoding_tree_store != NULL))
+    return encoding_tree_store;
+
   store = gtk_tree_store_new (N_ENCODING_COLUMNS,
                               G_TYPE_STRING,
                               G_TYPE_BOOLEAN,
@@ -406,9 +539,6 @@ terminal_encoding_model_new (const gchar *current,
                                      ENCODING_COLUMN_IS_CHARSET, TRUE,
                                      -1);
   g_free (default_label);
-  found = (current == NULL || g_strcmp0 (current, charset) == 0);
-  if (found)
-    *current_iter = iter;
 
   /*add the groups */
   for (n = 0; n < G_N_ELEMENTS (terminal_encodings_names); n++)
@@ -429,25 +559,81 @@ terminal_encoding_model_new (const gchar *current,
                                              ENCODING_COLUMN_TITLE, charset,
                                              ENCODING_COLUMN_VALUE, charset,
                                              -1);
-
-          if (!found && g_strcmp0 (charset, current) == 0)
-            {
-              *current_iter = iter;
-              found = TRUE;
-            }
         }
     }
 
-  if (!found)
+  encoding_tree_store = store;
+
+  return encoding_tree_store;
+}
+
+
+
+/**
+ * terminal_encoding_model_new:
+ * @current      : The charset to select or %NULL for the default.
+ * @current_iter : Return location for the row of @current.
+ *
+ * Return value: The shared model of the charsets with a new reference,
+ *               it is built on the first call.
+ **/
+GtkTreeModel *
+terminal_encoding_model_new (const gchar *current,
+                             GtkTreeIter *current_iter)
+{
+  GtkTreeStore   *store;
+  GtkTreeIter     parent;
+  GtkTreePath    *path;
+  const gchar    *charset;
+  EncodingLookup  lookup;
+
+  store = terminal_encoding_model_get ();
+
+  g_get_charset (&charset);
+  if (current == NULL || g_strcmp0 (current, charset) == 0)
     {
-      /* add custom in other menu */
-      gtk_tree_store_insert_with_values (store, current_iter, &parent, k,
-                                         ENCODING_COLUMN_TITLE, current,
-                                         ENCODING_COLUMN_IS_CHARSET, TRUE,
-                                         ENCODING_COLUMN_VALUE, current,
-                                         -1);
+      /* default */
+      gtk_tree_model_get_iter_first (GTK_TREE_MODEL (store), current_iter);
+    }
+  else
+    {
+      lookup.charset = current;
+      lookup.iter = current_iter;
+      lookup.found = FALSE;
+      gtk_tree_model_foreach (GTK_TREE_MODEL (store),
+                              (GtkTreeModelForeachFunc) terminal_encoding_model_lookup,
+                              &lookup);
+
+      if (!lookup.found)
+        {
+          /* the store is shared, so there is one row for a custom
+           * charset in the other menu, reused for the next one */
+          if (encoding_tree_custom != NULL)
+            {
+              path = gtk_tree_row_reference_get_path (encoding_tree_custom);
+              gtk_tree_model_get_iter (GTK_TREE_MODEL (store), current_iter, path);
+              gtk_tree_path_free (path);
+              gtk_tree_store_set (store, current_iter,
+                                  ENCODING_COLUMN_TITLE, current,
+                                  ENCODING_COLUMN_VALUE, current,
+                                  -1);
+            }
+          else
+            {
+              gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (store), &parent, NULL,
+                                             G_N_ELEMENTS (terminal_encodings_names));
+              gtk_tree_store_insert_with_values (store, current_iter, &parent, -1,
+                                                 ENCODING_COLUMN_TITLE, current,
+                                                 ENCODING_COLUMN_IS_CHARSET, TRUE,
+                                                 ENCODING_COLUMN_VALUE, current,
+                                                 -1);
+
+              path = gtk_tree_model_get_path (GTK_TREE_MODEL (store), current_iter);
+              encoding_tree_custom = gtk_tree_row_reference_new (GTK_TREE_MODEL (store), path);
+              gtk_tree_path_free (path);
+            }
+        }
     }
 
-  return GTK_TREE_MODEL (store);
+  return GTK_TREE_MODEL (g_object_ref (G_OBJECT (store)));
 }
-
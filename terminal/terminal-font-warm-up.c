@@ -0,0 +1,188 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <terminal/terminal-font-warm-up.h>
+#include <terminal/terminal-private.h>
+
+/* size of the hidden surface the warm-up draws into */
+#define WARM_UP_WIDTH  2048
+#define WARM_UP_HEIGHT 64
+
+
+
+typedef struct
+{
+  PangoFontDescription *font_desc;
+  PangoLayout          *layout;
+  cairo_surface_t      *surface;
+  cairo_t              *cr;
+  guint                 step;
+  GDestroyNotify        finished;
+  gpointer              user_data;
+#ifdef G_ENABLE_DEBUG
+  gint64                elapsed;
+#endif
+} TerminalWarmUp;
+
+
+
+static gboolean terminal_font_warm_up_step     (gpointer user_data);
+static void     terminal_font_warm_up_finished (gpointer user_data);
+
+
+
+/* text shaped during the warm-up to resolve the common fallback fonts */
+static const gchar *warm_up_fallbacks[] =
+{
+  "\346\227\245\346\234\254\350\252\236 \344\270\255\346\226\207 \355\225\234\352\265\255\354\226\264",  /* CJK */
+  "\342\224\200\342\224\202\342\224\214\342\226\210 \342\206\222 \342\234\224 \342\234\230 \316\273 \320\226",  /* box drawing, arrows, greek, cyrillic */
+  "\360\237\230\200 \360\237\232\200 \360\237\224\245 \342\255\220",                                            /* emoji */
+};
+
+
+
+static gboolean
+terminal_font_warm_up_step (gpointer user_data)
+{
+  TerminalWarmUp *warm_up = user_data;
+  gchar           ascii[0x7f - 0x20 + 1];
+  guint           step, n;
+#ifdef G_ENABLE_DEBUG
+  gint64          start = g_get_monotonic_time ();
+#endif
+
+  step = warm_up->step++;
+
+  if (step < 4)
+    {
+      /* regular, bold, italic and bold italic face; drawing the printable
+       * ascii range fills the glyph cache of the scaled fonts vte will use */
+      for (n = 0; n < sizeof (ascii) - 1; n++)
+        ascii[n] = 0x20 + n;
+      ascii[n] = '\0';
+
+      pango_font_description_set_weight (warm_up->font_desc, (step & 1) ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL);
+      pango_font_description_set_style (warm_up->font_desc, (step & 2) ? PANGO_STYLE_ITALIC : PANGO_STYLE_NORMAL);
+      pango_layout_set_font_description (warm_up->layout, warm_up->font_desc);
+      pango_layout_set_text (warm_up->layout, ascii, -1);
+    }
+  else if (step - 4 < G_N_ELEMENTS (warm_up_fallbacks))
+    {
+      /* glyphs the configured font lacks, resolved through fontconfig */
+      pango_font_description_set_weight (warm_up->font_desc, PANGO_WEIGHT_NORMAL);
+      pango_font_description_set_style (warm_up->font_desc, PANGO_STYLE_NORMAL);
+      pango_layout_set_font_description (warm_up->layout, warm_up->font_desc);
+      pango_layout_set_text (warm_up->layout, warm_up_fallbacks[step - 4], -1);
+    }
+  else
+    {
+      return FALSE;
+    }
+
+  cairo_move_to (warm_up->cr, 0, 0);
+  pango_cairo_show_layout (warm_up->cr, warm_up->layout);
+
+#ifdef G_ENABLE_DEBUG
+  warm_up->elapsed += g_get_monotonic_time () - start;
+#endif
+
+  return TRUE;
+}
+
+
+
+static void
+terminal_font_warm_up_finished (gpointer user_data)
+{
+  TerminalWarmUp *warm_up = user_data;
+
+#ifdef G_ENABLE_DEBUG
+  g_debug ("font warm-up: %u steps in %.1f ms", warm_up->step,
+           warm_up->elapsed / 1000.0);
+#endif
+
+  if (warm_up->finished != NULL)
+    (*warm_up->finished) (warm_up->user_data);
+
+  cairo_destroy (warm_up->cr);
+  cairo_surface_destroy (warm_up->surface);
+  g_object_unref (G_OBJECT (warm_up->layout));
+  pango_font_description_free (warm_up->font_desc);
+  g_slice_free (TerminalWarmUp, warm_up);
+}
+
+
+
+/**
+ * terminal_font_warm_up:
+ * @widget    : A realized #GtkWidget, usually a terminal window.
+ * @font_desc : The font the next terminals will use.
+ * @finished  : Called when the warm-up is done or its source removed.
+ * @user_data : Data for @finished.
+ *
+ * Draws the common glyphs of @font_desc, one face per idle iteration,
+ * the way vte draws them on the screen of @widget: the surface is
+ * similar to the window of @widget and the pango context has the font
+ * options and resolution of its screen. This fills the fontconfig,
+ * pango and cairo caches the next terminal draws with.
+ *
+ * Return value: The id of the idle source, or 0 if @widget is not
+ *               realized.
+ **/
+guint
+terminal_font_warm_up (GtkWidget                  *widget,
+                       const PangoFontDescription *font_desc,
+                       GDestroyNotify              finished,
+                       gpointer                    user_data)
+{
+  TerminalWarmUp *warm_up;
+  PangoContext   *context;
+  GdkScreen      *screen;
+  GdkWindow      *window;
+
+  terminal_return_val_if_fail (GTK_IS_WIDGET (widget), 0);
+  terminal_return_val_if_fail (font_desc != NULL, 0);
+
+  window = gtk_widget_get_window (widget);
+  if (G_UNLIKELY (window == NULL))
+    return 0;
+
+  warm_up = g_slice_new0 (TerminalWarmUp);
+  warm_up->font_desc = pango_font_description_copy (font_desc);
+  warm_up->finished = finished;
+  warm_up->user_data = user_data;
+
+  /* the backend of the window, so the glyphs land in the same caches */
+  warm_up->surface = gdk_window_create_similar_surface (window, CAIRO_CONTENT_COLOR_ALPHA,
+                                                        WARM_UP_WIDTH, WARM_UP_HEIGHT);
+  warm_up->cr = cairo_create (warm_up->surface);
+
+  /* the font options and resolution vte sets up for its fonts */
+  screen = gtk_widget_get_screen (widget);
+  context = gdk_pango_context_get_for_screen (screen);
+  pango_cairo_context_set_font_options (context, gdk_screen_get_font_options (screen));
+  pango_cairo_context_set_resolution (context, gdk_screen_get_resolution (screen));
+  pango_cairo_update_context (warm_up->cr, context);
+
+  warm_up->layout = pango_layout_new (context);
+  g_object_unref (G_OBJECT (context));
+
+  return gdk_threads_add_idle_full (G_PRIORITY_LOW, terminal_font_warm_up_step, warm_up,
+                                    terminal_font_warm_up_finished);
+}
@@ -0,0 +1,30 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_FONT_WARM_UP_H
+#define TERMINAL_FONT_WARM_UP_H
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+guint terminal_font_warm_up (GtkWidget                  *widget,
+                             const PangoFontDescription *font_desc,
+                             GDestroyNotify              finished,
+                             gpointer                    user_data);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_FONT_WARM_UP_H */
@@ -23,15 +23,58 @@
 #include <sys/types.h>
 #endif
 
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
 
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+#include <gio/gunixoutputstream.h>
+#include <glib-unix.h>
 
 #include <terminal/terminal-config.h>
 #include <terminal/terminal-gdbus.h>
+#include <terminal/terminal-image-loader.h>
 #include <terminal/terminal-private.h>
+#include <terminal/terminal-widget.h>
+#include <terminal/terminal-window.h>
+
+/* terminal-private.h maps these to VteRegex, WaitForMatch matches the
+ * text with the glib versions */
+#undef GRegex
+#undef g_regex_ref
+#undef g_regex_unref
+
+/* milliseconds between two change signals of the metrics */
+#define METRICS_CHANGED_INTERVAL (1000)
+/* bytes written to a reply pipe at once */
+#define PIPE_CHUNK_SIZE          (64 * 1024)
+/* rows ReadLines extracts at most, longer histories are read in pages */
+#define READ_LINES_MAX           (10000)
+
+
+
+typedef struct
+{
+  GOutputStream *stream;
+  gchar         *text;
+  gsize          length;
+  gsize          offset;
+} PipeWrite;
+
+typedef struct
+{
+  GDBusMethodInvocation *invocation;
+  TerminalScreen        *screen;
+  GRegex                *regex;
+  gulong                 changed_id;
+  gulong                 destroy_id;
+  guint                  timeout_id;
+} MatchWait;
 
 
 
@@ -44,10 +87,60 @@ static const gchar terminal_gdbus_introspection_xml[] =
         "<arg type='aay' name='argv' direction='in'/>"
       "</method>"
     "</interface>"
+    "<interface name='" TERMINAL_DBUS_METRICS_INTERFACE "'>"
+      "<method name='ListTerminals'>"
+        "<arg type='a(uus)' name='terminals' direction='out'/>"
+      "</method>"
+      "<method name='GetMetrics'>"
+        "<arg type='a{sv}' name='global' direction='out'/>"
+        "<arg type='a(uua{sv})' name='terminals' direction='out'/>"
+      "</method>"
+      "<method name='Subscribe'/>"
+      "<method name='Unsubscribe'/>"
+      "<signal name='Changed'/>"
+    "</interface>"
+    "<interface name='" TERMINAL_DBUS_CONTROL_INTERFACE "'>"
+      "<method name='SendInput'>"
+        "<arg type='u' name='terminal' direction='in'/>"
+        "<arg type='ay' name='data' direction='in'/>"
+      "</method>"
+      "<method name='ReadScreen'>"
+        "<arg type='u' name='terminal' direction='in'/>"
+        "<arg type='h' name='fd' direction='out'/>"
+      "</method>"
+      "<method name='ReadLines'>"
+        "<arg type='u' name='terminal' direction='in'/>"
+        "<arg type='x' name='first' direction='in'/>"
+        "<arg type='x' name='count' direction='in'/>"
+        "<arg type='h' name='fd' direction='out'/>"
+      "</method>"
+      "<method name='WaitForMatch'>"
+        "<arg type='u' name='terminal' direction='in'/>"
+        "<arg type='s' name='pattern' direction='in'/>"
+        "<arg type='u' name='timeout' direction='in'/>"
+        "<arg type='b' name='matched' direction='out'/>"
+        "<arg type='s' name='text' direction='out'/>"
+      "</method>"
+    "</interface>"
   "</node>";
 
 
 
+/* connection the metrics are exported on, once the bus is acquired */
+static GDBusConnection *metrics_connection = NULL;
+static guint            metrics_changed_id = 0;
+
+/* unique names of the clients that want the Changed signal, to the
+ * id of the watch that drops them when they leave the bus */
+static GHashTable      *metrics_subscribers = NULL;
+
+#ifdef G_ENABLE_DEBUG
+/* monotonic time the launch request being handled arrived */
+static gint64           request_time = 0;
+#endif
+
+
+
 static gchar *
 terminal_gdbus_display_name (void)
 {
@@ -92,6 +185,10 @@ terminal_gdbus_method_call (GDBusConnection       *connection,
 
   if (g_strcmp0 (method_name, TERMINAL_DBUS_METHOD_LAUNCH) == 0)
     {
+#ifdef G_ENABLE_DEBUG
+      request_time = g_get_monotonic_time ();
+#endif
+
       /* get paramenters */
       g_variant_get (parameters, "(u^ay^aay)", &uid, &display_name, &argv);
 
@@ -125,6 +222,10 @@ terminal_gdbus_method_call (GDBusConnection       *connection,
       g_free (display_name);
       g_free (display_name2);
       g_strfreev (argv);
+
+#ifdef G_ENABLE_DEBUG
+      request_time = 0;
+#endif
     }
   else
     {
@@ -145,6 +246,538 @@ static const GDBusInterfaceVTable terminal_gdbus_vtable =
 
 
 
+static GVariant *
+terminal_gdbus_metrics_screen (TerminalScreen *screen)
+{
+  GVariantBuilder      builder;
+  TerminalScreenStats  stats;
+  gchar               *title, *command;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+  title = terminal_screen_get_title (screen);
+  g_variant_builder_add (&builder, "{sv}", "title", g_variant_new_string (title != NULL ? title : ""));
+  g_free (title);
+
+  terminal_screen_get_stats (screen, &stats);
+
+  /* vte does not count the bytes it reads from the pty; this is what the
+   * foreground process wrote anywhere, which restarts with every process */
+  g_variant_builder_add (&builder, "{sv}", "foreground-wchar", g_variant_new_uint64 (stats.foreground_wchar));
+  g_variant_builder_add (&builder, "{sv}", "frames", g_variant_new_uint64 (stats.n_frames));
+  g_variant_builder_add (&builder, "{sv}", "frame-time", g_variant_new_int64 (stats.frame_time));
+  g_variant_builder_add (&builder, "{sv}", "scrollback-lines", g_variant_new_int64 (stats.scrollback_lines));
+  g_variant_builder_add (&builder, "{sv}", "scrollback-bytes", g_variant_new_uint64 (stats.scrollback_bytes));
+  g_variant_builder_add (&builder, "{sv}", "foreground-pid", g_variant_new_int32 (stats.foreground_pid));
+  g_variant_builder_add (&builder, "{sv}", "child-cpu-time", g_variant_new_int64 (stats.foreground_cpu_time));
+
+  command = terminal_screen_get_foreground_command (screen);
+  if (command != NULL)
+    g_variant_builder_add (&builder, "{sv}", "foreground-command", g_variant_new_string (command));
+  g_free (command);
+
+  return g_variant_builder_end (&builder);
+}
+
+
+
+static GVariant *
+terminal_gdbus_metrics_global (void)
+{
+  GVariantBuilder      builder;
+  TerminalImageLoader *loader;
+  guint                n_images, n_hits, n_misses;
+  guint                n_patterns, n_users, n_builds;
+  gsize                size;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+  loader = terminal_image_loader_get ();
+  terminal_image_loader_get_stats (loader, &n_images, &size, &n_hits, &n_misses);
+  g_object_unref (G_OBJECT (loader));
+
+  g_variant_builder_add (&builder, "{sv}", "image-cache-images", g_variant_new_uint32 (n_images));
+  g_variant_builder_add (&builder, "{sv}", "image-cache-bytes", g_variant_new_uint64 (size));
+  g_variant_builder_add (&builder, "{sv}", "image-cache-hits", g_variant_new_uint32 (n_hits));
+  g_variant_builder_add (&builder, "{sv}", "image-cache-misses", g_variant_new_uint32 (n_misses));
+
+  terminal_widget_get_regex_stats (&n_patterns, &n_users, &n_builds);
+
+  g_variant_builder_add (&builder, "{sv}", "regex-cache-patterns", g_variant_new_uint32 (n_patterns));
+  g_variant_builder_add (&builder, "{sv}", "regex-cache-users", g_variant_new_uint32 (n_users));
+  g_variant_builder_add (&builder, "{sv}", "regex-cache-builds", g_variant_new_uint32 (n_builds));
+
+  return g_variant_builder_end (&builder);
+}
+
+
+
+static void
+terminal_gdbus_metrics_unwatch (gpointer data)
+{
+  g_bus_unwatch_name (GPOINTER_TO_UINT (data));
+}
+
+
+
+static void
+terminal_gdbus_metrics_vanished (GDBusConnection *connection,
+                                 const gchar     *name,
+                                 gpointer         user_data)
+{
+  /* the client quit without unsubscribing */
+  if (metrics_subscribers != NULL)
+    g_hash_table_remove (metrics_subscribers, name);
+}
+
+
+
+static void
+terminal_gdbus_metrics_subscribe (GDBusConnection *connection,
+                                  const gchar     *sender,
+                                  gboolean         subscribe)
+{
+  guint watch_id;
+
+  if (!subscribe)
+    {
+      if (metrics_subscribers != NULL)
+        g_hash_table_remove (metrics_subscribers, sender);
+      return;
+    }
+
+  if (metrics_subscribers == NULL)
+    metrics_subscribers = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, terminal_gdbus_metrics_unwatch);
+
+  if (g_hash_table_contains (metrics_subscribers, sender))
+    return;
+
+  watch_id = g_bus_watch_name_on_connection (connection, sender,
+                                             G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                             NULL, terminal_gdbus_metrics_vanished,
+                                             NULL, NULL);
+  g_hash_table_insert (metrics_subscribers, g_strdup (sender), GUINT_TO_POINTER (watch_id));
+}
+
+
+
+static void
+terminal_gdbus_metrics_method_call (GDBusConnection       *connection,
+                                    const gchar           *sender,
+                                    const gchar           *object_path,
+                                    const gchar           *interface_name,
+                                    const gchar           *method_name,
+                                    GVariant              *parameters,
+                                    GDBusMethodInvocation *invocation,
+                                    gpointer               user_data)
+{
+  TerminalApp     *app = TERMINAL_APP (user_data);
+  GVariantBuilder  builder;
+  GSList          *lp;
+  GList           *children, *li;
+  gboolean         metrics;
+  guint            window_id, screen_id;
+  gchar           *title;
+
+  terminal_return_if_fail (TERMINAL_IS_APP (app));
+  terminal_return_if_fail (!g_strcmp0 (interface_name, TERMINAL_DBUS_METRICS_INTERFACE));
+
+  if (g_strcmp0 (method_name, "Subscribe") == 0
+      || g_strcmp0 (method_name, "Unsubscribe") == 0)
+    {
+      /* the Changed signal is only sent to subscribed clients */
+      terminal_gdbus_metrics_subscribe (connection, sender,
+                                        g_strcmp0 (method_name, "Subscribe") == 0);
+      g_dbus_method_invocation_return_value (invocation, NULL);
+      return;
+    }
+  else if (g_strcmp0 (method_name, "ListTerminals") == 0)
+    metrics = FALSE;
+  else if (g_strcmp0 (method_name, "GetMetrics") == 0)
+    metrics = TRUE;
+  else
+    {
+      g_dbus_method_invocation_return_error (invocation,
+          G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+          "Unknown method for DBus service " TERMINAL_DBUS_SERVICE);
+      return;
+    }
+
+  g_variant_builder_init (&builder, metrics ? G_VARIANT_TYPE ("a(uua{sv})") : G_VARIANT_TYPE ("a(uus)"));
+
+  /* only reads what the windows already know, nothing is changed */
+  for (lp = terminal_app_get_windows (app); lp != NULL; lp = lp->next)
+    {
+      window_id = terminal_window_get_id (lp->data);
+      children = gtk_container_get_children (GTK_CONTAINER (terminal_window_get_notebook (lp->data)));
+      for (li = children; li != NULL; li = li->next)
+        {
+          if (!TERMINAL_IS_SCREEN (li->data))
+            continue;
+
+          screen_id = terminal_screen_get_id (li->data);
+          if (metrics)
+            {
+              g_variant_builder_add (&builder, "(uu@a{sv})", window_id, screen_id,
+                                     terminal_gdbus_metrics_screen (li->data));
+            }
+          else
+            {
+              title = terminal_screen_get_title (li->data);
+              g_variant_builder_add (&builder, "(uus)", window_id, screen_id, title != NULL ? title : "");
+              g_free (title);
+            }
+        }
+      g_list_free (children);
+    }
+
+  if (metrics)
+    {
+      g_dbus_method_invocation_return_value (invocation,
+          g_variant_new ("(@a{sv}a(uua{sv}))", terminal_gdbus_metrics_global (), &builder));
+    }
+  else
+    {
+      g_dbus_method_invocation_return_value (invocation, g_variant_new ("(a(uus))", &builder));
+    }
+}
+
+
+
+static const GDBusInterfaceVTable terminal_gdbus_metrics_vtable =
+{
+  .method_call = terminal_gdbus_metrics_method_call,
+  .get_property = NULL,
+  .set_property = NULL
+};
+
+
+
+static gboolean
+terminal_gdbus_metrics_emit_changed (gpointer user_data)
+{
+  GHashTableIter  iter;
+  gpointer        name;
+
+  metrics_changed_id = 0;
+
+  if (metrics_connection == NULL || metrics_subscribers == NULL)
+    return FALSE;
+
+  /* unicast, clients that did not subscribe never wake up for it */
+  g_hash_table_iter_init (&iter, metrics_subscribers);
+  while (g_hash_table_iter_next (&iter, &name, NULL))
+    {
+      g_dbus_connection_emit_signal (metrics_connection, name,
+                                     TERMINAL_DBUS_PATH,
+                                     TERMINAL_DBUS_METRICS_INTERFACE,
+                                     "Changed", NULL, NULL);
+    }
+
+  return FALSE;
+}
+
+
+
+static TerminalScreen *
+terminal_gdbus_find_screen (TerminalApp *app,
+                            guint        id)
+{
+  TerminalScreen *screen = NULL;
+  GSList         *lp;
+  GList          *children, *li;
+
+  for (lp = terminal_app_get_windows (app); lp != NULL && screen == NULL; lp = lp->next)
+    {
+      children = gtk_container_get_children (GTK_CONTAINER (terminal_window_get_notebook (lp->data)));
+      for (li = children; li != NULL; li = li->next)
+        if (TERMINAL_IS_SCREEN (li->data) && terminal_screen_get_id (li->data) == id)
+          {
+            screen = li->data;
+            break;
+          }
+      g_list_free (children);
+    }
+
+  return screen;
+}
+
+
+
+static void
+terminal_gdbus_pipe_write_free (PipeWrite *pipe_write)
+{
+  /* closing the stream closes the pipe, the reader gets eof */
+  g_object_unref (G_OBJECT (pipe_write->stream));
+  g_free (pipe_write->text);
+  g_slice_free (PipeWrite, pipe_write);
+}
+
+
+
+static void
+terminal_gdbus_pipe_written (GObject      *object,
+                             GAsyncResult *result,
+                             gpointer      user_data)
+{
+  PipeWrite *pipe_write = user_data;
+  gssize     written;
+
+  written = g_output_stream_write_finish (G_OUTPUT_STREAM (object), result, NULL);
+  if (written > 0)
+    {
+      pipe_write->offset += written;
+      if (pipe_write->offset < pipe_write->length)
+        {
+          g_output_stream_write_async (pipe_write->stream,
+                                       pipe_write->text + pipe_write->offset,
+                                       MIN (pipe_write->length - pipe_write->offset, PIPE_CHUNK_SIZE),
+                                       G_PRIORITY_LOW, NULL,
+                                       terminal_gdbus_pipe_written, pipe_write);
+          return;
+        }
+    }
+
+  /* done, or the reader went away */
+  terminal_gdbus_pipe_write_free (pipe_write);
+}
+
+
+
+static void
+terminal_gdbus_return_text (GDBusMethodInvocation *invocation,
+                            gchar                 *text)
+{
+  PipeWrite   *pipe_write;
+  GUnixFDList *fd_list;
+  GError      *error = NULL;
+  gint         fds[2];
+
+  if (G_UNLIKELY (text == NULL))
+    {
+      g_dbus_method_invocation_return_error (invocation,
+          G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+          "Failed to read the text of the terminal");
+      return;
+    }
+
+  if (!g_unix_open_pipe (fds, FD_CLOEXEC, &error))
+    {
+      g_dbus_method_invocation_take_error (invocation, error);
+      g_free (text);
+      return;
+    }
+
+  /* the text can be much larger than a d-bus message, so the client
+   * gets the read end of a pipe that is filled from the main loop */
+  fd_list = g_unix_fd_list_new_from_array (&fds[0], 1);
+  g_dbus_method_invocation_return_value_with_unix_fd_list (invocation, g_variant_new ("(h)", 0), fd_list);
+  g_object_unref (G_OBJECT (fd_list));
+
+  g_unix_set_fd_nonblocking (fds[1], TRUE, NULL);
+
+  pipe_write = g_slice_new0 (PipeWrite);
+  pipe_write->stream = g_unix_output_stream_new (fds[1], TRUE);
+  pipe_write->text = text;
+  pipe_write->length = strlen (text);
+
+  if (pipe_write->length > 0)
+    {
+      g_output_stream_write_async (pipe_write->stream, pipe_write->text,
+                                   MIN (pipe_write->length, PIPE_CHUNK_SIZE),
+                                   G_PRIORITY_LOW, NULL,
+                                   terminal_gdbus_pipe_written, pipe_write);
+    }
+  else
+    {
+      terminal_gdbus_pipe_write_free (pipe_write);
+    }
+}
+
+
+
+static void
+terminal_gdbus_match_wait_free (MatchWait *wait)
+{
+  g_signal_handler_disconnect (G_OBJECT (wait->screen), wait->changed_id);
+  g_signal_handler_disconnect (G_OBJECT (wait->screen), wait->destroy_id);
+  if (wait->timeout_id != 0)
+    g_source_remove (wait->timeout_id);
+  g_regex_unref (wait->regex);
+  g_slice_free (MatchWait, wait);
+}
+
+
+
+static void
+terminal_gdbus_match_wait_check (MatchWait *wait)
+{
+  GMatchInfo *match_info;
+  gchar      *text, *match;
+
+  text = terminal_screen_get_text (wait->screen, -1, 0);
+  if (G_UNLIKELY (text == NULL))
+    return;
+
+  if (g_regex_match (wait->regex, text, 0, &match_info))
+    {
+      match = g_match_info_fetch (match_info, 0);
+      g_dbus_method_invocation_return_value (wait->invocation, g_variant_new ("(bs)", TRUE, match));
+      g_free (match);
+
+      terminal_gdbus_match_wait_free (wait);
+    }
+
+  g_match_info_free (match_info);
+  g_free (text);
+}
+
+
+
+static gboolean
+terminal_gdbus_match_wait_timeout (gpointer user_data)
+{
+  MatchWait *wait = user_data;
+
+  wait->timeout_id = 0;
+  g_dbus_method_invocation_return_value (wait->invocation, g_variant_new ("(bs)", FALSE, ""));
+  terminal_gdbus_match_wait_free (wait);
+
+  return FALSE;
+}
+
+
+
+static void
+terminal_gdbus_match_wait_destroyed (MatchWait *wait)
+{
+  g_dbus_method_invocation_return_error (wait->invocation,
+      G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+      "The terminal was closed");
+  terminal_gdbus_match_wait_free (wait);
+}
+
+
+
+static void
+terminal_gdbus_control_method_call (GDBusConnection       *connection,
+                                    const gchar           *sender,
+                                    const gchar           *object_path,
+                                    const gchar           *interface_name,
+                                    const gchar           *method_name,
+                                    GVariant              *parameters,
+                                    GDBusMethodInvocation *invocation,
+                                    gpointer               user_data)
+{
+  TerminalApp         *app = TERMINAL_APP (user_data);
+  TerminalPreferences *preferences;
+  TerminalScreen      *screen;
+  MatchWait           *wait;
+  GVariant            *data;
+  GRegex              *regex;
+  GError              *error = NULL;
+  gboolean             enabled;
+  const gchar         *pattern;
+  gconstpointer        bytes;
+  gsize                length;
+  guint                id, timeout;
+  gint64               first, count;
+
+  terminal_return_if_fail (TERMINAL_IS_APP (app));
+  terminal_return_if_fail (!g_strcmp0 (interface_name, TERMINAL_DBUS_CONTROL_INTERFACE));
+
+  /* typing into the terminals is only allowed if the user asked for it */
+  preferences = terminal_preferences_get ();
+  g_object_get (G_OBJECT (preferences), "misc-dbus-control", &enabled, NULL);
+  g_object_unref (G_OBJECT (preferences));
+  if (!enabled)
+    {
+      g_dbus_method_invocation_return_error (invocation,
+          G_DBUS_ERROR, G_DBUS_ERROR_ACCESS_DENIED,
+          "Remote control is disabled, set misc-dbus-control to enable it");
+      return;
+    }
+
+  g_variant_get_child (parameters, 0, "u", &id);
+  screen = terminal_gdbus_find_screen (app, id);
+  if (G_UNLIKELY (screen == NULL))
+    {
+      g_dbus_method_invocation_return_error (invocation,
+          G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+          "No terminal with id %u", id);
+      return;
+    }
+
+  if (g_strcmp0 (method_name, "SendInput") == 0)
+    {
+      data = g_variant_get_child_value (parameters, 1);
+      bytes = g_variant_get_fixed_array (data, &length, sizeof (guchar));
+      terminal_screen_send_input (screen, bytes, length);
+      g_variant_unref (data);
+
+      g_dbus_method_invocation_return_value (invocation, NULL);
+    }
+  else if (g_strcmp0 (method_name, "ReadScreen") == 0)
+    {
+      terminal_gdbus_return_text (invocation, terminal_screen_get_text (screen, -1, 0));
+    }
+  else if (g_strcmp0 (method_name, "ReadLines") == 0)
+    {
+      /* the text is extracted in one go, so a call is bounded; a count
+       * of 0 or above the limit returns the limit */
+      g_variant_get (parameters, "(uxx)", NULL, &first, &count);
+      if (count <= 0 || count > READ_LINES_MAX)
+        count = READ_LINES_MAX;
+      terminal_gdbus_return_text (invocation, terminal_screen_get_text (screen, MAX (first, 0), count));
+    }
+  else if (g_strcmp0 (method_name, "WaitForMatch") == 0)
+    {
+      g_variant_get (parameters, "(u&su)", NULL, &pattern, &timeout);
+
+      regex = g_regex_new (pattern, G_REGEX_MULTILINE | G_REGEX_OPTIMIZE, 0, &error);
+      if (G_UNLIKELY (regex == NULL))
+        {
+          g_dbus_method_invocation_return_error (invocation,
+              G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+              "%s", error->message);
+          g_error_free (error);
+          return;
+        }
+
+      /* the reply is sent when the screen shows a match, the main
+       * loop keeps running in the meantime */
+      wait = g_slice_new0 (MatchWait);
+      wait->invocation = invocation;
+      wait->screen = screen;
+      wait->regex = regex;
+      wait->changed_id = g_signal_connect_swapped (G_OBJECT (screen), "contents-changed",
+          G_CALLBACK (terminal_gdbus_match_wait_check), wait);
+      wait->destroy_id = g_signal_connect_swapped (G_OBJECT (screen), "destroy",
+          G_CALLBACK (terminal_gdbus_match_wait_destroyed), wait);
+      wait->timeout_id = gdk_threads_add_timeout (timeout, terminal_gdbus_match_wait_timeout, wait);
+
+      terminal_gdbus_match_wait_check (wait);
+    }
+  else
+    {
+      g_dbus_method_invocation_return_error (invocation,
+          G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+          "Unknown method for DBus service " TERMINAL_DBUS_SERVICE);
+    }
+}
+
+
+
+static const GDBusInterfaceVTable terminal_gdbus_control_vtable =
+{
+  .method_call = terminal_gdbus_control_method_call,
+  .get_property = NULL,
+  .set_property = NULL
+};
+
+
+
 static void
 terminal_gdbus_bus_acquired (GDBusConnection *connection,
                              const gchar     *name,
@@ -172,6 +805,43 @@ terminal_gdbus_bus_acquired (GDBusConnection *connection,
       g_error_free (error);
     }
 
+  terminal_assert (info->interfaces[1] != NULL);
+
+  register_id = g_dbus_connection_register_object (connection,
+                                                   TERMINAL_DBUS_PATH,
+                                                   info->interfaces[1], /* metrics iface */
+                                                   &terminal_gdbus_metrics_vtable,
+                                                   user_data,
+                                                   NULL,
+                                                   &error);
+
+  if (register_id == 0)
+    {
+      g_message ("Failed to register object: %s", error->message);
+      g_error_free (error);
+    }
+  else
+    {
+      metrics_connection = connection;
+      g_object_add_weak_pointer (G_OBJECT (connection), (gpointer) &metrics_connection);
+    }
+
+  terminal_assert (info->interfaces[2] != NULL);
+
+  register_id = g_dbus_connection_register_object (connection,
+                                                   TERMINAL_DBUS_PATH,
+                                                   info->interfaces[2], /* control iface */
+                                                   &terminal_gdbus_control_vtable,
+                                                   user_data,
+                                                   NULL,
+                                                   &error);
+
+  if (register_id == 0)
+    {
+      g_message ("Failed to register object: %s", error->message);
+      g_error_free (error);
+    }
+
   g_dbus_node_info_unref (info);
 }
 
@@ -248,3 +918,40 @@ terminal_gdbus_invoke_launch (gint     argc,
   return result;
 }
 
+
+
+/**
+ * terminal_gdbus_metrics_changed:
+ *
+ * Tells the clients of the metrics interface that the numbers
+ * changed. Called for every update of a terminal, the signal is
+ * emitted at most once a second and only to clients that called
+ * Subscribe and are still on the bus.
+ **/
+void
+terminal_gdbus_metrics_changed (void)
+{
+  if (metrics_connection == NULL || metrics_changed_id != 0
+      || metrics_subscribers == NULL || g_hash_table_size (metrics_subscribers) == 0)
+    return;
+
+  metrics_changed_id = gdk_threads_add_timeout (METRICS_CHANGED_INTERVAL,
+                                                terminal_gdbus_metrics_emit_changed,
+                                                NULL);
+}
+
+
+
+#ifdef G_ENABLE_DEBUG
+/**
+ * terminal_gdbus_get_request_time:
+ *
+ * Return value: The monotonic time the launch request that is being
+ *               processed arrived at, 0 outside a request.
+ **/
+gint64
+terminal_gdbus_get_request_time (void)
+{
+  return request_time;
+}
+#endif
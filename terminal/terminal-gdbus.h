@@ -30,6 +30,12 @@ gboolean  terminal_gdbus_invoke_launch     (gint          argc,
                                             gchar       **argv,
                                             GError      **error);
 
+void      terminal_gdbus_metrics_changed   (void);
+
+#ifdef G_ENABLE_DEBUG
+gint64    terminal_gdbus_get_request_time  (void);
+#endif
+
 G_END_DECLS
 
 #endif /* !TERMINAL_GDBUS_H */
@@ -68,6 +68,10 @@ struct _TerminalImageLoader
   GdkRGBA                  bgcolor;
   GdkPixbuf               *pixbuf;
   TerminalBackgroundStyle  style;
+
+  /* lookups answered from and added to the cache */
+  guint                    n_hits;
+  guint                    n_misses;
 };
 
 
@@ -401,10 +405,13 @@ terminal_image_loader_load (TerminalImageLoader *loader,
       if ((w == width && h == height) ||
           (w >= width && h >= height && loader->style == TERMINAL_BACKGROUND_STYLE_TILED))
         {
+          loader->n_hits++;
           return GDK_PIXBUF (g_object_ref (G_OBJECT (pixbuf)));
         }
     }
 
+  loader->n_misses++;
+
   pixbuf = gdk_pixbuf_new (gdk_pixbuf_get_colorspace (loader->pixbuf),
                            gdk_pixbuf_get_has_alpha (loader->pixbuf),
                            gdk_pixbuf_get_bits_per_sample (loader->pixbuf),
@@ -438,3 +445,43 @@ terminal_image_loader_load (TerminalImageLoader *loader,
 }
 
 
+
+
+
+/**
+ * terminal_image_loader_get_stats:
+ * @loader   : A #TerminalImageLoader.
+ * @n_images : Return location for the number of cached images.
+ * @size     : Return location for the bytes of pixel data they hold.
+ * @n_hits   : Return location for the lookups found in the cache.
+ * @n_misses : Return location for the lookups that drew a new image.
+ **/
+void
+terminal_image_loader_get_stats (TerminalImageLoader *loader,
+                                 guint               *n_images,
+                                 gsize               *size,
+                                 guint               *n_hits,
+                                 guint               *n_misses)
+{
+  GSList    *lists[2], *lp;
+  GdkPixbuf *pixbuf;
+  guint      n;
+
+  terminal_return_if_fail (TERMINAL_IS_IMAGE_LOADER (loader));
+
+  *n_images = 0;
+  *size = 0;
+
+  lists[0] = loader->cache;
+  lists[1] = loader->cache_invalid;
+  for (n = 0; n < G_N_ELEMENTS (lists); n++)
+    for (lp = lists[n]; lp != NULL; lp = lp->next)
+      {
+        pixbuf = GDK_PIXBUF (lp->data);
+        *size += (gsize) gdk_pixbuf_get_rowstride (pixbuf) * gdk_pixbuf_get_height (pixbuf);
+        *n_images += 1;
+      }
+
+  *n_hits = loader->n_hits;
+  *n_misses = loader->n_misses;
+}
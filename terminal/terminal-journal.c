@@ -0,0 +1,1067 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_SYS_FILE_H
+#include <sys/file.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include <terminal/terminal-journal.h>
+#include <terminal/terminal-private.h>
+#include <terminal/terminal-scrollback.h>
+
+/* seconds between two scans for new output and directory changes */
+#define JOURNAL_INTERVAL     (5)
+/* bytes written per second on average, the writer waits above it */
+#define JOURNAL_RATE         (32 * 1024)
+/* size at which the journal is rewritten from the current state */
+#define JOURNAL_MAX_SIZE     (4 * 1024 * 1024)
+/* items waiting for the writer before new output is held back */
+#define JOURNAL_QUEUE_LENGTH (256)
+/* history per tab kept on recovery */
+#define JOURNAL_HISTORY_SIZE (1024 * 1024)
+
+
+
+enum
+{
+  RECORD_WINDOW_OPEN = 1,
+  RECORD_WINDOW_CLOSE,
+  RECORD_WINDOW_SIZE,
+  RECORD_TAB_OPEN,
+  RECORD_TAB_CLOSE,
+  RECORD_TAB_MOVE,
+  RECORD_TAB_DIRECTORY,
+  RECORD_TAB_TITLE,
+  RECORD_TAB_SCROLLBACK,
+
+  /* never written, only for the writer thread */
+  RECORD_RESET,
+  RECORD_QUIT
+};
+
+/* Each record in the file is this header followed by size bytes of
+ * payload: a string, 32-bit numbers or a compressed chunk of output.
+ * A record cut short by a crash ends the journal. */
+typedef struct
+{
+  guint32 size;
+  guint32 type;
+  guint32 window;
+  guint32 tab;
+} JournalRecord;
+
+typedef struct
+{
+  guint32  type;
+  guint32  window;
+  guint32  tab;
+  GBytes  *payload;
+} JournalItem;
+
+typedef struct
+{
+  guint32  id;
+  glong    columns;
+  glong    rows;
+} JournalWindow;
+
+typedef struct
+{
+  guint32  id;
+  glong    row;
+  gchar   *directory;
+  gchar   *title;
+} JournalTab;
+
+struct _TerminalJournal
+{
+  gint           fd;
+  gchar         *filename;
+
+  GThread       *writer;
+  GAsyncQueue   *queue;
+  volatile gint  size;
+
+  /* wakes the writer from its rate wait when the journal is freed */
+  GMutex         lock;
+  GCond          cond;
+  gboolean       closing;
+
+  guint          scan_id;
+  guint32        last_id;
+
+  /* TerminalWindow to JournalWindow, TerminalScreen to JournalTab */
+  GHashTable    *windows;
+  GHashTable    *tabs;
+};
+
+typedef struct
+{
+  TerminalWindowAttr *attr;
+  GPtrArray          *tabs;
+} RecoverWindow;
+
+typedef struct
+{
+  TerminalTabAttr *attr;
+  GString         *history;
+  RecoverWindow   *window;
+} RecoverTab;
+
+
+
+static void           terminal_journal_push                (TerminalJournal *journal,
+                                                            guint32          type,
+                                                            guint32          window,
+                                                            guint32          tab,
+                                                            GBytes          *payload);
+static void           terminal_journal_push_string         (TerminalJournal *journal,
+                                                            guint32          type,
+                                                            guint32          window,
+                                                            guint32          tab,
+                                                            const gchar     *str);
+static void           terminal_journal_push_numbers        (TerminalJournal *journal,
+                                                            guint32          type,
+                                                            guint32          window,
+                                                            guint32          tab,
+                                                            guint32          first,
+                                                            guint32          second);
+static gpointer       terminal_journal_writer              (gpointer         data);
+static gboolean       terminal_journal_write               (gint             fd,
+                                                            gconstpointer    data,
+                                                            gsize            size);
+static JournalWindow *terminal_journal_find_window         (TerminalJournal *journal,
+                                                            GtkWidget       *widget);
+static void           terminal_journal_page_added          (GtkNotebook     *notebook,
+                                                            GtkWidget       *child,
+                                                            guint            page_num,
+                                                            TerminalJournal *journal);
+static void           terminal_journal_page_removed        (GtkNotebook     *notebook,
+                                                            GtkWidget       *child,
+                                                            guint            page_num,
+                                                            TerminalJournal *journal);
+static void           terminal_journal_page_reordered      (GtkNotebook     *notebook,
+                                                            GtkWidget       *child,
+                                                            guint            page_num,
+                                                            TerminalJournal *journal);
+static void           terminal_journal_notify_title        (TerminalScreen  *screen,
+                                                            GParamSpec      *pspec,
+                                                            TerminalJournal *journal);
+static void           terminal_journal_tab_finalized       (gpointer         data,
+                                                            GObject         *where_the_object_was);
+static void           terminal_journal_window_destroyed    (GtkWidget       *window,
+                                                            TerminalJournal *journal);
+static gboolean       terminal_journal_scan                (gpointer         data);
+static void           terminal_journal_item_free           (gpointer         data);
+static void           terminal_journal_tab_free            (gpointer         data);
+static void           terminal_journal_recover_tab_remove  (RecoverTab      *tab);
+static void           terminal_journal_recover_tab_free    (gpointer         data);
+static void           terminal_journal_recover_window_free (gpointer         data);
+static GSList        *terminal_journal_parse               (const guint8    *data,
+                                                            gsize            size);
+
+
+
+static void
+terminal_journal_push (TerminalJournal *journal,
+                       guint32          type,
+                       guint32          window,
+                       guint32          tab,
+                       GBytes          *payload)
+{
+  JournalItem *item;
+
+  item = g_slice_new (JournalItem);
+  item->type = type;
+  item->window = window;
+  item->tab = tab;
+  item->payload = payload;
+
+  g_async_queue_push (journal->queue, item);
+}
+
+
+
+static void
+terminal_journal_push_string (TerminalJournal *journal,
+                              guint32          type,
+                              guint32          window,
+                              guint32          tab,
+                              const gchar     *str)
+{
+  terminal_journal_push (journal, type, window, tab,
+                         g_bytes_new (str, str != NULL ? strlen (str) : 0));
+}
+
+
+
+static void
+terminal_journal_push_numbers (TerminalJournal *journal,
+                               guint32          type,
+                               guint32          window,
+                               guint32          tab,
+                               guint32          first,
+                               guint32          second)
+{
+  guint32 numbers[2] = { first, second };
+
+  terminal_journal_push (journal, type, window, tab, g_bytes_new (numbers, sizeof (numbers)));
+}
+
+
+
+static gpointer
+terminal_journal_writer (gpointer data)
+{
+  TerminalJournal *journal = data;
+  JournalItem     *item;
+  JournalRecord    record;
+  GBytes          *payload;
+  gint64           now, last = g_get_monotonic_time ();
+  gint64           tokens = JOURNAL_RATE;
+  gint64           end_time;
+  gsize            size;
+  gboolean         closing;
+
+  for (;;)
+    {
+      item = g_async_queue_pop (journal->queue);
+      if (item->type == RECORD_QUIT)
+        {
+          terminal_journal_item_free (item);
+          break;
+        }
+
+      /* nothing is worth a delay on a clean exit */
+      g_mutex_lock (&journal->lock);
+      closing = journal->closing;
+      g_mutex_unlock (&journal->lock);
+      if (closing)
+        {
+          terminal_journal_item_free (item);
+          continue;
+        }
+
+      if (item->type == RECORD_RESET)
+        {
+          /* the file is opened for appending, writes continue at 0 */
+          if (ftruncate (journal->fd, 0) == 0)
+            g_atomic_int_set (&journal->size, 0);
+          terminal_journal_item_free (item);
+          continue;
+        }
+
+      if (item->type == RECORD_TAB_SCROLLBACK)
+        payload = terminal_scrollback_compress (item->payload, NULL);
+      else
+        payload = g_bytes_ref (item->payload);
+
+      if (G_LIKELY (payload != NULL))
+        {
+          record.size = g_bytes_get_size (payload);
+          record.type = item->type;
+          record.window = item->window;
+          record.tab = item->tab;
+          size = sizeof (record) + record.size;
+
+          /* token bucket: bursts up to a second worth of writes, then
+           * wait until the average is back under the rate */
+          now = g_get_monotonic_time ();
+          tokens = MIN (tokens + (now - last) * JOURNAL_RATE / G_USEC_PER_SEC, JOURNAL_RATE);
+          last = now;
+          if (tokens < (gint64) size)
+            {
+              end_time = now + (size - tokens) * G_USEC_PER_SEC / JOURNAL_RATE;
+
+              g_mutex_lock (&journal->lock);
+              while (!journal->closing
+                     && g_cond_wait_until (&journal->cond, &journal->lock, end_time));
+              closing = journal->closing;
+              g_mutex_unlock (&journal->lock);
+
+              tokens = size;
+              last = g_get_monotonic_time ();
+            }
+          tokens -= size;
+
+          if (!closing
+              && terminal_journal_write (journal->fd, &record, sizeof (record))
+              && terminal_journal_write (journal->fd, g_bytes_get_data (payload, NULL), record.size))
+            g_atomic_int_add (&journal->size, size);
+
+          g_bytes_unref (payload);
+        }
+
+      terminal_journal_item_free (item);
+    }
+
+  return NULL;
+}
+
+
+
+static gboolean
+terminal_journal_write (gint          fd,
+                        gconstpointer data,
+                        gsize         size)
+{
+  const gchar *p = data;
+  gssize       n;
+
+  while (size > 0)
+    {
+      n = write (fd, p, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return FALSE;
+
+      p += n;
+      size -= n;
+    }
+
+  return TRUE;
+}
+
+
+
+static JournalWindow *
+terminal_journal_find_window (TerminalJournal *journal,
+                              GtkWidget       *widget)
+{
+  return g_hash_table_lookup (journal->windows, gtk_widget_get_toplevel (widget));
+}
+
+
+
+static void
+terminal_journal_page_added (GtkNotebook     *notebook,
+                             GtkWidget       *child,
+                             guint            page_num,
+                             TerminalJournal *journal)
+{
+  JournalWindow *window;
+  JournalTab    *tab;
+
+  window = terminal_journal_find_window (journal, GTK_WIDGET (notebook));
+  if (G_UNLIKELY (window == NULL || !TERMINAL_IS_SCREEN (child)))
+    return;
+
+  /* a tab moved from another window keeps its id */
+  tab = g_hash_table_lookup (journal->tabs, child);
+  if (tab == NULL)
+    {
+      tab = g_slice_new0 (JournalTab);
+      tab->id = ++journal->last_id;
+      g_hash_table_insert (journal->tabs, child, tab);
+
+      g_object_weak_ref (G_OBJECT (child), terminal_journal_tab_finalized, journal);
+      g_signal_connect (G_OBJECT (child), "notify::title",
+                        G_CALLBACK (terminal_journal_notify_title), journal);
+    }
+
+  terminal_journal_push_numbers (journal, RECORD_TAB_OPEN, window->id, tab->id, page_num, 0);
+  terminal_journal_notify_title (TERMINAL_SCREEN (child), NULL, journal);
+}
+
+
+
+static void
+terminal_journal_page_removed (GtkNotebook     *notebook,
+                               GtkWidget       *child,
+                               guint            page_num,
+                               TerminalJournal *journal)
+{
+  JournalWindow *window;
+  JournalTab    *tab;
+
+  window = terminal_journal_find_window (journal, GTK_WIDGET (notebook));
+  tab = g_hash_table_lookup (journal->tabs, child);
+  if (window != NULL && tab != NULL)
+    terminal_journal_push (journal, RECORD_TAB_CLOSE, window->id, tab->id, g_bytes_new (NULL, 0));
+}
+
+
+
+static void
+terminal_journal_page_reordered (GtkNotebook     *notebook,
+                                 GtkWidget       *child,
+                                 guint            page_num,
+                                 TerminalJournal *journal)
+{
+  JournalWindow *window;
+  JournalTab    *tab;
+
+  window = terminal_journal_find_window (journal, GTK_WIDGET (notebook));
+  tab = g_hash_table_lookup (journal->tabs, child);
+  if (window != NULL && tab != NULL)
+    terminal_journal_push_numbers (journal, RECORD_TAB_MOVE, window->id, tab->id, page_num, 0);
+}
+
+
+
+static void
+terminal_journal_notify_title (TerminalScreen  *screen,
+                               GParamSpec      *pspec,
+                               TerminalJournal *journal)
+{
+  JournalWindow *window;
+  JournalTab    *tab;
+  gchar         *title;
+
+  window = terminal_journal_find_window (journal, GTK_WIDGET (screen));
+  tab = g_hash_table_lookup (journal->tabs, screen);
+  if (window == NULL || tab == NULL)
+    return;
+
+  /* shells update the title with every prompt */
+  title = terminal_screen_get_title (screen);
+  if (g_strcmp0 (title, tab->title) != 0)
+    {
+      terminal_journal_push_string (journal, RECORD_TAB_TITLE, window->id, tab->id, title);
+      g_free (tab->title);
+      tab->title = title;
+    }
+  else
+    g_free (title);
+}
+
+
+
+static void
+terminal_journal_tab_finalized (gpointer  data,
+                                GObject  *where_the_object_was)
+{
+  TerminalJournal *journal = data;
+
+  g_hash_table_remove (journal->tabs, where_the_object_was);
+}
+
+
+
+static void
+terminal_journal_window_destroyed (GtkWidget       *window,
+                                   TerminalJournal *journal)
+{
+  JournalWindow *entry;
+
+  entry = g_hash_table_lookup (journal->windows, window);
+  if (G_UNLIKELY (entry == NULL))
+    return;
+
+  terminal_journal_push (journal, RECORD_WINDOW_CLOSE, entry->id, 0, g_bytes_new (NULL, 0));
+
+  g_signal_handlers_disconnect_by_data (G_OBJECT (terminal_window_get_notebook (TERMINAL_WINDOW (window))), journal);
+  g_signal_handlers_disconnect_by_data (G_OBJECT (window), journal);
+  g_hash_table_remove (journal->windows, window);
+}
+
+
+
+static gboolean
+terminal_journal_scan (gpointer data)
+{
+  TerminalJournal *journal = data;
+  GHashTableIter   iter;
+  gpointer         key, value;
+  JournalWindow   *window;
+  JournalTab      *tab;
+  GtkWidget       *notebook;
+  TerminalScreen  *screen;
+  const gchar     *directory;
+  gchar           *text, *start;
+  gsize            length, limit;
+  glong            columns, rows;
+  gint             n;
+
+  /* the writer is behind, it keeps the rate */
+  if (g_async_queue_length (journal->queue) > JOURNAL_QUEUE_LENGTH)
+    return TRUE;
+
+  if (g_atomic_int_get (&journal->size) > JOURNAL_MAX_SIZE)
+    {
+      /* start over from the current state and recent output */
+      terminal_journal_push (journal, RECORD_RESET, 0, 0, g_bytes_new (NULL, 0));
+
+      g_hash_table_iter_init (&iter, journal->windows);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        {
+          window = value;
+          window->columns = window->rows = 0;
+          terminal_journal_push (journal, RECORD_WINDOW_OPEN, window->id, 0, g_bytes_new (NULL, 0));
+
+          notebook = terminal_window_get_notebook (TERMINAL_WINDOW (key));
+          for (n = 0; n < gtk_notebook_get_n_pages (GTK_NOTEBOOK (notebook)); n++)
+            {
+              tab = g_hash_table_lookup (journal->tabs, gtk_notebook_get_nth_page (GTK_NOTEBOOK (notebook), n));
+              if (tab == NULL)
+                continue;
+
+              terminal_journal_push_numbers (journal, RECORD_TAB_OPEN, window->id, tab->id, n, 0);
+              terminal_journal_push_string (journal, RECORD_TAB_TITLE, window->id, tab->id, tab->title);
+
+              g_free (tab->directory);
+              tab->directory = NULL;
+              tab->row = 0;
+            }
+        }
+    }
+
+  g_hash_table_iter_init (&iter, journal->windows);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      window = value;
+      screen = terminal_window_get_active (TERMINAL_WINDOW (key));
+      if (screen == NULL)
+        continue;
+
+      terminal_screen_get_size (screen, &columns, &rows);
+      if (columns != window->columns || rows != window->rows)
+        {
+          terminal_journal_push_numbers (journal, RECORD_WINDOW_SIZE, window->id, 0, columns, rows);
+          window->columns = columns;
+          window->rows = rows;
+        }
+    }
+
+  /* share the rate between the tabs, only the latest output of a busy
+   * tab is written */
+  limit = JOURNAL_RATE * JOURNAL_INTERVAL / MAX (g_hash_table_size (journal->tabs), 1);
+
+  g_hash_table_iter_init (&iter, journal->tabs);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      tab = value;
+      window = terminal_journal_find_window (journal, GTK_WIDGET (key));
+      if (window == NULL)
+        continue;
+
+      directory = terminal_screen_get_working_directory (TERMINAL_SCREEN (key));
+      if (directory != NULL && g_strcmp0 (directory, tab->directory) != 0)
+        {
+          terminal_journal_push_string (journal, RECORD_TAB_DIRECTORY, window->id, tab->id, directory);
+          g_free (tab->directory);
+          tab->directory = g_strdup (directory);
+        }
+
+      /* a row holds at least a column worth of bytes, so rows further
+       * back would be cut below anyway; this keeps the first scan and
+       * the one after a reset from extracting the whole scrollback */
+      terminal_screen_get_size (TERMINAL_SCREEN (key), &columns, &rows);
+      text = terminal_screen_get_lines_since (TERMINAL_SCREEN (key), &tab->row,
+                                              limit / MAX (columns, 1) + 1);
+      if (text == NULL)
+        continue;
+
+      length = strlen (text);
+      start = text;
+      if (length > limit)
+        {
+          /* cut at a line start */
+          start = strchr (text + length - limit, '\n');
+          start = start != NULL ? start + 1 : text + length;
+          length -= start - text;
+        }
+
+      if (length > 0)
+        terminal_journal_push (journal, RECORD_TAB_SCROLLBACK, window->id, tab->id,
+                               g_bytes_new (start, length));
+      g_free (text);
+    }
+
+  return TRUE;
+}
+
+
+
+static void
+terminal_journal_item_free (gpointer data)
+{
+  JournalItem *item = data;
+
+  if (item->payload != NULL)
+    g_bytes_unref (item->payload);
+  g_slice_free (JournalItem, item);
+}
+
+
+
+static void
+terminal_journal_tab_free (gpointer data)
+{
+  JournalTab *tab = data;
+
+  g_free (tab->directory);
+  g_free (tab->title);
+  g_slice_free (JournalTab, tab);
+}
+
+
+
+/**
+ * terminal_journal_new:
+ * @error : Return location for errors or %NULL.
+ *
+ * Creates the crash-recovery journal of this process. Changes to the
+ * windows and tabs added with terminal_journal_add_window() are
+ * appended to it by a writer thread, new output is collected every
+ * few seconds. The writer keeps the average write rate under a fixed
+ * budget. The journal is removed by terminal_journal_free(), so only
+ * a crashed process leaves it behind.
+ *
+ * Return value: A new #TerminalJournal or %NULL on error.
+ **/
+TerminalJournal *
+terminal_journal_new (GError **error)
+{
+  TerminalJournal *journal;
+  gchar           *dirname;
+  gchar           *name;
+  gint             fd;
+
+  dirname = g_build_filename (g_get_user_cache_dir (), "xfce4", "terminal", NULL);
+  g_mkdir_with_parents (dirname, 0700);
+  name = g_strdup_printf ("journal-%d.bin", (gint) getpid ());
+
+  journal = g_slice_new0 (TerminalJournal);
+  journal->filename = g_build_filename (dirname, name, NULL);
+  g_free (dirname);
+  g_free (name);
+
+  /* no O_TRUNC: with a reused pid the file may be the journal of a
+   * crashed instance, which is only emptied once we hold the lock */
+  fd = g_open (journal->filename, O_WRONLY | O_CREAT | O_APPEND, 0600);
+  if (G_UNLIKELY (fd == -1))
+    {
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                   "%s: %s", journal->filename, g_strerror (errno));
+      g_free (journal->filename);
+      g_slice_free (TerminalJournal, journal);
+      return NULL;
+    }
+
+  /* keep it from the children, the lock tells others we are alive;
+   * without it another instance would recover the journal while we
+   * still write it */
+  fcntl (fd, F_SETFD, FD_CLOEXEC);
+  if (G_UNLIKELY (flock (fd, LOCK_EX | LOCK_NB) != 0 || ftruncate (fd, 0) != 0))
+    {
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                   "%s: %s", journal->filename, g_strerror (errno));
+      close (fd);
+      g_free (journal->filename);
+      g_slice_free (TerminalJournal, journal);
+      return NULL;
+    }
+  journal->fd = fd;
+
+  g_mutex_init (&journal->lock);
+  g_cond_init (&journal->cond);
+
+  journal->queue = g_async_queue_new_full (terminal_journal_item_free);
+  journal->windows = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+  journal->tabs = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, terminal_journal_tab_free);
+
+  journal->writer = g_thread_try_new ("journal", terminal_journal_writer, journal, error);
+  if (G_UNLIKELY (journal->writer == NULL))
+    {
+      terminal_journal_free (journal);
+      return NULL;
+    }
+
+  journal->scan_id = gdk_threads_add_timeout_seconds_full (G_PRIORITY_LOW, JOURNAL_INTERVAL,
+                                                           terminal_journal_scan, journal, NULL);
+
+  return journal;
+}
+
+
+
+/**
+ * terminal_journal_free:
+ * @journal : A #TerminalJournal.
+ *
+ * Stops the journal and removes its file.
+ **/
+void
+terminal_journal_free (TerminalJournal *journal)
+{
+  GHashTableIter iter;
+  gpointer       key;
+
+  terminal_return_if_fail (journal != NULL);
+
+  if (journal->scan_id != 0)
+    g_source_remove (journal->scan_id);
+
+  g_hash_table_iter_init (&iter, journal->windows);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      g_signal_handlers_disconnect_by_data (G_OBJECT (terminal_window_get_notebook (key)), journal);
+      g_signal_handlers_disconnect_by_data (G_OBJECT (key), journal);
+    }
+
+  g_hash_table_iter_init (&iter, journal->tabs);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      g_object_weak_unref (G_OBJECT (key), terminal_journal_tab_finalized, journal);
+      g_signal_handlers_disconnect_by_data (G_OBJECT (key), journal);
+    }
+
+  if (journal->writer != NULL)
+    {
+      g_mutex_lock (&journal->lock);
+      journal->closing = TRUE;
+      g_cond_signal (&journal->cond);
+      g_mutex_unlock (&journal->lock);
+
+      terminal_journal_push (journal, RECORD_QUIT, 0, 0, NULL);
+      g_thread_join (journal->writer);
+    }
+
+  close (journal->fd);
+  g_unlink (journal->filename);
+
+  g_async_queue_unref (journal->queue);
+  g_mutex_clear (&journal->lock);
+  g_cond_clear (&journal->cond);
+  g_hash_table_destroy (journal->windows);
+  g_hash_table_destroy (journal->tabs);
+  g_free (journal->filename);
+  g_slice_free (TerminalJournal, journal);
+}
+
+
+
+/**
+ * terminal_journal_add_window:
+ * @journal : A #TerminalJournal.
+ * @window  : A #TerminalWindow.
+ *
+ * Records @window and its tabs in @journal until it is destroyed.
+ **/
+void
+terminal_journal_add_window (TerminalJournal *journal,
+                             TerminalWindow  *window)
+{
+  JournalWindow *entry;
+  GtkWidget     *notebook;
+  gint           n;
+
+  terminal_return_if_fail (journal != NULL);
+  terminal_return_if_fail (TERMINAL_IS_WINDOW (window));
+
+  if (g_hash_table_contains (journal->windows, window))
+    return;
+
+  entry = g_new0 (JournalWindow, 1);
+  entry->id = ++journal->last_id;
+  g_hash_table_insert (journal->windows, window, entry);
+
+  terminal_journal_push (journal, RECORD_WINDOW_OPEN, entry->id, 0, g_bytes_new (NULL, 0));
+
+  g_signal_connect (G_OBJECT (window), "destroy",
+                    G_CALLBACK (terminal_journal_window_destroyed), journal);
+
+  notebook = terminal_window_get_notebook (window);
+  g_signal_connect (G_OBJECT (notebook), "page-added",
+                    G_CALLBACK (terminal_journal_page_added), journal);
+  g_signal_connect (G_OBJECT (notebook), "page-removed",
+                    G_CALLBACK (terminal_journal_page_removed), journal);
+  g_signal_connect (G_OBJECT (notebook), "page-reordered",
+                    G_CALLBACK (terminal_journal_page_reordered), journal);
+
+  for (n = 0; n < gtk_notebook_get_n_pages (GTK_NOTEBOOK (notebook)); n++)
+    terminal_journal_page_added (GTK_NOTEBOOK (notebook),
+                                 gtk_notebook_get_nth_page (GTK_NOTEBOOK (notebook), n),
+                                 n, journal);
+}
+
+
+
+static void
+terminal_journal_recover_tab_remove (RecoverTab *tab)
+{
+  if (tab->window != NULL)
+    {
+      g_ptr_array_remove (tab->window->tabs, tab);
+      tab->window = NULL;
+    }
+}
+
+
+
+static void
+terminal_journal_recover_tab_free (gpointer data)
+{
+  RecoverTab *tab = data;
+
+  if (tab->attr != NULL)
+    terminal_tab_attr_free (tab->attr);
+  g_string_free (tab->history, TRUE);
+  g_slice_free (RecoverTab, tab);
+}
+
+
+
+static void
+terminal_journal_recover_window_free (gpointer data)
+{
+  RecoverWindow *window = data;
+  guint          n;
+
+  for (n = 0; n < window->tabs->len; n++)
+    ((RecoverTab *) g_ptr_array_index (window->tabs, n))->window = NULL;
+  g_ptr_array_free (window->tabs, TRUE);
+
+  if (window->attr != NULL)
+    terminal_window_attr_free (window->attr);
+  g_slice_free (RecoverWindow, window);
+}
+
+
+
+static GSList *
+terminal_journal_parse (const guint8 *data,
+                        gsize         size)
+{
+  JournalRecord  record;
+  GHashTable    *windows, *tabs;
+  GPtrArray     *order;
+  RecoverWindow *window;
+  RecoverTab    *tab;
+  GSList        *window_attrs = NULL;
+  GBytes        *bytes, *text;
+  const gchar   *payload, *end;
+  guint32        numbers[2];
+  gsize          offset, cut;
+  guint          n, m;
+
+  /* the windows array owns them, the hash tables only look up */
+  order = g_ptr_array_new_with_free_func (terminal_journal_recover_window_free);
+  windows = g_hash_table_new (g_direct_hash, g_direct_equal);
+  tabs = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, terminal_journal_recover_tab_free);
+
+  for (offset = 0; size - offset >= sizeof (record); offset += sizeof (record) + record.size)
+    {
+      memcpy (&record, data + offset, sizeof (record));
+      if (record.size > size - offset - sizeof (record))
+        break;
+
+      payload = (const gchar *) data + offset + sizeof (record);
+      memset (numbers, 0, sizeof (numbers));
+      memcpy (numbers, payload, MIN (record.size, sizeof (numbers)));
+
+      if (record.type == RECORD_WINDOW_OPEN)
+        {
+          if (g_hash_table_contains (windows, GUINT_TO_POINTER (record.window)))
+            continue;
+
+          window = g_slice_new0 (RecoverWindow);
+          window->attr = terminal_window_attr_new ();
+          g_slist_free_full (window->attr->tabs, (GDestroyNotify) terminal_tab_attr_free);
+          window->attr->tabs = NULL;
+          window->tabs = g_ptr_array_new ();
+          g_ptr_array_add (order, window);
+          g_hash_table_insert (windows, GUINT_TO_POINTER (record.window), window);
+          continue;
+        }
+
+      window = g_hash_table_lookup (windows, GUINT_TO_POINTER (record.window));
+      if (window == NULL)
+        continue;
+
+      if (record.type == RECORD_WINDOW_CLOSE)
+        {
+          g_hash_table_remove (windows, GUINT_TO_POINTER (record.window));
+          g_ptr_array_remove (order, window);
+          continue;
+        }
+      else if (record.type == RECORD_WINDOW_SIZE)
+        {
+          g_free (window->attr->geometry);
+          window->attr->geometry = g_strdup_printf ("%ux%u", numbers[0], numbers[1]);
+          continue;
+        }
+
+      tab = g_hash_table_lookup (tabs, GUINT_TO_POINTER (record.tab));
+      if (tab == NULL)
+        {
+          if (record.type != RECORD_TAB_OPEN)
+            continue;
+
+          tab = g_slice_new0 (RecoverTab);
+          tab->attr = terminal_tab_attr_new ();
+          tab->history = g_string_new (NULL);
+          g_hash_table_insert (tabs, GUINT_TO_POINTER (record.tab), tab);
+        }
+
+      switch (record.type)
+        {
+        case RECORD_TAB_OPEN:
+        case RECORD_TAB_MOVE:
+          terminal_journal_recover_tab_remove (tab);
+          tab->window = window;
+          g_ptr_array_insert (window->tabs, MIN (numbers[0], window->tabs->len), tab);
+          break;
+
+        case RECORD_TAB_CLOSE:
+          terminal_journal_recover_tab_remove (tab);
+          break;
+
+        case RECORD_TAB_DIRECTORY:
+          g_free (tab->attr->directory);
+          tab->attr->directory = g_strndup (payload, record.size);
+          break;
+
+        case RECORD_TAB_TITLE:
+          /* as initial title, so the shell can still change it */
+          g_free (tab->attr->initial_title);
+          tab->attr->initial_title = record.size > 0 ? g_strndup (payload, record.size) : NULL;
+          break;
+
+        case RECORD_TAB_SCROLLBACK:
+          bytes = g_bytes_new_static (payload, record.size);
+          text = terminal_scrollback_decompress (bytes, NULL);
+          g_bytes_unref (bytes);
+          if (text == NULL)
+            break;
+
+          g_string_append_len (tab->history, g_bytes_get_data (text, NULL), g_bytes_get_size (text));
+          g_bytes_unref (text);
+
+          if (tab->history->len > JOURNAL_HISTORY_SIZE)
+            {
+              /* drop the oldest lines */
+              cut = tab->history->len - JOURNAL_HISTORY_SIZE;
+              end = memchr (tab->history->str + cut, '\n', JOURNAL_HISTORY_SIZE);
+              g_string_erase (tab->history, 0, end != NULL ? end + 1 - tab->history->str : (gssize) cut);
+            }
+          break;
+        }
+    }
+
+  for (n = 0; n < order->len; n++)
+    {
+      window = g_ptr_array_index (order, n);
+      if (window->tabs->len == 0)
+        continue;
+
+      for (m = 0; m < window->tabs->len; m++)
+        {
+          tab = g_ptr_array_index (window->tabs, m);
+          if (tab->history->len > 0)
+            {
+              bytes = g_bytes_new (tab->history->str, tab->history->len);
+              tab->attr->scrollback = terminal_scrollback_compress (bytes, NULL);
+              g_bytes_unref (bytes);
+            }
+
+          window->attr->tabs = g_slist_prepend (window->attr->tabs, tab->attr);
+          tab->attr = NULL;
+        }
+
+      window->attr->tabs = g_slist_reverse (window->attr->tabs);
+      window_attrs = g_slist_prepend (window_attrs, window->attr);
+      window->attr = NULL;
+    }
+
+  g_hash_table_destroy (windows);
+  g_hash_table_destroy (tabs);
+  g_ptr_array_free (order, TRUE);
+
+  return g_slist_reverse (window_attrs);
+}
+
+
+
+/**
+ * terminal_journal_recover:
+ *
+ * Looks for journals of crashed processes, which are no longer locked,
+ * and removes them.
+ *
+ * Return value: List of #TerminalWindowAttr with the windows and tabs
+ *               of the crashed processes, including their recent
+ *               output.
+ **/
+GSList *
+terminal_journal_recover (void)
+{
+  GSList      *window_attrs = NULL;
+  GDir        *dir;
+  const gchar *name;
+  gchar       *dirname;
+  gchar       *filename;
+  gchar       *contents;
+  gsize        length;
+  gint         fd;
+
+  dirname = g_build_filename (g_get_user_cache_dir (), "xfce4", "terminal", NULL);
+  dir = g_dir_open (dirname, 0, NULL);
+  if (dir == NULL)
+    {
+      g_free (dirname);
+      return NULL;
+    }
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      if (!g_str_has_prefix (name, "journal-") || !g_str_has_suffix (name, ".bin"))
+        continue;
+
+      filename = g_build_filename (dirname, name, NULL);
+      fd = g_open (filename, O_RDONLY, 0);
+      if (fd != -1)
+        {
+          /* keep the lock while reading, so only one process recovers it */
+          if (flock (fd, LOCK_EX | LOCK_NB) == 0)
+            {
+              if (g_file_get_contents (filename, &contents, &length, NULL))
+                {
+                  window_attrs = g_slist_concat (window_attrs,
+                                                 terminal_journal_parse ((const guint8 *) contents, length));
+                  g_free (contents);
+                }
+              g_unlink (filename);
+            }
+          close (fd);
+        }
+      g_free (filename);
+    }
+
+  g_dir_close (dir);
+  g_free (dirname);
+
+  return window_attrs;
+}
@@ -0,0 +1,36 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_JOURNAL_H
+#define TERMINAL_JOURNAL_H
+
+#include <terminal/terminal-window.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TerminalJournal TerminalJournal;
+
+TerminalJournal *terminal_journal_new        (GError          **error);
+
+void             terminal_journal_free       (TerminalJournal  *journal);
+
+void             terminal_journal_add_window (TerminalJournal  *journal,
+                                              TerminalWindow   *window);
+
+GSList          *terminal_journal_recover    (void);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_JOURNAL_H */
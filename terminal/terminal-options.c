@@ -155,6 +155,8 @@ terminal_options_parse (gint              argc,
         options->show_colors = 1;
       else if (terminal_option_cmp ("preferences", 0, argc, argv, &n, NULL))
         options->show_preferences = 1;
+      else if (terminal_option_cmp ("pty-holder", 0, argc, argv, &n, NULL))
+        options->pty_holder = 1;
     }
 }
 
@@ -438,6 +440,21 @@ terminal_window_attr_parse (gint              argc,
               win_attr->sm_client_id = g_strdup (s);
             }
         }
+      else if (terminal_option_cmp ("session-file", 0, argc, argv, &n, &s))
+        {
+          if (G_UNLIKELY (s == NULL))
+            {
+              g_set_error (error, G_SHELL_ERROR, G_SHELL_ERROR_FAILED,
+                           _("Option \"--session-file\" requires specifying "
+                             "the session file as its parameter"));
+              goto failed;
+            }
+          else
+            {
+              g_free (win_attr->session_file);
+              win_attr->session_file = g_strdup (s);
+            }
+        }
       else if (terminal_option_cmp ("startup-id", 0, argc, argv, &n, &s))
         {
           if (G_UNLIKELY (s == NULL))
@@ -666,6 +683,14 @@ terminal_tab_attr_free (TerminalTabAttr *attr)
   g_free (attr->color_text);
   g_free (attr->color_bg);
   g_free (attr->color_title);
+  if (attr->scrollback != NULL)
+    g_bytes_unref (attr->scrollback);
+  if (attr->scrollback_capture != NULL)
+    {
+      /* the snapshot won't find the attr anymore */
+      g_cancellable_cancel (attr->scrollback_capture);
+      g_object_unref (G_OBJECT (attr->scrollback_capture));
+    }
   g_slice_free (TerminalTabAttr, attr);
 }
 
@@ -683,6 +708,7 @@ terminal_window_attr_free (TerminalWindowAttr *attr)
   g_slist_free_full (attr->tabs, (GDestroyNotify) terminal_tab_attr_free);
   g_free (attr->startup_id);
   g_free (attr->sm_client_id);
+  g_free (attr->session_file);
   g_free (attr->geometry);
   g_free (attr->display);
   g_free (attr->role);
@@ -63,6 +63,10 @@ typedef struct
   gchar          *color_title;
   TerminalTitle   dynamic_title_mode;
   gint            position;
+  GBytes         *scrollback;
+  GCancellable   *scrollback_capture;
+  gint64          closed_time;
+  guint           holder_id;
   guint           hold : 1;
   guint           active : 1;
 } TerminalTabAttr;
@@ -75,6 +79,7 @@ typedef struct
   gchar              *role;
   gchar              *startup_id;
   gchar              *sm_client_id;
+  gchar              *session_file;
   gchar              *icon;
   gchar              *font;
   guint               drop_down : 1;
@@ -96,6 +101,7 @@ typedef struct
   guint show_colors : 1;
   guint show_preferences : 1;
   guint disable_server : 1;
+  guint pty_holder : 1;
 } TerminalOptions;
 
 void                terminal_options_parse     (gint                 argc,
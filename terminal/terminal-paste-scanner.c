@@ -0,0 +1,352 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <terminal/terminal-paste-scanner.h>
+#include <terminal/terminal-private.h>
+
+#if defined (__GNUC__) && defined (__SSE2__) && (defined (__x86_64__) || defined (__i386__))
+#define PASTE_SCAN_SSE2
+#include <emmintrin.h>
+#if (__GNUC__ >= 5) || defined (__clang__)
+#define PASTE_SCAN_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+/* sent by the terminal to end a bracketed paste */
+#define PASTE_TERMINATOR        "\033[201~"
+#define PASTE_TERMINATOR_LENGTH (sizeof (PASTE_TERMINATOR) - 1)
+
+
+
+/* returns the offset of the first byte at or after @offset that may
+ * start something unsafe, or @length if there is none */
+typedef gsize (*PasteScanFindFunc) (const guchar *text,
+                                    gsize         offset,
+                                    gsize         length);
+
+typedef enum
+{
+  PASTE_SCAN_NONE,
+  PASTE_SCAN_NEWLINE,
+  PASTE_SCAN_CONTROL,
+  PASTE_SCAN_TERMINATOR
+} PasteScanResult;
+
+
+
+static inline gboolean
+paste_scan_is_special (guchar c)
+{
+  /* C0 controls, DEL and the lead byte of the UTF-8 encoded C1 controls */
+  return c < 0x20 || c == 0x7f || c == 0xc2;
+}
+
+
+
+static gsize
+paste_scan_find_scalar (const guchar *text,
+                        gsize         offset,
+                        gsize         length)
+{
+  for (; offset < length; offset++)
+    if (G_UNLIKELY (paste_scan_is_special (text[offset])))
+      return offset;
+
+  return length;
+}
+
+
+
+#ifdef PASTE_SCAN_SSE2
+static gsize
+paste_scan_find_sse2 (const guchar *text,
+                      gsize         offset,
+                      gsize         length)
+{
+  const __m128i c1f = _mm_set1_epi8 (0x1f);
+  const __m128i c7f = _mm_set1_epi8 (0x7f);
+  const __m128i cc2 = _mm_set1_epi8 ((gchar) 0xc2);
+  __m128i       v, m;
+  gint          mask;
+
+  for (; offset + 16 <= length; offset += 16)
+    {
+      v = _mm_loadu_si128 ((const __m128i *) (text + offset));
+
+      /* min (v, 0x1f) == v is an unsigned v <= 0x1f */
+      m = _mm_or_si128 (_mm_cmpeq_epi8 (_mm_min_epu8 (v, c1f), v),
+                        _mm_or_si128 (_mm_cmpeq_epi8 (v, c7f),
+                                      _mm_cmpeq_epi8 (v, cc2)));
+
+      mask = _mm_movemask_epi8 (m);
+      if (G_UNLIKELY (mask != 0))
+        return offset + __builtin_ctz (mask);
+    }
+
+  return paste_scan_find_scalar (text, offset, length);
+}
+#endif
+
+
+
+#ifdef PASTE_SCAN_AVX2
+__attribute__ ((target ("avx2")))
+static gsize
+paste_scan_find_avx2 (const guchar *text,
+                      gsize         offset,
+                      gsize         length)
+{
+  const __m256i c1f = _mm256_set1_epi8 (0x1f);
+  const __m256i c7f = _mm256_set1_epi8 (0x7f);
+  const __m256i cc2 = _mm256_set1_epi8 ((gchar) 0xc2);
+  __m256i       v, m;
+  guint32       mask;
+
+  for (; offset + 32 <= length; offset += 32)
+    {
+      v = _mm256_loadu_si256 ((const __m256i *) (text + offset));
+
+      m = _mm256_or_si256 (_mm256_cmpeq_epi8 (_mm256_min_epu8 (v, c1f), v),
+                           _mm256_or_si256 (_mm256_cmpeq_epi8 (v, c7f),
+                                            _mm256_cmpeq_epi8 (v, cc2)));
+
+      mask = (guint32) _mm256_movemask_epi8 (m);
+      if (G_UNLIKELY (mask != 0))
+        return offset + __builtin_ctz (mask);
+    }
+
+  return paste_scan_find_scalar (text, offset, length);
+}
+#endif
+
+
+
+static PasteScanFindFunc
+paste_scan_get_find_func (void)
+{
+  static PasteScanFindFunc find = NULL;
+
+  if (G_UNLIKELY (find == NULL))
+    {
+#ifdef PASTE_SCAN_AVX2
+      __builtin_cpu_init ();
+      if (__builtin_cpu_supports ("avx2"))
+        find = paste_scan_find_avx2;
+      else
+#endif
+#ifdef PASTE_SCAN_SSE2
+        find = paste_scan_find_sse2;
+#else
+        find = paste_scan_find_scalar;
+#endif
+    }
+
+  return find;
+}
+
+
+
+static PasteScanResult
+paste_scan_classify (const guchar *text,
+                     gsize         offset,
+                     gsize         length,
+                     gsize        *n_bytes)
+{
+  guchar c = text[offset];
+
+  *n_bytes = 1;
+
+  switch (c)
+    {
+    case '\t':
+      return PASTE_SCAN_NONE;
+
+    case '\r':
+      /* \r\n is a single line break */
+      if (offset + 1 < length && text[offset + 1] == '\n')
+        *n_bytes = 2;
+      return PASTE_SCAN_NEWLINE;
+
+    case '\n':
+      return PASTE_SCAN_NEWLINE;
+
+    case 0x1b:
+      if (length - offset >= PASTE_TERMINATOR_LENGTH
+          && memcmp (text + offset, PASTE_TERMINATOR, PASTE_TERMINATOR_LENGTH) == 0)
+        {
+          *n_bytes = PASTE_TERMINATOR_LENGTH;
+          return PASTE_SCAN_TERMINATOR;
+        }
+      return PASTE_SCAN_CONTROL;
+
+    case 0xc2:
+      /* U+0080 to U+009F */
+      if (offset + 1 < length && text[offset + 1] >= 0x80 && text[offset + 1] <= 0x9f)
+        {
+          *n_bytes = 2;
+          return PASTE_SCAN_CONTROL;
+        }
+      return PASTE_SCAN_NONE;
+
+    default:
+      return PASTE_SCAN_CONTROL;
+    }
+}
+
+
+
+static void
+paste_scan_run (PasteScanFindFunc  find,
+                const guchar      *text,
+                gsize              length,
+                TerminalPasteScan *scan)
+{
+  TerminalPasteIssue *issue;
+  PasteScanResult     result;
+  gsize               offset = 0;
+  gsize               line_offset = 0;
+  gsize               n_bytes;
+
+  memset (scan, 0, sizeof (*scan));
+
+  for (;;)
+    {
+      offset = find (text, offset, length);
+      if (offset >= length)
+        break;
+
+      result = paste_scan_classify (text, offset, length, &n_bytes);
+
+      if (result == PASTE_SCAN_NEWLINE)
+        {
+          scan->n_newlines++;
+          line_offset = offset + n_bytes;
+        }
+      else if (result != PASTE_SCAN_NONE)
+        {
+          if (result == PASTE_SCAN_TERMINATOR)
+            scan->n_terminators++;
+          else
+            scan->n_controls++;
+
+          if (scan->n_issues < TERMINAL_PASTE_SCAN_MAX_ISSUES)
+            {
+              issue = &scan->issues[scan->n_issues++];
+              issue->type = result == PASTE_SCAN_TERMINATOR
+                            ? TERMINAL_PASTE_ISSUE_TERMINATOR : TERMINAL_PASTE_ISSUE_CONTROL;
+              issue->offset = offset;
+              issue->line = scan->n_newlines + 1;
+              issue->line_offset = line_offset;
+            }
+        }
+
+      offset += n_bytes;
+    }
+}
+
+
+
+/**
+ * terminal_paste_scan:
+ * @text   : UTF-8 text about to be pasted.
+ * @length : Length of @text in bytes.
+ * @scan   : Return location for the result.
+ *
+ * Counts the line breaks, control characters and bracketed paste
+ * terminators in @text in a single pass. Bytes that cannot start any
+ * of them are skipped 16 or 32 at a time if the CPU supports it.
+ **/
+void
+terminal_paste_scan (const gchar       *text,
+                     gsize              length,
+                     TerminalPasteScan *scan)
+{
+  terminal_return_if_fail (text != NULL);
+  terminal_return_if_fail (scan != NULL);
+
+  paste_scan_run (paste_scan_get_find_func (), (const guchar *) text, length, scan);
+}
+
+
+
+/**
+ * terminal_paste_scan_is_unsafe:
+ * @scan : A #TerminalPasteScan.
+ *
+ * Return value: %TRUE if pasting the scanned text may run commands.
+ **/
+gboolean
+terminal_paste_scan_is_unsafe (const TerminalPasteScan *scan)
+{
+  return scan->n_newlines > 0 || scan->n_controls > 0 || scan->n_terminators > 0;
+}
+
+
+
+/**
+ * terminal_paste_sanitize:
+ * @text   : UTF-8 text about to be pasted.
+ * @length : Length of @text in bytes.
+ *
+ * Removes control characters (except tabs and line breaks) and
+ * bracketed paste terminators from @text, in place.
+ *
+ * Return value: The new length of @text.
+ **/
+gsize
+terminal_paste_sanitize (gchar *text,
+                         gsize  length)
+{
+  PasteScanFindFunc  find = paste_scan_get_find_func ();
+  guchar            *p = (guchar *) text;
+  gsize              in = 0, out = 0;
+  gsize              next, n_bytes;
+
+  terminal_return_val_if_fail (text != NULL, 0);
+
+  for (;;)
+    {
+      next = find (p, in, length);
+
+      /* move the harmless part in front of the special byte */
+      if (in != out)
+        memmove (p + out, p + in, next - in);
+      out += next - in;
+
+      if (next >= length)
+        break;
+
+      if (paste_scan_classify (p, next, length, &n_bytes) < PASTE_SCAN_CONTROL)
+        {
+          memmove (p + out, p + next, n_bytes);
+          out += n_bytes;
+        }
+
+      in = next + n_bytes;
+    }
+
+  text[out] = '\0';
+
+  return out;
+}
@@ -0,0 +1,62 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_PASTE_SCANNER_H
+#define TERMINAL_PASTE_SCANNER_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* number of issues remembered for the unsafe paste dialog */
+#define TERMINAL_PASTE_SCAN_MAX_ISSUES (8)
+
+typedef enum
+{
+  TERMINAL_PASTE_ISSUE_CONTROL,
+  TERMINAL_PASTE_ISSUE_TERMINATOR
+} TerminalPasteIssueType;
+
+typedef struct
+{
+  TerminalPasteIssueType type;
+  gsize                  offset;
+  gsize                  line;
+  gsize                  line_offset;
+} TerminalPasteIssue;
+
+typedef struct
+{
+  gsize              n_newlines;
+  gsize              n_controls;
+  gsize              n_terminators;
+
+  /* the first issues found in the text */
+  guint              n_issues;
+  TerminalPasteIssue issues[TERMINAL_PASTE_SCAN_MAX_ISSUES];
+} TerminalPasteScan;
+
+void     terminal_paste_scan           (const gchar             *text,
+                                        gsize                    length,
+                                        TerminalPasteScan       *scan);
+
+gboolean terminal_paste_scan_is_unsafe (const TerminalPasteScan *scan);
+
+gsize    terminal_paste_sanitize       (gchar                   *text,
+                                        gsize                    length);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_PASTE_SCANNER_H */
@@ -0,0 +1,274 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <libxfce4ui/libxfce4ui.h>
+
+#include <terminal/terminal-perf-hud.h>
+#include <terminal/terminal-private.h>
+
+/* milliseconds between two updates of the numbers */
+#define UPDATE_INTERVAL (1000)
+/* milliseconds between two checks of the main loop */
+#define PROBE_INTERVAL  (50)
+
+
+
+static void     terminal_perf_hud_finalize (GObject         *object);
+static void     terminal_perf_hud_map      (GtkWidget       *widget);
+static void     terminal_perf_hud_unmap    (GtkWidget       *widget);
+static gboolean terminal_perf_hud_probe    (gpointer         user_data);
+static gboolean terminal_perf_hud_update   (gpointer         user_data);
+
+
+
+struct _TerminalPerfHudClass
+{
+  GtkLabelClass parent_class;
+};
+
+struct _TerminalPerfHud
+{
+  GtkLabel             parent_instance;
+
+  TerminalScreen      *screen;
+
+  guint                update_id;
+  gint64               last_time;
+  TerminalScreenStats  last;
+
+  /* longest main loop delay since the last update */
+  gint64               max_delay;
+};
+
+
+
+/* the main loop check is shared by all visible overlays */
+static guint   probe_id = 0;
+static GSList *probe_huds = NULL;
+static gint64  probe_expected = 0;
+
+
+
+G_DEFINE_TYPE (TerminalPerfHud, terminal_perf_hud, GTK_TYPE_LABEL)
+
+
+
+static void
+terminal_perf_hud_class_init (TerminalPerfHudClass *klass)
+{
+  GObjectClass   *gobject_class;
+  GtkWidgetClass *gtkwidget_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = terminal_perf_hud_finalize;
+
+  gtkwidget_class = GTK_WIDGET_CLASS (klass);
+  gtkwidget_class->map = terminal_perf_hud_map;
+  gtkwidget_class->unmap = terminal_perf_hud_unmap;
+}
+
+
+
+static void
+terminal_perf_hud_init (TerminalPerfHud *hud)
+{
+  PangoAttrList *attrs;
+
+  attrs = pango_attr_list_new ();
+  pango_attr_list_insert (attrs, pango_attr_family_new ("Monospace"));
+  pango_attr_list_insert (attrs, pango_attr_scale_new (PANGO_SCALE_SMALL));
+  gtk_label_set_attributes (GTK_LABEL (hud), attrs);
+  pango_attr_list_unref (attrs);
+
+  gtk_label_set_xalign (GTK_LABEL (hud), 0.0);
+  gtk_widget_set_margin_top (GTK_WIDGET (hud), 6);
+  gtk_widget_set_margin_end (GTK_WIDGET (hud), 6);
+  gtk_widget_set_can_focus (GTK_WIDGET (hud), FALSE);
+  gtk_style_context_add_class (gtk_widget_get_style_context (GTK_WIDGET (hud)), "osd");
+}
+
+
+
+static void
+terminal_perf_hud_finalize (GObject *object)
+{
+  TerminalPerfHud *hud = TERMINAL_PERF_HUD (object);
+
+  if (hud->update_id != 0)
+    g_source_remove (hud->update_id);
+
+  (*G_OBJECT_CLASS (terminal_perf_hud_parent_class)->finalize) (object);
+}
+
+
+
+static void
+terminal_perf_hud_map (GtkWidget *widget)
+{
+  TerminalPerfHud *hud = TERMINAL_PERF_HUD (widget);
+
+  (*GTK_WIDGET_CLASS (terminal_perf_hud_parent_class)->map) (widget);
+
+  /* only the overlay of the visible tab is updated */
+  if (probe_huds == NULL)
+    {
+      probe_expected = g_get_monotonic_time () + PROBE_INTERVAL * 1000;
+      probe_id = gdk_threads_add_timeout (PROBE_INTERVAL, terminal_perf_hud_probe, NULL);
+    }
+  probe_huds = g_slist_prepend (probe_huds, hud);
+
+  hud->max_delay = 0;
+  hud->last_time = 0;
+  terminal_perf_hud_update (hud);
+  hud->update_id = gdk_threads_add_timeout (UPDATE_INTERVAL, terminal_perf_hud_update, hud);
+}
+
+
+
+static void
+terminal_perf_hud_unmap (GtkWidget *widget)
+{
+  TerminalPerfHud *hud = TERMINAL_PERF_HUD (widget);
+
+  if (hud->update_id != 0)
+    {
+      g_source_remove (hud->update_id);
+      hud->update_id = 0;
+    }
+
+  probe_huds = g_slist_remove (probe_huds, hud);
+  if (probe_huds == NULL)
+    {
+      g_source_remove (probe_id);
+      probe_id = 0;
+    }
+
+  (*GTK_WIDGET_CLASS (terminal_perf_hud_parent_class)->unmap) (widget);
+}
+
+
+
+static gboolean
+terminal_perf_hud_probe (gpointer user_data)
+{
+  TerminalPerfHud *hud;
+  GSList          *li;
+  gint64           now = g_get_monotonic_time ();
+
+  /* how late the main loop came back to us, other tabs, windows and
+   * the output of their children all run in it */
+  for (li = probe_huds; li != NULL; li = li->next)
+    {
+      hud = TERMINAL_PERF_HUD (li->data);
+      hud->max_delay = MAX (hud->max_delay, now - probe_expected);
+    }
+  probe_expected = now + PROBE_INTERVAL * 1000;
+
+  return TRUE;
+}
+
+
+
+static gboolean
+terminal_perf_hud_update (gpointer user_data)
+{
+  TerminalPerfHud     *hud = TERMINAL_PERF_HUD (user_data);
+  TerminalScreenStats  stats;
+  GString             *text;
+  gchar               *command, *size;
+  gdouble              elapsed;
+  guint64              frames;
+  gint64               now;
+
+  terminal_screen_get_stats (hud->screen, &stats);
+  now = g_get_monotonic_time ();
+
+  text = g_string_new (NULL);
+
+  if (hud->last_time != 0)
+    {
+      elapsed = (now - hud->last_time) / (gdouble) G_USEC_PER_SEC;
+      frames = stats.n_frames - hud->last.n_frames;
+
+      /* what the foreground process writes, to the terminal and to files;
+       * the counter starts over when another process gets the foreground */
+      if (stats.foreground_pid == hud->last.foreground_pid
+          && stats.foreground_wchar >= hud->last.foreground_wchar)
+        {
+          size = g_format_size ((stats.foreground_wchar - hud->last.foreground_wchar) / elapsed);
+          g_string_append_printf (text, "%s  %s/s\n", _("Process writes"), size);
+          g_free (size);
+        }
+      else
+        g_string_append_printf (text, "%s  -\n", _("Process writes"));
+
+      g_string_append_printf (text, "%s  %.0f/s, %.1f ms\n", _("Frames"), frames / elapsed,
+                              frames > 0 ? (stats.frame_time - hud->last.frame_time) / 1000.0 / frames : 0.0);
+      g_string_append_printf (text, "%s  %.1f ms\n", _("Latency"), MAX (hud->max_delay, 0) / 1000.0);
+
+      if (stats.foreground_pid == hud->last.foreground_pid)
+        g_string_append_printf (text, "%s  %.0f%%\n", _("CPU"),
+                                (stats.foreground_cpu_time - hud->last.foreground_cpu_time) / 10000.0 / elapsed);
+    }
+
+  size = g_format_size (stats.scrollback_bytes);
+  g_string_append_printf (text, "%s  %ld, ~%s", _("History"), stats.scrollback_lines, size);
+  g_free (size);
+
+  command = terminal_screen_get_foreground_command (hud->screen);
+  if (stats.foreground_pid != -1)
+    g_string_append_printf (text, "\n%s  %d %s", _("Process"), stats.foreground_pid,
+                            command != NULL ? command : "");
+  g_free (command);
+
+  /* redrawing the label costs vte one frame a second */
+  gtk_label_set_text (GTK_LABEL (hud), text->str);
+  g_string_free (text, TRUE);
+
+  hud->last = stats;
+  hud->last_time = now;
+  hud->max_delay = 0;
+
+  return TRUE;
+}
+
+
+
+/**
+ * terminal_perf_hud_new:
+ * @screen : The #TerminalScreen to show the numbers of.
+ *
+ * Creates a label with the output rate of the foreground process, the
+ * frames vte draws, the main loop latency, the history and the process
+ * of @screen, updated every second while it is mapped.
+ *
+ * Return value: A new #TerminalPerfHud.
+ **/
+GtkWidget *
+terminal_perf_hud_new (TerminalScreen *screen)
+{
+  TerminalPerfHud *hud;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  hud = g_object_new (TERMINAL_TYPE_PERF_HUD, NULL);
+  hud->screen = screen;
+
+  return GTK_WIDGET (hud);
+}
@@ -0,0 +1,39 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_PERF_HUD_H
+#define TERMINAL_PERF_HUD_H
+
+#include <terminal/terminal-screen.h>
+
+G_BEGIN_DECLS
+
+#define TERMINAL_TYPE_PERF_HUD            (terminal_perf_hud_get_type ())
+#define TERMINAL_PERF_HUD(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TERMINAL_TYPE_PERF_HUD, TerminalPerfHud))
+#define TERMINAL_PERF_HUD_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), TERMINAL_TYPE_PERF_HUD, TerminalPerfHudClass))
+#define TERMINAL_IS_PERF_HUD(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TERMINAL_TYPE_PERF_HUD))
+#define TERMINAL_IS_PERF_HUD_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), TERMINAL_TYPE_PERF_HUD))
+#define TERMINAL_PERF_HUD_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), TERMINAL_TYPE_PERF_HUD, TerminalPerfHudClass))
+
+typedef struct _TerminalPerfHudClass TerminalPerfHudClass;
+typedef struct _TerminalPerfHud      TerminalPerfHud;
+
+GType      terminal_perf_hud_get_type (void) G_GNUC_CONST;
+
+GtkWidget *terminal_perf_hud_new      (TerminalScreen *screen);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_PERF_HUD_H */
@@ -34,9 +34,22 @@
 #include <terminal/terminal-encoding-action.h>
 #include <terminal/terminal-private.h>
 
-#include "terminal-preferences-ui.h"
+/* compiled into the binary by glib-compile-resources */
+#define PREFERENCES_UI_RESOURCE "/org/xfce/terminal/terminal-preferences.glade"
+
+
 
 static void     terminal_preferences_dialog_finalize          (GObject                   *object);
+static void     terminal_preferences_dialog_switch_page       (GtkNotebook               *notebook,
+                                                               GtkWidget                 *page,
+                                                               guint                      page_num,
+                                                               TerminalPreferencesDialog *dialog);
+static void     terminal_preferences_dialog_setup_general     (TerminalPreferencesDialog *dialog);
+static void     terminal_preferences_dialog_setup_dropdown    (TerminalPreferencesDialog *dialog);
+static void     terminal_preferences_dialog_setup_appearance  (TerminalPreferencesDialog *dialog);
+static void     terminal_preferences_dialog_setup_colors      (TerminalPreferencesDialog *dialog);
+static void     terminal_preferences_dialog_setup_compat      (TerminalPreferencesDialog *dialog);
+static void     terminal_preferences_dialog_setup_advanced    (TerminalPreferencesDialog *dialog);
 static void     terminal_preferences_dialog_disc_bindings     (GtkWidget                 *widget,
                                                                TerminalPreferencesDialog *dialog);
 static void     terminal_preferences_dialog_died              (gpointer                   user_data,
@@ -95,8 +108,24 @@ struct _TerminalPreferencesDialog
   gulong               bg_image_signal_id;
   gulong               palette_signal_id;
   gulong               geometry_signal_id;
+
+  /* pages whose widgets have been built */
+  guint                built_pages;
 };
 
+typedef struct
+{
+  /* the empty box in the notebook */
+  const gchar *name;
+
+  /* the content of the page first, then the adjustments, models
+   * and size groups it uses */
+  const gchar *objects[13];
+
+  void (*setup) (TerminalPreferencesDialog *dialog);
+}
+PreferencesPage;
+
 enum
 {
   PRESET_COLUMN_TITLE,
@@ -107,6 +136,33 @@ enum
 
 
 
+static const PreferencesPage preferences_pages[] =
+{
+  { "page-general",
+    { "vbox1", "liststore1", "liststore2", "liststore7", "scrolling-line", NULL },
+    terminal_preferences_dialog_setup_general },
+  { "page-dropdown",
+    { "dropdown-box", "dropdown-height", "dropdown-width", "dropdown-position",
+      "dropdown-position-vertical", "dropdown-opacity", "dropdown-animation-time", NULL },
+    terminal_preferences_dialog_setup_dropdown },
+  { "page-appearance",
+    { "vbox4", "background-darkness", "background-image-shading", "cell-width-scale",
+      "cell-height-scale", "geo-columns", "geo-rows", "liststore3", "liststore6",
+      "liststore9", "tab-activity-timeout", "sizegroup1", NULL },
+    terminal_preferences_dialog_setup_appearance },
+  { "page-colors",
+    { "vbox8", NULL },
+    terminal_preferences_dialog_setup_colors },
+  { "page-compatibility",
+    { "vbox11", "liststore4", "liststore5", "liststore8", NULL },
+    terminal_preferences_dialog_setup_compat },
+  { "page-advanced",
+    { "vbox13", NULL },
+    terminal_preferences_dialog_setup_advanced },
+};
+
+
+
 G_DEFINE_TYPE (TerminalPreferencesDialog, terminal_preferences_dialog, GTK_TYPE_BUILDER)
 
 
@@ -156,53 +212,16 @@ terminal_preferences_dialog_class_init (TerminalPreferencesDialogClass *klass)
 static void
 terminal_preferences_dialog_init (TerminalPreferencesDialog *dialog)
 {
-  GError           *error = NULL;
-  guint             i;
-  GObject          *object, *object2;
-  gchar             palette_name[16];
-  GtkFileFilter    *filter;
-  GBinding         *binding;
-  GtkTreeModel     *model;
-  gchar            *current;
-  GtkTreeIter       current_iter;
-  const gchar      *props_active[] = { "title-mode", "command-login-shell",
-                                       "command-update-records", "run-custom-command",
-                                       "use-default-working-dir", "scrolling-on-output",
-                                       "scrolling-on-keystroke", "scrolling-bar",
-                                       "scrolling-unlimited", "misc-cursor-shape",
-                                       "misc-cursor-blinks", "font-allow-bold",
-                                       "font-use-system", "text-blink-mode",
-                                       "misc-show-unsafe-paste-dialog", "misc-menubar-default",
-                                       "misc-toolbar-default", "misc-borders-default",
-                                       "misc-tab-close-middle-click", "misc-middle-click-opens-uri",
-                                       "misc-mouse-autohide", "misc-rewrap-on-resize",
-                                       "misc-copy-on-select", "misc-slim-tabs",
-                                       "misc-new-tab-adjacent", "misc-bell",
-                                       "misc-bell-urgent", "shortcuts-no-helpkey",
-                                       "shortcuts-no-mnemonics", "shortcuts-no-menukey",
-                                       "binding-backspace", "binding-delete",
-                                       "binding-ambiguous-width", "background-mode",
-                                       "background-image-style", "color-background-vary",
-                                       "color-bold-is-bright", "color-use-theme",
-                                       "dropdown-keep-open-default", "dropdown-keep-above",
-                                       "dropdown-toggle-focus", "dropdown-status-icon",
-                                       "dropdown-move-to-active", "dropdown-always-show-tabs",
-                                       "dropdown-show-borders"
-                                     };
-  const gchar      *props_color[] =  { "color-foreground", "color-background",
-                                       "tab-activity-color", "color-cursor-foreground",
-                                       "color-cursor", "color-selection",
-                                       "color-selection-background", "color-bold"
-                                     };
-  const gchar      *props_value[] =  { "dropdown-height", "dropdown-width",
-                                       "dropdown-position", "dropdown-position-vertical",
-                                       "dropdown-opacity", "dropdown-animation-time"
-                                     };
+  GError      *error = NULL;
+  GObject     *object;
+  GObject     *notebook;
+  const gchar *objects[] = { "dialog", NULL };
 
   dialog->preferences = terminal_preferences_get ();
 
-  if (!gtk_builder_add_from_string (GTK_BUILDER (dialog), terminal_preferences_ui,
-                                    terminal_preferences_ui_length, &error)) {
+  /* only the dialog and the empty pages, the rest is built when shown */
+  if (!gtk_builder_add_objects_from_resource (GTK_BUILDER (dialog), PREFERENCES_UI_RESOURCE,
+                                              (gchar **) objects, &error)) {
       g_critical ("Error loading UI: %s", error->message);
       g_error_free (error);
       return;
@@ -217,63 +236,185 @@ terminal_preferences_dialog_init (TerminalPreferencesDialog *dialog)
   g_signal_connect (object, "response",
       G_CALLBACK (terminal_preferences_dialog_response), dialog);
 
+  /* build the page the dialog opens with, the others on first switch */
+  notebook = gtk_builder_get_object (GTK_BUILDER (dialog), "notebook");
+  terminal_return_if_fail (GTK_IS_NOTEBOOK (notebook));
+  g_signal_connect (notebook, "switch-page",
+      G_CALLBACK (terminal_preferences_dialog_switch_page), dialog);
+  terminal_preferences_dialog_switch_page (GTK_NOTEBOOK (notebook),
+      gtk_notebook_get_nth_page (GTK_NOTEBOOK (notebook),
+                                 gtk_notebook_get_current_page (GTK_NOTEBOOK (notebook))),
+      0, dialog);
+}
+
+
+
+static void
+terminal_preferences_dialog_switch_page (GtkNotebook               *notebook,
+                                         GtkWidget                 *page,
+                                         guint                      page_num,
+                                         TerminalPreferencesDialog *dialog)
+{
+  GError      *error = NULL;
+  GObject     *object;
+  const gchar *name;
+  guint        n;
+
+  terminal_return_if_fail (GTK_IS_WIDGET (page));
+
+  name = gtk_buildable_get_name (GTK_BUILDABLE (page));
+  for (n = 0; n < G_N_ELEMENTS (preferences_pages); n++)
+    if (g_strcmp0 (name, preferences_pages[n].name) == 0)
+      break;
+
+  if (n == G_N_ELEMENTS (preferences_pages) || (dialog->built_pages & (1 << n)) != 0)
+    return;
+  dialog->built_pages |= 1 << n;
+
+  if (!gtk_builder_add_objects_from_resource (GTK_BUILDER (dialog), PREFERENCES_UI_RESOURCE,
+                                              (gchar **) preferences_pages[n].objects, &error)) {
+      g_critical ("Error loading UI: %s", error->message);
+      g_error_free (error);
+      return;
+  }
+
+  /* the first object is the content of the page */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), preferences_pages[n].objects[0]);
+  terminal_return_if_fail (GTK_IS_WIDGET (object));
+  gtk_box_pack_start (GTK_BOX (page), GTK_WIDGET (object), TRUE, TRUE, 0);
+
+  (*preferences_pages[n].setup) (dialog);
+}
+
+
+
+static void
+terminal_preferences_dialog_setup_general (TerminalPreferencesDialog *dialog)
+{
+  guint        i;
+  GObject     *object, *object2;
+  GBinding    *binding;
+  const gchar *props_active[] = { "title-mode", "command-login-shell",
+                                  "command-update-records", "run-custom-command",
+                                  "use-default-working-dir", "scrolling-on-output",
+                                  "scrolling-on-keystroke", "scrolling-bar",
+                                  "scrolling-unlimited", "misc-cursor-shape",
+                                  "misc-cursor-blinks", "misc-show-unsafe-paste-dialog",
+                                  "misc-copy-on-select"
+                                };
+
   /* bind active properties */
   for (i = 0; i < G_N_ELEMENTS (props_active); i++)
     BIND_PROPERTIES (props_active[i], "active");
 
-  /* bind color properties and click handler */
-  for (i = 0; i < G_N_ELEMENTS (props_color); i++)
-    {
-      BIND_PROPERTIES (props_color[i], "rgba");
-      g_signal_connect (object, "button-press-event",
-          G_CALLBACK (terminal_preferences_dialog_color_press_event), object);
-    }
+  /* other properties */
+  BIND_PROPERTIES ("title-initial", "text");
+  BIND_PROPERTIES ("custom-command", "text");
+  BIND_PROPERTIES ("default-working-dir", "text");
+  BIND_PROPERTIES ("scrolling-lines", "value");
+
+#ifndef HAVE_LIBUTEMPTER
+  /* hide "Update utmp/wtmp records" if no support for that */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "command-update-records");
+  terminal_return_if_fail (G_IS_OBJECT (object));
+  gtk_widget_hide (GTK_WIDGET (object));
+#endif
+
+  /* run custom command button */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "run-custom-command");
+  object2 = gtk_builder_get_object (GTK_BUILDER (dialog), "hbox3");
+  terminal_return_if_fail (G_IS_OBJECT (object) && G_IS_OBJECT (object2));
+  g_object_bind_property (object, "active",
+                          object2, "sensitive",
+                          G_BINDING_SYNC_CREATE);
+
+  /* working directory button */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "use-default-working-dir");
+  object2 = gtk_builder_get_object (GTK_BUILDER (dialog), "default-working-dir");
+  terminal_return_if_fail (G_IS_OBJECT (object) && G_IS_OBJECT (object2));
+  g_object_bind_property (object, "active",
+                          object2, "sensitive",
+                          G_BINDING_SYNC_CREATE);
+
+  /* unlimited scrollback button */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "scrolling-unlimited");
+  object2 = gtk_builder_get_object (GTK_BUILDER (dialog), "scrolling-lines");
+  terminal_return_if_fail (G_IS_OBJECT (object) && G_IS_OBJECT (object2));
+  g_object_bind_property (object, "active",
+                          object2, "sensitive",
+                          G_BINDING_INVERT_BOOLEAN | G_BINDING_SYNC_CREATE);
+}
+
+
+
+static void
+terminal_preferences_dialog_setup_dropdown (TerminalPreferencesDialog *dialog)
+{
+  guint        i;
+  GObject     *object;
+  GBinding    *binding;
+  const gchar *props_active[] = { "dropdown-keep-open-default", "dropdown-keep-above",
+                                  "dropdown-toggle-focus", "dropdown-status-icon",
+                                  "dropdown-move-to-active", "dropdown-always-show-tabs",
+                                  "dropdown-show-borders"
+                                };
+  const gchar *props_value[] =  { "dropdown-height", "dropdown-width",
+                                  "dropdown-position", "dropdown-position-vertical",
+                                  "dropdown-opacity", "dropdown-animation-time"
+                                };
+
+  /* bind active properties */
+  for (i = 0; i < G_N_ELEMENTS (props_active); i++)
+    BIND_PROPERTIES (props_active[i], "active");
 
   /* bind value properties */
   for (i = 0; i < G_N_ELEMENTS (props_value); i++)
     BIND_PROPERTIES (props_value[i], "value");
 
-  /* bind color palette properties */
-  for (i = 1; i <= 16; i++)
+  /* position scale */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "scale-position");
+  terminal_return_if_fail (G_IS_OBJECT (object));
+  for (i = 0; i <= 100; i += 25)
+    gtk_scale_add_mark (GTK_SCALE (object), i, GTK_POS_BOTTOM, NULL);
+
+  /* show warning and disable control if WM does not support compositing */
+  if (!gdk_screen_is_composited (gtk_widget_get_screen (GTK_WIDGET (object))))
     {
-      g_snprintf (palette_name, sizeof (palette_name), "color-palette%d", i);
-      object = gtk_builder_get_object (GTK_BUILDER (dialog), palette_name);
+      object = gtk_builder_get_object (GTK_BUILDER (dialog), "dropdown-opacity-not-available");
       terminal_return_if_fail (G_IS_OBJECT (object));
-      g_signal_connect (object, "color-set",
-          G_CALLBACK (terminal_preferences_dialog_palette_changed), dialog);
-
-#if GTK_CHECK_VERSION (3, 20, 0)
-      /* don't show palette when editing colors */
-      g_object_set (object, "show-editor", TRUE, NULL);
-#endif
+      gtk_widget_set_visible (GTK_WIDGET (object), TRUE);
+      object = gtk_builder_get_object (GTK_BUILDER (dialog), "scale-opacity");
+      terminal_return_if_fail (G_IS_OBJECT (object));
+      gtk_widget_set_sensitive (GTK_WIDGET (object), FALSE);
     }
+}
 
-  /* watch color changes in property */
-  dialog->palette_signal_id = g_signal_connect_swapped (G_OBJECT (dialog->preferences),
-      "notify::color-palette", G_CALLBACK (terminal_preferences_dialog_palette_notify), dialog);
-  terminal_preferences_dialog_palette_notify (dialog);
 
-  /* color presets */
-  terminal_preferences_dialog_presets_load (dialog);
+
+static void
+terminal_preferences_dialog_setup_appearance (TerminalPreferencesDialog *dialog)
+{
+  guint          i;
+  GObject       *object, *object2;
+  GtkFileFilter *filter;
+  GBinding      *binding;
+  const gchar   *props_active[] = { "font-allow-bold", "font-use-system",
+                                    "text-blink-mode", "misc-menubar-default",
+                                    "misc-toolbar-default", "misc-borders-default",
+                                    "misc-slim-tabs", "background-mode",
+                                    "background-image-style"
+                                  };
+
+  /* bind active properties */
+  for (i = 0; i < G_N_ELEMENTS (props_active); i++)
+    BIND_PROPERTIES (props_active[i], "active");
 
   /* other properties */
   BIND_PROPERTIES ("font-name", "font-name");
-  BIND_PROPERTIES ("title-initial", "text");
-  BIND_PROPERTIES ("custom-command", "text");
-  BIND_PROPERTIES ("default-working-dir", "text");
-  BIND_PROPERTIES ("word-chars", "text");
-  BIND_PROPERTIES ("scrolling-lines", "value");
   BIND_PROPERTIES ("tab-activity-timeout", "value");
   BIND_PROPERTIES ("background-darkness", "value");
   BIND_PROPERTIES ("background-image-shading", "value");
 
-#ifndef HAVE_LIBUTEMPTER
-  /* hide "Update utmp/wtmp records" if no support for that */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "command-update-records");
-  terminal_return_if_fail (G_IS_OBJECT (object));
-  gtk_widget_hide (GTK_WIDGET (object));
-#endif
-
 #if VTE_CHECK_VERSION (0, 51, 3)
   /* bind cell width scale */
   object = gtk_builder_get_object (GTK_BUILDER (dialog), "spin-cell-width-scale");
@@ -308,45 +449,9 @@ terminal_preferences_dialog_init (TerminalPreferencesDialog *dialog)
   object = gtk_builder_get_object (GTK_BUILDER (dialog), "cell-sp-box");
   terminal_return_if_fail (G_IS_OBJECT (object));
   gtk_widget_hide (GTK_WIDGET (object));
-
-  /* hide "Bold is bright" if vte doesn't support it */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "color-bold-is-bright");
-  terminal_return_if_fail (G_IS_OBJECT (object));
-  gtk_widget_hide (GTK_WIDGET (object));
 #endif
 
-#if VTE_CHECK_VERSION (0, 58, 0)
-  /* hide "Rewrap on resize" if vte's support for it has been dropped */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "misc-rewrap-on-resize");
-  terminal_return_if_fail (G_IS_OBJECT (object));
-  gtk_widget_hide (GTK_WIDGET (object));
-#endif
-
-  /* run custom command button */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "run-custom-command");
-  object2 = gtk_builder_get_object (GTK_BUILDER (dialog), "hbox3");
-  terminal_return_if_fail (G_IS_OBJECT (object) && G_IS_OBJECT (object2));
-  g_object_bind_property (object, "active",
-                          object2, "sensitive",
-                          G_BINDING_SYNC_CREATE);
-
-  /* working directory button */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "use-default-working-dir");
-  object2 = gtk_builder_get_object (GTK_BUILDER (dialog), "default-working-dir");
-  terminal_return_if_fail (G_IS_OBJECT (object) && G_IS_OBJECT (object2));
-  g_object_bind_property (object, "active",
-                          object2, "sensitive",
-                          G_BINDING_SYNC_CREATE);
-
-  /* unlimited scrollback button */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "scrolling-unlimited");
-  object2 = gtk_builder_get_object (GTK_BUILDER (dialog), "scrolling-lines");
-  terminal_return_if_fail (G_IS_OBJECT (object) && G_IS_OBJECT (object2));
-  g_object_bind_property (object, "active",
-                          object2, "sensitive",
-                          G_BINDING_INVERT_BOOLEAN | G_BINDING_SYNC_CREATE);
-
-  /* use system font button */
+  /* use system font button, the filter enumerates all font families */
   object = gtk_builder_get_object (GTK_BUILDER (dialog), "font-use-system");
   object2 = gtk_builder_get_object (GTK_BUILDER (dialog), "font-name");
   terminal_return_if_fail (G_IS_OBJECT (object) && G_IS_OBJECT (object2));
@@ -355,23 +460,117 @@ terminal_preferences_dialog_init (TerminalPreferencesDialog *dialog)
                           object2, "sensitive",
                           G_BINDING_INVERT_BOOLEAN | G_BINDING_SYNC_CREATE);
 
-  /* reset comparibility button */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "reset-compatibility");
+#ifdef GDK_WINDOWING_X11
+  terminal_preferences_dialog_geometry_changed (dialog);
+  dialog->geometry_signal_id = g_signal_connect_swapped (G_OBJECT (dialog->preferences),
+      "notify::misc-default-geometry",
+      G_CALLBACK (terminal_preferences_dialog_geometry_changed), dialog);
+
+  /* geo changes */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "geo-columns");
   terminal_return_if_fail (G_IS_OBJECT (object));
-  g_signal_connect (object, "clicked",
-      G_CALLBACK (terminal_preferences_dialog_reset_compat), dialog);
+  g_signal_connect (object, "value-changed",
+      G_CALLBACK (terminal_preferences_dialog_geometry_columns), dialog);
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "geo-rows");
+  terminal_return_if_fail (G_IS_OBJECT (object));
+  g_signal_connect (object, "value-changed",
+      G_CALLBACK (terminal_preferences_dialog_geometry_rows), dialog);
+#else
+  /* hide */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "geo-box");
+  terminal_return_if_fail (G_IS_OBJECT (object));
+  gtk_widget_hide (GTK_WIDGET (object));
+#endif
 
-  /* reset word-chars button */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "reset-word-chars");
+  /* background widgets visibility */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "background-mode");
   terminal_return_if_fail (G_IS_OBJECT (object));
-  g_signal_connect (object, "clicked",
-      G_CALLBACK (terminal_preferences_dialog_reset_word_chars), dialog);
+  g_signal_connect (object, "changed",
+      G_CALLBACK (terminal_preferences_dialog_background_mode), dialog);
+  terminal_preferences_dialog_background_mode (GTK_WIDGET (object), dialog);
 
-  /* position scale */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "scale-position");
+  /* background image file */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "background-image-file");
   terminal_return_if_fail (G_IS_OBJECT (object));
-  for (i = 0; i <= 100; i += 25)
-    gtk_scale_add_mark (GTK_SCALE (object), i, GTK_POS_BOTTOM, NULL);
+  dialog->bg_image_signal_id = g_signal_connect (G_OBJECT (dialog->preferences),
+      "notify::background-image-file", G_CALLBACK (terminal_preferences_dialog_background_notify), object);
+  terminal_preferences_dialog_background_notify (G_OBJECT (dialog->preferences), NULL, object);
+  g_signal_connect (object, "file-set",
+      G_CALLBACK (terminal_preferences_dialog_background_set), dialog);
+
+  /* add file filters */
+  filter = gtk_file_filter_new ();
+  gtk_file_filter_set_name (filter, _("All Files"));
+  gtk_file_filter_add_pattern (filter, "*");
+  gtk_file_chooser_add_filter (GTK_FILE_CHOOSER (object), filter);
+
+  /* add "Image Files" filter */
+  filter = gtk_file_filter_new ();
+  gtk_file_filter_set_name (filter, _("Image Files"));
+  gtk_file_filter_add_pixbuf_formats (filter);
+  gtk_file_chooser_add_filter (GTK_FILE_CHOOSER (object), filter);
+  gtk_file_chooser_set_filter (GTK_FILE_CHOOSER (object), filter);
+}
+
+
+
+static void
+terminal_preferences_dialog_setup_colors (TerminalPreferencesDialog *dialog)
+{
+  guint        i;
+  GObject     *object, *object2;
+  gchar        palette_name[16];
+  GBinding    *binding;
+  const gchar *props_active[] = { "color-background-vary", "color-bold-is-bright",
+                                  "color-use-theme"
+                                };
+  const gchar *props_color[] =  { "color-foreground", "color-background",
+                                  "tab-activity-color", "color-cursor-foreground",
+                                  "color-cursor", "color-selection",
+                                  "color-selection-background", "color-bold"
+                                };
+
+  /* bind active properties */
+  for (i = 0; i < G_N_ELEMENTS (props_active); i++)
+    BIND_PROPERTIES (props_active[i], "active");
+
+  /* bind color properties and click handler */
+  for (i = 0; i < G_N_ELEMENTS (props_color); i++)
+    {
+      BIND_PROPERTIES (props_color[i], "rgba");
+      g_signal_connect (object, "button-press-event",
+          G_CALLBACK (terminal_preferences_dialog_color_press_event), object);
+    }
+
+  /* bind color palette properties */
+  for (i = 1; i <= 16; i++)
+    {
+      g_snprintf (palette_name, sizeof (palette_name), "color-palette%d", i);
+      object = gtk_builder_get_object (GTK_BUILDER (dialog), palette_name);
+      terminal_return_if_fail (G_IS_OBJECT (object));
+      g_signal_connect (object, "color-set",
+          G_CALLBACK (terminal_preferences_dialog_palette_changed), dialog);
+
+#if GTK_CHECK_VERSION (3, 20, 0)
+      /* don't show palette when editing colors */
+      g_object_set (object, "show-editor", TRUE, NULL);
+#endif
+    }
+
+  /* watch color changes in property */
+  dialog->palette_signal_id = g_signal_connect_swapped (G_OBJECT (dialog->preferences),
+      "notify::color-palette", G_CALLBACK (terminal_preferences_dialog_palette_notify), dialog);
+  terminal_preferences_dialog_palette_notify (dialog);
+
+  /* color presets */
+  terminal_preferences_dialog_presets_load (dialog);
+
+#if !VTE_CHECK_VERSION (0, 51, 3)
+  /* hide "Bold is bright" if vte doesn't support it */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "color-bold-is-bright");
+  terminal_return_if_fail (G_IS_OBJECT (object));
+  gtk_widget_hide (GTK_WIDGET (object));
+#endif
 
   /* inverted custom colors and set sensitivity */
   object = gtk_builder_get_object (GTK_BUILDER (dialog), "color-use-theme");
@@ -429,57 +628,67 @@ terminal_preferences_dialog_init (TerminalPreferencesDialog *dialog)
   g_object_bind_property (object, "active",
                           object2, "sensitive",
                           G_BINDING_SYNC_CREATE);
+}
 
-#ifdef GDK_WINDOWING_X11
-  terminal_preferences_dialog_geometry_changed (dialog);
-  dialog->geometry_signal_id = g_signal_connect_swapped (G_OBJECT (dialog->preferences),
-      "notify::misc-default-geometry",
-      G_CALLBACK (terminal_preferences_dialog_geometry_changed), dialog);
 
-  /* geo changes */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "geo-columns");
-  terminal_return_if_fail (G_IS_OBJECT (object));
-  g_signal_connect (object, "value-changed",
-      G_CALLBACK (terminal_preferences_dialog_geometry_columns), dialog);
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "geo-rows");
+
+static void
+terminal_preferences_dialog_setup_compat (TerminalPreferencesDialog *dialog)
+{
+  guint        i;
+  GObject     *object;
+  GBinding    *binding;
+  const gchar *props_active[] = { "binding-backspace", "binding-delete",
+                                  "binding-ambiguous-width"
+                                };
+
+  /* bind active properties */
+  for (i = 0; i < G_N_ELEMENTS (props_active); i++)
+    BIND_PROPERTIES (props_active[i], "active");
+
+  /* reset comparibility button */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "reset-compatibility");
   terminal_return_if_fail (G_IS_OBJECT (object));
-  g_signal_connect (object, "value-changed",
-      G_CALLBACK (terminal_preferences_dialog_geometry_rows), dialog);
-#else
-  /* hide */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "geo-box");
+  g_signal_connect (object, "clicked",
+      G_CALLBACK (terminal_preferences_dialog_reset_compat), dialog);
+}
+
+
+
+static void
+terminal_preferences_dialog_setup_advanced (TerminalPreferencesDialog *dialog)
+{
+  guint         i;
+  GObject      *object;
+  GBinding     *binding;
+  GtkTreeModel *model;
+  gchar        *current;
+  GtkTreeIter   current_iter;
+  const gchar  *props_active[] = { "misc-tab-close-middle-click", "misc-middle-click-opens-uri",
+                                   "misc-mouse-autohide", "misc-rewrap-on-resize",
+                                   "misc-new-tab-adjacent", "misc-bell",
+                                   "misc-bell-urgent", "shortcuts-no-helpkey",
+                                   "shortcuts-no-mnemonics", "shortcuts-no-menukey"
+                                 };
+
+  /* bind active properties */
+  for (i = 0; i < G_N_ELEMENTS (props_active); i++)
+    BIND_PROPERTIES (props_active[i], "active");
+
+  BIND_PROPERTIES ("word-chars", "text");
+
+#if VTE_CHECK_VERSION (0, 58, 0)
+  /* hide "Rewrap on resize" if vte's support for it has been dropped */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "misc-rewrap-on-resize");
   terminal_return_if_fail (G_IS_OBJECT (object));
   gtk_widget_hide (GTK_WIDGET (object));
 #endif
 
-  /* background widgets visibility */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "background-mode");
-  terminal_return_if_fail (G_IS_OBJECT (object));
-  g_signal_connect (object, "changed",
-      G_CALLBACK (terminal_preferences_dialog_background_mode), dialog);
-  terminal_preferences_dialog_background_mode (GTK_WIDGET (object), dialog);
-
-  /* background image file */
-  object = gtk_builder_get_object (GTK_BUILDER (dialog), "background-image-file");
+  /* reset word-chars button */
+  object = gtk_builder_get_object (GTK_BUILDER (dialog), "reset-word-chars");
   terminal_return_if_fail (G_IS_OBJECT (object));
-  dialog->bg_image_signal_id = g_signal_connect (G_OBJECT (dialog->preferences),
-      "notify::background-image-file", G_CALLBACK (terminal_preferences_dialog_background_notify), object);
-  terminal_preferences_dialog_background_notify (G_OBJECT (dialog->preferences), NULL, object);
-  g_signal_connect (object, "file-set",
-      G_CALLBACK (terminal_preferences_dialog_background_set), dialog);
-
-  /* add file filters */
-  filter = gtk_file_filter_new ();
-  gtk_file_filter_set_name (filter, _("All Files"));
-  gtk_file_filter_add_pattern (filter, "*");
-  gtk_file_chooser_add_filter (GTK_FILE_CHOOSER (object), filter);
-
-  /* add "Image Files" filter */
-  filter = gtk_file_filter_new ();
-  gtk_file_filter_set_name (filter, _("Image Files"));
-  gtk_file_filter_add_pixbuf_formats (filter);
-  gtk_file_chooser_add_filter (GTK_FILE_CHOOSER (object), filter);
-  gtk_file_chooser_set_filter (GTK_FILE_CHOOSER (object), filter);
+  g_signal_connect (object, "clicked",
+      G_CALLBACK (terminal_preferences_dialog_reset_word_chars), dialog);
 
   /* encoding combo */
   object = gtk_builder_get_object (GTK_BUILDER (dialog), "encoding-combo");
@@ -577,7 +786,7 @@ terminal_preferences_dialog_response (GtkWidget                 *widget,
       /* if the drop-down preferences are shown, we open that page in the wiki */
       notebook = gtk_builder_get_object (GTK_BUILDER (dialog), "notebook");
       terminal_return_if_fail (GTK_IS_NOTEBOOK (notebook));
-      object = gtk_builder_get_object (GTK_BUILDER (dialog), "dropdown-box");
+      object = gtk_builder_get_object (GTK_BUILDER (dialog), "page-dropdown");
       terminal_return_if_fail (G_IS_OBJECT (object));
       if (gtk_notebook_page_num (GTK_NOTEBOOK (notebook), GTK_WIDGET (object))
           == gtk_notebook_get_current_page (GTK_NOTEBOOK (notebook)))
@@ -1141,11 +1350,11 @@ terminal_preferences_dialog_new (gboolean show_drop_down,
       g_object_add_weak_pointer (G_OBJECT (builder), (gpointer) &builder);
     }
 
-  object = gtk_builder_get_object (builder, "dropdown-box");
+  object = gtk_builder_get_object (builder, "page-dropdown");
   terminal_return_val_if_fail (GTK_IS_WIDGET (object), NULL);
   gtk_widget_set_visible (GTK_WIDGET (object), show_drop_down);
 
-  /* focus the drop-down tab if in drop-down mode */
+  /* focus the drop-down tab if in drop-down mode, this builds it */
   if (show_drop_down && drop_down_mode)
     {
       notebook = gtk_builder_get_object (builder, "notebook");
@@ -1154,17 +1363,6 @@ terminal_preferences_dialog_new (gboolean show_drop_down,
           gtk_notebook_page_num (GTK_NOTEBOOK (notebook), GTK_WIDGET (object)));
     }
 
-  /* show warning and disable control if WM does not support compositing */
-  if (show_drop_down && !gdk_screen_is_composited (gtk_widget_get_screen (GTK_WIDGET (object))))
-    {
-      object = gtk_builder_get_object (builder, "dropdown-opacity-not-available");
-      terminal_return_val_if_fail (G_IS_OBJECT (object), NULL);
-      gtk_widget_set_visible (GTK_WIDGET (object), TRUE);
-      object = gtk_builder_get_object (builder, "scale-opacity");
-      terminal_return_val_if_fail (G_IS_OBJECT (object), NULL);
-      gtk_widget_set_sensitive (GTK_WIDGET (object), FALSE);
-    }
-
   dialog = gtk_builder_get_object (builder, "dialog");
   terminal_return_val_if_fail (XFCE_IS_TITLED_DIALOG (dialog), NULL);
   gtk_window_set_type_hint (GTK_WINDOW (dialog), GDK_WINDOW_TYPE_HINT_DIALOG);
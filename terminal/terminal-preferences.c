@@ -115,6 +115,9 @@ enum
   PROP_MISC_NEW_TAB_ADJACENT,
   PROP_MISC_SEARCH_DIALOG_OPACITY,
   PROP_MISC_SHOW_UNSAFE_PASTE_DIALOG,
+  PROP_MISC_PTY_HOLDER,
+  PROP_MISC_RECOVER_WINDOWS,
+  PROP_MISC_DBUS_CONTROL,
   PROP_SCROLLING_BAR,
   PROP_SCROLLING_LINES,
   PROP_SCROLLING_ON_OUTPUT,
@@ -1080,6 +1083,45 @@ terminal_preferences_class_init (TerminalPreferencesClass *klass)
                             TRUE,
                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * TerminalPreferences:misc-pty-holder:
+   *
+   * Run the shells in a separate process that keeps them alive when
+   * the terminal exits, so the next instance can take them back.
+   **/
+  preferences_props[PROP_MISC_PTY_HOLDER] =
+      g_param_spec_boolean ("misc-pty-holder",
+                            NULL,
+                            "MiscPtyHolder",
+                            FALSE,
+                            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * TerminalPreferences:misc-recover-windows:
+   *
+   * Keep a journal of the windows and reopen them on the next start
+   * when the terminal did not exit cleanly.
+   **/
+  preferences_props[PROP_MISC_RECOVER_WINDOWS] =
+      g_param_spec_boolean ("misc-recover-windows",
+                            NULL,
+                            "MiscRecoverWindows",
+                            FALSE,
+                            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * TerminalPreferences:misc-dbus-control:
+   *
+   * Allow other programs of the user to type into the terminals and
+   * read their contents over d-bus.
+   **/
+  preferences_props[PROP_MISC_DBUS_CONTROL] =
+      g_param_spec_boolean ("misc-dbus-control",
+                            NULL,
+                            "MiscDbusControl",
+                            FALSE,
+                            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   /**
    * TerminalPreferences:scrolling-bar:
    **/
@@ -0,0 +1,1325 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_SIGNAL_H
+#include <signal.h>
+#endif
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_SYS_UN_H
+#include <sys/un.h>
+#endif
+#ifdef HAVE_TERMIOS_H
+#include <termios.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <gio/gio.h>
+#include <glib-unix.h>
+#include <glib/gstdio.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include <terminal/terminal-private.h>
+#include <terminal/terminal-pty-holder.h>
+
+/* output of a detached session kept for the next attach */
+#define HOLDER_RING_SIZE       (256 * 1024)
+/* milliseconds a client waits for a holder it started */
+#define HOLDER_CONNECT_TIMEOUT (1000)
+/* seconds a holder without sessions waits for its first client */
+#define HOLDER_IDLE_TIMEOUT    (10)
+/* largest message accepted from the other side */
+#define HOLDER_MESSAGE_MAX     (16 * 1024 * 1024)
+
+
+
+enum
+{
+  /* client to holder */
+  MESSAGE_SPAWN = 1,
+  MESSAGE_ATTACH,
+  MESSAGE_CLOSE,
+
+  /* holder to client */
+  MESSAGE_SESSION,
+  MESSAGE_DONE,
+  MESSAGE_ERROR
+};
+
+/* flags of a spawn message */
+enum
+{
+  HOLDER_FLAG_FILE_AND_ARGV_ZERO = 1 << 0
+};
+
+/* Each message on the socket is this header followed by size bytes of
+ * payload. A session message carries the pty master as SCM_RIGHTS
+ * ancillary data on its first byte. */
+typedef struct
+{
+  guint32 size;
+  guint32 type;
+  guint32 id;
+  guint32 arg;
+  guint32 flags;
+} HolderMessage;
+
+typedef struct _Holder       Holder;
+typedef struct _HolderClient HolderClient;
+
+typedef struct
+{
+  Holder       *holder;
+  guint32       id;
+  GPid          pid;
+  gint          fd;
+
+  /* reads the pty while no client has it */
+  guint         watch_id;
+  guint8       *ring;
+  gsize         ring_start;
+  gsize         ring_length;
+
+  HolderClient *client;
+  guint         closed : 1;
+} HolderSession;
+
+struct _HolderClient
+{
+  Holder     *holder;
+  gint        fd;
+  guint       watch_id;
+  GByteArray *buffer;
+};
+
+struct _Holder
+{
+  GMainLoop  *loop;
+  gchar      *path;
+  gint        listen_fd;
+
+  GHashTable *sessions;
+  GSList     *clients;
+  guint32     last_id;
+};
+
+typedef struct
+{
+  GPid    pid;
+  gint    fd;
+  GBytes *output;
+} ClientSession;
+
+typedef struct
+{
+  GString                    *payload;
+  guint32                     n_argv;
+  guint32                     flags;
+  TerminalPtyHolderSpawnFunc  func;
+  gpointer                    user_data;
+} ClientRequest;
+
+
+
+static gchar   *terminal_pty_holder_socket_path    (void);
+static gint     terminal_pty_holder_connect_socket (const gchar         *path);
+static gboolean terminal_pty_holder_send           (gint                 fd,
+                                                    const HolderMessage *message,
+                                                    gconstpointer        payload,
+                                                    gint                 pass_fd);
+static gboolean terminal_pty_holder_receive        (gint                 fd,
+                                                    HolderMessage       *message,
+                                                    gchar              **payload,
+                                                    gint                *pass_fd);
+static void     terminal_pty_holder_child_setup    (gpointer             user_data);
+static void     terminal_pty_holder_holder_setup   (gpointer             user_data);
+static void     terminal_pty_holder_ready_notify   (void);
+static void     terminal_pty_holder_ring_append    (HolderSession       *session,
+                                                    const guint8        *data,
+                                                    gsize                length);
+static gboolean terminal_pty_holder_session_read   (gint                 fd,
+                                                    GIOCondition         condition,
+                                                    gpointer             user_data);
+static void     terminal_pty_holder_session_detach (HolderSession       *session);
+static void     terminal_pty_holder_session_free   (gpointer             data);
+static void     terminal_pty_holder_child_exited   (GPid                 pid,
+                                                    gint                 status,
+                                                    gpointer             user_data);
+static void     terminal_pty_holder_check_idle     (Holder              *holder);
+static void     terminal_pty_holder_spawn_session  (HolderClient        *client,
+                                                    const HolderMessage *message,
+                                                    const gchar         *payload);
+static void     terminal_pty_holder_attach_all     (HolderClient        *client);
+static void     terminal_pty_holder_client_free    (HolderClient        *client);
+static gboolean terminal_pty_holder_client_read    (gint                 fd,
+                                                    GIOCondition         condition,
+                                                    gpointer             user_data);
+static gboolean terminal_pty_holder_accept         (gint                 fd,
+                                                    GIOCondition         condition,
+                                                    gpointer             user_data);
+static gboolean terminal_pty_holder_idle_timeout   (gpointer             user_data);
+static gboolean terminal_pty_holder_start          (GError             **error);
+static gboolean terminal_pty_holder_ready          (gint                 fd,
+                                                    GIOCondition         condition,
+                                                    gpointer             user_data);
+static gboolean terminal_pty_holder_start_timeout  (gpointer             user_data);
+static void     terminal_pty_holder_started        (gboolean             ready);
+static void     terminal_pty_holder_request        (ClientRequest       *request,
+                                                    GError              *error);
+static void     terminal_pty_holder_disconnect     (void);
+
+
+
+/* connection of this terminal to the holder */
+static gint        client_fd = -1;
+static GHashTable *client_sessions = NULL;
+
+/* spawn requests waiting for a holder we started to listen */
+static GSList     *client_requests = NULL;
+static gint        client_ready_fd = -1;
+static guint       client_ready_id = 0;
+static guint       client_timeout_id = 0;
+
+
+
+static gchar *
+terminal_pty_holder_socket_path (void)
+{
+  return g_build_filename (g_get_user_runtime_dir (), PACKAGE_NAME "-pty-holder", NULL);
+}
+
+
+
+static gint
+terminal_pty_holder_connect_socket (const gchar *path)
+{
+  struct sockaddr_un addr;
+  gint               fd;
+
+  fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (G_UNLIKELY (fd == -1))
+    return -1;
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  g_strlcpy (addr.sun_path, path, sizeof (addr.sun_path));
+
+  if (connect (fd, (struct sockaddr *) &addr, sizeof (addr)) != 0)
+    {
+      close (fd);
+      return -1;
+    }
+
+  return fd;
+}
+
+
+
+static gboolean
+terminal_pty_holder_send (gint                 fd,
+                          const HolderMessage *message,
+                          gconstpointer        payload,
+                          gint                 pass_fd)
+{
+  struct msghdr   msg;
+  struct iovec    iov[2];
+  struct cmsghdr *cmsg;
+  gssize          n;
+  union
+  {
+    struct cmsghdr align;
+    gchar          buf[CMSG_SPACE (sizeof (gint))];
+  } control;
+
+  iov[0].iov_base = (gpointer) message;
+  iov[0].iov_len = sizeof (*message);
+  iov[1].iov_base = (gpointer) payload;
+  iov[1].iov_len = message->size;
+
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = message->size > 0 ? 2 : 1;
+
+  if (pass_fd != -1)
+    {
+      memset (&control, 0, sizeof (control));
+      msg.msg_control = control.buf;
+      msg.msg_controllen = sizeof (control.buf);
+
+      cmsg = CMSG_FIRSTHDR (&msg);
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN (sizeof (gint));
+      memcpy (CMSG_DATA (cmsg), &pass_fd, sizeof (gint));
+    }
+
+  while (msg.msg_iovlen > 0)
+    {
+      n = sendmsg (fd, &msg, MSG_NOSIGNAL);
+      if (G_UNLIKELY (n < 0))
+        {
+          if (errno == EINTR)
+            continue;
+          return FALSE;
+        }
+
+      /* the descriptor went with the first byte */
+      msg.msg_control = NULL;
+      msg.msg_controllen = 0;
+
+      while (msg.msg_iovlen > 0 && (gsize) n >= msg.msg_iov->iov_len)
+        {
+          n -= msg.msg_iov->iov_len;
+          msg.msg_iov++;
+          msg.msg_iovlen--;
+        }
+
+      if (msg.msg_iovlen > 0)
+        {
+          msg.msg_iov->iov_base = (guint8 *) msg.msg_iov->iov_base + n;
+          msg.msg_iov->iov_len -= n;
+        }
+    }
+
+  return TRUE;
+}
+
+
+
+static gboolean
+terminal_pty_holder_receive (gint            fd,
+                             HolderMessage  *message,
+                             gchar         **payload,
+                             gint           *pass_fd)
+{
+  struct msghdr   msg;
+  struct iovec    iov;
+  struct cmsghdr *cmsg;
+  gsize           done = 0;
+  gssize          n;
+  gint            flags = 0;
+  union
+  {
+    struct cmsghdr align;
+    gchar          buf[CMSG_SPACE (sizeof (gint))];
+  } control;
+
+  *payload = NULL;
+  *pass_fd = -1;
+
+#ifdef MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+  while (done < sizeof (*message))
+    {
+      iov.iov_base = (guint8 *) message + done;
+      iov.iov_len = sizeof (*message) - done;
+
+      memset (&msg, 0, sizeof (msg));
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      msg.msg_control = control.buf;
+      msg.msg_controllen = sizeof (control.buf);
+
+      n = recvmsg (fd, &msg, flags);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        goto failed;
+
+      for (cmsg = CMSG_FIRSTHDR (&msg); cmsg != NULL; cmsg = CMSG_NXTHDR (&msg, cmsg))
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && *pass_fd == -1)
+          {
+            memcpy (pass_fd, CMSG_DATA (cmsg), sizeof (gint));
+            fcntl (*pass_fd, F_SETFD, FD_CLOEXEC);
+          }
+
+      done += n;
+    }
+
+  if (G_UNLIKELY (message->size > HOLDER_MESSAGE_MAX))
+    goto failed;
+
+  *payload = g_malloc (message->size + 1);
+  for (done = 0; done < message->size; done += n)
+    {
+      n = read (fd, *payload + done, message->size - done);
+      if (n < 0 && errno == EINTR)
+        n = 0;
+      else if (n <= 0)
+        goto failed;
+    }
+  (*payload)[message->size] = '\0';
+
+  return TRUE;
+
+failed:
+  if (*pass_fd != -1)
+    close (*pass_fd);
+  *pass_fd = -1;
+  g_free (*payload);
+  *payload = NULL;
+  return FALSE;
+}
+
+
+
+static void
+terminal_pty_holder_child_setup (gpointer user_data)
+{
+  const gchar *name = user_data;
+  gint         fd;
+
+  /* the pty becomes the controlling terminal of a new session */
+  setsid ();
+
+  fd = open (name, O_RDWR);
+  if (fd == -1)
+    _exit (127);
+
+#ifdef TIOCSCTTY
+  ioctl (fd, TIOCSCTTY, 0);
+#endif
+
+  dup2 (fd, STDIN_FILENO);
+  dup2 (fd, STDOUT_FILENO);
+  dup2 (fd, STDERR_FILENO);
+  if (fd > STDERR_FILENO)
+    close (fd);
+}
+
+
+
+static void
+terminal_pty_holder_holder_setup (gpointer user_data)
+{
+  /* leave the session of the terminal, so it can quit without us */
+  setsid ();
+}
+
+
+
+static void
+terminal_pty_holder_ready_notify (void)
+{
+  gint fd;
+
+  /* the terminal that started us waits for a byte on our stdout, see
+   * terminal_pty_holder_start(), nothing else is written to it */
+  if (write (STDOUT_FILENO, "\n", 1) != 1)
+    return;
+
+  fd = open ("/dev/null", O_WRONLY);
+  if (fd != -1)
+    {
+      dup2 (fd, STDOUT_FILENO);
+      close (fd);
+    }
+}
+
+
+
+static void
+terminal_pty_holder_ring_append (HolderSession *session,
+                                 const guint8  *data,
+                                 gsize          length)
+{
+  gsize pos, n;
+
+  /* only the end of a long burst fits */
+  if (length > HOLDER_RING_SIZE)
+    {
+      data += length - HOLDER_RING_SIZE;
+      length = HOLDER_RING_SIZE;
+    }
+
+  if (session->ring == NULL)
+    session->ring = g_malloc (HOLDER_RING_SIZE);
+
+  pos = (session->ring_start + session->ring_length) % HOLDER_RING_SIZE;
+  n = MIN (length, HOLDER_RING_SIZE - pos);
+  memcpy (session->ring + pos, data, n);
+  memcpy (session->ring, data + n, length - n);
+
+  session->ring_length += length;
+  if (session->ring_length > HOLDER_RING_SIZE)
+    {
+      session->ring_start = (session->ring_start + session->ring_length - HOLDER_RING_SIZE) % HOLDER_RING_SIZE;
+      session->ring_length = HOLDER_RING_SIZE;
+    }
+}
+
+
+
+static gboolean
+terminal_pty_holder_session_read (gint         fd,
+                                  GIOCondition condition,
+                                  gpointer     user_data)
+{
+  HolderSession *session = user_data;
+  guint8         buffer[8192];
+  gssize         n;
+
+  n = read (fd, buffer, sizeof (buffer));
+  if (n > 0)
+    {
+      terminal_pty_holder_ring_append (session, buffer, n);
+      return TRUE;
+    }
+
+  if (n < 0 && (errno == EINTR || errno == EAGAIN))
+    return TRUE;
+
+  /* the child is gone, the child watch cleans up */
+  session->watch_id = 0;
+  return FALSE;
+}
+
+
+
+static void
+terminal_pty_holder_session_detach (HolderSession *session)
+{
+  session->client = NULL;
+
+  /* keep draining the pty so the child never blocks on output */
+  if (session->watch_id == 0)
+    session->watch_id = g_unix_fd_add (session->fd, G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                       terminal_pty_holder_session_read, session);
+}
+
+
+
+static void
+terminal_pty_holder_session_free (gpointer data)
+{
+  HolderSession *session = data;
+
+  if (session->watch_id != 0)
+    g_source_remove (session->watch_id);
+
+  close (session->fd);
+  g_spawn_close_pid (session->pid);
+  g_free (session->ring);
+  g_slice_free (HolderSession, session);
+}
+
+
+
+static void
+terminal_pty_holder_child_exited (GPid     pid,
+                                  gint     status,
+                                  gpointer user_data)
+{
+  HolderSession *session = user_data;
+  Holder        *holder = session->holder;
+
+  g_hash_table_remove (holder->sessions, GUINT_TO_POINTER (session->id));
+  terminal_pty_holder_check_idle (holder);
+}
+
+
+
+static void
+terminal_pty_holder_check_idle (Holder *holder)
+{
+  if (g_hash_table_size (holder->sessions) == 0 && holder->clients == NULL)
+    g_main_loop_quit (holder->loop);
+}
+
+
+
+static void
+terminal_pty_holder_spawn_session (HolderClient        *client,
+                                   const HolderMessage *message,
+                                   const gchar         *payload)
+{
+  Holder         *holder = client->holder;
+  HolderSession  *session;
+  HolderMessage   reply = { 0, };
+  struct winsize  size;
+  GPtrArray      *argv, *env;
+  const gchar    *p, *end, *directory;
+  gchar          *name = NULL;
+  GError         *error = NULL;
+  GSpawnFlags     flags;
+  GPid            pid;
+  guint32         numbers[2];
+  gint            fd;
+
+  /* the columns and rows, the directory, argv and then the environment */
+  if (G_UNLIKELY (message->size < sizeof (numbers) || payload[message->size - 1] != '\0'))
+    {
+      g_set_error_literal (&error, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED, "Malformed request");
+      goto failed;
+    }
+
+  memcpy (numbers, payload, sizeof (numbers));
+  p = payload + sizeof (numbers);
+  end = payload + message->size;
+
+  directory = p;
+  p += strlen (p) + 1;
+
+  argv = g_ptr_array_new ();
+  env = g_ptr_array_new ();
+  for (; p < end; p += strlen (p) + 1)
+    g_ptr_array_add (argv->len < message->arg ? argv : env, (gpointer) p);
+  g_ptr_array_add (argv, NULL);
+  g_ptr_array_add (env, NULL);
+
+  fd = posix_openpt (O_RDWR | O_NOCTTY);
+  if (fd != -1 && grantpt (fd) == 0 && unlockpt (fd) == 0)
+    name = g_strdup (ptsname (fd));
+
+  if (G_UNLIKELY (name == NULL))
+    {
+      g_set_error (&error, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED,
+                   "Failed to open a pty: %s", g_strerror (errno));
+      if (fd != -1)
+        close (fd);
+      fd = -1;
+    }
+  else
+    {
+      fcntl (fd, F_SETFD, FD_CLOEXEC);
+      fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+
+      size.ws_col = numbers[0];
+      size.ws_row = numbers[1];
+      size.ws_xpixel = size.ws_ypixel = 0;
+      ioctl (fd, TIOCSWINSZ, &size);
+
+      flags = G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_SEARCH_PATH;
+      if ((message->flags & HOLDER_FLAG_FILE_AND_ARGV_ZERO) != 0)
+        flags |= G_SPAWN_FILE_AND_ARGV_ZERO;
+
+      if (!g_spawn_async (*directory != '\0' ? directory : NULL,
+                          (gchar **) argv->pdata, (gchar **) env->pdata, flags,
+                          terminal_pty_holder_child_setup, name, &pid, &error))
+        {
+          close (fd);
+          fd = -1;
+        }
+    }
+
+  g_free (name);
+  g_ptr_array_free (argv, TRUE);
+  g_ptr_array_free (env, TRUE);
+
+  if (fd == -1)
+    goto failed;
+
+  session = g_slice_new0 (HolderSession);
+  session->holder = holder;
+  session->id = ++holder->last_id;
+  session->pid = pid;
+  session->fd = fd;
+  session->client = client;
+  g_hash_table_insert (holder->sessions, GUINT_TO_POINTER (session->id), session);
+  g_child_watch_add (pid, terminal_pty_holder_child_exited, session);
+
+  reply.type = MESSAGE_SESSION;
+  reply.id = session->id;
+  reply.arg = pid;
+  terminal_pty_holder_send (client->fd, &reply, NULL, fd);
+  return;
+
+failed:
+  reply.type = MESSAGE_ERROR;
+  reply.size = strlen (error->message) + 1;
+  terminal_pty_holder_send (client->fd, &reply, error->message, -1);
+  g_error_free (error);
+}
+
+
+
+static void
+terminal_pty_holder_attach_all (HolderClient *client)
+{
+  GHashTableIter  iter;
+  HolderSession  *session;
+  HolderMessage   reply = { 0, };
+  guint8         *output;
+  gsize           n;
+
+  g_hash_table_iter_init (&iter, client->holder->sessions);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &session))
+    {
+      if (session->client != NULL || session->closed)
+        continue;
+
+      /* stop reading, output from now on is for the client */
+      if (session->watch_id != 0)
+        {
+          g_source_remove (session->watch_id);
+          session->watch_id = 0;
+        }
+
+      output = g_malloc (session->ring_length + 1);
+      n = MIN (session->ring_length, HOLDER_RING_SIZE - session->ring_start);
+      if (session->ring != NULL)
+        {
+          memcpy (output, session->ring + session->ring_start, n);
+          memcpy (output + n, session->ring, session->ring_length - n);
+        }
+
+      reply.type = MESSAGE_SESSION;
+      reply.id = session->id;
+      reply.arg = session->pid;
+      reply.size = session->ring_length;
+      terminal_pty_holder_send (client->fd, &reply, output, session->fd);
+      g_free (output);
+
+      g_free (session->ring);
+      session->ring = NULL;
+      session->ring_start = session->ring_length = 0;
+      session->client = client;
+    }
+
+  memset (&reply, 0, sizeof (reply));
+  reply.type = MESSAGE_DONE;
+  terminal_pty_holder_send (client->fd, &reply, NULL, -1);
+}
+
+
+
+static void
+terminal_pty_holder_client_free (HolderClient *client)
+{
+  Holder         *holder = client->holder;
+  GHashTableIter  iter;
+  HolderSession  *session;
+
+  g_hash_table_iter_init (&iter, holder->sessions);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &session))
+    if (session->client == client)
+      terminal_pty_holder_session_detach (session);
+
+  holder->clients = g_slist_remove (holder->clients, client);
+
+  g_source_remove (client->watch_id);
+  close (client->fd);
+  g_byte_array_free (client->buffer, TRUE);
+  g_slice_free (HolderClient, client);
+}
+
+
+
+static gboolean
+terminal_pty_holder_client_read (gint         fd,
+                                 GIOCondition condition,
+                                 gpointer     user_data)
+{
+  HolderClient  *client = user_data;
+  Holder        *holder = client->holder;
+  HolderSession *session;
+  HolderMessage  message;
+  guint8         buffer[8192];
+  gssize         n;
+
+  n = read (fd, buffer, sizeof (buffer));
+  if (n < 0 && (errno == EINTR || errno == EAGAIN))
+    return TRUE;
+
+  if (n <= 0)
+    {
+      /* the terminal quit or crashed, its sessions wait for the next one */
+      terminal_pty_holder_client_free (client);
+      terminal_pty_holder_check_idle (holder);
+      return FALSE;
+    }
+
+  g_byte_array_append (client->buffer, buffer, n);
+
+  while (client->buffer->len >= sizeof (message))
+    {
+      memcpy (&message, client->buffer->data, sizeof (message));
+      if (G_UNLIKELY (message.size > HOLDER_MESSAGE_MAX))
+        {
+          terminal_pty_holder_client_free (client);
+          terminal_pty_holder_check_idle (holder);
+          return FALSE;
+        }
+
+      if (client->buffer->len < sizeof (message) + message.size)
+        break;
+
+      switch (message.type)
+        {
+        case MESSAGE_SPAWN:
+          terminal_pty_holder_spawn_session (client, &message,
+              (const gchar *) client->buffer->data + sizeof (message));
+          break;
+
+        case MESSAGE_ATTACH:
+          terminal_pty_holder_attach_all (client);
+          break;
+
+        case MESSAGE_CLOSE:
+          /* the tab was closed, hang up like the terminal would */
+          session = g_hash_table_lookup (holder->sessions, GUINT_TO_POINTER (message.id));
+          if (session != NULL && !session->closed)
+            {
+              session->closed = TRUE;
+              kill (-session->pid, SIGHUP);
+              if (session->client == client)
+                terminal_pty_holder_session_detach (session);
+            }
+          break;
+        }
+
+      g_byte_array_remove_range (client->buffer, 0, sizeof (message) + message.size);
+    }
+
+  return TRUE;
+}
+
+
+
+static gboolean
+terminal_pty_holder_accept (gint         fd,
+                            GIOCondition condition,
+                            gpointer     user_data)
+{
+  Holder       *holder = user_data;
+  HolderClient *client;
+  gint          connection;
+
+  connection = accept (fd, NULL, NULL);
+  if (G_UNLIKELY (connection == -1))
+    return TRUE;
+
+  fcntl (connection, F_SETFD, FD_CLOEXEC);
+
+  client = g_slice_new0 (HolderClient);
+  client->holder = holder;
+  client->fd = connection;
+  client->buffer = g_byte_array_new ();
+  client->watch_id = g_unix_fd_add (connection, G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                    terminal_pty_holder_client_read, client);
+  holder->clients = g_slist_prepend (holder->clients, client);
+
+  return TRUE;
+}
+
+
+
+static gboolean
+terminal_pty_holder_idle_timeout (gpointer user_data)
+{
+  terminal_pty_holder_check_idle (user_data);
+  return FALSE;
+}
+
+
+
+static gboolean
+terminal_pty_holder_start (GError **error)
+{
+  gchar    *argv[3];
+  gboolean  succeed;
+
+  /* start a holder from the same binary, in its own session; it
+   * writes a byte to its stdout once it listens, so the pipe tells us
+   * when to connect and eof without a byte that it failed */
+  argv[0] = g_file_read_link ("/proc/self/exe", NULL);
+  if (argv[0] == NULL)
+    argv[0] = g_strdup (PACKAGE_NAME);
+  argv[1] = (gchar *) "--pty-holder";
+  argv[2] = NULL;
+
+  succeed = g_spawn_async_with_pipes ("/", argv, NULL,
+                                      G_SPAWN_SEARCH_PATH | G_SPAWN_STDERR_TO_DEV_NULL,
+                                      terminal_pty_holder_holder_setup, NULL, NULL,
+                                      NULL, &client_ready_fd, NULL, error);
+  g_free (argv[0]);
+
+  if (G_UNLIKELY (!succeed))
+    return FALSE;
+
+  fcntl (client_ready_fd, F_SETFD, FD_CLOEXEC);
+  client_ready_id = g_unix_fd_add (client_ready_fd, G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                   terminal_pty_holder_ready, NULL);
+  client_timeout_id = g_timeout_add (HOLDER_CONNECT_TIMEOUT, terminal_pty_holder_start_timeout, NULL);
+
+  return TRUE;
+}
+
+
+
+static gboolean
+terminal_pty_holder_ready (gint         fd,
+                           GIOCondition condition,
+                           gpointer     user_data)
+{
+  gchar   byte;
+  gssize  n;
+
+  n = read (fd, &byte, 1);
+  if (n < 0 && (errno == EINTR || errno == EAGAIN))
+    return TRUE;
+
+  client_ready_id = 0;
+  terminal_pty_holder_started (n == 1);
+
+  return FALSE;
+}
+
+
+
+static gboolean
+terminal_pty_holder_start_timeout (gpointer user_data)
+{
+  client_timeout_id = 0;
+  terminal_pty_holder_started (FALSE);
+
+  return FALSE;
+}
+
+
+
+static void
+terminal_pty_holder_started (gboolean ready)
+{
+  GSList *requests;
+  GSList *lp;
+  GError *error = NULL;
+  gchar  *path;
+
+  if (client_ready_id != 0)
+    g_source_remove (client_ready_id);
+  if (client_timeout_id != 0)
+    g_source_remove (client_timeout_id);
+  client_ready_id = client_timeout_id = 0;
+
+  close (client_ready_fd);
+  client_ready_fd = -1;
+
+  path = terminal_pty_holder_socket_path ();
+  if (ready)
+    client_fd = terminal_pty_holder_connect_socket (path);
+
+  if (G_UNLIKELY (client_fd == -1))
+    g_set_error (&error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                 _("The pty holder did not start listening on \"%s\""), path);
+  g_free (path);
+
+  /* the callbacks may queue new requests */
+  requests = client_requests;
+  client_requests = NULL;
+  for (lp = requests; lp != NULL; lp = lp->next)
+    terminal_pty_holder_request (lp->data, error);
+  g_slist_free (requests);
+
+  if (error != NULL)
+    g_error_free (error);
+}
+
+
+
+static void
+terminal_pty_holder_request (ClientRequest *request,
+                             GError        *error)
+{
+  HolderMessage  message = { 0, };
+  GError        *err = NULL;
+  gchar         *reply = NULL;
+  gint           pass_fd = -1;
+
+  if (error == NULL)
+    {
+      message.size = request->payload->len;
+      message.type = MESSAGE_SPAWN;
+      message.arg = request->n_argv;
+      message.flags = request->flags;
+
+      /* the holder answers right away, it only forks the child */
+      if (!terminal_pty_holder_send (client_fd, &message, request->payload->str, -1)
+          || !terminal_pty_holder_receive (client_fd, &message, &reply, &pass_fd))
+        {
+          g_set_error_literal (&err, G_IO_ERROR, G_IO_ERROR_BROKEN_PIPE,
+                               _("Lost the connection to the pty holder"));
+          terminal_pty_holder_disconnect ();
+        }
+      else if (message.type != MESSAGE_SESSION || pass_fd == -1)
+        {
+          g_set_error_literal (&err, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED, reply);
+          if (pass_fd != -1)
+            close (pass_fd);
+          pass_fd = -1;
+        }
+
+      g_free (reply);
+      error = err;
+    }
+
+  if (error != NULL)
+    (*request->func) (-1, 0, 0, error, request->user_data);
+  else
+    (*request->func) (pass_fd, message.id, message.arg, NULL, request->user_data);
+
+  if (err != NULL)
+    g_error_free (err);
+  g_string_free (request->payload, TRUE);
+  g_slice_free (ClientRequest, request);
+}
+
+
+
+static void
+terminal_pty_holder_disconnect (void)
+{
+  if (client_fd != -1)
+    close (client_fd);
+  client_fd = -1;
+}
+
+
+
+/**
+ * terminal_pty_holder_main:
+ *
+ * Runs the pty holder until it has no sessions and no terminal is
+ * connected anymore. The holder owns the ptys and the children of
+ * the terminals connected to it and buffers the output of sessions
+ * no terminal has.
+ *
+ * Return value: The exit status of the process.
+ **/
+gint
+terminal_pty_holder_main (void)
+{
+  Holder             holder;
+  struct sockaddr_un addr;
+
+  memset (&holder, 0, sizeof (holder));
+  holder.path = terminal_pty_holder_socket_path ();
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen (holder.path) >= sizeof (addr.sun_path))
+    {
+      g_printerr ("%s: socket path too long\n", holder.path);
+      g_free (holder.path);
+      return EXIT_FAILURE;
+    }
+  g_strlcpy (addr.sun_path, holder.path, sizeof (addr.sun_path));
+
+  holder.listen_fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (holder.listen_fd != -1
+      && bind (holder.listen_fd, (struct sockaddr *) &addr, sizeof (addr)) != 0
+      && errno == EADDRINUSE)
+    {
+      /* a live holder answers, a stale socket is replaced */
+      gint fd = terminal_pty_holder_connect_socket (holder.path);
+      if (fd != -1)
+        {
+          close (fd);
+          close (holder.listen_fd);
+          g_free (holder.path);
+          terminal_pty_holder_ready_notify ();
+          return EXIT_SUCCESS;
+        }
+
+      g_unlink (holder.path);
+      if (bind (holder.listen_fd, (struct sockaddr *) &addr, sizeof (addr)) != 0)
+        {
+          close (holder.listen_fd);
+          holder.listen_fd = -1;
+        }
+    }
+
+  if (holder.listen_fd == -1 || listen (holder.listen_fd, 8) != 0)
+    {
+      g_printerr ("%s: %s\n", holder.path, g_strerror (errno));
+      g_free (holder.path);
+      return EXIT_FAILURE;
+    }
+
+  /* tell the terminal that started us it can connect */
+  terminal_pty_holder_ready_notify ();
+
+  /* outlive the terminal that started us */
+  signal (SIGHUP, SIG_IGN);
+
+  holder.loop = g_main_loop_new (NULL, FALSE);
+  holder.sessions = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                           NULL, terminal_pty_holder_session_free);
+
+  g_unix_fd_add (holder.listen_fd, G_IO_IN, terminal_pty_holder_accept, &holder);
+  g_timeout_add_seconds (HOLDER_IDLE_TIMEOUT, terminal_pty_holder_idle_timeout, &holder);
+
+  g_main_loop_run (holder.loop);
+
+  /* stop taking clients before the last ones are dropped */
+  g_unlink (holder.path);
+  close (holder.listen_fd);
+
+  while (holder.clients != NULL)
+    terminal_pty_holder_client_free (holder.clients->data);
+  g_hash_table_destroy (holder.sessions);
+  g_main_loop_unref (holder.loop);
+  g_free (holder.path);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+/**
+ * terminal_pty_holder_spawn:
+ * @working_directory  : Directory of the child, or %NULL.
+ * @argv               : Command of the child.
+ * @env                : Environment of the child.
+ * @file_and_argv_zero : Whether argv[0] is the file and argv[1] the name
+ *                       of the child, see %G_SPAWN_FILE_AND_ARGV_ZERO.
+ * @columns            : Initial width of the pty.
+ * @rows               : Initial height of the pty.
+ * @func               : Called with the pty master, the session id and
+ *                       the child pid, or with an error.
+ * @user_data          : User data for @func.
+ *
+ * Starts @argv on a new pty owned by the holder. If no holder is
+ * running, one is started and @func is called from the main loop once
+ * it listens; otherwise @func is called before this function returns.
+ **/
+void
+terminal_pty_holder_spawn (const gchar                 *working_directory,
+                           gchar                      **argv,
+                           gchar                      **env,
+                           gboolean                     file_and_argv_zero,
+                           glong                        columns,
+                           glong                        rows,
+                           TerminalPtyHolderSpawnFunc   func,
+                           gpointer                     user_data)
+{
+  ClientRequest *request;
+  GError        *error = NULL;
+  guint32        numbers[2];
+  gchar         *path;
+  guint          n;
+
+  terminal_return_if_fail (argv != NULL && argv[0] != NULL);
+  terminal_return_if_fail (func != NULL);
+
+  numbers[0] = columns;
+  numbers[1] = rows;
+
+  request = g_slice_new (ClientRequest);
+  request->payload = g_string_new_len ((const gchar *) numbers, sizeof (numbers));
+  g_string_append_len (request->payload, working_directory != NULL ? working_directory : "", -1);
+  g_string_append_c (request->payload, '\0');
+  for (n = 0; argv[n] != NULL; n++)
+    g_string_append_len (request->payload, argv[n], strlen (argv[n]) + 1);
+  for (; env != NULL && *env != NULL; env++)
+    g_string_append_len (request->payload, *env, strlen (*env) + 1);
+  request->n_argv = n;
+  request->flags = file_and_argv_zero ? HOLDER_FLAG_FILE_AND_ARGV_ZERO : 0;
+  request->func = func;
+  request->user_data = user_data;
+
+  if (client_fd == -1 && client_ready_fd == -1)
+    {
+      path = terminal_pty_holder_socket_path ();
+      client_fd = terminal_pty_holder_connect_socket (path);
+      g_free (path);
+
+      if (client_fd == -1 && !terminal_pty_holder_start (&error))
+        {
+          terminal_pty_holder_request (request, error);
+          g_error_free (error);
+          return;
+        }
+    }
+
+  if (client_ready_fd != -1)
+    client_requests = g_slist_append (client_requests, request);
+  else
+    terminal_pty_holder_request (request, NULL);
+}
+
+
+
+/**
+ * terminal_pty_holder_attach:
+ * @error : Return location for errors.
+ *
+ * Takes over the sessions of the holder that no terminal has, usually
+ * because the terminal that started them crashed or was restarted. The
+ * sessions wait for terminal_pty_holder_claim(). No holder is started
+ * if none is running.
+ *
+ * Return value: The list of session ids, or %NULL.
+ **/
+GSList *
+terminal_pty_holder_attach (GError **error)
+{
+  HolderMessage  message = { 0, };
+  ClientSession *session;
+  GSList        *ids = NULL;
+  gchar         *output;
+  gchar         *path;
+  gint           fd, pass_fd;
+
+  /* without a running holder there is nothing to take over */
+  if (client_fd == -1)
+    {
+      path = terminal_pty_holder_socket_path ();
+      client_fd = terminal_pty_holder_connect_socket (path);
+      g_free (path);
+    }
+
+  fd = client_fd;
+  if (fd == -1)
+    return NULL;
+
+  if (client_sessions == NULL)
+    client_sessions = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  message.type = MESSAGE_ATTACH;
+  if (!terminal_pty_holder_send (fd, &message, NULL, -1))
+    goto failed;
+
+  for (;;)
+    {
+      if (!terminal_pty_holder_receive (fd, &message, &output, &pass_fd))
+        goto failed;
+
+      if (message.type == MESSAGE_DONE)
+        {
+          g_free (output);
+          break;
+        }
+
+      if (message.type != MESSAGE_SESSION || pass_fd == -1)
+        {
+          g_free (output);
+          continue;
+        }
+
+      session = g_slice_new (ClientSession);
+      session->pid = message.arg;
+      session->fd = pass_fd;
+      session->output = g_bytes_new_take (output, message.size);
+      g_hash_table_insert (client_sessions, GUINT_TO_POINTER (message.id), session);
+
+      ids = g_slist_prepend (ids, GUINT_TO_POINTER (message.id));
+    }
+
+  return g_slist_reverse (ids);
+
+failed:
+  g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_BROKEN_PIPE,
+                       _("Lost the connection to the pty holder"));
+  terminal_pty_holder_disconnect ();
+  return g_slist_reverse (ids);
+}
+
+
+
+/**
+ * terminal_pty_holder_claim:
+ * @id     : A session id from terminal_pty_holder_attach().
+ * @pid    : Return location for the child pid.
+ * @output : Return location for the output of the session while it
+ *           was detached.
+ *
+ * Return value: The pty master of session @id, or -1 if the session
+ *               was already claimed.
+ **/
+gint
+terminal_pty_holder_claim (guint    id,
+                           GPid    *pid,
+                           GBytes **output)
+{
+  ClientSession *session;
+  gint           fd;
+
+  if (client_sessions == NULL)
+    return -1;
+
+  session = g_hash_table_lookup (client_sessions, GUINT_TO_POINTER (id));
+  if (session == NULL)
+    return -1;
+
+  g_hash_table_remove (client_sessions, GUINT_TO_POINTER (id));
+
+  fd = session->fd;
+  *pid = session->pid;
+  *output = session->output;
+  g_slice_free (ClientSession, session);
+
+  return fd;
+}
+
+
+
+/**
+ * terminal_pty_holder_close:
+ * @id : A session id.
+ *
+ * Tells the holder the tab of session @id was closed. The holder hangs
+ * up the child and forgets the session once it exits.
+ **/
+void
+terminal_pty_holder_close (guint id)
+{
+  HolderMessage  message = { 0, };
+  ClientSession *session;
+
+  if (client_sessions != NULL)
+    {
+      session = g_hash_table_lookup (client_sessions, GUINT_TO_POINTER (id));
+      if (session != NULL)
+        {
+          g_hash_table_remove (client_sessions, GUINT_TO_POINTER (id));
+          close (session->fd);
+          g_bytes_unref (session->output);
+          g_slice_free (ClientSession, session);
+        }
+    }
+
+  if (client_fd == -1)
+    return;
+
+  message.type = MESSAGE_CLOSE;
+  message.id = id;
+  if (!terminal_pty_holder_send (client_fd, &message, NULL, -1))
+    terminal_pty_holder_disconnect ();
+}
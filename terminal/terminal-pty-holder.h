@@ -0,0 +1,50 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_PTY_HOLDER_H
+#define TERMINAL_PTY_HOLDER_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef void (*TerminalPtyHolderSpawnFunc) (gint          fd,
+                                            guint         id,
+                                            GPid          pid,
+                                            const GError *error,
+                                            gpointer      user_data);
+
+gint    terminal_pty_holder_main   (void);
+
+void    terminal_pty_holder_spawn  (const gchar                 *working_directory,
+                                    gchar                      **argv,
+                                    gchar                      **env,
+                                    gboolean                     file_and_argv_zero,
+                                    glong                        columns,
+                                    glong                        rows,
+                                    TerminalPtyHolderSpawnFunc   func,
+                                    gpointer                     user_data);
+
+GSList *terminal_pty_holder_attach (GError                     **error);
+
+gint    terminal_pty_holder_claim  (guint                        id,
+                                    GPid                        *pid,
+                                    GBytes                     **output);
+
+void    terminal_pty_holder_close  (guint                        id);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_PTY_HOLDER_H */
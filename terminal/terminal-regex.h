@@ -44,6 +44,8 @@
 #ifndef TERMINAL_REGEX_H
 #define TERMINAL_REGEX_H
 
+#include <vte/vte.h>
+
 /* Lookbehind to see if there's a preceding apostrophe */
 #define APOS_START_DEF "(?<APOS_START>(?<='))?"
 
@@ -152,4 +154,35 @@
 #define REGEX_EMAIL      DEFS "(?i:mailto:)?" USER "@" EMAIL_HOST
 #define REGEX_NEWS_MAN   "(?i:news:|man:|info:|magnet:)[-[:alnum:]\\Q^_{|}~!\"#$%&'()*+,./;:=?`\\E]+"
 
+/* The patterns the terminals highlight, shared with tests/test-regex.c */
+
+#if VTE_CHECK_VERSION (0, 45, 90)
+#define REGEX_MATCH_FLAGS (PCRE2_CASELESS | PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE)
+#else
+#define REGEX_MATCH_FLAGS (G_REGEX_CASELESS | G_REGEX_OPTIMIZE | G_REGEX_MULTILINE)
+#endif
+
+typedef enum
+{
+  PATTERN_TYPE_NONE,
+  PATTERN_TYPE_FULL_HTTP,
+  PATTERN_TYPE_HTTP,
+  PATTERN_TYPE_EMAIL
+} PatternType;
+
+typedef struct
+{
+  const gchar *pattern;
+  PatternType  type;
+} TerminalRegexPattern;
+
+static const TerminalRegexPattern regex_patterns[] =
+{
+  { REGEX_URL_AS_IS, PATTERN_TYPE_FULL_HTTP },
+  { REGEX_URL_HTTP,  PATTERN_TYPE_HTTP },
+  { REGEX_URL_FILE,  PATTERN_TYPE_FULL_HTTP },
+  { REGEX_EMAIL,     PATTERN_TYPE_EMAIL },
+  { REGEX_NEWS_MAN,  PATTERN_TYPE_FULL_HTTP },
+};
+
 #endif /* !TERMINAL_REGEX_H */
@@ -44,13 +44,19 @@
 #include <sys/wait.h>
 
 #include <libxfce4ui/libxfce4ui.h>
-#include <xfconf/xfconf.h>
 
 #include <terminal/terminal-util.h>
+#include <terminal/terminal-child-writer.h>
 #include <terminal/terminal-enum-types.h>
+#include <terminal/terminal-gdbus.h>
 #include <terminal/terminal-image-loader.h>
 #include <terminal/terminal-marshal.h>
+#include <terminal/terminal-paste-scanner.h>
+#include <terminal/terminal-perf-hud.h>
+#include <terminal/terminal-pty-holder.h>
 #include <terminal/terminal-screen.h>
+#include <terminal/terminal-scrollback.h>
+#include <terminal/terminal-system-font.h>
 #include <terminal/terminal-widget.h>
 #include <terminal/terminal-window.h>
 
@@ -69,6 +75,20 @@
 #define MIN_COLUMNS 4
 #define MIN_ROWS    1
 
+/* show the progress of writes to the child from this size on */
+#define WRITER_PROGRESS_SIZE (1024 * 1024)
+
+/* size of the text preview in the unsafe paste dialog */
+#define UNSAFE_PASTE_PREVIEW_LINES   5
+#define UNSAFE_PASTE_PREVIEW_COLUMNS 80
+
+/* rough size of a cell in the history of vte, text and attributes */
+#define SCROLLBACK_CELL_SIZE (4)
+
+/* seconds between putting the blink timers of the shown screens back
+ * on the shared clock, they drift apart as vte re-arms them */
+#define BLINK_RESYNC_INTERVAL (10)
+
 
 
 enum
@@ -83,6 +103,7 @@ enum
   GET_CONTEXT_MENU,
   SELECTION_CHANGED,
   CLOSE_TAB,
+  CONTENTS_CHANGED,
   LAST_SIGNAL
 };
 
@@ -107,10 +128,27 @@ static void       terminal_screen_set_property                  (GObject
                                                                  GParamSpec            *pspec);
 static void       terminal_screen_realize                       (GtkWidget             *widget);
 static void       terminal_screen_unrealize                     (GtkWidget             *widget);
+static void       terminal_screen_map                           (GtkWidget             *widget);
+static void       terminal_screen_unmap                         (GtkWidget             *widget);
+static void       terminal_screen_queue_draw                    (TerminalScreen        *screen);
 static void       terminal_screen_style_updated                 (GtkWidget             *widget);
 static gboolean   terminal_screen_draw                          (GtkWidget             *widget,
                                                                  cairo_t               *cr,
                                                                  gpointer               user_data);
+static gboolean   terminal_screen_draw_search_matches           (GtkWidget             *widget,
+                                                                 cairo_t               *cr,
+                                                                 TerminalScreen        *screen);
+static gboolean   terminal_screen_frame_start                   (GtkWidget             *widget,
+                                                                 cairo_t               *cr,
+                                                                 TerminalScreen        *screen);
+static gboolean   terminal_screen_frame_end                     (GtkWidget             *widget,
+                                                                 cairo_t               *cr,
+                                                                 TerminalScreen        *screen);
+#ifdef G_ENABLE_DEBUG
+static gboolean   terminal_screen_first_frame                   (GtkWidget             *widget,
+                                                                 cairo_t               *cr,
+                                                                 TerminalScreen        *screen);
+#endif
 static void       terminal_screen_preferences_changed           (TerminalPreferences   *preferences,
                                                                  GParamSpec            *pspec,
                                                                  TerminalScreen        *screen);
@@ -136,6 +174,8 @@ static void       terminal_screen_update_scrolling_lines        (TerminalScreen
 static void       terminal_screen_update_scrolling_on_output    (TerminalScreen        *screen);
 static void       terminal_screen_update_scrolling_on_keystroke (TerminalScreen        *screen);
 static void       terminal_screen_update_text_blink_mode        (TerminalScreen        *screen);
+static void       terminal_screen_blink_sync                    (TerminalScreen        *screen);
+static void       terminal_screen_blink_leave                   (TerminalScreen        *screen);
 static void       terminal_screen_update_title                  (TerminalScreen        *screen);
 static void       terminal_screen_update_word_chars             (TerminalScreen        *screen);
 static void       terminal_screen_vte_child_exited              (VteTerminal           *terminal,
@@ -160,13 +200,48 @@ static void       terminal_screen_urgent_bell                   (TerminalWidget
                                                                  TerminalScreen        *screen);
 static void       terminal_screen_set_custom_command            (TerminalScreen        *screen,
                                                                  gchar                **command);
+static void       terminal_screen_tab_label_map                 (GtkWidget             *hbox,
+                                                                 TerminalScreen        *screen);
 static void       terminal_screen_set_tab_label_color           (TerminalScreen        *screen,
                                                                  const GdkRGBA         *color);
+static gsize      terminal_screen_unsafe_paste_line             (GString               *preview,
+                                                                 const gchar           *text,
+                                                                 const gchar           *end);
 static GtkWidget* terminal_screen_unsafe_paste_dialog_new       (TerminalScreen        *screen,
-                                                                 const gchar           *text);
+                                                                 GBytes                *text,
+                                                                 const TerminalPasteScan *scan);
 static void       terminal_screen_paste_unsafe_text             (TerminalScreen        *screen,
-                                                                 const gchar           *text,
-                                                                 GdkAtom                original_clipboard);
+                                                                 GBytes                *text,
+                                                                 const TerminalPasteScan *scan,
+                                                                 GdkAtom                selection);
+static void       terminal_screen_paste_text                    (TerminalScreen        *screen,
+                                                                 GBytes                *text,
+                                                                 GdkAtom                selection);
+static void       terminal_screen_paste_received                (TerminalScreen        *screen,
+                                                                 GBytes                *text,
+                                                                 GdkAtom                selection);
+static void       terminal_screen_paste_contents_cb             (GtkClipboard          *clipboard,
+                                                                 GtkSelectionData      *selection_data,
+                                                                 gpointer               user_data);
+static void       terminal_screen_paste_text_cb                 (GtkClipboard          *clipboard,
+                                                                 const gchar           *str,
+                                                                 gpointer               user_data);
+static void       terminal_screen_paste_selection               (TerminalScreen        *screen,
+                                                                 GdkAtom                selection);
+static void       terminal_screen_write_child                   (TerminalScreen        *screen,
+                                                                 GBytes                *data,
+                                                                 gboolean               paste);
+static void       terminal_screen_writer_progress               (TerminalChildWriter   *writer,
+                                                                 TerminalScreen        *screen);
+static void       terminal_screen_writer_finished               (TerminalChildWriter   *writer,
+                                                                 gboolean               cancelled,
+                                                                 TerminalScreen        *screen);
+static void       terminal_screen_set_pty                       (TerminalScreen        *screen,
+                                                                 VtePty                *pty,
+                                                                 GPid                   pid,
+                                                                 GBytes                *output,
+                                                                 gboolean               watch);
+static void       terminal_screen_restore_scrollback            (TerminalScreen        *screen);
 
 
 
@@ -180,6 +255,11 @@ struct _TerminalScreen
   GtkOverlay           parent_instance;
   TerminalPreferences *preferences;
   TerminalImageLoader *loader;
+  TerminalSearchIndex *search_index;
+  TerminalSystemFont  *system_font;
+  TerminalChildWriter *writer;
+  GtkWidget           *writer_bar;
+  GtkWidget           *writer_progress;
   GtkWidget           *hbox;
   GtkWidget           *terminal;
   GtkWidget           *scrollbar;
@@ -187,11 +267,18 @@ struct _TerminalScreen
 
   GdkRGBA              background_color;
 
+  /* shared font description last set on the terminal */
+  const PangoFontDescription *font_desc;
+
   guint                session_id;
 
   GPid                 pid;
   gchar               *working_directory;
 
+  /* name of the foreground process group, read again when it changes */
+  gint                 foreground_pgid;
+  gchar               *foreground_command;
+
   gchar              **custom_command;
   gchar               *custom_title;
   gchar               *initial_title;
@@ -203,18 +290,54 @@ struct _TerminalScreen
   TerminalTitle        dynamic_title_mode;
   guint                hold : 1;
   guint                has_random_bg_color : 1;
+  guint                holder_attach : 1;
 #if !VTE_CHECK_VERSION (0, 51, 1)
   guint                scroll_on_output : 1;
 #endif
 
   guint                activity_timeout_id;
   time_t               activity_resize_time;
+  gint64               activity_time;
+
+  /* not mapped: no blinking, output and redraws only mark the screen
+   * dirty and it is repainted once when it is mapped again */
+  guint                hidden : 1;
+  guint                dirty : 1;
+  /* blinking waits for the next tick of the shared clock */
+  guint                blink_waiting : 1;
+
+  /* history restored when the tab is first shown, see terminal_screen_map();
+   * until then the pty of the child is not attached, its output waits */
+  GBytes              *pending_scrollback;
+  VtePty              *pending_pty;
+  GBytes              *pending_output;
+  guint                pending_watch : 1;
+
+  /* session of the child in the pty holder, or 0 */
+  guint                holder_id;
+
+  /* frames drawn by vte, see terminal_screen_get_stats() */
+  guint64              n_frames;
+  gint64               frame_time;
+  gint64               frame_start;
+
+  GtkWidget           *perf_hud;
+
+#ifdef G_ENABLE_DEBUG
+  gint64               created_time;
+#endif
 };
 
 
 
-static guint screen_signals[LAST_SIGNAL];
-static guint screen_last_session_id = 0;
+static guint   screen_signals[LAST_SIGNAL];
+static guint   screen_last_session_id = 0;
+
+/* the shown screens, their blink timers start on ticks of one clock */
+static GSList *screen_blink_screens = NULL;
+static gint64  screen_blink_epoch = 0;
+static guint   screen_blink_tick_id = 0;
+static guint   screen_blink_resync_id = 0;
 
 
 
@@ -236,6 +359,8 @@ terminal_screen_class_init (TerminalScreenClass *klass)
   gtkwidget_class = GTK_WIDGET_CLASS (klass);
   gtkwidget_class->realize = terminal_screen_realize;
   gtkwidget_class->unrealize = terminal_screen_unrealize;
+  gtkwidget_class->map = terminal_screen_map;
+  gtkwidget_class->unmap = terminal_screen_unmap;
   gtkwidget_class->style_updated = terminal_screen_style_updated;
 
   /**
@@ -292,6 +417,19 @@ terminal_screen_class_init (TerminalScreenClass *klass)
                   0, NULL, NULL,
                   g_cclosure_marshal_VOID__VOID,
                   G_TYPE_NONE, 0);
+
+  /**
+   * TerminalScreen::contents-changed
+   *
+   * Emitted when the visible text of the terminal changed.
+   **/
+  screen_signals[CONTENTS_CHANGED] =
+    g_signal_new (I_("contents-changed"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
 }
 
 
@@ -323,10 +461,26 @@ terminal_screen_init (TerminalScreen *screen)
       G_CALLBACK (terminal_screen_vte_resize_window), screen);
   g_signal_connect (G_OBJECT (screen->terminal), "draw",
       G_CALLBACK (terminal_screen_draw), screen);
+  g_signal_connect (G_OBJECT (screen->terminal), "draw",
+      G_CALLBACK (terminal_screen_frame_start), screen);
+  g_signal_connect_after (G_OBJECT (screen->terminal), "draw",
+      G_CALLBACK (terminal_screen_frame_end), screen);
   g_signal_connect_swapped (G_OBJECT (screen->terminal), "paste-selection-request",
       G_CALLBACK (terminal_screen_paste_primary), screen);
+#ifdef G_ENABLE_DEBUG
+  screen->created_time = g_get_monotonic_time ();
+  g_signal_connect_after (G_OBJECT (screen->terminal), "draw",
+      G_CALLBACK (terminal_screen_first_frame), screen);
+#endif
   gtk_box_pack_start (GTK_BOX (screen->hbox), screen->terminal, TRUE, TRUE, 0);
 
+  /* show the progress of large pastes and drops */
+  screen->writer = g_object_ref (terminal_widget_get_writer (TERMINAL_WIDGET (screen->terminal)));
+  g_signal_connect (G_OBJECT (screen->writer), "progress",
+      G_CALLBACK (terminal_screen_writer_progress), screen);
+  g_signal_connect (G_OBJECT (screen->writer), "finished",
+      G_CALLBACK (terminal_screen_writer_finished), screen);
+
   screen->scrollbar = gtk_scrollbar_new (GTK_ORIENTATION_VERTICAL,
                                          gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal)));
   gtk_box_pack_start (GTK_BOX (screen->hbox), screen->scrollbar, FALSE, FALSE, 0);
@@ -340,6 +494,9 @@ terminal_screen_init (TerminalScreen *screen)
   /* show the terminal */
   gtk_widget_show_all (screen->hbox);
 
+  /* nothing blinks until the tab is shown */
+  screen->hidden = TRUE;
+
   /* apply current settings */
   terminal_screen_update_binding_backspace (screen);
   terminal_screen_update_binding_delete (screen);
@@ -377,6 +534,8 @@ terminal_screen_finalize (GObject *object)
   if (screen->activity_timeout_id != 0)
     g_source_remove (screen->activity_timeout_id);
 
+  terminal_screen_blink_leave (screen);
+
   /* detach from preferences */
   g_signal_handlers_disconnect_by_func (screen->preferences,
       G_CALLBACK (terminal_screen_preferences_changed), screen);
@@ -385,14 +544,46 @@ terminal_screen_finalize (GObject *object)
   if (screen->loader != NULL)
     g_object_unref (G_OBJECT (screen->loader));
 
+  if (screen->search_index != NULL)
+    g_object_unref (G_OBJECT (screen->search_index));
+
+  if (screen->system_font != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (screen->system_font),
+          G_CALLBACK (terminal_screen_update_font), screen);
+      g_object_unref (G_OBJECT (screen->system_font));
+    }
+
+  g_signal_handlers_disconnect_by_data (G_OBJECT (screen->writer), screen);
+  g_object_unref (G_OBJECT (screen->writer));
+
   g_strfreev (screen->custom_command);
   g_free (screen->working_directory);
+  g_free (screen->foreground_command);
   g_free (screen->custom_title);
   g_free (screen->initial_title);
   g_free (screen->custom_fg_color);
   g_free (screen->custom_bg_color);
   g_free (screen->custom_title_color);
 
+  if (screen->pending_scrollback != NULL)
+    g_bytes_unref (screen->pending_scrollback);
+  if (screen->pending_output != NULL)
+    g_bytes_unref (screen->pending_output);
+  if (screen->pending_pty != NULL)
+    {
+      /* vte never watched the child, reap it once it exits */
+      if (screen->pending_watch)
+        g_child_watch_add (screen->pid, (GChildWatchFunc) g_spawn_close_pid, NULL);
+      g_object_unref (G_OBJECT (screen->pending_pty));
+    }
+
+  /* the tab is gone, so is its shell */
+  if (screen->holder_id != 0)
+    terminal_pty_holder_close (screen->holder_id);
+
+  terminal_gdbus_metrics_changed ();
+
   (*G_OBJECT_CLASS (terminal_screen_parent_class)->finalize) (object);
 }
 
@@ -522,6 +713,60 @@ terminal_screen_unrealize (GtkWidget *widget)
 
 
 
+static void
+terminal_screen_map (GtkWidget *widget)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (widget);
+
+  (*GTK_WIDGET_CLASS (terminal_screen_parent_class)->map) (widget);
+
+  /* start the blink timers again, on the clock of the other screens */
+  screen->hidden = FALSE;
+  terminal_screen_blink_sync (screen);
+
+  /* everything that changed while the tab was hidden at once */
+  if (screen->dirty)
+    {
+      screen->dirty = FALSE;
+      gtk_widget_queue_draw (GTK_WIDGET (screen));
+    }
+
+  /* the history of a reopened or restored tab is only decompressed
+   * when the tab is shown the first time */
+  if (screen->pending_scrollback != NULL)
+    terminal_screen_restore_scrollback (screen);
+}
+
+
+
+static void
+terminal_screen_unmap (GtkWidget *widget)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (widget);
+
+  /* background tabs and a hidden drop-down don't need to wake up
+   * for blinking */
+  screen->hidden = TRUE;
+  terminal_screen_blink_leave (screen);
+  terminal_screen_update_misc_cursor_blinks (screen);
+  terminal_screen_update_text_blink_mode (screen);
+
+  (*GTK_WIDGET_CLASS (terminal_screen_parent_class)->unmap) (widget);
+}
+
+
+
+static void
+terminal_screen_queue_draw (TerminalScreen *screen)
+{
+  if (screen->hidden)
+    screen->dirty = TRUE;
+  else
+    gtk_widget_queue_draw (GTK_WIDGET (screen));
+}
+
+
+
 static void
 terminal_screen_style_updated (GtkWidget *widget)
 {
@@ -583,6 +828,9 @@ terminal_screen_draw (GtkWidget *widget,
   cairo_destroy (ctx);
   cairo_surface_destroy (surface);
 
+  /* the search matches were drawn by the after handler of the nested
+   * draw, terminal_screen_draw_search_matches() */
+
   cairo_restore (cr);
 
   g_signal_connect (G_OBJECT (screen->terminal), "draw",
@@ -593,6 +841,71 @@ terminal_screen_draw (GtkWidget *widget,
 
 
 
+static gboolean
+terminal_screen_draw_search_matches (GtkWidget      *widget,
+                                     cairo_t        *cr,
+                                     TerminalScreen *screen)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
+
+  if (screen->search_index != NULL)
+    terminal_search_index_draw (screen->search_index, cr);
+
+  return FALSE;
+}
+
+
+
+static gboolean
+terminal_screen_frame_start (GtkWidget      *widget,
+                             cairo_t        *cr,
+                             TerminalScreen *screen)
+{
+  screen->frame_start = g_get_monotonic_time ();
+  return FALSE;
+}
+
+
+
+static gboolean
+terminal_screen_frame_end (GtkWidget      *widget,
+                           cairo_t        *cr,
+                           TerminalScreen *screen)
+{
+  /* a background image draws the terminal from its own handler, the
+   * nested draw is the frame that counts */
+  if (G_LIKELY (screen->frame_start != 0))
+    {
+      screen->n_frames++;
+      screen->frame_time += g_get_monotonic_time () - screen->frame_start;
+      screen->frame_start = 0;
+    }
+
+  return FALSE;
+}
+
+
+
+#ifdef G_ENABLE_DEBUG
+static gboolean
+terminal_screen_first_frame (GtkWidget      *widget,
+                             cairo_t        *cr,
+                             TerminalScreen *screen)
+{
+  /* includes fontconfig matching, shaping and glyph rasterization of
+   * the first frame, see terminal_font_warm_up() */
+  g_debug ("screen %u: first frame drawn %.1f ms after creation", screen->session_id,
+           (g_get_monotonic_time () - screen->created_time) / 1000.0);
+
+  g_signal_handlers_disconnect_by_func (G_OBJECT (widget),
+      G_CALLBACK (terminal_screen_first_frame), screen);
+
+  return FALSE;
+}
+#endif
+
+
+
 static void
 terminal_screen_preferences_changed (TerminalPreferences *preferences,
                                      GParamSpec          *pspec,
@@ -627,7 +940,7 @@ terminal_screen_preferences_changed (TerminalPreferences *preferences,
   else if (strncmp ("misc-bell", name, strlen ("misc-bell")) == 0)
     terminal_screen_update_misc_bell (screen);
   else if (strcmp ("misc-cursor-blinks", name) == 0)
-    terminal_screen_update_misc_cursor_blinks (screen);
+    terminal_screen_blink_sync (screen);
   else if (strcmp ("misc-cursor-shape", name) == 0)
     terminal_screen_update_misc_cursor_shape (screen);
   else if (strcmp ("misc-mouse-autohide", name) == 0)
@@ -643,7 +956,7 @@ terminal_screen_preferences_changed (TerminalPreferences *preferences,
   else if (strcmp ("scrolling-on-keystroke", name) == 0)
     terminal_screen_update_scrolling_on_keystroke (screen);
   else if (strcmp ("text-blink-mode", name) == 0)
-    terminal_screen_update_text_blink_mode (screen);
+    terminal_screen_blink_sync (screen);
   else if (strncmp ("title-", name, strlen ("title-")) == 0)
     terminal_screen_update_title (screen);
   else if (strcmp ("word-chars", name) == 0)
@@ -940,7 +1253,7 @@ terminal_screen_update_background (TerminalScreen *screen)
   screen->background_color.alpha = background_alpha;
   vte_terminal_set_color_background (VTE_TERMINAL (screen->terminal), &screen->background_color);
 
-  gtk_widget_queue_draw (GTK_WIDGET (screen));
+  terminal_screen_queue_draw (screen);
 }
 
 
@@ -1230,7 +1543,8 @@ terminal_screen_update_misc_cursor_blinks (TerminalScreen *screen)
   gboolean bval;
   g_object_get (G_OBJECT (screen->preferences), "misc-cursor-blinks", &bval, NULL);
   vte_terminal_set_cursor_blink_mode (VTE_TERMINAL (screen->terminal),
-                                      bval ? VTE_CURSOR_BLINK_ON : VTE_CURSOR_BLINK_OFF);
+                                      bval && !screen->hidden && !screen->blink_waiting
+                                      ? VTE_CURSOR_BLINK_ON : VTE_CURSOR_BLINK_OFF);
 }
 
 
@@ -1351,12 +1665,145 @@ terminal_screen_update_text_blink_mode (TerminalScreen *screen)
         terminal_assert_not_reached ();
     }
 
+  if (screen->hidden || screen->blink_waiting)
+    mode = VTE_TEXT_BLINK_NEVER;
+
   vte_terminal_set_text_blink_mode (VTE_TERMINAL (screen->terminal), mode);
 #endif
 }
 
 
 
+static gboolean
+terminal_screen_blink_tick (gpointer user_data)
+{
+  TerminalScreen *screen;
+  GSList         *lp;
+
+  screen_blink_tick_id = 0;
+
+  /* (re)start the timers of the waiting screens in this dispatch, so
+   * vte wakes up once for all of them instead of once per screen */
+  for (lp = screen_blink_screens; lp != NULL; lp = lp->next)
+    {
+      screen = TERMINAL_SCREEN (lp->data);
+      if (!screen->blink_waiting)
+        continue;
+
+      /* vte only restarts its timers when the mode changes */
+      terminal_screen_update_misc_cursor_blinks (screen);
+      terminal_screen_update_text_blink_mode (screen);
+      screen->blink_waiting = FALSE;
+      terminal_screen_update_misc_cursor_blinks (screen);
+      terminal_screen_update_text_blink_mode (screen);
+    }
+
+  return FALSE;
+}
+
+
+
+static void
+terminal_screen_blink_schedule (void)
+{
+  GtkSettings *settings;
+  gint         blink_time;
+  gint64       now, half_period;
+
+  if (screen_blink_tick_id != 0 || screen_blink_screens == NULL)
+    return;
+
+  /* vte toggles the cursor and blinking text every half period */
+  settings = gtk_widget_get_settings (GTK_WIDGET (screen_blink_screens->data));
+  g_object_get (G_OBJECT (settings), "gtk-cursor-blink-time", &blink_time, NULL);
+  half_period = MAX (blink_time / 2, 1) * (gint64) 1000;
+
+  now = g_get_monotonic_time ();
+  if (screen_blink_epoch == 0)
+    screen_blink_epoch = now;
+
+  screen_blink_tick_id =
+      gdk_threads_add_timeout ((half_period - (now - screen_blink_epoch) % half_period) / 1000,
+                               terminal_screen_blink_tick, NULL);
+}
+
+
+
+static gboolean
+terminal_screen_blink_resync (gpointer user_data)
+{
+  GSList *lp;
+
+  /* each timer re-arms itself from its own dispatch and slowly drifts,
+   * the next tick puts them back in phase */
+  for (lp = screen_blink_screens; lp != NULL; lp = lp->next)
+    TERMINAL_SCREEN (lp->data)->blink_waiting = TRUE;
+  terminal_screen_blink_schedule ();
+
+  return TRUE;
+}
+
+
+
+static void
+terminal_screen_blink_sync (TerminalScreen *screen)
+{
+  TerminalTextBlinkMode text_blink_mode;
+  gboolean              cursor_blinks;
+
+  g_object_get (G_OBJECT (screen->preferences),
+                "misc-cursor-blinks", &cursor_blinks,
+                "text-blink-mode", &text_blink_mode,
+                NULL);
+
+  if (screen->hidden || (!cursor_blinks && text_blink_mode == TERMINAL_TEXT_BLINK_MODE_NEVER))
+    {
+      terminal_screen_blink_leave (screen);
+      terminal_screen_update_misc_cursor_blinks (screen);
+      terminal_screen_update_text_blink_mode (screen);
+      return;
+    }
+
+  if (g_slist_find (screen_blink_screens, screen) == NULL)
+    screen_blink_screens = g_slist_prepend (screen_blink_screens, screen);
+
+  /* no blinking until the next tick of the shared clock */
+  screen->blink_waiting = TRUE;
+  terminal_screen_update_misc_cursor_blinks (screen);
+  terminal_screen_update_text_blink_mode (screen);
+  terminal_screen_blink_schedule ();
+
+  if (screen_blink_resync_id == 0)
+    screen_blink_resync_id = gdk_threads_add_timeout_seconds (BLINK_RESYNC_INTERVAL,
+                                                              terminal_screen_blink_resync, NULL);
+}
+
+
+
+static void
+terminal_screen_blink_leave (TerminalScreen *screen)
+{
+  screen_blink_screens = g_slist_remove (screen_blink_screens, screen);
+  screen->blink_waiting = FALSE;
+
+  /* nothing left to keep in phase */
+  if (screen_blink_screens == NULL)
+    {
+      if (screen_blink_tick_id != 0)
+        {
+          g_source_remove (screen_blink_tick_id);
+          screen_blink_tick_id = 0;
+        }
+      if (screen_blink_resync_id != 0)
+        {
+          g_source_remove (screen_blink_resync_id);
+          screen_blink_resync_id = 0;
+        }
+    }
+}
+
+
+
 static void
 terminal_screen_update_title (TerminalScreen *screen)
 {
@@ -1537,9 +1984,9 @@ terminal_screen_vte_resize_window (VteTerminal    *terminal,
     return;
 
   /* set the terminal size and resize the window if it is active */
-  vte_terminal_set_size (terminal, width, height);
+  terminal_window_queue_screen_size (TERMINAL_WINDOW (toplevel), screen, width, height);
   if (screen == terminal_window_get_active (TERMINAL_WINDOW (toplevel)))
-    terminal_screen_force_resize_window (screen, GTK_WINDOW (toplevel), width, height);
+    terminal_window_queue_resize (TERMINAL_WINDOW (toplevel), screen, width, height);
 }
 
 
@@ -1551,10 +1998,26 @@ terminal_screen_reset_activity_timeout (gpointer user_data)
   GdkRGBA         active_color;
   GdkRGBA         fg_color;
   GdkRGBA         label_color;
+  guint           timeout;
+  gint64          remaining;
+
+  screen->activity_timeout_id = 0;
 
   if (G_UNLIKELY (screen->tab_label == NULL))
     return FALSE;
 
+  /* there was output in the meantime, wait for the rest of the period
+   * after the last output */
+  g_object_get (G_OBJECT (screen->preferences), "tab-activity-timeout", &timeout, NULL);
+  remaining = screen->activity_time + (gint64) timeout * G_USEC_PER_SEC - g_get_monotonic_time ();
+  if (remaining > 0)
+    {
+      screen->activity_timeout_id =
+          gdk_threads_add_timeout_seconds ((remaining + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC,
+                                           terminal_screen_reset_activity_timeout, screen);
+      return FALSE;
+    }
+
   /* unset */
   if (G_LIKELY (screen->custom_title_color == NULL))
     gtk_label_set_attributes (GTK_LABEL (screen->tab_label), NULL);
@@ -1579,14 +2042,6 @@ terminal_screen_reset_activity_timeout (gpointer user_data)
 
 
 
-static void
-terminal_screen_reset_activity_destroyed (gpointer user_data)
-{
-  TERMINAL_SCREEN (user_data)->activity_timeout_id = 0;
-}
-
-
-
 static void
 terminal_screen_vte_window_contents_changed (TerminalScreen *screen)
 {
@@ -1599,6 +2054,12 @@ terminal_screen_vte_window_contents_changed (TerminalScreen *screen)
   terminal_return_if_fail (GTK_IS_LABEL (screen->tab_label));
   terminal_return_if_fail (TERMINAL_IS_PREFERENCES (screen->preferences));
 
+  terminal_gdbus_metrics_changed ();
+  g_signal_emit (G_OBJECT (screen), screen_signals[CONTENTS_CHANGED], 0);
+
+  if (screen->hidden)
+    screen->dirty = TRUE;
+
   /* leave if we should not start an update */
   if (screen->tab_label == NULL
       || (gtk_widget_get_state_flags (screen->terminal) & GTK_STATE_FLAG_FOCUSED) != 0
@@ -1610,6 +2071,12 @@ terminal_screen_vte_window_contents_changed (TerminalScreen *screen)
   if (timeout < 1)
     return;
 
+  /* the label is already colored, a busy tab only updates the time
+   * instead of restarting the timeout on every change */
+  screen->activity_time = g_get_monotonic_time ();
+  if (screen->activity_timeout_id != 0)
+    return;
+
   /* set label color */
   has_color = terminal_preferences_get_color (screen->preferences, "tab-activity-color", &color);
   if (G_LIKELY (has_color))
@@ -1619,15 +2086,9 @@ terminal_screen_vte_window_contents_changed (TerminalScreen *screen)
   else if (gdk_rgba_parse (&label_color, screen->custom_title_color))
     terminal_screen_set_tab_label_color (screen, &label_color);
 
-  /* stop running reset timeout */
-  if (screen->activity_timeout_id != 0)
-    g_source_remove (screen->activity_timeout_id);
-
   /* start new timeout to unset the activity */
   screen->activity_timeout_id =
-      gdk_threads_add_timeout_seconds_full (G_PRIORITY_DEFAULT, timeout,
-                                            terminal_screen_reset_activity_timeout,
-                                            screen, terminal_screen_reset_activity_destroyed);
+      gdk_threads_add_timeout_seconds (timeout, terminal_screen_reset_activity_timeout, screen);
 }
 
 
@@ -1737,24 +2198,75 @@ terminal_screen_set_tab_label_color (TerminalScreen *screen,
 
 
 
-static gboolean
-terminal_screen_is_text_unsafe (const gchar *text)
+static gsize
+terminal_screen_unsafe_paste_line (GString     *preview,
+                                   const gchar *text,
+                                   const gchar *end)
 {
-  return text != NULL && strchr (text, '\n') != NULL;
+  const gchar *p;
+  gunichar     c;
+  guint        column;
+
+  for (p = text, column = 0; p < end && *p != '\n' && column < UNSAFE_PASTE_PREVIEW_COLUMNS; p = g_utf8_next_char (p))
+    {
+      /* make control characters visible */
+      c = g_utf8_get_char (p);
+      if (c < 0x20 || c == 0x7f)
+        {
+          g_string_append_c (preview, '^');
+          g_string_append_c (preview, c ^ 0x40);
+          column += 2;
+        }
+      else if (c >= 0x80 && c < 0xa0)
+        {
+          g_string_append_printf (preview, "<U+%04X>", c);
+          column += 8;
+        }
+      else
+        {
+          g_string_append_unichar (preview, c);
+          column++;
+        }
+    }
+
+  /* skip the rest of a long line */
+  if (p < end && *p != '\n')
+    {
+      g_string_append (preview, "\342\200\246");
+      p = memchr (p, '\n', end - p);
+      if (p == NULL)
+        return end - text;
+    }
+
+  /* the length of the line with its line break */
+  return (p < end ? p + 1 : end) - text;
 }
 
 
 
 static GtkWidget*
-terminal_screen_unsafe_paste_dialog_new (TerminalScreen *screen,
-                                         const gchar    *text)
+terminal_screen_unsafe_paste_dialog_new (TerminalScreen          *screen,
+                                         GBytes                  *text,
+                                         const TerminalPasteScan *scan)
 {
-  GtkWindow     *parent = GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen)));
-  GtkTextBuffer *buffer = gtk_text_buffer_new (gtk_text_tag_table_new ());
-  GtkWidget     *tv = gtk_text_view_new_with_buffer (buffer);
-  GtkWidget     *sw = gtk_scrolled_window_new (NULL, NULL);
-  GtkWidget     *dialog = xfce_titled_dialog_new ();
-  GtkWidget     *button;
+  GtkWindow                *parent = GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen)));
+  GtkWidget                *dialog = xfce_titled_dialog_new ();
+  GtkWidget                *vbox;
+  GtkWidget                *label;
+  GtkWidget                *button;
+  GString                  *summary;
+  GString                  *issues;
+  GString                  *preview;
+  const TerminalPasteIssue *issue;
+  const gchar              *data, *end, *p;
+  const guchar             *c;
+  gchar                    *character;
+  gchar                    *size;
+  gsize                     length, n_lines, column, n_more;
+  guint                     n;
+
+  data = g_bytes_get_data (text, &length);
+  end = data + length;
 
   gtk_window_set_transient_for (GTK_WINDOW (dialog), parent);
   gtk_window_set_destroy_with_parent (GTK_WINDOW (dialog), TRUE);
@@ -1765,23 +2277,128 @@ terminal_screen_unsafe_paste_dialog_new (TerminalScreen *screen,
 
   button = xfce_gtk_button_new_mixed ("gtk-cancel", _("_Cancel"));
   gtk_dialog_add_action_widget (GTK_DIALOG (dialog), button, GTK_RESPONSE_CANCEL);
+  if (scan->n_controls > 0 || scan->n_terminators > 0)
+    {
+      button = gtk_button_new_with_mnemonic (_("Paste _Sanitized"));
+      gtk_widget_set_tooltip_text (button, _("Paste the text without control characters"));
+      gtk_dialog_add_action_widget (GTK_DIALOG (dialog), button, GTK_RESPONSE_APPLY);
+    }
   button = xfce_gtk_button_new_mixed ("gtk-ok", _("_Paste"));
   gtk_dialog_add_action_widget (GTK_DIALOG (dialog), button, GTK_RESPONSE_YES);
 
-  gtk_text_view_set_cursor_visible (GTK_TEXT_VIEW (tv), TRUE);
-  gtk_text_view_set_monospace (GTK_TEXT_VIEW (tv), TRUE);
-  gtk_text_view_set_top_margin (GTK_TEXT_VIEW (tv), 6);
-  gtk_text_view_set_bottom_margin (GTK_TEXT_VIEW (tv), 6);
-  gtk_text_view_set_right_margin (GTK_TEXT_VIEW (tv), 6);
-  gtk_text_view_set_left_margin (GTK_TEXT_VIEW (tv), 6);
+  vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+  gtk_container_set_border_width (GTK_CONTAINER (vbox), 6);
+  gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))), vbox, TRUE, TRUE, 0);
+
+  /* summary of the scan, the text itself is never loaded into a widget */
+  n_lines = scan->n_newlines + (length > 0 && end[-1] != '\n' ? 1 : 0);
+  size = g_format_size (length);
+  summary = g_string_new (NULL);
+  g_string_append_printf (summary, g_dngettext (GETTEXT_PACKAGE,
+                                                "The text has %s in %lu line.",
+                                                "The text has %s in %lu lines.",
+                                                n_lines),
+                          size, (gulong) n_lines);
+  g_free (size);
+  if (scan->n_controls > 0)
+    {
+      g_string_append_c (summary, '\n');
+      g_string_append_printf (summary, g_dngettext (GETTEXT_PACKAGE,
+                                                    "The text contains %lu control character.",
+                                                    "The text contains %lu control characters.",
+                                                    scan->n_controls),
+                              (gulong) scan->n_controls);
+    }
+  if (scan->n_terminators > 0)
+    {
+      g_string_append_c (summary, '\n');
+      g_string_append_printf (summary, g_dngettext (GETTEXT_PACKAGE,
+                                                    "The text contains %lu sequence that ends bracketed paste mode.",
+                                                    "The text contains %lu sequences that end bracketed paste mode.",
+                                                    scan->n_terminators),
+                              (gulong) scan->n_terminators);
+    }
+
+  label = gtk_label_new (summary->str);
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+  gtk_label_set_line_wrap (GTK_LABEL (label), TRUE);
+  gtk_box_pack_start (GTK_BOX (vbox), label, FALSE, FALSE, 0);
+  g_string_free (summary, TRUE);
+
+  /* the first offending characters with the lines they are on */
+  if (scan->n_issues > 0)
+    {
+      issues = g_string_new (NULL);
+      for (n = 0; n < scan->n_issues; n++)
+        {
+          issue = &scan->issues[n];
+          column = g_utf8_strlen (data + issue->line_offset, issue->offset - issue->line_offset) + 1;
+
+          if (n > 0)
+            g_string_append_c (issues, '\n');
+
+          if (issue->type == TERMINAL_PASTE_ISSUE_TERMINATOR)
+            {
+              g_string_append_printf (issues, _("Line %lu, column %lu: end of bracketed paste"),
+                                      (gulong) issue->line, (gulong) column);
+            }
+          else
+            {
+              c = (const guchar *) data + issue->offset;
+              if (*c == 0xc2)
+                character = g_strdup_printf ("U+%04X", c[1]);
+              else
+                character = g_strdup_printf ("^%c", *c ^ 0x40);
+              g_string_append_printf (issues, _("Line %lu, column %lu: control character %s"),
+                                      (gulong) issue->line, (gulong) column, character);
+              g_free (character);
+            }
+
+          g_string_append (issues, "\n    ");
+          terminal_screen_unsafe_paste_line (issues, data + issue->line_offset, end);
+        }
+
+      n_more = scan->n_controls + scan->n_terminators - scan->n_issues;
+      if (n_more > 0)
+        {
+          g_string_append_c (issues, '\n');
+          g_string_append_printf (issues, g_dngettext (GETTEXT_PACKAGE,
+                                                       "and %lu more",
+                                                       "and %lu more",
+                                                       n_more),
+                                  (gulong) n_more);
+        }
+
+      label = gtk_label_new (issues->str);
+      gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+      gtk_label_set_selectable (GTK_LABEL (label), TRUE);
+      gtk_style_context_add_class (gtk_widget_get_style_context (label), "monospace");
+      gtk_box_pack_start (GTK_BOX (vbox), label, FALSE, FALSE, 0);
+      g_string_free (issues, TRUE);
+    }
 
-  gtk_scrolled_window_set_min_content_width (GTK_SCROLLED_WINDOW (sw), 400);
-  gtk_scrolled_window_set_min_content_height (GTK_SCROLLED_WINDOW (sw), 150);
+  /* the first few lines */
+  label = gtk_label_new (_("Beginning of the text:"));
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+  gtk_widget_set_margin_top (label, 6);
+  gtk_box_pack_start (GTK_BOX (vbox), label, FALSE, FALSE, 0);
 
-  gtk_container_add (GTK_CONTAINER (sw), tv);
-  gtk_container_add (GTK_CONTAINER (gtk_dialog_get_content_area (GTK_DIALOG (dialog))), sw);
+  preview = g_string_new (NULL);
+  for (n = 0, p = data; n < UNSAFE_PASTE_PREVIEW_LINES && p < end; n++)
+    {
+      if (n > 0)
+        g_string_append_c (preview, '\n');
+      p += terminal_screen_unsafe_paste_line (preview, p, end);
+    }
+  if (p < end)
+    g_string_append (preview, "\n\342\200\246");
 
-  gtk_text_buffer_set_text (buffer, text, -1);
+  label = gtk_label_new (preview->str);
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+  gtk_label_set_selectable (GTK_LABEL (label), TRUE);
+  gtk_style_context_add_class (gtk_widget_get_style_context (label), "monospace");
+  gtk_box_pack_start (GTK_BOX (vbox), label, FALSE, FALSE, 0);
+  g_string_free (preview, TRUE);
 
   return dialog;
 }
@@ -1789,52 +2406,256 @@ terminal_screen_unsafe_paste_dialog_new (TerminalScreen *screen,
 
 
 static void
-terminal_screen_paste_unsafe_text (TerminalScreen *screen,
-                                   const gchar    *text,
-                                   GdkAtom         original_clipboard)
+terminal_screen_paste_unsafe_text (TerminalScreen          *screen,
+                                   GBytes                  *text,
+                                   const TerminalPasteScan *scan,
+                                   GdkAtom                  selection)
 {
-  GtkWidget *dialog;
+  GtkWidget    *dialog;
+  GBytes       *sanitized;
+  const gchar  *data;
+  gchar        *copy;
+  gsize         length;
+  gint          response;
+#if !VTE_CHECK_VERSION (0, 68, 0)
+  GtkClipboard *clipboard;
+#endif
 
-  terminal_return_if_fail (original_clipboard != GDK_SELECTION_CLIPBOARD && original_clipboard != GDK_SELECTION_PRIMARY);
+  terminal_return_if_fail (selection == GDK_SELECTION_CLIPBOARD || selection == GDK_SELECTION_PRIMARY);
 
-  dialog = terminal_screen_unsafe_paste_dialog_new (screen, text);
+  dialog = terminal_screen_unsafe_paste_dialog_new (screen, text, scan);
   gtk_widget_show_all (dialog);
   /* set focus to the Paste button */
   gtk_widget_grab_focus (gtk_dialog_get_widget_for_response (GTK_DIALOG (dialog), GTK_RESPONSE_YES));
 
-  if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_YES)
-    {
-      GtkWidget     *content_area = gtk_dialog_get_content_area (GTK_DIALOG (dialog));
-      GtkWidget     *sw = g_list_first (gtk_container_get_children (GTK_CONTAINER (content_area)))->data;
-      GtkTextView   *tv = GTK_TEXT_VIEW (gtk_bin_get_child (GTK_BIN (sw)));
-      GtkTextBuffer *buffer = gtk_text_view_get_buffer (tv);
-      GtkTextIter    start, end;
-      char          *res_text;
+  response = gtk_dialog_run (GTK_DIALOG (dialog));
+  gtk_widget_destroy (dialog);
 
-      gtk_text_buffer_get_bounds (buffer, &start, &end);
-      res_text = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+  if (response == GTK_RESPONSE_APPLY)
+    {
+      /* the clipboard text stays as it is */
+      data = g_bytes_get_data (text, &length);
+      copy = g_malloc (length + 1);
+      memcpy (copy, data, length);
+      length = terminal_paste_sanitize (copy, length);
+      sanitized = g_bytes_new_take (copy, length);
+
+#if VTE_CHECK_VERSION (0, 68, 0)
+      terminal_screen_paste_text (screen, sanitized, selection);
+#else
+      /* Modify the content of the clipboard as required, and then paste it.
+       * Using the builtin pasting function enables bracketed paste mode when applicable.
+       */
+      clipboard = gtk_clipboard_get (selection);
+      gtk_clipboard_set_text (clipboard, copy, length);
+      terminal_screen_paste_text (screen, sanitized, selection);
+
+      /* restore original clipboard contents */
+      data = g_bytes_get_data (text, &length);
+      gtk_clipboard_set_text (clipboard, data, length);
+#endif
+
+      g_bytes_unref (sanitized);
+    }
+  else if (response == GTK_RESPONSE_YES)
+    {
+      terminal_screen_paste_text (screen, text, selection);
+    }
+}
+
+
+
+static void
+terminal_screen_paste_text (TerminalScreen *screen,
+                            GBytes         *text,
+                            GdkAtom         selection)
+{
+#if VTE_CHECK_VERSION (0, 68, 0)
+  /* the writer takes a reference, so a large paste is never copied */
+  terminal_screen_write_child (screen, text, TRUE);
+#else
+  /* only the builtin pasting function knows about bracketed paste mode */
+  if (selection == GDK_SELECTION_CLIPBOARD)
+    vte_terminal_paste_clipboard (VTE_TERMINAL (screen->terminal));
+  else
+    vte_terminal_paste_primary (VTE_TERMINAL (screen->terminal));
+#endif
+}
 
-      if (res_text != NULL)
+
+
+static void
+terminal_screen_paste_received (TerminalScreen *screen,
+                                GBytes         *text,
+                                GdkAtom         selection)
+{
+  TerminalPasteScan  scan;
+  gboolean           show_dialog;
+  const gchar       *data;
+  gsize              length;
+
+  data = g_bytes_get_data (text, &length);
+
+  g_object_get (G_OBJECT (screen->preferences), "misc-show-unsafe-paste-dialog", &show_dialog, NULL);
+
+  if (show_dialog)
+    {
+      terminal_paste_scan (data, length, &scan);
+      if (terminal_paste_scan_is_unsafe (&scan))
         {
-          /* Modify the content of the clipboard as required, and then paste it.
-           * Using the builtin pasting function enables bracketed paste mode when applicable.
-           */
-          GtkClipboard *clipboard = gtk_clipboard_get (original_clipboard);
-          gtk_clipboard_set_text (clipboard, res_text, strlen (res_text));
-          g_free (res_text);
-
-          if (original_clipboard == GDK_SELECTION_CLIPBOARD) {
-            vte_terminal_paste_clipboard (VTE_TERMINAL (screen->terminal));
-          } else {
-            vte_terminal_paste_primary (VTE_TERMINAL (screen->terminal));
-          }
-
-          /* restore original clipboard contents */
-          gtk_clipboard_set_text (clipboard, text, strlen (text));
+          terminal_screen_paste_unsafe_text (screen, text, &scan, selection);
+          return;
         }
     }
 
-  gtk_widget_destroy (dialog);
+  terminal_screen_paste_text (screen, text, selection);
+}
+
+
+
+static void
+terminal_screen_paste_contents_cb (GtkClipboard     *clipboard,
+                                   GtkSelectionData *selection_data,
+                                   gpointer          user_data)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+  const guchar   *data = gtk_selection_data_get_data (selection_data);
+  gint            length = gtk_selection_data_get_length (selection_data);
+  GBytes         *text;
+
+  if (length > 0 && g_utf8_validate ((const gchar *) data, length, NULL))
+    {
+      /* gtk frees the data on return, this is the only copy of it; the
+       * tab may have been closed in the meantime */
+      if (gtk_widget_get_parent (GTK_WIDGET (screen)) != NULL)
+        {
+          text = g_bytes_new (data, length);
+          terminal_screen_paste_received (screen, text, gtk_clipboard_get_selection (clipboard));
+          g_bytes_unref (text);
+        }
+      g_object_unref (G_OBJECT (screen));
+    }
+  else
+    {
+      /* other targets and encodings */
+      gtk_clipboard_request_text (clipboard, terminal_screen_paste_text_cb, screen);
+    }
+}
+
+
+
+static void
+terminal_screen_paste_text_cb (GtkClipboard *clipboard,
+                               const gchar  *str,
+                               gpointer      user_data)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+  GBytes         *text;
+
+  if (str != NULL && gtk_widget_get_parent (GTK_WIDGET (screen)) != NULL)
+    {
+      text = g_bytes_new (str, strlen (str));
+      terminal_screen_paste_received (screen, text, gtk_clipboard_get_selection (clipboard));
+      g_bytes_unref (text);
+    }
+
+  g_object_unref (G_OBJECT (screen));
+}
+
+
+
+static void
+terminal_screen_paste_selection (TerminalScreen *screen,
+                                 GdkAtom         selection)
+{
+  /* the clipboard owner may be slow, never wait for it */
+  gtk_clipboard_request_contents (gtk_clipboard_get (selection),
+                                  gdk_atom_intern_static_string ("UTF8_STRING"),
+                                  terminal_screen_paste_contents_cb,
+                                  g_object_ref (G_OBJECT (screen)));
+}
+
+
+
+static void
+terminal_screen_write_child (TerminalScreen *screen,
+                             GBytes         *data,
+                             gboolean        paste)
+{
+  terminal_child_writer_push_bytes (screen->writer, data, paste);
+  terminal_screen_writer_progress (screen->writer, screen);
+}
+
+
+
+static void
+terminal_screen_writer_progress (TerminalChildWriter *writer,
+                                 TerminalScreen      *screen)
+{
+  GtkWidget *content_area;
+  GtkWidget *label;
+  guint64    written, total;
+  gchar     *written_str, *total_str;
+  gchar     *text;
+
+  written = terminal_child_writer_get_written (writer);
+  total = terminal_child_writer_get_total (writer);
+
+  /* offer to cancel large writes */
+  if (screen->writer_bar == NULL)
+    {
+      if (total < WRITER_PROGRESS_SIZE || !terminal_child_writer_is_busy (writer))
+        return;
+
+      screen->writer_bar = gtk_info_bar_new_with_buttons (_("_Cancel"), GTK_RESPONSE_CANCEL, NULL);
+      gtk_info_bar_set_message_type (GTK_INFO_BAR (screen->writer_bar), GTK_MESSAGE_INFO);
+      content_area = gtk_info_bar_get_content_area (GTK_INFO_BAR (screen->writer_bar));
+
+      label = gtk_label_new (_("Pasting text to the terminal"));
+      gtk_container_add (GTK_CONTAINER (content_area), label);
+
+      screen->writer_progress = gtk_progress_bar_new ();
+      gtk_progress_bar_set_show_text (GTK_PROGRESS_BAR (screen->writer_progress), TRUE);
+      gtk_widget_set_hexpand (screen->writer_progress, TRUE);
+      gtk_widget_set_valign (screen->writer_progress, GTK_ALIGN_CENTER);
+      gtk_container_add (GTK_CONTAINER (content_area), screen->writer_progress);
+
+      g_signal_connect_swapped (G_OBJECT (screen->writer_bar), "response",
+          G_CALLBACK (terminal_child_writer_cancel), writer);
+
+      gtk_widget_set_halign (screen->writer_bar, GTK_ALIGN_FILL);
+      gtk_widget_set_valign (screen->writer_bar, GTK_ALIGN_END);
+      gtk_overlay_add_overlay (GTK_OVERLAY (screen), screen->writer_bar);
+      gtk_widget_show_all (screen->writer_bar);
+    }
+
+  written_str = g_format_size (written);
+  total_str = g_format_size (total);
+  /* TRANSLATORS: progress of a large paste, e.g. "12.0 MB of 200.0 MB" */
+  text = g_strdup_printf (_("%s of %s"), written_str, total_str);
+
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (screen->writer_progress),
+                                 total > 0 ? (gdouble) written / total : 1.0);
+  gtk_progress_bar_set_text (GTK_PROGRESS_BAR (screen->writer_progress), text);
+
+  g_free (written_str);
+  g_free (total_str);
+  g_free (text);
+}
+
+
+
+static void
+terminal_screen_writer_finished (TerminalChildWriter *writer,
+                                 gboolean             cancelled,
+                                 TerminalScreen      *screen)
+{
+  if (screen->writer_bar != NULL)
+    {
+      gtk_widget_destroy (screen->writer_bar);
+      screen->writer_bar = NULL;
+      screen->writer_progress = NULL;
+    }
 }
 
 
@@ -1872,6 +2693,191 @@ terminal_screen_spawn_async_cb (VteTerminal *terminal,
 
 
 
+static void
+terminal_screen_set_pty (TerminalScreen *screen,
+                         VtePty         *pty,
+                         GPid            pid,
+                         GBytes         *output,
+                         gboolean        watch)
+{
+  gconstpointer data;
+  gsize         length;
+
+  screen->pid = pid;
+
+  if (screen->pending_scrollback != NULL)
+    {
+      /* the output goes below the history, the child waits in its pty
+       * until the tab is shown, see terminal_screen_restore_scrollback() */
+      terminal_assert (screen->pending_pty == NULL);
+      screen->pending_pty = g_object_ref (G_OBJECT (pty));
+      screen->pending_output = output != NULL ? g_bytes_ref (output) : NULL;
+      screen->pending_watch = watch;
+      return;
+    }
+
+  /* what the child wrote while no terminal had it */
+  if (output != NULL)
+    {
+      data = g_bytes_get_data (output, &length);
+      if (length > 0)
+        vte_terminal_feed (VTE_TERMINAL (screen->terminal), data, length);
+    }
+
+  vte_terminal_set_pty (VTE_TERMINAL (screen->terminal), pty);
+  if (watch)
+    vte_terminal_watch_child (VTE_TERMINAL (screen->terminal), pid);
+}
+
+
+
+static void
+terminal_screen_restore_scrollback (TerminalScreen *screen)
+{
+  VtePty *pty;
+  GBytes *output;
+
+  terminal_return_if_fail (screen->pending_scrollback != NULL);
+
+  terminal_scrollback_restore (VTE_TERMINAL (screen->terminal), screen->pending_scrollback, NULL);
+  g_bytes_unref (screen->pending_scrollback);
+  screen->pending_scrollback = NULL;
+
+  /* a child started while the tab was hidden */
+  if (screen->pending_pty != NULL)
+    {
+      pty = screen->pending_pty;
+      output = screen->pending_output;
+      screen->pending_pty = NULL;
+      screen->pending_output = NULL;
+
+      terminal_screen_set_pty (screen, pty, screen->pid, output, screen->pending_watch);
+
+      g_object_unref (G_OBJECT (pty));
+      if (output != NULL)
+        g_bytes_unref (output);
+    }
+}
+
+
+
+#if VTE_CHECK_VERSION (0, 48, 0)
+static void
+terminal_screen_pty_spawned_cb (GObject      *source_object,
+                                GAsyncResult *result,
+                                gpointer      user_data)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+  VtePty         *pty = VTE_PTY (source_object);
+  GError         *error = NULL;
+  GPid            pid;
+
+  if (!vte_pty_spawn_finish (pty, result, &pid, &error))
+    {
+      if (gtk_widget_get_parent (GTK_WIDGET (screen)) != NULL)
+        xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
+                                error, _("Failed to execute child"));
+      g_error_free (error);
+    }
+  else if (gtk_widget_get_parent (GTK_WIDGET (screen)) == NULL)
+    {
+      /* the tab was closed in the meantime, the child gets a hangup */
+      g_child_watch_add (pid, (GChildWatchFunc) g_spawn_close_pid, NULL);
+    }
+  else
+    {
+      terminal_screen_set_pty (screen, pty, pid, NULL, TRUE);
+#ifdef HAVE_LIBUTEMPTER
+      {
+        gboolean update_records;
+        g_object_get (G_OBJECT (screen->preferences), "command-update-records", &update_records, NULL);
+        if (update_records)
+          utempter_add_record (vte_pty_get_fd (pty), NULL);
+      }
+#endif // HAVE_LIBUTEMPTER
+    }
+
+  g_object_unref (G_OBJECT (pty));
+  g_object_unref (G_OBJECT (screen));
+}
+#endif
+
+
+
+static gboolean
+terminal_screen_attach_pty (TerminalScreen  *screen,
+                            gint             fd,
+                            GPid             pid,
+                            GBytes          *output,
+                            GError         **error)
+{
+  VtePty *pty;
+
+  pty = vte_pty_new_foreign_sync (fd, NULL, error);
+  if (G_UNLIKELY (pty == NULL))
+    {
+      close (fd);
+      return FALSE;
+    }
+
+  /* vte only watches its own children, the exit shows up as eof */
+  terminal_screen_set_pty (screen, pty, pid, output, FALSE);
+  g_object_unref (G_OBJECT (pty));
+
+#ifdef HAVE_LIBUTEMPTER
+  {
+    gboolean update_records;
+    g_object_get (G_OBJECT (screen->preferences), "command-update-records", &update_records, NULL);
+    if (update_records)
+      utempter_add_record (fd, NULL);
+  }
+#endif // HAVE_LIBUTEMPTER
+
+  return TRUE;
+}
+
+
+
+static void
+terminal_screen_holder_spawned (gint          fd,
+                                guint         id,
+                                GPid          pid,
+                                const GError *error,
+                                gpointer      user_data)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (user_data);
+  GError         *err = NULL;
+
+  if (gtk_widget_get_parent (GTK_WIDGET (screen)) == NULL)
+    {
+      /* the tab was closed while the holder started */
+      if (fd != -1)
+        {
+          close (fd);
+          terminal_pty_holder_close (id);
+        }
+    }
+  else if (fd == -1)
+    {
+      xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
+                              error, _("Failed to execute child"));
+    }
+  else
+    {
+      screen->holder_id = id;
+      if (!terminal_screen_attach_pty (screen, fd, pid, NULL, &err))
+        {
+          xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
+                                  err, _("Failed to execute child"));
+          g_error_free (err);
+        }
+    }
+
+  g_object_unref (G_OBJECT (screen));
+}
+
+
+
 /**
  * terminal_screen_new:
  * @attr    : Terminal attributes.
@@ -1899,6 +2905,17 @@ terminal_screen_new (TerminalTabAttr *attr,
   screen->hold = attr->hold;
   vte_terminal_set_size (VTE_TERMINAL (screen->terminal), columns, rows);
 
+  /* history of a reopened or restored tab, see terminal_screen_map() */
+  if (attr->scrollback != NULL)
+    screen->pending_scrollback = g_bytes_ref (attr->scrollback);
+
+  /* a shell that outlived the previous terminal, see terminal_screen_launch_child() */
+  if (attr->holder_id != 0)
+    {
+      screen->holder_id = attr->holder_id;
+      screen->holder_attach = TRUE;
+    }
+
   if (attr->color_text != NULL)
     screen->custom_fg_color = g_strdup (attr->color_text);
   if (attr->color_bg != NULL)
@@ -1928,6 +2945,13 @@ terminal_screen_launch_child (TerminalScreen *screen)
   guint         i, argc;
   VtePtyFlags   pty_flags = VTE_PTY_DEFAULT;
   GSpawnFlags   spawn_flags = G_SPAWN_CHILD_INHERITS_STDIN | G_SPAWN_SEARCH_PATH;
+  gboolean      use_holder;
+  GBytes       *output;
+  GPid          pid;
+  gint          fd;
+#if VTE_CHECK_VERSION (0, 48, 0)
+  VtePty       *pty;
+#endif
 
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
 
@@ -1936,6 +2960,36 @@ terminal_screen_launch_child (TerminalScreen *screen)
     g_error ("Tried to launch command in a TerminalScreen that is not realized");
 #endif
 
+  /* the history of a reopened or restored tab goes above the output
+   * of its child; hidden tabs start their commands right away too, but
+   * restore the history when they are first shown */
+#if VTE_CHECK_VERSION (0, 48, 0)
+  if (screen->pending_scrollback != NULL && gtk_widget_get_mapped (GTK_WIDGET (screen)))
+#else
+  if (screen->pending_scrollback != NULL)
+#endif
+    terminal_screen_restore_scrollback (screen);
+
+  /* take back a shell of the previous terminal from the pty holder */
+  if (screen->holder_attach)
+    {
+      screen->holder_attach = FALSE;
+      fd = terminal_pty_holder_claim (screen->holder_id, &pid, &output);
+      if (G_LIKELY (fd != -1))
+        {
+          if (!terminal_screen_attach_pty (screen, fd, pid, output, &error))
+            {
+              xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
+                                      error, _("Failed to execute child"));
+              g_error_free (error);
+            }
+          g_bytes_unref (output);
+          return;
+        }
+
+      screen->holder_id = 0;
+    }
+
   if (!terminal_screen_get_child_command (screen, &command, &argv, &error))
     {
       /* tell the user that we were unable to execute the command */
@@ -1959,38 +3013,74 @@ terminal_screen_launch_child (TerminalScreen *screen)
           spawn_flags |= G_SPAWN_FILE_AND_ARGV_ZERO;
         }
 
+      g_object_get (G_OBJECT (screen->preferences), "misc-pty-holder", &use_holder, NULL);
+      if (use_holder)
+        {
+          /* the holder owns the pty, the child survives this process */
+          terminal_pty_holder_spawn (screen->working_directory, argv2, env, argv != NULL,
+                                     vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal)),
+                                     vte_terminal_get_row_count (VTE_TERMINAL (screen->terminal)),
+                                     terminal_screen_holder_spawned, g_object_ref (G_OBJECT (screen)));
+        }
 #if VTE_CHECK_VERSION (0, 48, 0)
-      vte_terminal_spawn_async (VTE_TERMINAL (screen->terminal),
-                                pty_flags,
-                                screen->working_directory, argv2, env,
-                                spawn_flags,
-                                NULL, NULL,
-                                NULL, SPAWN_TIMEOUT,
-                                NULL,
-                                terminal_screen_spawn_async_cb,
-                                screen);
-#else
-      if (!vte_terminal_spawn_sync (VTE_TERMINAL (screen->terminal),
+      else if (screen->pending_scrollback != NULL)
+        {
+          /* the pty is attached once the history is restored */
+          pty = vte_terminal_pty_new_sync (VTE_TERMINAL (screen->terminal), pty_flags, NULL, &error);
+          if (G_UNLIKELY (pty == NULL))
+            {
+              xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
+                                      error, _("Failed to execute child"));
+              g_error_free (error);
+            }
+          else
+            {
+              vte_pty_spawn_async (pty,
+                                   screen->working_directory, argv2, env,
+                                   spawn_flags,
+                                   NULL, NULL, NULL,
+                                   SPAWN_TIMEOUT,
+                                   NULL,
+                                   terminal_screen_pty_spawned_cb,
+                                   g_object_ref (G_OBJECT (screen)));
+            }
+        }
+#endif
+      else
+        {
+#if VTE_CHECK_VERSION (0, 48, 0)
+          vte_terminal_spawn_async (VTE_TERMINAL (screen->terminal),
                                     pty_flags,
                                     screen->working_directory, argv2, env,
                                     spawn_flags,
                                     NULL, NULL,
-                                    &screen->pid, NULL, &error))
-        {
-          xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
-                                  error, _("Failed to execute child"));
-          g_error_free (error);
-        }
+                                    NULL, SPAWN_TIMEOUT,
+                                    NULL,
+                                    terminal_screen_spawn_async_cb,
+                                    screen);
+#else
+          if (!vte_terminal_spawn_sync (VTE_TERMINAL (screen->terminal),
+                                        pty_flags,
+                                        screen->working_directory, argv2, env,
+                                        spawn_flags,
+                                        NULL, NULL,
+                                        &screen->pid, NULL, &error))
+            {
+              xfce_dialog_show_error (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (screen))),
+                                      error, _("Failed to execute child"));
+              g_error_free (error);
+            }
 #ifdef HAVE_LIBUTEMPTER
-      else
-        {
-          gboolean update_records;
-          g_object_get (G_OBJECT (screen->preferences), "command-update-records", &update_records, NULL);
-          if (update_records)
-            utempter_add_record (vte_pty_get_fd (vte_terminal_get_pty (VTE_TERMINAL (screen->terminal))), NULL);
-        }
+          else
+            {
+              gboolean update_records;
+              g_object_get (G_OBJECT (screen->preferences), "command-update-records", &update_records, NULL);
+              if (update_records)
+                utempter_add_record (vte_pty_get_fd (vte_terminal_get_pty (VTE_TERMINAL (screen->terminal))), NULL);
+            }
 #endif // HAVE_LIBUTEMPTER
 #endif
+        }
 
       g_free (argv2);
 
@@ -2462,19 +3552,8 @@ terminal_screen_copy_clipboard_html (TerminalScreen *screen)
 void
 terminal_screen_paste_clipboard (TerminalScreen *screen)
 {
-  gboolean  show_dialog;
-  gchar    *text = gtk_clipboard_wait_for_text (gtk_clipboard_get (GDK_SELECTION_CLIPBOARD));
-
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-
-  g_object_get (G_OBJECT (screen->preferences), "misc-show-unsafe-paste-dialog", &show_dialog, NULL);
-
-  if (show_dialog && terminal_screen_is_text_unsafe (text))
-    terminal_screen_paste_unsafe_text (screen, text, GDK_SELECTION_CLIPBOARD);
-  else
-    vte_terminal_paste_clipboard (VTE_TERMINAL (screen->terminal));
-
-  g_free (text);
+  terminal_screen_paste_selection (screen, GDK_SELECTION_CLIPBOARD);
 }
 
 
@@ -2491,19 +3570,8 @@ terminal_screen_paste_clipboard (TerminalScreen *screen)
 void
 terminal_screen_paste_primary (TerminalScreen *screen)
 {
-  gboolean  show_dialog;
-  gchar    *text = gtk_clipboard_wait_for_text (gtk_clipboard_get (GDK_SELECTION_PRIMARY));
-
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
-
-  g_object_get (G_OBJECT (screen->preferences), "misc-show-unsafe-paste-dialog", &show_dialog, NULL);
-
-  if (show_dialog && terminal_screen_is_text_unsafe (text))
-    terminal_screen_paste_unsafe_text (screen, text, GDK_SELECTION_PRIMARY);
-  else
-    vte_terminal_paste_primary (VTE_TERMINAL (screen->terminal));
-
-  g_free (text);
+  terminal_screen_paste_selection (screen, GDK_SELECTION_PRIMARY);
 }
 
 
@@ -2592,7 +3660,10 @@ terminal_screen_reset_activity (TerminalScreen *screen)
   terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
 
   if (screen->activity_timeout_id != 0)
-    g_source_remove (screen->activity_timeout_id);
+    {
+      g_source_remove (screen->activity_timeout_id);
+      screen->activity_timeout_id = 0;
+    }
 
   if (screen->tab_label != NULL)
     {
@@ -2616,7 +3687,7 @@ terminal_screen_close_tab_cb (TerminalScreen *screen)
 GtkWidget *
 terminal_screen_get_tab_label (TerminalScreen *screen)
 {
-  GtkWidget *hbox, *button, *image;
+  GtkWidget *hbox;
 
   terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
 
@@ -2630,6 +3701,34 @@ terminal_screen_get_tab_label (TerminalScreen *screen)
   g_object_bind_property (G_OBJECT (screen), "title",
                           G_OBJECT (screen->tab_label), "label",
                           G_BINDING_SYNC_CREATE);
+
+  /* show the box and all its widgets */
+  gtk_widget_show_all (hbox);
+
+  /* update orientation */
+  terminal_screen_update_label_orientation (screen);
+
+  /* a scrollable notebook only maps the tabs in view, so with many
+   * tabs most of them never get the tooltip and close button */
+  g_signal_connect (G_OBJECT (hbox), "map",
+                    G_CALLBACK (terminal_screen_tab_label_map), screen);
+
+  return hbox;
+}
+
+
+
+static void
+terminal_screen_tab_label_map (GtkWidget      *hbox,
+                               TerminalScreen *screen)
+{
+  GtkWidget *button, *image;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  g_signal_handlers_disconnect_by_func (G_OBJECT (hbox),
+      G_CALLBACK (terminal_screen_tab_label_map), screen);
+
   g_object_bind_property (G_OBJECT (screen->tab_label), "label",
                           G_OBJECT (screen->tab_label), "tooltip-text",
                           G_BINDING_SYNC_CREATE);
@@ -2654,19 +3753,12 @@ terminal_screen_get_tab_label (TerminalScreen *screen)
   /* button image */
   image = gtk_image_new_from_icon_name ("window-close-symbolic", GTK_ICON_SIZE_MENU);
   gtk_container_add (GTK_CONTAINER (button), image);
-
-  /* show the box and all its widgets */
-  gtk_widget_show_all (hbox);
-
-  /* update orientation */
-  terminal_screen_update_label_orientation (screen);
+  gtk_widget_show (image);
 
   /* respect the show/hide buttons option */
   g_object_bind_property (G_OBJECT (screen->preferences), "misc-tab-close-buttons",
                           G_OBJECT (button), "visible",
                           G_BINDING_SYNC_CREATE);
-
-  return hbox;
 }
 
 
@@ -2741,6 +3833,30 @@ terminal_screen_search_find_previous (TerminalScreen *screen)
 
 
 
+/**
+ * terminal_screen_get_search_index:
+ * @screen  : A #TerminalScreen.
+ *
+ * Return value: The scrollback search index of @screen, created on
+ *               first use. The screen owns the index.
+ **/
+TerminalSearchIndex *
+terminal_screen_get_search_index (TerminalScreen *screen)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  if (G_UNLIKELY (screen->search_index == NULL))
+    {
+      screen->search_index = terminal_search_index_new (VTE_TERMINAL (screen->terminal));
+      g_signal_connect_after (G_OBJECT (screen->terminal), "draw",
+          G_CALLBACK (terminal_screen_draw_search_matches), screen);
+    }
+
+  return screen->search_index;
+}
+
+
+
 void
 terminal_screen_update_scrolling_bar (TerminalScreen *screen)
 {
@@ -2790,7 +3906,12 @@ terminal_screen_update_scrolling_bar (TerminalScreen *screen)
 
   /* update window geometry it required */
   if (grid_w > 0 && grid_h > 0)
-    terminal_screen_force_resize_window (screen, GTK_WINDOW (toplevel), grid_w, grid_h);
+    {
+      if (TERMINAL_IS_WINDOW (toplevel))
+        terminal_window_queue_resize (TERMINAL_WINDOW (toplevel), screen, grid_w, grid_h);
+      else
+        terminal_screen_force_resize_window (screen, GTK_WINDOW (toplevel), grid_w, grid_h);
+    }
 }
 
 
@@ -2798,14 +3919,12 @@ terminal_screen_update_scrolling_bar (TerminalScreen *screen)
 void
 terminal_screen_update_font (TerminalScreen *screen)
 {
-  GtkWidget            *toplevel = gtk_widget_get_toplevel (GTK_WIDGET (screen));
-  gboolean              font_use_system, font_allow_bold;
-  gchar                *font_name = NULL;
-  PangoFontDescription *font_desc;
-  glong                 grid_w = 0, grid_h = 0;
-  GSettings            *settings;
-  XfconfChannel        *channel;
-  gdouble               font_scale = PANGO_SCALE_MEDIUM;
+  GtkWidget                  *toplevel = gtk_widget_get_toplevel (GTK_WIDGET (screen));
+  gboolean                    font_use_system, font_allow_bold;
+  gchar                      *font_name = NULL;
+  const PangoFontDescription *font_desc;
+  glong                       grid_w = 0, grid_h = 0;
+  gdouble                     font_scale = PANGO_SCALE_MEDIUM;
 #if VTE_CHECK_VERSION (0, 51, 3)
   gdouble cell_width_scale, cell_height_scale;
 #endif
@@ -2821,21 +3940,14 @@ terminal_screen_update_font (TerminalScreen *screen)
 
   if (font_use_system)
     {
-      /* read Xfce settings */
-      xfconf_init (NULL);
-      channel = xfconf_channel_get ("xsettings");
-      if (xfconf_channel_has_property (channel, "/Gtk/MonospaceFontName"))
-        font_name = xfconf_channel_get_string (channel, "/Gtk/MonospaceFontName", "");
-      xfconf_shutdown ();
-
-      /* if font isn't set, read GNOME settings */
-      if (!IS_STRING (font_name))
+      /* the system font is resolved once per process and watched there */
+      if (screen->system_font == NULL)
         {
-          g_free (font_name);
-          settings = g_settings_new ("org.gnome.desktop.interface");
-          font_name = g_settings_get_string (settings, "monospace-font-name");
-          g_object_unref (settings);
+          screen->system_font = terminal_system_font_get ();
+          g_signal_connect_swapped (G_OBJECT (screen->system_font), "changed",
+              G_CALLBACK (terminal_screen_update_font), screen);
         }
+      font_name = g_strdup (terminal_system_font_get_name (screen->system_font));
     }
   else
     g_object_get (G_OBJECT (screen->preferences), "font-name", &font_name, NULL);
@@ -2873,11 +3985,15 @@ terminal_screen_update_font (TerminalScreen *screen)
 
   if (G_LIKELY (font_name != NULL))
     {
-      font_desc = pango_font_description_from_string (font_name);
+      /* the description is shared, so zooming never reloads the font */
+      font_desc = terminal_util_get_font_description (font_name);
       vte_terminal_set_allow_bold (VTE_TERMINAL (screen->terminal), font_allow_bold);
-      vte_terminal_set_font (VTE_TERMINAL (screen->terminal), font_desc);
+      if (font_desc != screen->font_desc)
+        {
+          vte_terminal_set_font (VTE_TERMINAL (screen->terminal), font_desc);
+          screen->font_desc = font_desc;
+        }
       vte_terminal_set_font_scale (VTE_TERMINAL (screen->terminal), font_scale);
-      pango_font_description_free (font_desc);
       g_free (font_name);
     }
 
@@ -2893,7 +4009,7 @@ terminal_screen_update_font (TerminalScreen *screen)
 
   /* update window geometry it required (not needed for drop-down) */
   if (TERMINAL_IS_WINDOW (toplevel) && !terminal_window_is_drop_down (TERMINAL_WINDOW (toplevel)) && grid_w > 0 && grid_h > 0)
-    terminal_screen_force_resize_window (screen, GTK_WINDOW (toplevel), grid_w, grid_h);
+    terminal_window_queue_resize (TERMINAL_WINDOW (toplevel), screen, grid_w, grid_h);
 }
 
 
@@ -2955,6 +4071,152 @@ terminal_screen_save_contents (TerminalScreen *screen,
 
 
 
+/**
+ * terminal_screen_capture_scrollback:
+ * @screen  : A #TerminalScreen.
+ *
+ * Return value: A compressed snapshot of the text in @screen, or %NULL
+ *               if it could not be captured.
+ **/
+GBytes *
+terminal_screen_capture_scrollback (TerminalScreen *screen)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  /* a tab that was never shown still has its old history */
+  if (screen->pending_scrollback != NULL)
+    return g_bytes_ref (screen->pending_scrollback);
+
+  return terminal_scrollback_capture (VTE_TERMINAL (screen->terminal), NULL);
+}
+
+
+
+/**
+ * terminal_screen_capture_scrollback_async:
+ * @screen      : A #TerminalScreen.
+ * @cancellable : A #GCancellable or %NULL.
+ * @callback    : Called with the snapshot.
+ * @user_data   : User data for @callback.
+ *
+ * Like terminal_screen_capture_scrollback(), but compresses the text in
+ * a worker thread. Get the snapshot in @callback with
+ * terminal_scrollback_capture_finish(); @screen can be destroyed in
+ * the meantime.
+ **/
+void
+terminal_screen_capture_scrollback_async (TerminalScreen      *screen,
+                                          GCancellable        *cancellable,
+                                          GAsyncReadyCallback  callback,
+                                          gpointer             user_data)
+{
+  GTask *task;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  if (screen->pending_scrollback != NULL)
+    {
+      /* a tab that was never shown still has its old history */
+      task = g_task_new (NULL, cancellable, callback, user_data);
+      g_task_return_pointer (task, g_bytes_ref (screen->pending_scrollback), (GDestroyNotify) g_bytes_unref);
+      g_object_unref (G_OBJECT (task));
+      return;
+    }
+
+  terminal_scrollback_capture_async (VTE_TERMINAL (screen->terminal), cancellable, callback, user_data);
+}
+
+
+
+/**
+ * terminal_screen_get_lines_since:
+ * @screen   : A #TerminalScreen.
+ * @row      : The first row to return, set to the row after the last
+ *             returned one.
+ * @max_rows : The maximum number of rows to return.
+ *
+ * Returns the lines above the cursor, starting at @row or the oldest
+ * line still in the scrollback, but no more than the last @max_rows
+ * of them. If the terminal was reset, @row is moved back to the
+ * cursor.
+ *
+ * Return value: The completed lines or %NULL if there are none.
+ **/
+gchar *
+terminal_screen_get_lines_since (TerminalScreen *screen,
+                                 glong          *row,
+                                 glong           max_rows)
+{
+  GtkAdjustment *adjustment;
+  glong          first_row, cursor_row;
+  gchar         *text;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+  terminal_return_val_if_fail (row != NULL, NULL);
+  terminal_return_val_if_fail (max_rows > 0, NULL);
+
+  vte_terminal_get_cursor_position (VTE_TERMINAL (screen->terminal), NULL, &cursor_row);
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+  first_row = MAX (*row, (glong) gtk_adjustment_get_lower (adjustment));
+  first_row = MAX (first_row, cursor_row - max_rows);
+
+  if (first_row >= cursor_row)
+    {
+      *row = cursor_row;
+      return NULL;
+    }
+
+  text = vte_terminal_get_text_range (VTE_TERMINAL (screen->terminal),
+                                      first_row, 0,
+                                      cursor_row - 1, vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal)),
+                                      NULL, NULL, NULL);
+  *row = cursor_row;
+
+  return text;
+}
+
+
+
+/**
+ * terminal_screen_get_tab_attr:
+ * @screen     : A #TerminalScreen.
+ * @scrollback : Whether to include a snapshot of the scrollback.
+ *
+ * Collects what is needed to recreate @screen with terminal_screen_new(),
+ * optionally including a snapshot of its scrollback.
+ *
+ * Return value: A new #TerminalTabAttr, free with terminal_tab_attr_free().
+ **/
+TerminalTabAttr *
+terminal_screen_get_tab_attr (TerminalScreen *screen,
+                              gboolean        scrollback)
+{
+  TerminalTabAttr *tab_attr;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  tab_attr = terminal_tab_attr_new ();
+  tab_attr->command = g_strdupv (screen->custom_command);
+  tab_attr->directory = g_strdup (terminal_screen_get_working_directory (screen));
+  if (IS_STRING (screen->custom_title))
+    tab_attr->title = g_strdup (screen->custom_title);
+  tab_attr->initial_title = g_strdup (screen->initial_title);
+  if (IS_STRING (screen->custom_fg_color))
+    tab_attr->color_text = g_strdup (screen->custom_fg_color);
+  if (IS_STRING (screen->custom_bg_color))
+    tab_attr->color_bg = g_strdup (screen->custom_bg_color);
+  if (IS_STRING (screen->custom_title_color))
+    tab_attr->color_title = g_strdup (screen->custom_title_color);
+  tab_attr->dynamic_title_mode = screen->dynamic_title_mode;
+  tab_attr->hold = screen->hold;
+  if (scrollback)
+    tab_attr->scrollback = terminal_screen_capture_scrollback (screen);
+
+  return tab_attr;
+}
+
+
+
 /**
  * terminal_screen_has_foreground_process:
  * @screen  : A #TerminalScreen.
@@ -2988,6 +4250,60 @@ terminal_screen_has_foreground_process (TerminalScreen *screen)
 
 
 
+/**
+ * terminal_screen_get_foreground_command:
+ * @screen  : A #TerminalScreen.
+ *
+ * The name is only read from /proc when the foreground process group
+ * changed since the last call, so this is cheap to call often.
+ *
+ * Return value: The name of the foreground process of @screen, which
+ *               is the shell if no other process runs, or %NULL if
+ *               not known. Free with g_free().
+ **/
+gchar *
+terminal_screen_get_foreground_command (TerminalScreen *screen)
+{
+  VtePty *pty;
+  gchar  *file;
+  gchar  *command = NULL;
+  int     fd;
+  int     fgpid;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  if (screen->pid == -1)
+    return NULL;
+
+  pty = vte_terminal_get_pty (VTE_TERMINAL (screen->terminal));
+  if (pty == NULL)
+    return NULL;
+
+  fd = vte_pty_get_fd (pty);
+  if (fd == -1)
+    return NULL;
+
+  fgpid = tcgetpgrp (fd);
+  if (fgpid == -1)
+    return NULL;
+
+  if (fgpid == screen->foreground_pgid && screen->foreground_command != NULL)
+    return g_strdup (screen->foreground_command);
+
+  file = g_strdup_printf ("/proc/%d/comm", fgpid);
+  if (g_file_get_contents (file, &command, NULL, NULL))
+    g_strchomp (command);
+  g_free (file);
+
+  g_free (screen->foreground_command);
+  screen->foreground_command = g_strdup (command);
+  screen->foreground_pgid = fgpid;
+
+  return command;
+}
+
+
+
 void
 terminal_screen_feed_text (TerminalScreen *screen,
                            const char     *text)
@@ -2998,6 +4314,79 @@ terminal_screen_feed_text (TerminalScreen *screen,
 
 
 
+/**
+ * terminal_screen_send_input:
+ * @screen : A #TerminalScreen.
+ * @data   : Bytes to send to the child.
+ * @length : Number of bytes in @data.
+ *
+ * Queues @data for the child, like typed input. Large amounts are
+ * written in chunks from the main loop.
+ **/
+void
+terminal_screen_send_input (TerminalScreen *screen,
+                            const gchar    *data,
+                            gsize           length)
+{
+  GBytes *bytes;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  terminal_return_if_fail (data != NULL || length == 0);
+
+  bytes = g_bytes_new (data, length);
+  terminal_screen_write_child (screen, bytes, FALSE);
+  g_bytes_unref (bytes);
+}
+
+
+
+/**
+ * terminal_screen_get_text:
+ * @screen    : A #TerminalScreen.
+ * @first_row : The first row to return, 0 is the oldest line in the
+ *              scrollback, or -1 for the rows at the bottom, where the
+ *              output goes, regardless of the scroll position.
+ * @n_rows    : The maximum number of rows, 0 for all following rows.
+ *
+ * Return value: The text of the rows, free with g_free(), or %NULL if
+ *               vte failed to extract it.
+ **/
+gchar *
+terminal_screen_get_text (TerminalScreen *screen,
+                          glong           first_row,
+                          glong           n_rows)
+{
+  GtkAdjustment *adjustment;
+  glong          last_row;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+  if (first_row < 0)
+    {
+      first_row = gtk_adjustment_get_upper (adjustment) - gtk_adjustment_get_page_size (adjustment);
+      n_rows = gtk_adjustment_get_page_size (adjustment);
+    }
+  else
+    {
+      first_row += gtk_adjustment_get_lower (adjustment);
+    }
+
+  last_row = gtk_adjustment_get_upper (adjustment);
+  if (n_rows > 0)
+    last_row = MIN (last_row, first_row + n_rows);
+
+  if (first_row >= last_row)
+    return g_strdup ("");
+
+  return vte_terminal_get_text_range (VTE_TERMINAL (screen->terminal),
+                                      first_row, 0,
+                                      last_row - 1, vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal)),
+                                      NULL, NULL, NULL);
+}
+
+
+
 const gchar *
 terminal_screen_get_custom_fg_color (TerminalScreen *screen)
 {
@@ -3044,3 +4433,134 @@ terminal_screen_set_custom_title_color (TerminalScreen *screen,
       terminal_screen_set_tab_label_color (screen, &label_color);
     }
 }
+
+
+
+/**
+ * terminal_screen_get_stats:
+ * @screen : A #TerminalScreen.
+ * @stats  : Return location for the numbers.
+ *
+ * Collects the counters of @screen. The numbers of the foreground
+ * process come from /proc and are 0 where it is not available.
+ **/
+void
+terminal_screen_get_stats (TerminalScreen      *screen,
+                           TerminalScreenStats *stats)
+{
+  GtkAdjustment  *adjustment;
+  VtePty         *pty;
+  gchar          *file, *contents, *p;
+  gchar         **fields;
+  gint            fd = -1;
+
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  terminal_return_if_fail (stats != NULL);
+
+  memset (stats, 0, sizeof (*stats));
+  stats->n_frames = screen->n_frames;
+  stats->frame_time = screen->frame_time;
+
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen->terminal));
+  stats->scrollback_lines = gtk_adjustment_get_upper (adjustment) - gtk_adjustment_get_lower (adjustment);
+  stats->scrollback_bytes = (gsize) stats->scrollback_lines * SCROLLBACK_CELL_SIZE
+                            * vte_terminal_get_column_count (VTE_TERMINAL (screen->terminal));
+
+  stats->foreground_pid = -1;
+  pty = vte_terminal_get_pty (VTE_TERMINAL (screen->terminal));
+  if (pty != NULL && screen->pid != -1)
+    fd = vte_pty_get_fd (pty);
+  if (fd == -1 || (stats->foreground_pid = tcgetpgrp (fd)) == -1)
+    return;
+
+  file = g_strdup_printf ("/proc/%d/io", stats->foreground_pid);
+  if (g_file_get_contents (file, &contents, NULL, NULL))
+    {
+      /* everything it wrote, to the pty and to files */
+      p = strstr (contents, "wchar:");
+      if (p != NULL)
+        stats->foreground_wchar = g_ascii_strtoull (p + 6, NULL, 10);
+      g_free (contents);
+    }
+  g_free (file);
+
+  file = g_strdup_printf ("/proc/%d/stat", stats->foreground_pid);
+  if (g_file_get_contents (file, &contents, NULL, NULL))
+    {
+      /* utime and stime follow the command name, which may contain anything */
+      p = strrchr (contents, ')');
+      if (p != NULL)
+        {
+          fields = g_strsplit (p + 2, " ", 14);
+          if (g_strv_length (fields) >= 14)
+            stats->foreground_cpu_time = (g_ascii_strtoull (fields[11], NULL, 10)
+                                          + g_ascii_strtoull (fields[12], NULL, 10))
+                                         * G_USEC_PER_SEC / sysconf (_SC_CLK_TCK);
+          g_strfreev (fields);
+        }
+      g_free (contents);
+    }
+  g_free (file);
+}
+
+
+
+/**
+ * terminal_screen_get_perf_hud:
+ * @screen : A #TerminalScreen.
+ *
+ * Return value: %TRUE if @screen shows its performance overlay.
+ **/
+gboolean
+terminal_screen_get_perf_hud (TerminalScreen *screen)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
+  return screen->perf_hud != NULL && gtk_widget_get_visible (screen->perf_hud);
+}
+
+
+
+/**
+ * terminal_screen_set_perf_hud:
+ * @screen : A #TerminalScreen.
+ * @show   : Whether to show the overlay.
+ *
+ * Shows or hides the live performance numbers of @screen on top of the
+ * terminal. The overlay is created the first time it is shown.
+ **/
+void
+terminal_screen_set_perf_hud (TerminalScreen *screen,
+                              gboolean        show)
+{
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  if (screen->perf_hud == NULL)
+    {
+      if (!show)
+        return;
+
+      screen->perf_hud = terminal_perf_hud_new (screen);
+      gtk_widget_set_halign (screen->perf_hud, GTK_ALIGN_END);
+      gtk_widget_set_valign (screen->perf_hud, GTK_ALIGN_START);
+      gtk_overlay_add_overlay (GTK_OVERLAY (screen), screen->perf_hud);
+      gtk_overlay_set_overlay_pass_through (GTK_OVERLAY (screen), screen->perf_hud, TRUE);
+    }
+
+  gtk_widget_set_visible (screen->perf_hud, show);
+}
+
+
+
+/**
+ * terminal_screen_get_id:
+ * @screen : A #TerminalScreen.
+ *
+ * Return value: The number of @screen, unique in this process and the
+ *               value of %# in the title.
+ **/
+guint
+terminal_screen_get_id (TerminalScreen *screen)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SCREEN (screen), 0);
+  return screen->session_id;
+}
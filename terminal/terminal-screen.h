@@ -23,6 +23,7 @@
 #include <gtk/gtk.h>
 #include <terminal/terminal-private.h>
 #include <terminal/terminal-options.h>
+#include <terminal/terminal-search-index.h>
 
 G_BEGIN_DECLS
 
@@ -36,6 +37,23 @@ G_BEGIN_DECLS
 typedef struct _TerminalScreenClass TerminalScreenClass;
 typedef struct _TerminalScreen      TerminalScreen;
 
+typedef struct
+{
+  /* frames drawn by vte and the microseconds it took */
+  guint64 n_frames;
+  gint64  frame_time;
+
+  /* lines in the history and an estimate of their size */
+  glong   scrollback_lines;
+  gsize   scrollback_bytes;
+
+  /* foreground process, -1 if unknown, and the bytes it wrote to the
+   * pty and to files since it started (wchar of /proc/PID/io) */
+  GPid    foreground_pid;
+  guint64 foreground_wchar;
+  gint64  foreground_cpu_time;
+} TerminalScreenStats;
+
 GType           terminal_screen_get_type                  (void) G_GNUC_CONST;
 
 TerminalScreen *terminal_screen_new                       (TerminalTabAttr *attr,
@@ -109,6 +127,8 @@ gboolean        terminal_screen_search_has_gregex         (TerminalScreen *scree
 void            terminal_screen_search_find_next          (TerminalScreen *screen);
 void            terminal_screen_search_find_previous      (TerminalScreen *screen);
 
+TerminalSearchIndex *terminal_screen_get_search_index     (TerminalScreen *screen);
+
 void            terminal_screen_update_scrolling_bar      (TerminalScreen *screen);
 
 void            terminal_screen_update_font               (TerminalScreen *screen);
@@ -125,11 +145,34 @@ void            terminal_screen_save_contents             (TerminalScreen *scree
                                                            GOutputStream  *stream,
                                                            GError         *error);
 
+GBytes         *terminal_screen_capture_scrollback        (TerminalScreen *screen);
+void            terminal_screen_capture_scrollback_async  (TerminalScreen      *screen,
+                                                           GCancellable        *cancellable,
+                                                           GAsyncReadyCallback  callback,
+                                                           gpointer             user_data);
+
+TerminalTabAttr *terminal_screen_get_tab_attr            (TerminalScreen *screen,
+                                                          gboolean        scrollback);
+
+gchar          *terminal_screen_get_lines_since           (TerminalScreen *screen,
+                                                           glong          *row,
+                                                           glong           max_rows);
+
 gboolean        terminal_screen_has_foreground_process    (TerminalScreen *screen);
 
+gchar          *terminal_screen_get_foreground_command    (TerminalScreen *screen);
+
 void            terminal_screen_feed_text                 (TerminalScreen *screen,
                                                            const char     *text);
 
+void            terminal_screen_send_input                (TerminalScreen *screen,
+                                                           const gchar    *data,
+                                                           gsize           length);
+
+gchar          *terminal_screen_get_text                  (TerminalScreen *screen,
+                                                           glong           first_row,
+                                                           glong           n_rows);
+
 const gchar    *terminal_screen_get_custom_fg_color       (TerminalScreen *screen);
 
 const gchar    *terminal_screen_get_custom_bg_color       (TerminalScreen *screen);
@@ -138,6 +181,15 @@ const gchar    *terminal_screen_get_custom_title_color    (TerminalScreen *scree
 void            terminal_screen_set_custom_title_color    (TerminalScreen *screen,
                                                            const gchar    *color);
 
+void            terminal_screen_get_stats                 (TerminalScreen      *screen,
+                                                           TerminalScreenStats *stats);
+
+guint           terminal_screen_get_id                    (TerminalScreen *screen);
+
+gboolean        terminal_screen_get_perf_hud              (TerminalScreen *screen);
+void            terminal_screen_set_perf_hud              (TerminalScreen *screen,
+                                                           gboolean        show);
+
 G_END_DECLS
 
 #endif /* !TERMINAL_SCREEN_H */
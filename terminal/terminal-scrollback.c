@@ -0,0 +1,347 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gio/gio.h>
+
+#include <terminal/terminal-private.h>
+#include <terminal/terminal-scrollback.h>
+
+/* size of the chunks handed to vte_terminal_feed() */
+#define FEED_SIZE (64 * 1024)
+
+
+
+static GBytes *terminal_scrollback_convert        (GConverter    *converter,
+                                                   GBytes        *input,
+                                                   GError       **error);
+static void    terminal_scrollback_compress_thread (GTask         *task,
+                                                   gpointer       source_object,
+                                                   gpointer       task_data,
+                                                   GCancellable  *cancellable);
+
+
+
+static GBytes *
+terminal_scrollback_convert (GConverter  *converter,
+                             GBytes      *input,
+                             GError     **error)
+{
+  GConverterResult  result;
+  GByteArray       *output;
+  const guint8     *data;
+  gsize             size, used = 0;
+  gsize             bytes_read, bytes_written;
+
+  data = g_bytes_get_data (input, &size);
+  output = g_byte_array_new ();
+  g_byte_array_set_size (output, MAX (size, 4096));
+
+  do
+    {
+      if (output->len - used < 4096)
+        g_byte_array_set_size (output, output->len * 2);
+
+      result = g_converter_convert (converter, data, size, output->data + used, output->len - used,
+                                    G_CONVERTER_INPUT_AT_END, &bytes_read, &bytes_written, error);
+      if (result == G_CONVERTER_ERROR)
+        {
+          g_byte_array_free (output, TRUE);
+          return NULL;
+        }
+
+      data += bytes_read;
+      size -= bytes_read;
+      used += bytes_written;
+    }
+  while (result != G_CONVERTER_FINISHED);
+
+  /* drop the unused tail of the buffer */
+  return g_bytes_new_take (g_realloc (g_byte_array_free (output, FALSE), used), used);
+}
+
+
+
+/**
+ * terminal_scrollback_capture:
+ * @terminal : A #VteTerminal.
+ * @error    : Return location for errors or %NULL.
+ *
+ * Writes the text of @terminal, scrollback included, through a zlib
+ * compressor into memory. The uncompressed text is never held in
+ * memory as a whole, but all the work happens in the calling thread,
+ * see terminal_scrollback_capture_async() for the main loop.
+ *
+ * Return value: The compressed snapshot or %NULL on error.
+ **/
+GBytes *
+terminal_scrollback_capture (VteTerminal  *terminal,
+                             GError      **error)
+{
+  GOutputStream *memory;
+  GOutputStream *stream;
+  GConverter    *compressor;
+  GBytes        *snapshot = NULL;
+  gpointer       data;
+  gsize          size;
+
+  terminal_return_val_if_fail (VTE_IS_TERMINAL (terminal), NULL);
+  terminal_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  memory = g_memory_output_stream_new (NULL, 0, g_realloc, g_free);
+  compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, -1));
+  stream = g_converter_output_stream_new (memory, compressor);
+
+  if (vte_terminal_write_contents_sync (terminal, stream, VTE_WRITE_DEFAULT, NULL, error)
+      && g_output_stream_close (stream, NULL, error))
+    {
+      /* the memory stream grows in steps, drop the unused tail */
+      size = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (memory));
+      data = g_memory_output_stream_steal_data (G_MEMORY_OUTPUT_STREAM (memory));
+      snapshot = g_bytes_new_take (g_realloc (data, size), size);
+    }
+
+  g_object_unref (G_OBJECT (stream));
+  g_object_unref (G_OBJECT (compressor));
+  g_object_unref (G_OBJECT (memory));
+
+  return snapshot;
+}
+
+
+
+static void
+terminal_scrollback_compress_thread (GTask        *task,
+                                     gpointer      source_object,
+                                     gpointer      task_data,
+                                     GCancellable *cancellable)
+{
+  GBytes *snapshot;
+  GError *error = NULL;
+
+  snapshot = terminal_scrollback_compress (task_data, &error);
+  if (G_LIKELY (snapshot != NULL))
+    g_task_return_pointer (task, snapshot, (GDestroyNotify) g_bytes_unref);
+  else
+    g_task_return_error (task, error);
+}
+
+
+
+/**
+ * terminal_scrollback_capture_async:
+ * @terminal    : A #VteTerminal.
+ * @cancellable : A #GCancellable or %NULL.
+ * @callback    : Called with the snapshot.
+ * @user_data   : User data for @callback.
+ *
+ * Like terminal_scrollback_capture(), but only the text is written in
+ * the calling thread, vte can't be used from others. The compression,
+ * most of the time with a long history, runs in a worker thread.
+ **/
+void
+terminal_scrollback_capture_async (VteTerminal         *terminal,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+  GOutputStream *memory;
+  GTask         *task;
+  GError        *error = NULL;
+
+  terminal_return_if_fail (VTE_IS_TERMINAL (terminal));
+
+  /* no source object, the terminal may be destroyed in the meantime */
+  task = g_task_new (NULL, cancellable, callback, user_data);
+
+  memory = g_memory_output_stream_new (NULL, 0, g_realloc, g_free);
+  if (vte_terminal_write_contents_sync (terminal, memory, VTE_WRITE_DEFAULT, cancellable, &error)
+      && g_output_stream_close (memory, cancellable, &error))
+    {
+      g_task_set_task_data (task, g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (memory)),
+                            (GDestroyNotify) g_bytes_unref);
+      g_task_run_in_thread (task, terminal_scrollback_compress_thread);
+    }
+  else
+    {
+      g_task_return_error (task, error);
+    }
+
+  g_object_unref (G_OBJECT (memory));
+  g_object_unref (G_OBJECT (task));
+}
+
+
+
+/**
+ * terminal_scrollback_capture_finish:
+ * @result : The #GAsyncResult passed to the callback.
+ * @error  : Return location for errors or %NULL.
+ *
+ * Return value: The compressed snapshot or %NULL on error.
+ **/
+GBytes *
+terminal_scrollback_capture_finish (GAsyncResult  *result,
+                                    GError       **error)
+{
+  terminal_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+
+
+/**
+ * terminal_scrollback_restore:
+ * @terminal : A #VteTerminal.
+ * @snapshot : A snapshot from terminal_scrollback_capture().
+ * @error    : Return location for errors or %NULL.
+ *
+ * Decompresses @snapshot and feeds the text to the display of
+ * @terminal, so it shows up above whatever the child prints next.
+ * Empty lines at the end of the snapshot (the unused bottom of the
+ * old screen) are dropped.
+ *
+ * Return value: %TRUE if @snapshot was restored.
+ **/
+gboolean
+terminal_scrollback_restore (VteTerminal  *terminal,
+                             GBytes       *snapshot,
+                             GError      **error)
+{
+  GConverter       *decompressor;
+  GConverterResult  result;
+  GString          *buffer;
+  const gchar      *input;
+  gchar             output[8192];
+  gsize             input_size;
+  gsize             bytes_read, bytes_written;
+  gsize             n;
+  guint             n_newlines = 0;
+  gboolean          has_text = FALSE;
+  gboolean          succeed = TRUE;
+
+  terminal_return_val_if_fail (VTE_IS_TERMINAL (terminal), FALSE);
+  terminal_return_val_if_fail (snapshot != NULL, FALSE);
+  terminal_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW));
+  buffer = g_string_sized_new (FEED_SIZE + sizeof (output));
+
+  input = g_bytes_get_data (snapshot, &input_size);
+  do
+    {
+      result = g_converter_convert (decompressor, input, input_size, output, sizeof (output),
+                                    G_CONVERTER_INPUT_AT_END, &bytes_read, &bytes_written, error);
+      if (result == G_CONVERTER_ERROR)
+        {
+          succeed = FALSE;
+          break;
+        }
+
+      input += bytes_read;
+      input_size -= bytes_read;
+
+      for (n = 0; n < bytes_written; n++)
+        {
+          /* newlines are held back until more text follows, the
+           * display needs a carriage return with each of them */
+          if (output[n] == '\n')
+            {
+              n_newlines++;
+              continue;
+            }
+
+          for (; n_newlines > 0; n_newlines--)
+            g_string_append_len (buffer, "\r\n", 2);
+          g_string_append_c (buffer, output[n]);
+          has_text = TRUE;
+        }
+
+      if (buffer->len >= FEED_SIZE)
+        {
+          vte_terminal_feed (terminal, buffer->str, buffer->len);
+          g_string_truncate (buffer, 0);
+        }
+    }
+  while (result != G_CONVERTER_FINISHED);
+
+  /* start the child output on a fresh line */
+  if (succeed && has_text)
+    g_string_append_len (buffer, "\r\n", 2);
+  if (buffer->len > 0)
+    vte_terminal_feed (terminal, buffer->str, buffer->len);
+
+  g_string_free (buffer, TRUE);
+  g_object_unref (G_OBJECT (decompressor));
+
+  return succeed;
+}
+
+
+
+/**
+ * terminal_scrollback_compress:
+ * @text  : Text of a terminal.
+ * @error : Return location for errors or %NULL.
+ *
+ * Compresses @text into the format of terminal_scrollback_capture().
+ * Unlike the capture, this is safe to call from any thread.
+ *
+ * Return value: The compressed snapshot or %NULL on error.
+ **/
+GBytes *
+terminal_scrollback_compress (GBytes  *text,
+                              GError **error)
+{
+  GConverter *compressor;
+  GBytes     *snapshot;
+
+  terminal_return_val_if_fail (text != NULL, NULL);
+
+  compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, -1));
+  snapshot = terminal_scrollback_convert (compressor, text, error);
+  g_object_unref (G_OBJECT (compressor));
+
+  return snapshot;
+}
+
+
+
+/**
+ * terminal_scrollback_decompress:
+ * @snapshot : A compressed snapshot.
+ * @error    : Return location for errors or %NULL.
+ *
+ * Return value: The text in @snapshot or %NULL on error.
+ **/
+GBytes *
+terminal_scrollback_decompress (GBytes  *snapshot,
+                                GError **error)
+{
+  GConverter *decompressor;
+  GBytes     *text;
+
+  terminal_return_val_if_fail (snapshot != NULL, NULL);
+
+  decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW));
+  text = terminal_scrollback_convert (decompressor, snapshot, error);
+  g_object_unref (G_OBJECT (decompressor));
+
+  return text;
+}
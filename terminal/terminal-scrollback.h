@@ -0,0 +1,46 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_SCROLLBACK_H
+#define TERMINAL_SCROLLBACK_H
+
+#include <vte/vte.h>
+
+G_BEGIN_DECLS
+
+GBytes   *terminal_scrollback_capture        (VteTerminal          *terminal,
+                                              GError              **error);
+
+void      terminal_scrollback_capture_async  (VteTerminal          *terminal,
+                                              GCancellable         *cancellable,
+                                              GAsyncReadyCallback   callback,
+                                              gpointer              user_data);
+
+GBytes   *terminal_scrollback_capture_finish (GAsyncResult         *result,
+                                              GError              **error);
+
+gboolean  terminal_scrollback_restore        (VteTerminal          *terminal,
+                                              GBytes               *snapshot,
+                                              GError              **error);
+
+GBytes   *terminal_scrollback_compress       (GBytes               *text,
+                                              GError              **error);
+
+GBytes   *terminal_scrollback_decompress     (GBytes               *snapshot,
+                                              GError              **error);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_SCROLLBACK_H */
@@ -40,6 +40,15 @@ static void terminal_search_dialog_entry_icon_release (GtkWidget            *ent
                                                        GtkEntryIconPosition  icon_pos);
 static void terminal_search_dialog_entry_changed      (GtkWidget            *entry,
                                                        TerminalSearchDialog *dialog);
+static void terminal_search_dialog_pattern_changed    (TerminalSearchDialog *dialog);
+
+
+
+enum
+{
+  PATTERN_CHANGED,
+  LAST_SIGNAL
+};
 
 
 struct _TerminalSearchDialogClass
@@ -57,17 +66,23 @@ struct _TerminalSearchDialog
   GtkWidget     *button_next;
 
   GtkWidget     *entry;
+  GtkWidget     *match_count;
 
   GtkWidget     *match_case;
   GtkWidget     *match_regex;
   GtkWidget     *match_word;
   GtkWidget     *wrap_around;
+  GtkWidget     *highlight_all;
 
   GtkAdjustment *opacity_adjustment;
 };
 
 
 
+static guint search_dialog_signals[LAST_SIGNAL];
+
+
+
 G_DEFINE_TYPE (TerminalSearchDialog, terminal_search_dialog, GTK_TYPE_DIALOG)
 
 
@@ -79,6 +94,19 @@ terminal_search_dialog_class_init (TerminalSearchDialogClass *klass)
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->finalize = terminal_search_dialog_finalize;
+
+  /**
+   * TerminalSearchDialog::pattern-changed
+   *
+   * Emitted when the search text or one of the match options changed.
+   **/
+  search_dialog_signals[PATTERN_CHANGED] =
+    g_signal_new (I_("pattern-changed"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
 }
 
 
@@ -139,20 +167,26 @@ terminal_search_dialog_init (TerminalSearchDialog *dialog)
   g_signal_connect (G_OBJECT (dialog->entry), "changed",
       G_CALLBACK (terminal_search_dialog_entry_changed), dialog);
 
+  dialog->match_count = gtk_label_new (NULL);
+  gtk_style_context_add_class (gtk_widget_get_style_context (dialog->match_count), GTK_STYLE_CLASS_DIM_LABEL);
+  gtk_label_set_width_chars (GTK_LABEL (dialog->match_count), 10);
+  gtk_label_set_xalign (GTK_LABEL (dialog->match_count), 1.0);
+  gtk_box_pack_start (GTK_BOX (hbox), dialog->match_count, FALSE, FALSE, 0);
+
   dialog->match_case = gtk_check_button_new_with_mnemonic (_("C_ase sensitive"));
   gtk_box_pack_start (GTK_BOX (vbox), dialog->match_case, FALSE, FALSE, 0);
   g_signal_connect_swapped (G_OBJECT (dialog->match_case), "toggled",
-      G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
+      G_CALLBACK (terminal_search_dialog_pattern_changed), dialog);
 
   dialog->match_regex = gtk_check_button_new_with_mnemonic (_("Match as _regular expression"));
   gtk_box_pack_start (GTK_BOX (vbox), dialog->match_regex, FALSE, FALSE, 0);
   g_signal_connect_swapped (G_OBJECT (dialog->match_regex), "toggled",
-      G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
+      G_CALLBACK (terminal_search_dialog_pattern_changed), dialog);
 
   dialog->match_word = gtk_check_button_new_with_mnemonic (_("Match _entire word only"));
   gtk_box_pack_start (GTK_BOX (vbox), dialog->match_word, FALSE, FALSE, 0);
   g_signal_connect_swapped (G_OBJECT (dialog->match_word), "toggled",
-      G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
+      G_CALLBACK (terminal_search_dialog_pattern_changed), dialog);
 
   dialog->wrap_around = gtk_check_button_new_with_mnemonic (_("_Wrap around"));
   gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (dialog->wrap_around), TRUE);
@@ -160,6 +194,12 @@ terminal_search_dialog_init (TerminalSearchDialog *dialog)
   g_signal_connect_swapped (G_OBJECT (dialog->wrap_around), "toggled",
       G_CALLBACK (terminal_search_dialog_clear_gregex), dialog);
 
+  dialog->highlight_all = gtk_check_button_new_with_mnemonic (_("_Highlight all matches"));
+  gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (dialog->highlight_all), TRUE);
+  gtk_box_pack_start (GTK_BOX (vbox), dialog->highlight_all, FALSE, FALSE, 0);
+  g_signal_connect_swapped (G_OBJECT (dialog->highlight_all), "toggled",
+      G_CALLBACK (terminal_search_dialog_pattern_changed), dialog);
+
   opacity_box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
   gtk_widget_set_margin_start (opacity_box, 6);
 
@@ -246,13 +286,23 @@ terminal_search_dialog_entry_changed (GtkWidget            *entry,
   text = gtk_entry_get_text (GTK_ENTRY (dialog->entry));
   has_text = IS_STRING (text);
 
-  terminal_search_dialog_clear_gregex (dialog);
-
   gtk_widget_set_sensitive (dialog->button_prev, has_text);
   gtk_widget_set_sensitive (dialog->button_next, has_text);
 
   gtk_dialog_set_default_response (GTK_DIALOG (dialog),
     has_text ? TERMINAL_RESPONSE_SEARCH_PREV : GTK_RESPONSE_CLOSE);
+
+  terminal_search_dialog_pattern_changed (dialog);
+}
+
+
+
+static void
+terminal_search_dialog_pattern_changed (TerminalSearchDialog *dialog)
+{
+  terminal_search_dialog_clear_gregex (dialog);
+
+  g_signal_emit (G_OBJECT (dialog), search_dialog_signals[PATTERN_CHANGED], 0);
 }
 
 
@@ -277,18 +327,61 @@ terminal_search_dialog_get_wrap_around (TerminalSearchDialog *dialog)
 
 
 
+/**
+ * terminal_search_dialog_get_pattern:
+ * @dialog   : A #TerminalSearchDialog.
+ * @caseless : Return location for the case sensitivity or %NULL.
+ *
+ * Return value: The regular expression for the search text with the
+ *               match options applied, or %NULL if nothing was typed.
+ *               Free with g_free().
+ **/
+gchar *
+terminal_search_dialog_get_pattern (TerminalSearchDialog *dialog,
+                                    gboolean             *caseless)
+{
+  const gchar *text;
+  gchar       *pattern;
+  gchar       *pattern_escaped;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog), NULL);
+
+  /* unset if no pattern is typed */
+  text = gtk_entry_get_text (GTK_ENTRY (dialog->entry));
+  if (!IS_STRING (text))
+    return NULL;
+
+  if (caseless != NULL)
+    *caseless = !gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_case));
+
+  if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_regex)))
+    pattern = g_strdup (text);
+  else
+    pattern = g_regex_escape_string (text, -1);
+
+  if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_word)))
+    {
+      pattern_escaped = pattern;
+      pattern = g_strdup_printf ("\\b%s\\b", pattern_escaped);
+      g_free (pattern_escaped);
+    }
+
+  return pattern;
+}
+
+
+
 GRegex *
 terminal_search_dialog_get_regex (TerminalSearchDialog  *dialog,
                                   GError               **error)
 {
-  const gchar        *pattern;
 #if VTE_CHECK_VERSION (0, 45, 90)
   guint32             flags = PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE;
 #else
-  GRegexCompileFlags  flags = G_REGEX_OPTIMIZE;
+  GRegexCompileFlags  flags = G_REGEX_OPTIMIZE | G_REGEX_MULTILINE;
 #endif
-  gchar              *pattern_escaped = NULL;
-  gchar              *word_regex = NULL;
+  gchar              *pattern;
+  gboolean            caseless;
   GRegex             *regex;
 
   terminal_return_val_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog), NULL);
@@ -298,45 +391,24 @@ terminal_search_dialog_get_regex (TerminalSearchDialog  *dialog,
   if (dialog->last_gregex != NULL)
     return g_regex_ref (dialog->last_gregex);
 
-  /* unset if no pattern is typed */
-  pattern = gtk_entry_get_text (GTK_ENTRY (dialog->entry));
-  if (!IS_STRING (pattern))
+  pattern = terminal_search_dialog_get_pattern (dialog, &caseless);
+  if (pattern == NULL)
     return NULL;
 
-  if (!gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_case)))
+  if (caseless)
 #if VTE_CHECK_VERSION (0, 45, 90)
     flags |= PCRE2_CASELESS;
 #else
     flags |= G_REGEX_CASELESS;
 #endif
 
-  if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_regex)))
-    {
-/* MULTILINE flag is always used for pcre2 */
-#if !VTE_CHECK_VERSION (0, 45, 90)
-      flags |= G_REGEX_MULTILINE;
-#endif
-    }
-  else
-    {
-      pattern_escaped = g_regex_escape_string (pattern, -1);
-      pattern = pattern_escaped;
-    }
-
-  if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->match_word)))
-    {
-      word_regex = g_strdup_printf ("\\b%s\\b", pattern);
-      pattern = word_regex;
-    }
-
 #if VTE_CHECK_VERSION (0, 45, 90)
   regex = vte_regex_new_for_search (pattern, -1, flags, error);
 #else
   regex = g_regex_new (pattern, flags, 0, error);
 #endif
 
-  g_free (pattern_escaped);
-  g_free (word_regex);
+  g_free (pattern);
 
   /* keep around */
   if (regex != NULL)
@@ -347,6 +419,46 @@ terminal_search_dialog_get_regex (TerminalSearchDialog  *dialog,
 
 
 
+gboolean
+terminal_search_dialog_get_highlight_all (TerminalSearchDialog *dialog)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog), FALSE);
+  return gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (dialog->highlight_all));
+}
+
+
+
+/**
+ * terminal_search_dialog_set_match_count:
+ * @dialog    : A #TerminalSearchDialog.
+ * @current   : Index of the current match or -1.
+ * @n_matches : Number of matches or -1 to clear the label.
+ **/
+void
+terminal_search_dialog_set_match_count (TerminalSearchDialog *dialog,
+                                        gint                  current,
+                                        gint                  n_matches)
+{
+  gchar *text;
+
+  terminal_return_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog));
+
+  if (n_matches < 0)
+    text = NULL;
+  else if (n_matches == 0)
+    text = g_strdup (_("No matches"));
+  else if (current < 0)
+    text = g_strdup_printf (g_dngettext (GETTEXT_PACKAGE, "%d match", "%d matches", n_matches), n_matches);
+  else
+    /* TRANSLATORS: current match "n of m" in the search dialog */
+    text = g_strdup_printf (_("%d of %d"), current + 1, n_matches);
+
+  gtk_label_set_text (GTK_LABEL (dialog->match_count), text);
+  g_free (text);
+}
+
+
+
 void
 terminal_search_dialog_present (TerminalSearchDialog *dialog)
 {
@@ -44,9 +44,18 @@ GtkWidget *terminal_search_dialog_new             (GtkWindow             *parent
 
 gboolean   terminal_search_dialog_get_wrap_around (TerminalSearchDialog  *dialog);
 
+gchar     *terminal_search_dialog_get_pattern     (TerminalSearchDialog  *dialog,
+                                                   gboolean              *caseless);
+
 GRegex    *terminal_search_dialog_get_regex       (TerminalSearchDialog  *dialog,
                                                    GError               **error);
 
+gboolean   terminal_search_dialog_get_highlight_all (TerminalSearchDialog *dialog);
+
+void       terminal_search_dialog_set_match_count (TerminalSearchDialog  *dialog,
+                                                   gint                   current,
+                                                   gint                   n_matches);
+
 void       terminal_search_dialog_present         (TerminalSearchDialog  *dialog);
 
 G_END_DECLS
@@ -0,0 +1,1198 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <terminal/terminal-search-index.h>
+
+#ifdef HAVE_PCRE2
+#ifndef PCRE2_CODE_UNIT_WIDTH
+#define PCRE2_CODE_UNIT_WIDTH 0
+#endif
+#include <pcre2.h>
+#else
+/* terminal-private.h maps these to VteRegex, we want the glib versions */
+#undef GRegex
+#undef g_regex_ref
+#undef g_regex_unref
+#endif
+
+/* number of scrollback rows copied per idle iteration, also the
+ * number of rows vte dropped before they are removed from the snapshot */
+#define SNAPSHOT_CHUNK_ROWS (1000)
+
+/* delay (ms) before searching after the pattern changed */
+#define PATTERN_DELAY (100)
+
+/* delay (ms) before indexing new terminal output */
+#define CONTENTS_DELAY (250)
+
+
+
+typedef struct _SearchPattern SearchPattern;
+typedef struct _SearchJob     SearchJob;
+typedef struct _SearchMatch   SearchMatch;
+
+
+
+static void           terminal_search_index_dispose          (GObject             *object);
+static void           terminal_search_index_finalize         (GObject             *object);
+static void           terminal_search_index_contents_changed (TerminalSearchIndex *index);
+static gboolean       terminal_search_index_update           (gpointer             user_data);
+static void           terminal_search_index_release          (TerminalSearchIndex *index);
+static void           terminal_search_index_match            (TerminalSearchIndex *index);
+static void           terminal_search_index_trim             (TerminalSearchIndex *index,
+                                                              guint                n_rows);
+static SearchPattern *search_pattern_new                     (const gchar         *pattern,
+                                                              gboolean             caseless,
+                                                              GError             **error);
+static SearchPattern *search_pattern_ref                     (SearchPattern       *pattern);
+static void           search_pattern_unref                   (SearchPattern       *pattern);
+
+
+
+enum
+{
+  CHANGED,
+  LAST_SIGNAL
+};
+
+struct _TerminalSearchIndexClass
+{
+  GObjectClass parent_class;
+};
+
+struct _TerminalSearchIndex
+{
+  GObject        parent_instance;
+
+  VteTerminal   *terminal;
+
+  gchar         *pattern;
+  SearchPattern *compiled;
+  guint          caseless : 1;
+  guint          highlight_all : 1;
+
+  /* snapshot of the scrollback, rows are separated by a newline
+   * unless they were soft-wrapped by vte */
+  GString       *text;
+  GArray        *rows;
+  glong          first_row;
+  glong          snapshot_row;
+  glong          stable_row;
+  glong          n_columns;
+  guint          snapshot_id;
+  guint          dirty : 1;
+
+  /* sorted array of matches in the snapshot */
+  GArray        *matches;
+  gsize          matched_offset;
+  gint           current;
+  guint          searched : 1;
+
+  /* pending or running search */
+  guint          update_id;
+  GCancellable  *cancellable;
+  guint          pending : 1;
+};
+
+struct _SearchPattern
+{
+  gint          ref_count;
+#ifdef HAVE_PCRE2
+  pcre2_code_8 *code;
+#else
+  GRegex       *regex;
+#endif
+};
+
+struct _SearchJob
+{
+  SearchPattern *pattern;
+  const gchar   *text;
+  gsize          length;
+  gsize          offset;
+  const gsize   *rows;
+  guint          n_rows;
+  glong          first_row;
+};
+
+struct _SearchMatch
+{
+  gsize start;
+  gsize end;
+  glong row;
+};
+
+
+
+static guint index_signals[LAST_SIGNAL];
+
+
+
+G_DEFINE_TYPE (TerminalSearchIndex, terminal_search_index, G_TYPE_OBJECT)
+
+
+
+static void
+terminal_search_index_class_init (TerminalSearchIndexClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->dispose = terminal_search_index_dispose;
+  gobject_class->finalize = terminal_search_index_finalize;
+
+  /**
+   * TerminalSearchIndex::changed
+   *
+   * Emitted when the number of matches or the current match changed.
+   **/
+  index_signals[CHANGED] =
+    g_signal_new (I_("changed"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
+}
+
+
+
+static void
+terminal_search_index_init (TerminalSearchIndex *index)
+{
+  index->rows = g_array_new (FALSE, FALSE, sizeof (gsize));
+  index->matches = g_array_new (FALSE, FALSE, sizeof (SearchMatch));
+  index->current = -1;
+  index->highlight_all = TRUE;
+}
+
+
+
+static void
+terminal_search_index_dispose (GObject *object)
+{
+  TerminalSearchIndex *index = TERMINAL_SEARCH_INDEX (object);
+
+  if (index->terminal != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (index->terminal),
+          G_CALLBACK (terminal_search_index_contents_changed), index);
+      g_object_remove_weak_pointer (G_OBJECT (index->terminal), (gpointer) &index->terminal);
+      index->terminal = NULL;
+    }
+
+  if (index->update_id != 0)
+    {
+      g_source_remove (index->update_id);
+      index->update_id = 0;
+    }
+
+  if (index->snapshot_id != 0)
+    {
+      g_source_remove (index->snapshot_id);
+      index->snapshot_id = 0;
+    }
+
+  if (index->cancellable != NULL)
+    g_cancellable_cancel (index->cancellable);
+
+  (*G_OBJECT_CLASS (terminal_search_index_parent_class)->dispose) (object);
+}
+
+
+
+static void
+terminal_search_index_finalize (GObject *object)
+{
+  TerminalSearchIndex *index = TERMINAL_SEARCH_INDEX (object);
+
+  /* a running task holds a reference, so nothing uses the text anymore */
+  terminal_assert (index->cancellable == NULL);
+
+  if (index->compiled != NULL)
+    search_pattern_unref (index->compiled);
+  g_free (index->pattern);
+
+  if (index->text != NULL)
+    g_string_free (index->text, TRUE);
+  g_array_free (index->rows, TRUE);
+  g_array_free (index->matches, TRUE);
+
+  (*G_OBJECT_CLASS (terminal_search_index_parent_class)->finalize) (object);
+}
+
+
+
+static SearchPattern *
+search_pattern_new (const gchar  *pattern,
+                    gboolean      caseless,
+                    GError      **error)
+{
+  SearchPattern *compiled;
+#ifdef HAVE_PCRE2
+  pcre2_code_8  *code;
+  guint32        flags = PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE;
+  gint           errcode;
+  PCRE2_SIZE     erroffset;
+  PCRE2_UCHAR8   message[256];
+
+  if (caseless)
+    flags |= PCRE2_CASELESS;
+
+  code = pcre2_compile_8 ((PCRE2_SPTR8) pattern, PCRE2_ZERO_TERMINATED, flags,
+                          &errcode, &erroffset, NULL);
+  if (G_UNLIKELY (code == NULL))
+    {
+      pcre2_get_error_message_8 (errcode, message, sizeof (message));
+      g_set_error (error, G_REGEX_ERROR, G_REGEX_ERROR_COMPILE,
+                   "%s (offset %lu)", message, (gulong) erroffset);
+      return NULL;
+    }
+
+  /* the interpreter is used if jit is not available on this platform */
+  pcre2_jit_compile_8 (code, PCRE2_JIT_COMPLETE);
+
+  compiled = g_slice_new0 (SearchPattern);
+  compiled->code = code;
+#else
+  GRegex        *regex;
+
+  regex = g_regex_new (pattern,
+                       G_REGEX_OPTIMIZE | G_REGEX_MULTILINE | (caseless ? G_REGEX_CASELESS : 0),
+                       0, error);
+  if (G_UNLIKELY (regex == NULL))
+    return NULL;
+
+  compiled = g_slice_new0 (SearchPattern);
+  compiled->regex = regex;
+#endif
+
+  compiled->ref_count = 1;
+
+  return compiled;
+}
+
+
+
+static SearchPattern *
+search_pattern_ref (SearchPattern *pattern)
+{
+  g_atomic_int_inc (&pattern->ref_count);
+  return pattern;
+}
+
+
+
+static void
+search_pattern_unref (SearchPattern *pattern)
+{
+  if (g_atomic_int_dec_and_test (&pattern->ref_count))
+    {
+#ifdef HAVE_PCRE2
+      pcre2_code_free_8 (pattern->code);
+#else
+      g_regex_unref (pattern->regex);
+#endif
+      g_slice_free (SearchPattern, pattern);
+    }
+}
+
+
+
+static void
+search_job_free (gpointer data)
+{
+  SearchJob *job = data;
+
+  search_pattern_unref (job->pattern);
+  g_slice_free (SearchJob, job);
+}
+
+
+
+static guint
+search_row_for_offset (const gsize *rows,
+                       guint        n_rows,
+                       gsize        offset)
+{
+  guint lo = 0, hi = n_rows, mid;
+
+  /* last row starting at or before offset */
+  while (hi - lo > 1)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (rows[mid] <= offset)
+        lo = mid;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+
+
+static guint
+search_first_match_in_row (GArray *matches,
+                           glong   row)
+{
+  guint lo = 0, hi = matches->len, mid;
+
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (g_array_index (matches, SearchMatch, mid).row < row)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+
+
+static guint
+search_first_match_ending_after (GArray *matches,
+                                 gsize   offset)
+{
+  guint lo = 0, hi = matches->len, mid;
+
+  /* matches do not overlap, so the end offsets are sorted too */
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (g_array_index (matches, SearchMatch, mid).end <= offset)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+
+
+static void
+terminal_search_index_match_thread (GTask        *task,
+                                    gpointer      source_object,
+                                    gpointer      task_data,
+                                    GCancellable *cancellable)
+{
+  SearchJob          *job = task_data;
+  GArray             *matches;
+  SearchMatch         match;
+  gsize               offset = job->offset;
+#ifdef HAVE_PCRE2
+  pcre2_match_data_8 *match_data;
+  PCRE2_SIZE         *ovector;
+#else
+  GMatchInfo         *match_info = NULL;
+  gint                start, end;
+#endif
+#ifdef G_ENABLE_DEBUG
+  gint64              timer = g_get_monotonic_time ();
+#endif
+
+  matches = g_array_new (FALSE, FALSE, sizeof (SearchMatch));
+
+#ifdef HAVE_PCRE2
+  match_data = pcre2_match_data_create_from_pattern_8 (job->pattern->code, NULL);
+  ovector = pcre2_get_ovector_pointer_8 (match_data);
+
+  while (offset < job->length && !g_cancellable_is_cancelled (cancellable))
+    {
+      /* the snapshot is valid utf-8, vte only returns complete characters */
+      if (pcre2_match_8 (job->pattern->code, (PCRE2_SPTR8) job->text, job->length,
+                         offset, PCRE2_NO_UTF_CHECK, match_data, NULL) < 0)
+        break;
+
+      match.start = ovector[0];
+      match.end = ovector[1];
+#else
+  g_regex_match_full (job->pattern->regex, job->text, job->length, offset, 0, &match_info, NULL);
+  for (; g_match_info_matches (match_info) && !g_cancellable_is_cancelled (cancellable);
+       g_match_info_next (match_info, NULL))
+    {
+      g_match_info_fetch_pos (match_info, 0, &start, &end);
+      match.start = start;
+      match.end = end;
+#endif
+
+      if (G_UNLIKELY (match.end <= match.start))
+        {
+          /* skip empty matches */
+          if (match.end >= job->length)
+            break;
+          offset = g_utf8_next_char (job->text + match.end) - job->text;
+          continue;
+        }
+
+      match.row = job->first_row + search_row_for_offset (job->rows, job->n_rows, match.start);
+      g_array_append_val (matches, match);
+
+      offset = match.end;
+    }
+
+#ifdef HAVE_PCRE2
+  pcre2_match_data_free_8 (match_data);
+#else
+  g_match_info_free (match_info);
+#endif
+
+#ifdef G_ENABLE_DEBUG
+  g_debug ("search index: %u matches in %" G_GSIZE_FORMAT " bytes, %.1f ms",
+           matches->len, job->length - job->offset,
+           (g_get_monotonic_time () - timer) / 1000.0);
+#endif
+
+  g_task_return_pointer (task, matches, (GDestroyNotify) g_array_unref);
+}
+
+
+
+static void
+terminal_search_index_match_ready (GObject      *object,
+                                   GAsyncResult *result,
+                                   gpointer      user_data)
+{
+  TerminalSearchIndex *index = TERMINAL_SEARCH_INDEX (object);
+  SearchJob           *job = g_task_get_task_data (G_TASK (result));
+  GArray              *matches;
+  gboolean             cancelled;
+
+  matches = g_task_propagate_pointer (G_TASK (result), NULL);
+  cancelled = g_cancellable_is_cancelled (index->cancellable);
+  g_clear_object (&index->cancellable);
+
+  if (matches != NULL)
+    {
+      /* drop results for an old pattern */
+      if (!cancelled && job->pattern == index->compiled)
+        {
+          g_array_append_vals (index->matches, matches->data, matches->len);
+          index->matched_offset = job->length;
+          index->searched = TRUE;
+
+          if (index->terminal != NULL)
+            gtk_widget_queue_draw (GTK_WIDGET (index->terminal));
+          g_signal_emit (G_OBJECT (index), index_signals[CHANGED], 0);
+        }
+
+      g_array_unref (matches);
+    }
+
+  if (index->pending)
+    {
+      index->pending = FALSE;
+      terminal_search_index_update (index);
+    }
+}
+
+
+
+static void
+terminal_search_index_match (TerminalSearchIndex *index)
+{
+  SearchJob *job;
+  GTask     *task;
+
+  terminal_return_if_fail (index->cancellable == NULL);
+
+  if (index->compiled == NULL
+      || index->text == NULL
+      || index->matched_offset >= index->text->len)
+    {
+      /* nothing new to search, but the index is ready now */
+      index->searched = index->compiled != NULL;
+      g_signal_emit (G_OBJECT (index), index_signals[CHANGED], 0);
+      return;
+    }
+
+  /* the snapshot is not touched until the task completed */
+  job = g_slice_new0 (SearchJob);
+  job->pattern = search_pattern_ref (index->compiled);
+  job->text = index->text->str;
+  job->length = index->text->len;
+  job->offset = index->matched_offset;
+  job->rows = (const gsize *) (gpointer) index->rows->data;
+  job->n_rows = index->rows->len;
+  job->first_row = index->first_row;
+
+  index->cancellable = g_cancellable_new ();
+
+  task = g_task_new (index, index->cancellable, terminal_search_index_match_ready, NULL);
+  g_task_set_task_data (task, job, search_job_free);
+  g_task_run_in_thread (task, terminal_search_index_match_thread);
+  g_object_unref (G_OBJECT (task));
+}
+
+
+
+static gboolean
+terminal_search_index_snapshot (gpointer user_data)
+{
+  TerminalSearchIndex *index = TERMINAL_SEARCH_INDEX (user_data);
+  GtkAdjustment       *adjustment;
+  glong                end_row, last_row;
+  gchar               *text;
+  gsize                offset;
+
+  if (G_UNLIKELY (index->terminal == NULL))
+    {
+      index->snapshot_id = 0;
+      return FALSE;
+    }
+
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (index->terminal));
+  end_row = (glong) gtk_adjustment_get_upper (adjustment);
+  last_row = MIN (index->snapshot_row + SNAPSHOT_CHUNK_ROWS, end_row);
+
+  for (; index->snapshot_row < last_row; index->snapshot_row++)
+    {
+      offset = index->text->len;
+      g_array_append_val (index->rows, offset);
+
+      text = vte_terminal_get_text_range (index->terminal,
+                                          index->snapshot_row, 0,
+                                          index->snapshot_row, index->n_columns,
+                                          NULL, NULL, NULL);
+      if (G_LIKELY (text != NULL))
+        {
+          g_string_append (index->text, text);
+          g_free (text);
+        }
+    }
+
+  if (index->snapshot_row < end_row)
+    return TRUE;
+
+  /* rows on the screen can still change, everything above is history */
+  index->stable_row = MAX (index->first_row, end_row - vte_terminal_get_row_count (index->terminal));
+  index->snapshot_id = 0;
+
+  terminal_search_index_match (index);
+
+  return FALSE;
+}
+
+
+
+static void
+terminal_search_index_trim (TerminalSearchIndex *index,
+                            guint                n_rows)
+{
+  SearchMatch *match;
+  gsize       *rows;
+  gsize        offset;
+  guint        n;
+
+  offset = n_rows < index->rows->len ? g_array_index (index->rows, gsize, n_rows) : index->text->len;
+  g_string_erase (index->text, 0, offset);
+  g_array_remove_range (index->rows, 0, n_rows);
+  index->first_row += n_rows;
+
+  /* the remaining offsets are relative to the new start of the text */
+  rows = (gsize *) (gpointer) index->rows->data;
+  for (n = 0; n < index->rows->len; n++)
+    rows[n] -= offset;
+
+  for (n = 0; n < index->matches->len; n++)
+    {
+      match = &g_array_index (index->matches, SearchMatch, n);
+      terminal_assert (match->start >= offset);
+      match->start -= offset;
+      match->end -= offset;
+    }
+
+  index->matched_offset = index->matched_offset > offset ? index->matched_offset - offset : 0;
+}
+
+
+
+static void
+terminal_search_index_rewind (TerminalSearchIndex *index)
+{
+  GtkAdjustment *adjustment;
+  glong          lower, upper, n_columns;
+  guint          row, n;
+  gsize          offset;
+
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (index->terminal));
+  lower = (glong) gtk_adjustment_get_lower (adjustment);
+  upper = (glong) gtk_adjustment_get_upper (adjustment);
+  n_columns = vte_terminal_get_column_count (index->terminal);
+
+  if (index->text == NULL
+      || n_columns != index->n_columns
+      || upper < index->stable_row
+      || lower >= index->first_row + (glong) index->rows->len)
+    {
+      /* the contents were rewrapped, reset or scrolled out entirely */
+      if (index->text == NULL)
+        index->text = g_string_sized_new (4096);
+      else
+        g_string_truncate (index->text, 0);
+      g_array_set_size (index->rows, 0);
+      g_array_set_size (index->matches, 0);
+
+      index->first_row = lower;
+      index->stable_row = lower;
+      index->n_columns = n_columns;
+      index->matched_offset = 0;
+      index->current = -1;
+      index->searched = FALSE;
+    }
+  else
+    {
+      /* only re-read the rows that were on the screen */
+      row = index->stable_row - index->first_row;
+      if (row < index->rows->len)
+        {
+          offset = g_array_index (index->rows, gsize, row);
+          g_string_truncate (index->text, offset);
+          g_array_set_size (index->rows, row);
+
+          /* matches on the last logical line can change as well */
+          while (offset > 0 && index->text->str[offset - 1] != '\n')
+            offset--;
+
+          n = search_first_match_ending_after (index->matches, offset);
+          g_array_set_size (index->matches, n);
+          index->matched_offset = MIN (index->matched_offset, offset);
+        }
+
+      /* forget matches that vte dropped from the scrollback */
+      n = search_first_match_in_row (index->matches, lower);
+      if (n > 0)
+        {
+          g_array_remove_range (index->matches, 0, n);
+          index->current = index->current >= (gint) n ? index->current - (gint) n : -1;
+        }
+
+      /* and the rows, in chunks so the text is not moved for every line */
+      if (lower - index->first_row >= SNAPSHOT_CHUNK_ROWS)
+        terminal_search_index_trim (index, MIN (lower - index->first_row, (glong) index->rows->len));
+    }
+
+  if (index->current >= (gint) index->matches->len)
+    index->current = -1;
+
+  index->snapshot_row = index->stable_row;
+}
+
+
+
+static gboolean
+terminal_search_index_update (gpointer user_data)
+{
+  TerminalSearchIndex *index = TERMINAL_SEARCH_INDEX (user_data);
+
+  index->update_id = 0;
+
+  /* wait for the running search to finish, the snapshot is in use */
+  if (index->cancellable != NULL)
+    {
+      index->pending = TRUE;
+      return FALSE;
+    }
+
+  if (index->compiled == NULL || index->terminal == NULL)
+    {
+      terminal_search_index_release (index);
+      return FALSE;
+    }
+
+  /* running snapshot reads up to the last row anyway */
+  if (index->snapshot_id != 0)
+    return FALSE;
+
+  if (index->dirty || index->text == NULL)
+    {
+      index->dirty = FALSE;
+      terminal_search_index_rewind (index);
+      index->snapshot_id = gdk_threads_add_idle_full (G_PRIORITY_LOW, terminal_search_index_snapshot,
+                                                      index, NULL);
+    }
+  else
+    {
+      /* only the pattern changed, reuse the snapshot */
+      terminal_search_index_match (index);
+    }
+
+  return FALSE;
+}
+
+
+
+static void
+terminal_search_index_schedule (TerminalSearchIndex *index,
+                                guint                delay)
+{
+  if (index->update_id != 0)
+    g_source_remove (index->update_id);
+  index->update_id = gdk_threads_add_timeout (delay, terminal_search_index_update, index);
+}
+
+
+
+static void
+terminal_search_index_release (TerminalSearchIndex *index)
+{
+  terminal_return_if_fail (index->cancellable == NULL);
+
+  if (index->snapshot_id != 0)
+    {
+      g_source_remove (index->snapshot_id);
+      index->snapshot_id = 0;
+    }
+
+  if (index->text != NULL)
+    {
+      g_string_free (index->text, TRUE);
+      index->text = NULL;
+    }
+
+  g_array_set_size (index->rows, 0);
+  g_array_set_size (index->matches, 0);
+  index->matched_offset = 0;
+  index->current = -1;
+  index->searched = FALSE;
+}
+
+
+
+static void
+terminal_search_index_contents_changed (TerminalSearchIndex *index)
+{
+  if (index->compiled == NULL)
+    return;
+
+  index->dirty = TRUE;
+
+  /* don't postpone a pending update, so a busy terminal is still indexed */
+  if (index->update_id == 0)
+    index->update_id = gdk_threads_add_timeout (CONTENTS_DELAY, terminal_search_index_update, index);
+}
+
+
+
+static glong
+search_text_columns (TerminalSearchIndex *index,
+                     const gchar         *text,
+                     gsize                length)
+{
+  const gchar *end = text + length;
+  gunichar     c;
+  glong        columns = 0;
+  gboolean     cjk;
+
+  /* the cells the text takes on the screen, like vte counts them */
+  cjk = vte_terminal_get_cjk_ambiguous_width (index->terminal) == 2;
+  for (; text < end; text = g_utf8_next_char (text))
+    {
+      c = g_utf8_get_char (text);
+      if (c == '\n' || g_unichar_iszerowidth (c))
+        continue;
+      columns += (cjk ? g_unichar_iswide_cjk (c) : g_unichar_iswide (c)) ? 2 : 1;
+    }
+
+  return columns;
+}
+
+
+
+static void
+terminal_search_index_draw_match (TerminalSearchIndex *index,
+                                  cairo_t             *cr,
+                                  const SearchMatch   *match,
+                                  glong                top_row,
+                                  glong                n_rows,
+                                  glong                char_width,
+                                  glong                char_height,
+                                  const GtkBorder     *padding)
+{
+  guint  r = match->row - index->first_row;
+  glong  row = match->row;
+  gsize  offset, row_start, row_end, end;
+  glong  column, width;
+
+  for (offset = match->start; offset < match->end && r < index->rows->len; r++, row++)
+    {
+      row_start = g_array_index (index->rows, gsize, r);
+      row_end = r + 1 < index->rows->len ? g_array_index (index->rows, gsize, r + 1) : index->text->len;
+      end = MIN (match->end, row_end);
+
+      if (row >= top_row && row < top_row + n_rows && end > offset)
+        {
+          column = search_text_columns (index, index->text->str + row_start, offset - row_start);
+          width = search_text_columns (index, index->text->str + offset, end - offset);
+
+          if (width > 0)
+            cairo_rectangle (cr,
+                             padding->left + column * char_width,
+                             padding->top + (row - top_row) * char_height,
+                             width * char_width, char_height);
+        }
+
+      offset = MAX (end, offset);
+    }
+}
+
+
+
+/**
+ * terminal_search_index_new:
+ * @terminal : A #VteTerminal.
+ *
+ * Return value: A new search index for the scrollback of @terminal.
+ **/
+TerminalSearchIndex *
+terminal_search_index_new (VteTerminal *terminal)
+{
+  TerminalSearchIndex *index;
+
+  terminal_return_val_if_fail (VTE_IS_TERMINAL (terminal), NULL);
+
+  index = g_object_new (TERMINAL_TYPE_SEARCH_INDEX, NULL);
+  index->terminal = terminal;
+  g_object_add_weak_pointer (G_OBJECT (terminal), (gpointer) &index->terminal);
+  g_signal_connect_swapped (G_OBJECT (terminal), "contents-changed",
+      G_CALLBACK (terminal_search_index_contents_changed), index);
+
+  return index;
+}
+
+
+
+/**
+ * terminal_search_index_set_pattern:
+ * @index    : A #TerminalSearchIndex.
+ * @pattern  : Regular expression or %NULL to stop searching.
+ * @caseless : Whether to match case insensitive.
+ * @error    : Return location for errors or %NULL.
+ *
+ * Compiles @pattern and schedules a search in a worker thread. The
+ * scrollback snapshot is kept between patterns, so typing in the
+ * search entry only re-runs the matching.
+ *
+ * Return value: %FALSE if @pattern failed to compile.
+ **/
+gboolean
+terminal_search_index_set_pattern (TerminalSearchIndex  *index,
+                                   const gchar          *pattern,
+                                   gboolean              caseless,
+                                   GError              **error)
+{
+  SearchPattern *compiled = NULL;
+  gboolean       succeed = TRUE;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SEARCH_INDEX (index), FALSE);
+  terminal_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (g_strcmp0 (index->pattern, pattern) == 0 && index->caseless == !!caseless)
+    return TRUE;
+
+  if (IS_STRING (pattern))
+    {
+      compiled = search_pattern_new (pattern, caseless, error);
+      if (G_UNLIKELY (compiled == NULL))
+        {
+          pattern = NULL;
+          succeed = FALSE;
+        }
+    }
+  else
+    pattern = NULL;
+
+  /* stop the running search */
+  if (index->cancellable != NULL)
+    g_cancellable_cancel (index->cancellable);
+
+  if (index->compiled != NULL)
+    search_pattern_unref (index->compiled);
+  index->compiled = compiled;
+
+  g_free (index->pattern);
+  index->pattern = g_strdup (pattern);
+  index->caseless = !!caseless;
+
+  g_array_set_size (index->matches, 0);
+  index->matched_offset = 0;
+  index->current = -1;
+  index->searched = FALSE;
+
+  if (compiled != NULL)
+    {
+      terminal_search_index_schedule (index, PATTERN_DELAY);
+    }
+  else
+    {
+      if (index->update_id != 0)
+        {
+          g_source_remove (index->update_id);
+          index->update_id = 0;
+        }
+
+      if (index->cancellable != NULL)
+        index->pending = TRUE;
+      else
+        terminal_search_index_release (index);
+    }
+
+  if (index->terminal != NULL)
+    gtk_widget_queue_draw (GTK_WIDGET (index->terminal));
+  g_signal_emit (G_OBJECT (index), index_signals[CHANGED], 0);
+
+  return succeed;
+}
+
+
+
+void
+terminal_search_index_set_highlight (TerminalSearchIndex *index,
+                                     gboolean             highlight_all)
+{
+  terminal_return_if_fail (TERMINAL_IS_SEARCH_INDEX (index));
+
+  if (index->highlight_all != !!highlight_all)
+    {
+      index->highlight_all = !!highlight_all;
+      if (index->terminal != NULL && index->matches->len > 0)
+        gtk_widget_queue_draw (GTK_WIDGET (index->terminal));
+    }
+}
+
+
+
+/**
+ * terminal_search_index_is_ready:
+ * @index : A #TerminalSearchIndex.
+ *
+ * Return value: %TRUE if a pattern is set and the scrollback has
+ *               been searched, new output may still be pending.
+ **/
+gboolean
+terminal_search_index_is_ready (TerminalSearchIndex *index)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SEARCH_INDEX (index), FALSE);
+
+  return index->compiled != NULL && index->searched;
+}
+
+
+
+gint
+terminal_search_index_get_n_matches (TerminalSearchIndex *index)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SEARCH_INDEX (index), 0);
+  return index->matches->len;
+}
+
+
+
+gint
+terminal_search_index_get_current (TerminalSearchIndex *index)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SEARCH_INDEX (index), -1);
+  return index->current;
+}
+
+
+
+/**
+ * terminal_search_index_jump:
+ * @index : A #TerminalSearchIndex.
+ * @n     : Index of the match.
+ *
+ * Makes @n the current match and scrolls the terminal so it is visible.
+ *
+ * Return value: %FALSE if @n is not a valid match.
+ **/
+gboolean
+terminal_search_index_jump (TerminalSearchIndex *index,
+                            gint                 n)
+{
+  GtkAdjustment     *adjustment;
+  const SearchMatch *match;
+  gdouble            value, page_size;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SEARCH_INDEX (index), FALSE);
+
+  if (n < 0 || n >= (gint) index->matches->len || index->terminal == NULL)
+    return FALSE;
+
+  match = &g_array_index (index->matches, SearchMatch, n);
+
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (index->terminal));
+  value = gtk_adjustment_get_value (adjustment);
+  page_size = gtk_adjustment_get_page_size (adjustment);
+  if (match->row < value || match->row >= value + page_size)
+    gtk_adjustment_set_value (adjustment, match->row - page_size / 2);
+
+  index->current = n;
+
+  gtk_widget_queue_draw (GTK_WIDGET (index->terminal));
+  g_signal_emit (G_OBJECT (index), index_signals[CHANGED], 0);
+
+  return TRUE;
+}
+
+
+
+gboolean
+terminal_search_index_find_next (TerminalSearchIndex *index,
+                                 gboolean             wrap_around)
+{
+  GtkAdjustment *adjustment;
+  gint           n;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SEARCH_INDEX (index), FALSE);
+
+  if (index->matches->len == 0 || index->terminal == NULL)
+    return FALSE;
+
+  if (index->current < 0)
+    {
+      /* first match in or below the visible area */
+      adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (index->terminal));
+      n = search_first_match_in_row (index->matches, (glong) gtk_adjustment_get_value (adjustment));
+    }
+  else
+    n = index->current + 1;
+
+  if (n >= (gint) index->matches->len)
+    {
+      if (!wrap_around)
+        return FALSE;
+      n = 0;
+    }
+
+  return terminal_search_index_jump (index, n);
+}
+
+
+
+gboolean
+terminal_search_index_find_previous (TerminalSearchIndex *index,
+                                     gboolean             wrap_around)
+{
+  GtkAdjustment *adjustment;
+  gint           n;
+
+  terminal_return_val_if_fail (TERMINAL_IS_SEARCH_INDEX (index), FALSE);
+
+  if (index->matches->len == 0 || index->terminal == NULL)
+    return FALSE;
+
+  if (index->current < 0)
+    {
+      /* last match in or above the visible area */
+      adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (index->terminal));
+      n = search_first_match_in_row (index->matches,
+                                     (glong) (gtk_adjustment_get_value (adjustment)
+                                              + gtk_adjustment_get_page_size (adjustment))) - 1;
+    }
+  else
+    n = index->current - 1;
+
+  if (n < 0)
+    {
+      if (!wrap_around)
+        return FALSE;
+      n = index->matches->len - 1;
+    }
+
+  return terminal_search_index_jump (index, n);
+}
+
+
+
+/**
+ * terminal_search_index_draw:
+ * @index : A #TerminalSearchIndex.
+ * @cr    : Cairo context of the terminal widget.
+ *
+ * Paints the matches in the visible rows on top of the terminal.
+ **/
+void
+terminal_search_index_draw (TerminalSearchIndex *index,
+                            cairo_t             *cr)
+{
+  GtkWidget         *widget;
+  GtkAdjustment     *adjustment;
+  GtkBorder          padding;
+  const SearchMatch *match;
+  glong              top_row, n_rows, char_width, char_height;
+  guint              i, r;
+
+  terminal_return_if_fail (TERMINAL_IS_SEARCH_INDEX (index));
+
+  if (index->terminal == NULL
+      || index->matches->len == 0
+      || (!index->highlight_all && index->current < 0))
+    return;
+
+  widget = GTK_WIDGET (index->terminal);
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (widget));
+  top_row = (glong) gtk_adjustment_get_value (adjustment);
+  n_rows = vte_terminal_get_row_count (index->terminal);
+  char_width = vte_terminal_get_char_width (index->terminal);
+  char_height = vte_terminal_get_char_height (index->terminal);
+  gtk_style_context_get_padding (gtk_widget_get_style_context (widget),
+                                 gtk_widget_get_state_flags (widget),
+                                 &padding);
+
+  cairo_save (cr);
+
+  if (index->highlight_all && top_row >= index->first_row)
+    {
+      r = top_row - index->first_row;
+      if (r < index->rows->len)
+        {
+          cairo_set_source_rgba (cr, 1.0, 0.85, 0.0, 0.35);
+          i = search_first_match_ending_after (index->matches, g_array_index (index->rows, gsize, r));
+          for (; i < index->matches->len; i++)
+            {
+              match = &g_array_index (index->matches, SearchMatch, i);
+              if (match->row >= top_row + n_rows)
+                break;
+              if ((gint) i != index->current)
+                terminal_search_index_draw_match (index, cr, match, top_row, n_rows,
+                                                  char_width, char_height, &padding);
+            }
+          cairo_fill (cr);
+        }
+    }
+
+  if (index->current >= 0)
+    {
+      cairo_set_source_rgba (cr, 1.0, 0.5, 0.0, 0.6);
+      match = &g_array_index (index->matches, SearchMatch, index->current);
+      terminal_search_index_draw_match (index, cr, match, top_row, n_rows,
+                                        char_width, char_height, &padding);
+      cairo_fill (cr);
+    }
+
+  cairo_restore (cr);
+}
@@ -0,0 +1,66 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_SEARCH_INDEX_H
+#define TERMINAL_SEARCH_INDEX_H
+
+#include <gtk/gtk.h>
+#include <terminal/terminal-private.h>
+
+G_BEGIN_DECLS
+
+#define TERMINAL_TYPE_SEARCH_INDEX            (terminal_search_index_get_type ())
+#define TERMINAL_SEARCH_INDEX(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TERMINAL_TYPE_SEARCH_INDEX, TerminalSearchIndex))
+#define TERMINAL_SEARCH_INDEX_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), TERMINAL_TYPE_SEARCH_INDEX, TerminalSearchIndexClass))
+#define TERMINAL_IS_SEARCH_INDEX(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TERMINAL_TYPE_SEARCH_INDEX))
+#define TERMINAL_IS_SEARCH_INDEX_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), TERMINAL_TYPE_SEARCH_INDEX))
+#define TERMINAL_SEARCH_INDEX_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), TERMINAL_TYPE_SEARCH_INDEX, TerminalSearchIndexClass))
+
+typedef struct _TerminalSearchIndexClass TerminalSearchIndexClass;
+typedef struct _TerminalSearchIndex      TerminalSearchIndex;
+
+GType                terminal_search_index_get_type      (void) G_GNUC_CONST;
+
+TerminalSearchIndex *terminal_search_index_new           (VteTerminal          *terminal);
+
+gboolean             terminal_search_index_set_pattern   (TerminalSearchIndex  *index,
+                                                          const gchar          *pattern,
+                                                          gboolean              caseless,
+                                                          GError              **error);
+
+void                 terminal_search_index_set_highlight (TerminalSearchIndex  *index,
+                                                          gboolean              highlight_all);
+
+gboolean             terminal_search_index_is_ready      (TerminalSearchIndex  *index);
+
+gint                 terminal_search_index_get_n_matches (TerminalSearchIndex  *index);
+
+gint                 terminal_search_index_get_current   (TerminalSearchIndex  *index);
+
+gboolean             terminal_search_index_jump          (TerminalSearchIndex  *index,
+                                                          gint                  n);
+
+gboolean             terminal_search_index_find_next     (TerminalSearchIndex  *index,
+                                                          gboolean              wrap_around);
+
+gboolean             terminal_search_index_find_previous (TerminalSearchIndex  *index,
+                                                          gboolean              wrap_around);
+
+void                 terminal_search_index_draw          (TerminalSearchIndex  *index,
+                                                          cairo_t              *cr);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_SEARCH_INDEX_H */
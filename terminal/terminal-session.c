@@ -0,0 +1,538 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <gio/gio.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include <terminal/terminal-private.h>
+#include <terminal/terminal-scrollback.h>
+#include <terminal/terminal-session.h>
+
+#define SESSION_MAGIC   "XFTERMS"
+#define SESSION_VERSION (1)
+
+#define SESSION_WINDOW_FULLSCREEN (1 << 0)
+#define SESSION_WINDOW_MAXIMIZE   (1 << 1)
+#define SESSION_WINDOW_MINIMIZE   (1 << 2)
+
+#define SESSION_TAB_HOLD          (1 << 0)
+#define SESSION_TAB_ACTIVE        (1 << 1)
+
+/* sanity limits for the records in a file */
+#define SESSION_MAX_RECORDS       (1 << 20)
+
+
+
+/* The file starts with an index of fixed size records and a string
+ * table, which are read straight from the mapped file. The compressed
+ * scrollback of the tabs follows the index; the pages of a blob are
+ * only read when its tab is shown. Numbers are in host byte order, the
+ * version doubles as byte order check. Strings are referenced by their
+ * offset in the string table, offset 0 is %NULL. */
+typedef struct
+{
+  gchar   magic[8];
+  guint32 version;
+  guint32 n_windows;
+  guint32 n_tabs;
+  guint32 strings_size;
+  guint64 blobs_offset;
+  guint64 blobs_size;
+} SessionHeader;
+
+typedef struct
+{
+  guint32 display;
+  guint32 role;
+  guint32 geometry;
+  guint32 font;
+  guint32 icon;
+  guint32 first_tab;
+  guint32 n_tabs;
+  guint32 flags;
+  gint32  menubar;
+  gint32  borders;
+  gint32  toolbar;
+  gint32  scrollbar;
+  gint32  zoom;
+  guint32 reserved;
+} SessionWindow;
+
+typedef struct
+{
+  guint32 command;
+  guint32 n_command;
+  guint32 directory;
+  guint32 title;
+  guint32 initial_title;
+  guint32 color_text;
+  guint32 color_bg;
+  guint32 color_title;
+  gint32  dynamic_title_mode;
+  guint32 flags;
+  guint32 scrollback_size;
+  guint32 reserved;
+  guint64 scrollback_offset;
+} SessionTab;
+
+G_STATIC_ASSERT (sizeof (SessionHeader) == 40);
+G_STATIC_ASSERT (sizeof (SessionWindow) == 56);
+G_STATIC_ASSERT (sizeof (SessionTab) == 56);
+
+typedef struct
+{
+  GString    *strings;
+  GHashTable *offsets;
+} SessionStrings;
+
+
+
+static guint32   terminal_session_add_string    (SessionStrings *strings,
+                                                 const gchar    *str);
+static gboolean  terminal_session_get_string    (const gchar    *strings,
+                                                 guint32         strings_size,
+                                                 guint32         offset,
+                                                 gchar         **return_str);
+
+
+
+static guint32
+terminal_session_add_string (SessionStrings *strings,
+                             const gchar    *str)
+{
+  gpointer offset;
+  guint32  result;
+
+  if (str == NULL || *str == '\0')
+    return 0;
+
+  /* titles and directories repeat a lot */
+  if (g_hash_table_lookup_extended (strings->offsets, str, NULL, &offset))
+    return GPOINTER_TO_UINT (offset);
+
+  result = strings->strings->len;
+  g_string_append_len (strings->strings, str, strlen (str) + 1);
+  g_hash_table_insert (strings->offsets, g_strdup (str), GUINT_TO_POINTER (result));
+
+  return result;
+}
+
+
+
+static gboolean
+terminal_session_get_string (const gchar  *strings,
+                             guint32       strings_size,
+                             guint32       offset,
+                             gchar       **return_str)
+{
+  /* the table ends with a nul, so every offset in it is a valid string */
+  if (offset >= strings_size)
+    return FALSE;
+
+  g_free (*return_str);
+  *return_str = offset != 0 ? g_strdup (strings + offset) : NULL;
+
+  return TRUE;
+}
+
+
+
+/**
+ * terminal_session_serialize:
+ * @window_attrs : List of #TerminalWindowAttr.
+ *
+ * Writes @window_attrs, including the scrollback snapshots of the tabs,
+ * into the session file format. This does not touch any widgets, so it
+ * can run in a thread.
+ *
+ * Return value: The session file contents.
+ **/
+GBytes *
+terminal_session_serialize (GSList *window_attrs)
+{
+  TerminalWindowAttr *win_attr;
+  TerminalTabAttr    *tab_attr;
+  SessionHeader       header;
+  SessionWindow       window;
+  SessionTab          tab;
+  SessionStrings      strings;
+  GArray             *windows;
+  GArray             *tabs;
+  GPtrArray          *blobs;
+  GSList             *wp, *tp;
+  guint8             *data, *p;
+  gsize               size, index_size;
+  guint               n;
+
+  windows = g_array_new (FALSE, FALSE, sizeof (SessionWindow));
+  tabs = g_array_new (FALSE, FALSE, sizeof (SessionTab));
+  blobs = g_ptr_array_new ();
+
+  strings.strings = g_string_new_len ("", 1);
+  strings.offsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  memset (&header, 0, sizeof (header));
+
+  for (wp = window_attrs; wp != NULL; wp = wp->next)
+    {
+      win_attr = wp->data;
+
+      memset (&window, 0, sizeof (window));
+      window.display = terminal_session_add_string (&strings, win_attr->display);
+      window.role = terminal_session_add_string (&strings, win_attr->role);
+      window.geometry = terminal_session_add_string (&strings, win_attr->geometry);
+      window.font = terminal_session_add_string (&strings, win_attr->font);
+      window.icon = terminal_session_add_string (&strings, win_attr->icon);
+      window.first_tab = tabs->len;
+      window.menubar = win_attr->menubar;
+      window.borders = win_attr->borders;
+      window.toolbar = win_attr->toolbar;
+      window.scrollbar = win_attr->scrollbar;
+      window.zoom = win_attr->zoom;
+      if (win_attr->fullscreen)
+        window.flags |= SESSION_WINDOW_FULLSCREEN;
+      if (win_attr->maximize)
+        window.flags |= SESSION_WINDOW_MAXIMIZE;
+      if (win_attr->minimize)
+        window.flags |= SESSION_WINDOW_MINIMIZE;
+
+      for (tp = win_attr->tabs; tp != NULL; tp = tp->next)
+        {
+          tab_attr = tp->data;
+
+          memset (&tab, 0, sizeof (tab));
+          if (tab_attr->command != NULL && tab_attr->command[0] != NULL)
+            {
+              /* the arguments are stored in a row, empty ones included */
+              tab.command = strings.strings->len;
+              for (n = 0; tab_attr->command[n] != NULL; n++)
+                g_string_append_len (strings.strings, tab_attr->command[n], strlen (tab_attr->command[n]) + 1);
+              tab.n_command = n;
+            }
+          tab.directory = terminal_session_add_string (&strings, tab_attr->directory);
+          tab.title = terminal_session_add_string (&strings, tab_attr->title);
+          tab.initial_title = terminal_session_add_string (&strings, tab_attr->initial_title);
+          tab.color_text = terminal_session_add_string (&strings, tab_attr->color_text);
+          tab.color_bg = terminal_session_add_string (&strings, tab_attr->color_bg);
+          tab.color_title = terminal_session_add_string (&strings, tab_attr->color_title);
+          tab.dynamic_title_mode = tab_attr->dynamic_title_mode;
+          if (tab_attr->hold)
+            tab.flags |= SESSION_TAB_HOLD;
+          if (tab_attr->active)
+            tab.flags |= SESSION_TAB_ACTIVE;
+
+          if (tab_attr->scrollback != NULL
+              && g_bytes_get_size (tab_attr->scrollback) <= G_MAXUINT32)
+            {
+              tab.scrollback_offset = header.blobs_size;
+              tab.scrollback_size = g_bytes_get_size (tab_attr->scrollback);
+              header.blobs_size += tab.scrollback_size;
+              g_ptr_array_add (blobs, tab_attr->scrollback);
+            }
+
+          g_array_append_val (tabs, tab);
+          window.n_tabs++;
+        }
+
+      g_array_append_val (windows, window);
+    }
+
+  memcpy (header.magic, SESSION_MAGIC, sizeof (header.magic));
+  header.version = SESSION_VERSION;
+  header.n_windows = windows->len;
+  header.n_tabs = tabs->len;
+  header.strings_size = strings.strings->len;
+
+  /* keep the blobs aligned, they may be mapped */
+  index_size = sizeof (SessionHeader)
+               + windows->len * sizeof (SessionWindow)
+               + tabs->len * sizeof (SessionTab)
+               + strings.strings->len;
+  header.blobs_offset = (index_size + 7) & ~((gsize) 7);
+  size = header.blobs_offset + header.blobs_size;
+
+  data = g_malloc0 (size);
+  p = data;
+  memcpy (p, &header, sizeof (header));
+  p += sizeof (header);
+  memcpy (p, windows->data, windows->len * sizeof (SessionWindow));
+  p += windows->len * sizeof (SessionWindow);
+  memcpy (p, tabs->data, tabs->len * sizeof (SessionTab));
+  p += tabs->len * sizeof (SessionTab);
+  memcpy (p, strings.strings->str, strings.strings->len);
+
+  p = data + header.blobs_offset;
+  for (n = 0; n < blobs->len; n++)
+    {
+      memcpy (p, g_bytes_get_data (blobs->pdata[n], NULL), g_bytes_get_size (blobs->pdata[n]));
+      p += g_bytes_get_size (blobs->pdata[n]);
+    }
+
+  g_array_free (windows, TRUE);
+  g_array_free (tabs, TRUE);
+  g_ptr_array_free (blobs, TRUE);
+  g_string_free (strings.strings, TRUE);
+  g_hash_table_destroy (strings.offsets);
+
+  return g_bytes_new_take (data, size);
+}
+
+
+
+/**
+ * terminal_session_parse:
+ * @session : Contents of a session file.
+ * @error   : Return location for errors or %NULL.
+ *
+ * Reads the windows and tabs from @session. The scrollback snapshots of
+ * the tabs reference the data of @session, nothing is decompressed.
+ *
+ * Return value: List of #TerminalWindowAttr or %NULL on error.
+ **/
+GSList *
+terminal_session_parse (GBytes  *session,
+                        GError **error)
+{
+  TerminalWindowAttr *win_attr;
+  TerminalTabAttr    *tab_attr;
+  SessionHeader       header;
+  SessionWindow       window;
+  SessionTab          tab;
+  const guint8       *data;
+  const gchar        *strings;
+  GSList             *window_attrs = NULL;
+  gsize               size;
+  guint64             index_size;
+  guint32             offset;
+  guint               w, t, n;
+
+  terminal_return_val_if_fail (session != NULL, NULL);
+
+  data = g_bytes_get_data (session, &size);
+  if (size < sizeof (header))
+    goto invalid;
+
+  /* records are copied out, the data need not be aligned */
+  memcpy (&header, data, sizeof (header));
+  if (memcmp (header.magic, SESSION_MAGIC, sizeof (header.magic)) != 0
+      || header.version != SESSION_VERSION
+      || header.n_windows == 0
+      || header.n_windows > SESSION_MAX_RECORDS
+      || header.n_tabs > SESSION_MAX_RECORDS
+      || header.strings_size == 0)
+    goto invalid;
+
+  index_size = sizeof (SessionHeader)
+               + (guint64) header.n_windows * sizeof (SessionWindow)
+               + (guint64) header.n_tabs * sizeof (SessionTab)
+               + header.strings_size;
+  if (index_size > header.blobs_offset
+      || header.blobs_offset > size
+      || header.blobs_size > size - header.blobs_offset)
+    goto invalid;
+
+  strings = (const gchar *) data + index_size - header.strings_size;
+  if (strings[header.strings_size - 1] != '\0')
+    goto invalid;
+
+  for (w = 0; w < header.n_windows; w++)
+    {
+      memcpy (&window, data + sizeof (SessionHeader) + w * sizeof (SessionWindow), sizeof (window));
+      if (window.n_tabs == 0
+          || window.first_tab > header.n_tabs
+          || window.n_tabs > header.n_tabs - window.first_tab)
+        goto invalid;
+
+      win_attr = terminal_window_attr_new ();
+      window_attrs = g_slist_prepend (window_attrs, win_attr);
+
+      /* replace the default tab */
+      g_slist_free_full (win_attr->tabs, (GDestroyNotify) terminal_tab_attr_free);
+      win_attr->tabs = NULL;
+
+      if (!terminal_session_get_string (strings, header.strings_size, window.display, &win_attr->display)
+          || !terminal_session_get_string (strings, header.strings_size, window.role, &win_attr->role)
+          || !terminal_session_get_string (strings, header.strings_size, window.geometry, &win_attr->geometry)
+          || !terminal_session_get_string (strings, header.strings_size, window.font, &win_attr->font)
+          || !terminal_session_get_string (strings, header.strings_size, window.icon, &win_attr->icon))
+        goto invalid;
+
+      win_attr->menubar = window.menubar;
+      win_attr->borders = window.borders;
+      win_attr->toolbar = window.toolbar;
+      win_attr->scrollbar = window.scrollbar;
+      win_attr->zoom = CLAMP (window.zoom, TERMINAL_ZOOM_LEVEL_MINIMUM, TERMINAL_ZOOM_LEVEL_MAXIMUM);
+      win_attr->fullscreen = (window.flags & SESSION_WINDOW_FULLSCREEN) != 0;
+      win_attr->maximize = (window.flags & SESSION_WINDOW_MAXIMIZE) != 0;
+      win_attr->minimize = (window.flags & SESSION_WINDOW_MINIMIZE) != 0;
+
+      for (t = window.first_tab; t < window.first_tab + window.n_tabs; t++)
+        {
+          memcpy (&tab, data + sizeof (SessionHeader) + header.n_windows * sizeof (SessionWindow)
+                  + t * sizeof (SessionTab), sizeof (tab));
+
+          tab_attr = terminal_tab_attr_new ();
+          win_attr->tabs = g_slist_prepend (win_attr->tabs, tab_attr);
+
+          if (tab.n_command > 0)
+            {
+              if (tab.n_command > header.strings_size)
+                goto invalid;
+
+              tab_attr->command = g_new0 (gchar *, tab.n_command + 1);
+              for (n = 0, offset = tab.command; n < tab.n_command; n++)
+                {
+                  if (offset >= header.strings_size)
+                    goto invalid;
+                  tab_attr->command[n] = g_strdup (strings + offset);
+                  offset += strlen (strings + offset) + 1;
+                }
+            }
+
+          if (!terminal_session_get_string (strings, header.strings_size, tab.directory, &tab_attr->directory)
+              || !terminal_session_get_string (strings, header.strings_size, tab.title, &tab_attr->title)
+              || !terminal_session_get_string (strings, header.strings_size, tab.initial_title, &tab_attr->initial_title)
+              || !terminal_session_get_string (strings, header.strings_size, tab.color_text, &tab_attr->color_text)
+              || !terminal_session_get_string (strings, header.strings_size, tab.color_bg, &tab_attr->color_bg)
+              || !terminal_session_get_string (strings, header.strings_size, tab.color_title, &tab_attr->color_title))
+            goto invalid;
+
+          if (tab.dynamic_title_mode >= TERMINAL_TITLE_REPLACE
+              && tab.dynamic_title_mode <= TERMINAL_TITLE_DEFAULT)
+            tab_attr->dynamic_title_mode = tab.dynamic_title_mode;
+          tab_attr->hold = (tab.flags & SESSION_TAB_HOLD) != 0;
+          tab_attr->active = (tab.flags & SESSION_TAB_ACTIVE) != 0;
+
+          if (tab.scrollback_size > 0)
+            {
+              if (tab.scrollback_offset > header.blobs_size
+                  || tab.scrollback_size > header.blobs_size - tab.scrollback_offset)
+                goto invalid;
+
+              tab_attr->scrollback = g_bytes_new_from_bytes (session,
+                                                             header.blobs_offset + tab.scrollback_offset,
+                                                             tab.scrollback_size);
+            }
+        }
+
+      win_attr->tabs = g_slist_reverse (win_attr->tabs);
+    }
+
+  return g_slist_reverse (window_attrs);
+
+invalid:
+  g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                       _("The session file is invalid or damaged"));
+  g_slist_free_full (window_attrs, (GDestroyNotify) terminal_window_attr_free);
+
+  return NULL;
+}
+
+
+
+/**
+ * terminal_session_save:
+ * @window_attrs : List of #TerminalWindowAttr.
+ * @filename     : The session file to write.
+ * @error        : Return location for errors or %NULL.
+ *
+ * Writes @window_attrs to @filename. The scrollback of the tabs is
+ * already compressed, so this only copies it into the file. The file
+ * is replaced atomically and only readable by the user.
+ *
+ * Return value: %TRUE if @filename was written.
+ **/
+gboolean
+terminal_session_save (GSList       *window_attrs,
+                       const gchar  *filename,
+                       GError      **error)
+{
+  GBytes   *contents;
+  GFile    *file;
+  GFile    *parent;
+  GError   *err = NULL;
+  gboolean  succeed;
+
+  terminal_return_val_if_fail (filename != NULL, FALSE);
+  terminal_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  contents = terminal_session_serialize (window_attrs);
+
+  file = g_file_new_for_path (filename);
+  parent = g_file_get_parent (file);
+  if (!g_file_make_directory_with_parents (parent, NULL, &err)
+      && g_error_matches (err, G_IO_ERROR, G_IO_ERROR_EXISTS))
+    g_clear_error (&err);
+
+  /* the scrollback is private, replace the file atomically */
+  succeed = err == NULL
+            && g_file_replace_contents (file,
+                                        g_bytes_get_data (contents, NULL),
+                                        g_bytes_get_size (contents),
+                                        NULL, FALSE,
+                                        G_FILE_CREATE_PRIVATE | G_FILE_CREATE_REPLACE_DESTINATION,
+                                        NULL, NULL, &err);
+
+  g_object_unref (G_OBJECT (parent));
+  g_object_unref (G_OBJECT (file));
+  g_bytes_unref (contents);
+
+  if (!succeed)
+    g_propagate_error (error, err);
+
+  return succeed;
+}
+
+
+
+/**
+ * terminal_session_load:
+ * @filename : A session file.
+ * @error    : Return location for errors or %NULL.
+ *
+ * Maps @filename and reads its windows and tabs. The scrollback of
+ * the tabs stays in the mapped file until it is restored.
+ *
+ * Return value: List of #TerminalWindowAttr or %NULL on error.
+ **/
+GSList *
+terminal_session_load (const gchar  *filename,
+                       GError      **error)
+{
+  GMappedFile *mapped_file;
+  GBytes      *session;
+  GSList      *window_attrs;
+
+  terminal_return_val_if_fail (filename != NULL, NULL);
+
+  mapped_file = g_mapped_file_new (filename, FALSE, error);
+  if (mapped_file == NULL)
+    return NULL;
+
+  session = g_mapped_file_get_bytes (mapped_file);
+  window_attrs = terminal_session_parse (session, error);
+  g_bytes_unref (session);
+  g_mapped_file_unref (mapped_file);
+
+  return window_attrs;
+}
@@ -0,0 +1,37 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_SESSION_H
+#define TERMINAL_SESSION_H
+
+#include <terminal/terminal-options.h>
+
+G_BEGIN_DECLS
+
+GBytes   *terminal_session_serialize (GSList       *window_attrs);
+
+GSList   *terminal_session_parse     (GBytes       *session,
+                                      GError      **error);
+
+gboolean  terminal_session_save      (GSList       *window_attrs,
+                                      const gchar  *filename,
+                                      GError      **error);
+
+GSList   *terminal_session_load      (const gchar  *filename,
+                                      GError      **error);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_SESSION_H */
@@ -0,0 +1,243 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gio/gio.h>
+#include <xfconf/xfconf.h>
+
+#include <terminal/terminal-system-font.h>
+#include <terminal/terminal-private.h>
+
+#define XSETTINGS_CHANNEL   "xsettings"
+#define XSETTINGS_PROPERTY  "/Gtk/MonospaceFontName"
+#define GNOME_SCHEMA        "org.gnome.desktop.interface"
+#define GNOME_KEY           "monospace-font-name"
+
+
+
+static void     terminal_system_font_finalize (GObject            *object);
+static gboolean terminal_system_font_resolve  (TerminalSystemFont *font);
+static void     terminal_system_font_changed  (TerminalSystemFont *font);
+
+
+
+enum
+{
+  CHANGED,
+  LAST_SIGNAL
+};
+
+struct _TerminalSystemFontClass
+{
+  GObjectClass parent_class;
+};
+
+struct _TerminalSystemFont
+{
+  GObject        parent_instance;
+
+  /* xfce settings, NULL if xfconf is not available */
+  XfconfChannel *channel;
+
+  /* gnome settings, NULL if the schema is not installed */
+  GSettings     *settings;
+
+  gchar         *font_name;
+};
+
+
+
+static guint font_signals[LAST_SIGNAL];
+
+
+
+G_DEFINE_TYPE (TerminalSystemFont, terminal_system_font, G_TYPE_OBJECT)
+
+
+
+static void
+terminal_system_font_class_init (TerminalSystemFontClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = terminal_system_font_finalize;
+
+  /**
+   * TerminalSystemFont::changed
+   *
+   * Emitted when the system monospace font changed.
+   **/
+  font_signals[CHANGED] =
+    g_signal_new (I_("changed"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
+}
+
+
+
+static void
+terminal_system_font_init (TerminalSystemFont *font)
+{
+  GSettingsSchemaSource *source;
+  GSettingsSchema       *schema;
+
+  /* watch the Xfce settings */
+  if (xfconf_init (NULL))
+    {
+      font->channel = g_object_ref (xfconf_channel_get (XSETTINGS_CHANNEL));
+      g_signal_connect_swapped (G_OBJECT (font->channel), "property-changed::" XSETTINGS_PROPERTY,
+                                G_CALLBACK (terminal_system_font_changed), font);
+    }
+
+  /* watch the GNOME settings, g_settings_new() aborts on a missing schema */
+  source = g_settings_schema_source_get_default ();
+  schema = source != NULL ? g_settings_schema_source_lookup (source, GNOME_SCHEMA, TRUE) : NULL;
+  if (schema != NULL)
+    {
+      if (g_settings_schema_has_key (schema, GNOME_KEY))
+        {
+          font->settings = g_settings_new_full (schema, NULL, NULL);
+          g_signal_connect_swapped (G_OBJECT (font->settings), "changed::" GNOME_KEY,
+                                    G_CALLBACK (terminal_system_font_changed), font);
+        }
+      g_settings_schema_unref (schema);
+    }
+
+  terminal_system_font_resolve (font);
+}
+
+
+
+static void
+terminal_system_font_finalize (GObject *object)
+{
+  TerminalSystemFont *font = TERMINAL_SYSTEM_FONT (object);
+
+  if (font->channel != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (font->channel),
+          G_CALLBACK (terminal_system_font_changed), font);
+      g_object_unref (G_OBJECT (font->channel));
+      xfconf_shutdown ();
+    }
+
+  if (font->settings != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (font->settings),
+          G_CALLBACK (terminal_system_font_changed), font);
+      g_object_unref (G_OBJECT (font->settings));
+    }
+
+  g_free (font->font_name);
+
+  (*G_OBJECT_CLASS (terminal_system_font_parent_class)->finalize) (object);
+}
+
+
+
+static gboolean
+terminal_system_font_resolve (TerminalSystemFont *font)
+{
+  gchar *font_name = NULL;
+
+  /* read Xfce settings */
+  if (font->channel != NULL && xfconf_channel_has_property (font->channel, XSETTINGS_PROPERTY))
+    font_name = xfconf_channel_get_string (font->channel, XSETTINGS_PROPERTY, "");
+
+  /* if font isn't set, read GNOME settings */
+  if (!IS_STRING (font_name) && font->settings != NULL)
+    {
+      g_free (font_name);
+      font_name = g_settings_get_string (font->settings, GNOME_KEY);
+    }
+
+  if (!IS_STRING (font_name))
+    {
+      g_free (font_name);
+      font_name = NULL;
+    }
+
+  if (g_strcmp0 (font_name, font->font_name) == 0)
+    {
+      g_free (font_name);
+      return FALSE;
+    }
+
+  g_free (font->font_name);
+  font->font_name = font_name;
+
+  return TRUE;
+}
+
+
+
+static void
+terminal_system_font_changed (TerminalSystemFont *font)
+{
+  if (terminal_system_font_resolve (font))
+    g_signal_emit (G_OBJECT (font), font_signals[CHANGED], 0);
+}
+
+
+
+/**
+ * terminal_system_font_get:
+ *
+ * Returns the #TerminalSystemFont instance, which resolves the system
+ * monospace font once and tells all screens when it changes. The
+ * returned pointer is already ref'ed, call g_object_unref() if you
+ * don't need it any longer.
+ *
+ * Return value : The #TerminalSystemFont instance.
+ **/
+TerminalSystemFont*
+terminal_system_font_get (void)
+{
+  static TerminalSystemFont *font = NULL;
+
+  if (G_UNLIKELY (font == NULL))
+    {
+      font = g_object_new (TERMINAL_TYPE_SYSTEM_FONT, NULL);
+      g_object_add_weak_pointer (G_OBJECT (font), (gpointer) &font);
+    }
+  else
+    {
+      g_object_ref (G_OBJECT (font));
+    }
+
+  return font;
+}
+
+
+
+/**
+ * terminal_system_font_get_name:
+ * @font : A #TerminalSystemFont.
+ *
+ * Return value: The system monospace font name or %NULL if none is set.
+ **/
+const gchar*
+terminal_system_font_get_name (TerminalSystemFont *font)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_SYSTEM_FONT (font), NULL);
+  return font->font_name;
+}
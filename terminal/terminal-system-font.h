@@ -0,0 +1,41 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_SYSTEM_FONT_H
+#define TERMINAL_SYSTEM_FONT_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define TERMINAL_TYPE_SYSTEM_FONT            (terminal_system_font_get_type ())
+#define TERMINAL_SYSTEM_FONT(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TERMINAL_TYPE_SYSTEM_FONT, TerminalSystemFont))
+#define TERMINAL_SYSTEM_FONT_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), TERMINAL_TYPE_SYSTEM_FONT, TerminalSystemFontClass))
+#define TERMINAL_IS_SYSTEM_FONT(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TERMINAL_TYPE_SYSTEM_FONT))
+#define TERMINAL_IS_SYSTEM_FONT_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), TERMINAL_TYPE_SYSTEM_FONT))
+#define TERMINAL_SYSTEM_FONT_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), TERMINAL_TYPE_SYSTEM_FONT, TerminalSystemFontClass))
+
+typedef struct _TerminalSystemFontClass TerminalSystemFontClass;
+typedef struct _TerminalSystemFont      TerminalSystemFont;
+
+GType               terminal_system_font_get_type (void) G_GNUC_CONST;
+
+TerminalSystemFont *terminal_system_font_get      (void);
+
+const gchar        *terminal_system_font_get_name (TerminalSystemFont *font);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_SYSTEM_FONT_H */
@@ -0,0 +1,410 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <terminal/terminal-private.h>
+#include <terminal/terminal-tab-index.h>
+
+/* the score of a match is built from these */
+#define SCORE_SUBSTRING   (1000)
+#define SCORE_CHAR        (1)
+#define SCORE_CONSECUTIVE (4)
+#define SCORE_WORD_START  (3)
+#define SCORE_MAX_GAP     (8)
+
+
+
+typedef struct _TabIndexEntry TabIndexEntry;
+
+
+
+static void     tab_index_entry_free      (gpointer           data);
+static guint64  tab_index_mask            (const gchar       *folded);
+static gint     tab_index_score           (const gchar       *haystack,
+                                           const gchar       *needle,
+                                           gsize              needle_len);
+
+
+
+struct _TerminalTabIndex
+{
+  /* entries in the order they were added */
+  GPtrArray  *entries;
+  GHashTable *keys;
+};
+
+struct _TabIndexEntry
+{
+  gpointer  key;
+  gchar    *text[TERMINAL_TAB_INDEX_N_FIELDS];
+  gchar    *folded[TERMINAL_TAB_INDEX_N_FIELDS];
+
+  /* characters in any of the fields, to skip entries that
+   * cannot match before scoring them */
+  guint64   mask;
+};
+
+
+
+static void
+tab_index_entry_free (gpointer data)
+{
+  TabIndexEntry *entry = data;
+  guint          n;
+
+  for (n = 0; n < TERMINAL_TAB_INDEX_N_FIELDS; n++)
+    {
+      g_free (entry->text[n]);
+      g_free (entry->folded[n]);
+    }
+
+  g_slice_free (TabIndexEntry, entry);
+}
+
+
+
+static guint64
+tab_index_mask (const gchar *folded)
+{
+  const guchar *p;
+  guint64       mask = 0;
+
+  /* one bit per ascii character class, multibyte characters are
+   * left out so they never reject an entry */
+  if (folded != NULL)
+    for (p = (const guchar *) folded; *p != '\0'; p++)
+      if (*p < 0x80)
+        mask |= G_GUINT64_CONSTANT (1) << (*p & 63);
+
+  return mask;
+}
+
+
+
+static inline gboolean
+tab_index_is_word_start (const gchar *haystack,
+                         const gchar *p)
+{
+  return p == haystack || strchr (" /-_.:@~", p[-1]) != NULL;
+}
+
+
+
+static gint
+tab_index_score (const gchar *haystack,
+                 const gchar *needle,
+                 gsize        needle_len)
+{
+  const gchar *found;
+  const gchar *p = haystack;
+  const gchar *prev_end = NULL;
+  const gchar *n, *next;
+  gchar        c[8];
+  gint         score = 0;
+  gsize        len;
+
+  /* matching a piece of the text as is beats any scattered match */
+  found = strstr (haystack, needle);
+  if (found != NULL)
+    {
+      return SCORE_SUBSTRING + (gint) needle_len * SCORE_CONSECUTIVE
+             + (tab_index_is_word_start (haystack, found) ? SCORE_WORD_START : 0);
+    }
+
+  /* find the characters of the needle in order, preferring runs
+   * of characters and characters at the start of words */
+  for (n = needle; *n != '\0'; n = next)
+    {
+      next = g_utf8_next_char (n);
+      len = next - n;
+
+      if (G_LIKELY (len == 1))
+        {
+          found = strchr (p, *n);
+        }
+      else
+        {
+          memcpy (c, n, len);
+          c[len] = '\0';
+          found = strstr (p, c);
+        }
+
+      if (found == NULL)
+        return -1;
+
+      score += SCORE_CHAR;
+      if (found == prev_end)
+        score += SCORE_CONSECUTIVE;
+      else if (prev_end != NULL)
+        score -= MIN (found - prev_end, SCORE_MAX_GAP);
+      if (tab_index_is_word_start (haystack, found))
+        score += SCORE_WORD_START;
+
+      p = prev_end = found + len;
+    }
+
+  return MAX (score, 0);
+}
+
+
+
+/**
+ * terminal_tab_index_new:
+ *
+ * Creates an index of the title, working directory and command of
+ * tabs, to look up tabs with fuzzy queries.
+ *
+ * Return value: A new #TerminalTabIndex.
+ **/
+TerminalTabIndex *
+terminal_tab_index_new (void)
+{
+  TerminalTabIndex *index;
+
+  index = g_slice_new (TerminalTabIndex);
+  index->entries = g_ptr_array_new_with_free_func (tab_index_entry_free);
+  index->keys = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  return index;
+}
+
+
+
+/**
+ * terminal_tab_index_free:
+ * @index : A #TerminalTabIndex.
+ **/
+void
+terminal_tab_index_free (TerminalTabIndex *index)
+{
+  terminal_return_if_fail (index != NULL);
+
+  g_hash_table_destroy (index->keys);
+  g_ptr_array_free (index->entries, TRUE);
+  g_slice_free (TerminalTabIndex, index);
+}
+
+
+
+/**
+ * terminal_tab_index_set:
+ * @index : A #TerminalTabIndex.
+ * @key   : The tab.
+ * @field : The field to update.
+ * @text  : The new text of @field, or %NULL.
+ *
+ * Updates a single field of @key, adding @key to @index if needed.
+ **/
+void
+terminal_tab_index_set (TerminalTabIndex      *index,
+                        gpointer               key,
+                        TerminalTabIndexField  field,
+                        const gchar           *text)
+{
+  TabIndexEntry *entry;
+  guint          n;
+
+  terminal_return_if_fail (index != NULL);
+  terminal_return_if_fail (field < TERMINAL_TAB_INDEX_N_FIELDS);
+
+  entry = g_hash_table_lookup (index->keys, key);
+  if (entry == NULL)
+    {
+      entry = g_slice_new0 (TabIndexEntry);
+      entry->key = key;
+      g_ptr_array_add (index->entries, entry);
+      g_hash_table_insert (index->keys, key, entry);
+    }
+
+  if (g_strcmp0 (entry->text[field], text) == 0)
+    return;
+
+  g_free (entry->text[field]);
+  g_free (entry->folded[field]);
+  entry->text[field] = g_strdup (text);
+  entry->folded[field] = text != NULL ? g_utf8_casefold (text, -1) : NULL;
+
+  entry->mask = 0;
+  for (n = 0; n < TERMINAL_TAB_INDEX_N_FIELDS; n++)
+    entry->mask |= tab_index_mask (entry->folded[n]);
+}
+
+
+
+/**
+ * terminal_tab_index_get:
+ * @index : A #TerminalTabIndex.
+ * @key   : The tab.
+ * @field : The field to return.
+ *
+ * Return value: The text of @field, or %NULL.
+ **/
+const gchar *
+terminal_tab_index_get (TerminalTabIndex      *index,
+                        gpointer               key,
+                        TerminalTabIndexField  field)
+{
+  TabIndexEntry *entry;
+
+  terminal_return_val_if_fail (index != NULL, NULL);
+  terminal_return_val_if_fail (field < TERMINAL_TAB_INDEX_N_FIELDS, NULL);
+
+  entry = g_hash_table_lookup (index->keys, key);
+  return entry != NULL ? entry->text[field] : NULL;
+}
+
+
+
+/**
+ * terminal_tab_index_remove:
+ * @index : A #TerminalTabIndex.
+ * @key   : The tab.
+ **/
+void
+terminal_tab_index_remove (TerminalTabIndex *index,
+                           gpointer          key)
+{
+  TabIndexEntry *entry;
+
+  terminal_return_if_fail (index != NULL);
+
+  entry = g_hash_table_lookup (index->keys, key);
+  if (entry != NULL)
+    {
+      g_hash_table_remove (index->keys, key);
+      g_ptr_array_remove (index->entries, entry);
+    }
+}
+
+
+
+/**
+ * terminal_tab_index_match:
+ * @index     : A #TerminalTabIndex.
+ * @query     : The text to look for.
+ * @matches   : Array for the results.
+ * @n_matches : Length of @matches.
+ *
+ * Matches the words in @query case-insensitively against the fields
+ * of all tabs, each word can match another field. Characters of a
+ * word have to appear in the same order, but not next to each other.
+ * Tabs with the same score are returned in the order they were added.
+ *
+ * Return value: The number of matches stored in @matches, best first.
+ **/
+guint
+terminal_tab_index_match (TerminalTabIndex *index,
+                          const gchar      *query,
+                          TerminalTabMatch *matches,
+                          guint             n_matches)
+{
+  TabIndexEntry  *entry;
+  gchar          *folded;
+  gchar         **words;
+  gsize           lengths[8];
+  guint64         mask = 0;
+  guint           n, f, w, i, n_words = 0, n_found = 0;
+  gint            score, word_best, total;
+  guint           field, word_field;
+
+  terminal_return_val_if_fail (index != NULL, 0);
+  terminal_return_val_if_fail (matches != NULL || n_matches == 0, 0);
+
+  if (n_matches == 0)
+    return 0;
+
+  folded = g_utf8_casefold (query != NULL ? query : "", -1);
+  words = g_strsplit (folded, " ", -1);
+  g_free (folded);
+
+  /* drop empty words, and ignore words beyond the first few */
+  for (w = 0; words[w] != NULL; w++)
+    {
+      if (*words[w] == '\0' || n_words == G_N_ELEMENTS (lengths))
+        {
+          g_free (words[w]);
+          continue;
+        }
+
+      words[n_words] = words[w];
+      lengths[n_words] = strlen (words[w]);
+      mask |= tab_index_mask (words[w]);
+      n_words++;
+    }
+  words[n_words] = NULL;
+
+  for (n = 0; n < index->entries->len; n++)
+    {
+      entry = g_ptr_array_index (index->entries, n);
+      if ((entry->mask & mask) != mask)
+        continue;
+
+      /* every word has to match, in the field it matches best */
+      total = 0;
+      field = TERMINAL_TAB_INDEX_TITLE;
+      for (w = 0; w < n_words; w++)
+        {
+          word_best = -1;
+          word_field = TERMINAL_TAB_INDEX_TITLE;
+          for (f = 0; f < TERMINAL_TAB_INDEX_N_FIELDS; f++)
+            {
+              if (entry->folded[f] == NULL)
+                continue;
+
+              score = tab_index_score (entry->folded[f], words[w], lengths[w]);
+              if (score > word_best)
+                {
+                  word_best = score;
+                  word_field = f;
+                }
+            }
+
+          if (word_best < 0)
+            break;
+
+          if (w == 0)
+            field = word_field;
+          total += word_best;
+        }
+
+      if (w < n_words)
+        continue;
+
+      /* insert after the matches with an equal or better score */
+      for (i = n_found; i > 0 && matches[i - 1].score < total; i--)
+        if (i < n_matches)
+          matches[i] = matches[i - 1];
+
+      if (i < n_matches)
+        {
+          matches[i].key = entry->key;
+          matches[i].score = total;
+          matches[i].field = field;
+          if (n_found < n_matches)
+            n_found++;
+        }
+    }
+
+  g_strfreev (words);
+
+  return n_found;
+}
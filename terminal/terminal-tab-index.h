@@ -0,0 +1,63 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_TAB_INDEX_H
+#define TERMINAL_TAB_INDEX_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  TERMINAL_TAB_INDEX_TITLE,
+  TERMINAL_TAB_INDEX_DIRECTORY,
+  TERMINAL_TAB_INDEX_COMMAND,
+  TERMINAL_TAB_INDEX_N_FIELDS
+} TerminalTabIndexField;
+
+typedef struct
+{
+  gpointer              key;
+  gint                  score;
+  TerminalTabIndexField field;
+} TerminalTabMatch;
+
+typedef struct _TerminalTabIndex TerminalTabIndex;
+
+TerminalTabIndex *terminal_tab_index_new        (void);
+
+void              terminal_tab_index_free       (TerminalTabIndex      *index);
+
+void              terminal_tab_index_set        (TerminalTabIndex      *index,
+                                                 gpointer               key,
+                                                 TerminalTabIndexField  field,
+                                                 const gchar           *text);
+
+const gchar      *terminal_tab_index_get        (TerminalTabIndex      *index,
+                                                 gpointer               key,
+                                                 TerminalTabIndexField  field);
+
+void              terminal_tab_index_remove     (TerminalTabIndex      *index,
+                                                 gpointer               key);
+
+guint             terminal_tab_index_match      (TerminalTabIndex      *index,
+                                                 const gchar           *query,
+                                                 TerminalTabMatch      *matches,
+                                                 guint                  n_matches);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_TAB_INDEX_H */
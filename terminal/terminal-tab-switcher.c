@@ -0,0 +1,303 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <libxfce4ui/libxfce4ui.h>
+
+#include <terminal/terminal-private.h>
+#include <terminal/terminal-tab-switcher.h>
+
+/* number of tabs listed for a query */
+#define MAX_MATCHES (50)
+
+
+
+static void     terminal_tab_switcher_search_changed (TerminalTabSwitcher *switcher);
+static gboolean terminal_tab_switcher_key_press      (GtkWidget           *entry,
+                                                      GdkEventKey         *event,
+                                                      TerminalTabSwitcher *switcher);
+static void     terminal_tab_switcher_activate       (TerminalTabSwitcher *switcher);
+static void     terminal_tab_switcher_row_activated  (GtkListBox          *list_box,
+                                                      GtkListBoxRow       *row,
+                                                      TerminalTabSwitcher *switcher);
+static void     terminal_tab_switcher_select         (TerminalTabSwitcher *switcher,
+                                                      GtkListBoxRow       *row);
+
+
+
+enum
+{
+  TAB_ACTIVATED,
+  LAST_SIGNAL
+};
+
+struct _TerminalTabSwitcherClass
+{
+  GtkPopoverClass parent_class;
+};
+
+struct _TerminalTabSwitcher
+{
+  GtkPopover        parent_instance;
+
+  TerminalTabIndex *index;
+
+  GtkWidget        *entry;
+  GtkWidget        *list_box;
+  GtkWidget        *scroll;
+};
+
+
+
+static guint switcher_signals[LAST_SIGNAL];
+static GQuark switcher_key_quark = 0;
+
+
+
+G_DEFINE_TYPE (TerminalTabSwitcher, terminal_tab_switcher, GTK_TYPE_POPOVER)
+
+
+
+static void
+terminal_tab_switcher_class_init (TerminalTabSwitcherClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+
+  /**
+   * TerminalTabSwitcher::tab-activated:
+   *
+   * Emitted with the key of the tab the user picked.
+   **/
+  switcher_signals[TAB_ACTIVATED] =
+    g_signal_new (I_("tab-activated"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__POINTER,
+                  G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+  switcher_key_quark = g_quark_from_static_string ("terminal-tab-switcher-key");
+}
+
+
+
+static void
+terminal_tab_switcher_init (TerminalTabSwitcher *switcher)
+{
+  GtkWidget *box;
+
+  box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+  gtk_container_set_border_width (GTK_CONTAINER (box), 6);
+  gtk_container_add (GTK_CONTAINER (switcher), box);
+
+  switcher->entry = gtk_search_entry_new ();
+  gtk_entry_set_placeholder_text (GTK_ENTRY (switcher->entry), _("Title, directory or command"));
+  gtk_entry_set_width_chars (GTK_ENTRY (switcher->entry), 50);
+  gtk_box_pack_start (GTK_BOX (box), switcher->entry, FALSE, TRUE, 0);
+  g_signal_connect_swapped (G_OBJECT (switcher->entry), "search-changed",
+      G_CALLBACK (terminal_tab_switcher_search_changed), switcher);
+  g_signal_connect_swapped (G_OBJECT (switcher->entry), "activate",
+      G_CALLBACK (terminal_tab_switcher_activate), switcher);
+  g_signal_connect_swapped (G_OBJECT (switcher->entry), "stop-search",
+      G_CALLBACK (gtk_widget_hide), switcher);
+  g_signal_connect (G_OBJECT (switcher->entry), "key-press-event",
+      G_CALLBACK (terminal_tab_switcher_key_press), switcher);
+
+  switcher->scroll = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (switcher->scroll),
+                                  GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (switcher->scroll), GTK_SHADOW_IN);
+#if GTK_CHECK_VERSION (3, 22, 0)
+  gtk_scrolled_window_set_propagate_natural_height (GTK_SCROLLED_WINDOW (switcher->scroll), TRUE);
+  gtk_scrolled_window_set_max_content_height (GTK_SCROLLED_WINDOW (switcher->scroll), 400);
+#else
+  gtk_widget_set_size_request (switcher->scroll, -1, 400);
+#endif
+  gtk_box_pack_start (GTK_BOX (box), switcher->scroll, TRUE, TRUE, 0);
+
+  switcher->list_box = gtk_list_box_new ();
+  gtk_list_box_set_selection_mode (GTK_LIST_BOX (switcher->list_box), GTK_SELECTION_BROWSE);
+  gtk_list_box_set_activate_on_single_click (GTK_LIST_BOX (switcher->list_box), TRUE);
+  gtk_container_add (GTK_CONTAINER (switcher->scroll), switcher->list_box);
+  g_signal_connect (G_OBJECT (switcher->list_box), "row-activated",
+      G_CALLBACK (terminal_tab_switcher_row_activated), switcher);
+
+  gtk_widget_show_all (box);
+}
+
+
+
+static void
+terminal_tab_switcher_search_changed (TerminalTabSwitcher *switcher)
+{
+  TerminalTabMatch  matches[MAX_MATCHES];
+  GList            *children, *li;
+  GtkWidget        *row, *box, *label;
+  const gchar      *title, *directory, *command;
+  gchar            *details;
+  guint             n, n_matches;
+
+  children = gtk_container_get_children (GTK_CONTAINER (switcher->list_box));
+  for (li = children; li != NULL; li = li->next)
+    gtk_widget_destroy (GTK_WIDGET (li->data));
+  g_list_free (children);
+
+  /* only the best matches get a row, whatever the number of tabs */
+  n_matches = terminal_tab_index_match (switcher->index,
+                                        gtk_entry_get_text (GTK_ENTRY (switcher->entry)),
+                                        matches, G_N_ELEMENTS (matches));
+
+  for (n = 0; n < n_matches; n++)
+    {
+      title = terminal_tab_index_get (switcher->index, matches[n].key, TERMINAL_TAB_INDEX_TITLE);
+      directory = terminal_tab_index_get (switcher->index, matches[n].key, TERMINAL_TAB_INDEX_DIRECTORY);
+      command = terminal_tab_index_get (switcher->index, matches[n].key, TERMINAL_TAB_INDEX_COMMAND);
+
+      row = gtk_list_box_row_new ();
+      g_object_set_qdata (G_OBJECT (row), switcher_key_quark, matches[n].key);
+
+      box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+      gtk_container_set_border_width (GTK_CONTAINER (box), 3);
+      gtk_container_add (GTK_CONTAINER (row), box);
+
+      label = gtk_label_new (title);
+      gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+      gtk_label_set_ellipsize (GTK_LABEL (label), PANGO_ELLIPSIZE_END);
+      gtk_box_pack_start (GTK_BOX (box), label, FALSE, TRUE, 0);
+
+      if (IS_STRING (directory) && IS_STRING (command))
+        details = g_strdup_printf ("%s \342\200\224 %s", directory, command);
+      else
+        details = g_strdup (IS_STRING (directory) ? directory : command);
+
+      if (details != NULL)
+        {
+          label = gtk_label_new (details);
+          gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+          gtk_label_set_ellipsize (GTK_LABEL (label), PANGO_ELLIPSIZE_MIDDLE);
+          gtk_style_context_add_class (gtk_widget_get_style_context (label), "dim-label");
+          gtk_box_pack_start (GTK_BOX (box), label, FALSE, TRUE, 0);
+          g_free (details);
+        }
+
+      gtk_widget_show_all (row);
+      gtk_container_add (GTK_CONTAINER (switcher->list_box), row);
+    }
+
+  terminal_tab_switcher_select (switcher, gtk_list_box_get_row_at_index (GTK_LIST_BOX (switcher->list_box), 0));
+}
+
+
+
+static gboolean
+terminal_tab_switcher_key_press (GtkWidget           *entry,
+                                 GdkEventKey         *event,
+                                 TerminalTabSwitcher *switcher)
+{
+  GtkListBoxRow *row;
+  gint           index;
+
+  if (event->keyval != GDK_KEY_Up && event->keyval != GDK_KEY_Down)
+    return FALSE;
+
+  /* move through the list while typing */
+  row = gtk_list_box_get_selected_row (GTK_LIST_BOX (switcher->list_box));
+  index = row != NULL ? gtk_list_box_row_get_index (row) : -1;
+  index += event->keyval == GDK_KEY_Up ? -1 : 1;
+
+  row = gtk_list_box_get_row_at_index (GTK_LIST_BOX (switcher->list_box), MAX (index, 0));
+  if (row != NULL)
+    terminal_tab_switcher_select (switcher, row);
+
+  return TRUE;
+}
+
+
+
+static void
+terminal_tab_switcher_activate (TerminalTabSwitcher *switcher)
+{
+  GtkListBoxRow *row;
+
+  row = gtk_list_box_get_selected_row (GTK_LIST_BOX (switcher->list_box));
+  if (row != NULL)
+    terminal_tab_switcher_row_activated (GTK_LIST_BOX (switcher->list_box), row, switcher);
+}
+
+
+
+static void
+terminal_tab_switcher_row_activated (GtkListBox          *list_box,
+                                     GtkListBoxRow       *row,
+                                     TerminalTabSwitcher *switcher)
+{
+  g_signal_emit (G_OBJECT (switcher), switcher_signals[TAB_ACTIVATED], 0,
+                 g_object_get_qdata (G_OBJECT (row), switcher_key_quark));
+}
+
+
+
+static void
+terminal_tab_switcher_select (TerminalTabSwitcher *switcher,
+                              GtkListBoxRow       *row)
+{
+  GtkAdjustment *adjustment;
+  GtkAllocation  allocation;
+
+  gtk_list_box_select_row (GTK_LIST_BOX (switcher->list_box), row);
+  if (row == NULL || !gtk_widget_get_realized (GTK_WIDGET (row)))
+    return;
+
+  /* keep the row in view, the focus stays in the entry */
+  gtk_widget_get_allocation (GTK_WIDGET (row), &allocation);
+  adjustment = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (switcher->scroll));
+  gtk_adjustment_clamp_page (adjustment, allocation.y, allocation.y + allocation.height);
+}
+
+
+
+/**
+ * terminal_tab_switcher_new:
+ * @relative_to : The widget the switcher points to.
+ * @index       : The #TerminalTabIndex to search in.
+ *
+ * Creates a popover that lists the tabs in @index matching the text
+ * typed in it. The caller has to keep @index alive while the switcher
+ * exists.
+ *
+ * Return value: A new #TerminalTabSwitcher.
+ **/
+GtkWidget *
+terminal_tab_switcher_new (GtkWidget        *relative_to,
+                           TerminalTabIndex *index)
+{
+  TerminalTabSwitcher *switcher;
+
+  terminal_return_val_if_fail (GTK_IS_WIDGET (relative_to), NULL);
+  terminal_return_val_if_fail (index != NULL, NULL);
+
+  switcher = g_object_new (TERMINAL_TYPE_TAB_SWITCHER, "relative-to", relative_to, NULL);
+  switcher->index = index;
+
+  /* list all tabs until something is typed */
+  terminal_tab_switcher_search_changed (switcher);
+
+  return GTK_WIDGET (switcher);
+}
@@ -0,0 +1,41 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_TAB_SWITCHER_H
+#define TERMINAL_TAB_SWITCHER_H
+
+#include <gtk/gtk.h>
+#include <terminal/terminal-tab-index.h>
+
+G_BEGIN_DECLS
+
+#define TERMINAL_TYPE_TAB_SWITCHER            (terminal_tab_switcher_get_type ())
+#define TERMINAL_TAB_SWITCHER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), TERMINAL_TYPE_TAB_SWITCHER, TerminalTabSwitcher))
+#define TERMINAL_TAB_SWITCHER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), TERMINAL_TYPE_TAB_SWITCHER, TerminalTabSwitcherClass))
+#define TERMINAL_IS_TAB_SWITCHER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TERMINAL_TYPE_TAB_SWITCHER))
+#define TERMINAL_IS_TAB_SWITCHER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), TERMINAL_TYPE_TAB_SWITCHER))
+#define TERMINAL_TAB_SWITCHER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), TERMINAL_TYPE_TAB_SWITCHER, TerminalTabSwitcherClass))
+
+typedef struct _TerminalTabSwitcherClass TerminalTabSwitcherClass;
+typedef struct _TerminalTabSwitcher      TerminalTabSwitcher;
+
+GType      terminal_tab_switcher_get_type (void) G_GNUC_CONST;
+
+GtkWidget *terminal_tab_switcher_new      (GtkWidget        *relative_to,
+                                           TerminalTabIndex *index);
+
+G_END_DECLS
+
+#endif /* !TERMINAL_TAB_SWITCHER_H */
@@ -143,3 +143,37 @@ terminal_util_activate_window (GtkWindow *window)
   gtk_window_present (window);
 #endif
 }
+
+
+
+/**
+ * terminal_util_get_font_description:
+ * @font_name : a Pango font name.
+ *
+ * Parses @font_name once per process and returns the shared result, so
+ * callers can tell an unchanged font apart with a pointer comparison.
+ *
+ * Return value: a #PangoFontDescription owned by the cache.
+ **/
+const PangoFontDescription*
+terminal_util_get_font_description (const gchar *font_name)
+{
+  static GHashTable    *descriptions = NULL;
+  PangoFontDescription *font_desc;
+
+  terminal_return_val_if_fail (font_name != NULL, NULL);
+
+  /* only a handful of fonts is ever used, so entries are never removed */
+  if (G_UNLIKELY (descriptions == NULL))
+    descriptions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          (GDestroyNotify) pango_font_description_free);
+
+  font_desc = g_hash_table_lookup (descriptions, font_name);
+  if (G_UNLIKELY (font_desc == NULL))
+    {
+      font_desc = pango_font_description_from_string (font_name);
+      g_hash_table_insert (descriptions, g_strdup (font_name), font_desc);
+    }
+
+  return font_desc;
+}
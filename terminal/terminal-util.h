@@ -22,9 +22,11 @@
 
 G_BEGIN_DECLS
 
-void terminal_util_show_about_dialog  (GtkWindow    *parent);
+void                        terminal_util_show_about_dialog     (GtkWindow   *parent);
 
-void terminal_util_activate_window    (GtkWindow    *window);
+void                        terminal_util_activate_window       (GtkWindow   *window);
+
+const PangoFontDescription *terminal_util_get_font_description (const gchar *font_name);
 
 G_END_DECLS
 
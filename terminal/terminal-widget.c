@@ -45,6 +45,9 @@
 
 #define MAILTO          "mailto:"
 
+/* bytes of quoted file names handed to the writer at once */
+#define DROP_BATCH_SIZE (64 * 1024)
+
 
 
 enum
@@ -54,29 +57,6 @@ enum
   LAST_SIGNAL,
 };
 
-typedef enum
-{
-  PATTERN_TYPE_NONE,
-  PATTERN_TYPE_FULL_HTTP,
-  PATTERN_TYPE_HTTP,
-  PATTERN_TYPE_EMAIL
-} PatternType;
-
-typedef struct
-{
-  const gchar *pattern;
-  PatternType  type;
-} TerminalRegexPattern;
-
-static const TerminalRegexPattern regex_patterns[] =
-{
-  { REGEX_URL_AS_IS, PATTERN_TYPE_FULL_HTTP },
-  { REGEX_URL_HTTP,  PATTERN_TYPE_HTTP },
-  { REGEX_URL_FILE,  PATTERN_TYPE_FULL_HTTP },
-  { REGEX_EMAIL,     PATTERN_TYPE_EMAIL },
-  { REGEX_NEWS_MAN,  PATTERN_TYPE_FULL_HTTP },
-};
-
 
 
 static void     terminal_widget_finalize              (GObject          *object);
@@ -95,6 +75,22 @@ static void     terminal_widget_open_uri              (TerminalWidget   *widget,
                                                        const gchar      *wlink,
                                                        gint              tag);
 static void     terminal_widget_update_highlight_urls (TerminalWidget   *widget);
+static void     terminal_widget_drop_uris             (TerminalWidget   *widget,
+                                                       gchar            *uri_list);
+static void     terminal_widget_drop_uris_thread      (GTask            *task,
+                                                       gpointer          source_object,
+                                                       gpointer          task_data,
+                                                       GCancellable     *cancellable);
+static void     terminal_widget_drop_push             (TerminalWidget   *widget,
+                                                       GString          *text,
+                                                       gboolean          last,
+                                                       GCancellable     *cancellable);
+static gboolean terminal_widget_drop_push_idle        (gpointer          user_data);
+static void     terminal_widget_writer_finished       (TerminalChildWriter *writer,
+                                                       gboolean          cancelled,
+                                                       TerminalWidget   *widget);
+static GRegex **terminal_widget_regex_cache_ref      (void);
+static void     terminal_widget_regex_cache_unref    (void);
 
 
 
@@ -110,12 +106,33 @@ struct _TerminalWidget
   /*< private >*/
   TerminalPreferences *preferences;
   gint                 regex_tags[G_N_ELEMENTS (regex_patterns)];
+  guint                has_regex_cache : 1;
+
+  /* writes drops and pastes to the child */
+  TerminalChildWriter *writer;
+  GCancellable        *drop_cancellable;
+
+  /* uri drops are quoted one after the other */
+  GMutex               drop_lock;
 };
 
+typedef struct
+{
+  TerminalWidget *widget;
+  GCancellable   *cancellable;
+  GString        *text;
+  gboolean        last;
+} DropBatch;
+
 
 
 static guint widget_signals[LAST_SIGNAL];
 
+/* compiled url patterns, shared by all widgets with highlighting enabled */
+static GRegex *regex_cache[G_N_ELEMENTS (regex_patterns)];
+static guint   regex_cache_users = 0;
+static guint   regex_cache_builds = 0;
+
 
 
 static const GtkTargetEntry targets[] =
@@ -185,6 +202,8 @@ terminal_widget_init (TerminalWidget *widget)
   /* unset tags */
   memset (widget->regex_tags, -1, sizeof (widget->regex_tags));
 
+  g_mutex_init (&widget->drop_lock);
+
   /* setup Drag'n'Drop support */
   gtk_drag_dest_set (GTK_WIDGET (widget),
                      GTK_DEST_DEFAULT_MOTION |
@@ -217,9 +236,28 @@ terminal_widget_finalize (GObject *object)
   /* disconnect the misc-highlight-urls watch */
   g_signal_handlers_disconnect_by_func (G_OBJECT (widget->preferences), G_CALLBACK (terminal_widget_update_highlight_urls), widget);
 
+  /* vte holds its own references on the regexes it matches */
+  if (widget->has_regex_cache)
+    terminal_widget_regex_cache_unref ();
+
   /* disconnect from the preferences */
   g_object_unref (G_OBJECT (widget->preferences));
 
+  /* stop quoting pending drops */
+  if (widget->drop_cancellable != NULL)
+    {
+      g_cancellable_cancel (widget->drop_cancellable);
+      g_object_unref (G_OBJECT (widget->drop_cancellable));
+    }
+
+  if (widget->writer != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (widget->writer), G_CALLBACK (terminal_widget_writer_finished), widget);
+      g_object_unref (G_OBJECT (widget->writer));
+    }
+
+  g_mutex_clear (&widget->drop_lock);
+
   (*G_OBJECT_CLASS (terminal_widget_parent_class)->finalize) (object);
 }
 
@@ -472,15 +510,16 @@ terminal_widget_drag_data_received (GtkWidget        *widget,
                                     guint             info,
                                     guint             time)
 {
-  const guint16 *ucs;
-  GdkRGBA        color;
-  GString       *str;
-  GValue         value = { 0, };
-  gchar        **uris;
-  gchar         *filename;
-  gchar         *text;
-  gint           n;
-  GtkWidget     *screen;
+  TerminalChildWriter *writer = terminal_widget_get_writer (TERMINAL_WIDGET (widget));
+  GBytes              *bytes;
+  const guint16       *ucs;
+  GdkRGBA              color;
+  GString             *str;
+  GValue               value = { 0, };
+  gchar               *filename;
+  gchar               *text;
+  gint                 n;
+  GtkWidget           *screen;
 
   switch (info)
     {
@@ -490,11 +529,7 @@ terminal_widget_drag_data_received (GtkWidget        *widget,
     case TARGET_TEXT:
       text = (gchar *) gtk_selection_data_get_text (selection_data);
       if (G_LIKELY (text != NULL))
-        {
-          if (G_LIKELY (*text != '\0'))
-            vte_terminal_feed_child (VTE_TERMINAL (widget), text, strlen (text));
-          g_free (text);
-        }
+        terminal_child_writer_push (writer, text, strlen (text), FALSE);
       break;
 
     case TARGET_TEXT_PLAIN:
@@ -505,9 +540,11 @@ terminal_widget_drag_data_received (GtkWidget        *widget,
         }
       else
         {
-          vte_terminal_feed_child (VTE_TERMINAL (widget),
-                                   (const gchar *) gtk_selection_data_get_data (selection_data),
-                                   gtk_selection_data_get_length (selection_data));
+          /* all of the data, it may contain nul characters */
+          bytes = g_bytes_new (gtk_selection_data_get_data (selection_data),
+                               gtk_selection_data_get_length (selection_data));
+          terminal_child_writer_push_bytes (writer, bytes, FALSE);
+          g_bytes_unref (bytes);
         }
       break;
 
@@ -528,15 +565,12 @@ terminal_widget_drag_data_received (GtkWidget        *widget,
           filename = g_filename_from_uri (str->str, NULL, NULL);
           if (filename != NULL)
             {
-              vte_terminal_feed_child (VTE_TERMINAL (widget), filename, strlen (filename));
+              g_string_assign (str, filename);
               g_free (filename);
             }
-          else
-            {
-              vte_terminal_feed_child (VTE_TERMINAL (widget), str->str, str->len);
-            }
-          vte_terminal_feed_child (VTE_TERMINAL (widget), " ", 1);
-          g_string_free (str, TRUE);
+          g_string_append_c (str, ' ');
+          n = str->len;
+          terminal_child_writer_push (writer, g_string_free (str, FALSE), n, FALSE);
         }
       break;
 
@@ -548,32 +582,9 @@ terminal_widget_drag_data_received (GtkWidget        *widget,
         }
       else
         {
-          /* split the text/uri-list */
+          /* quote the file names in a thread, a drop can hold thousands of them */
           text = g_strndup ((const gchar *) gtk_selection_data_get_data (selection_data), gtk_selection_data_get_length (selection_data));
-          uris = g_uri_list_extract_uris (text);
-          g_free (text);
-
-          /* translate all file:-URIs to quoted file names */
-          for (n = 0; uris[n] != NULL; ++n)
-            {
-              /* check if we have a local file here */
-              filename = g_filename_from_uri (uris[n], NULL, NULL);
-              if (G_LIKELY (filename != NULL))
-                {
-                  /* release the file:-URI */
-                  g_free (uris[n]);
-
-                  /* quote the file name (for the shell) */
-                  uris[n] = g_shell_quote (filename);
-                  g_free (filename);
-                }
-            }
-
-          text = g_strjoinv (" ", uris);
-          vte_terminal_feed_child (VTE_TERMINAL (widget), text, strlen (text));
-          vte_terminal_feed_child (VTE_TERMINAL (widget), " ", 1);
-          g_strfreev (uris);
-          g_free (text);
+          terminal_widget_drop_uris (TERMINAL_WIDGET (widget), text);
         }
       break;
 
@@ -625,6 +636,143 @@ terminal_widget_drag_data_received (GtkWidget        *widget,
 
 
 
+static void
+terminal_widget_drop_uris (TerminalWidget *widget,
+                           gchar          *uri_list)
+{
+  GTask *task;
+
+  if (widget->drop_cancellable == NULL)
+    widget->drop_cancellable = g_cancellable_new ();
+
+  /* the writer finishes once, after the last batch of the drop */
+  terminal_child_writer_hold (terminal_widget_get_writer (widget));
+
+  task = g_task_new (widget, widget->drop_cancellable, NULL, NULL);
+  g_task_set_task_data (task, uri_list, g_free);
+  g_task_run_in_thread (task, terminal_widget_drop_uris_thread);
+  g_object_unref (G_OBJECT (task));
+}
+
+
+
+static void
+terminal_widget_drop_uris_thread (GTask        *task,
+                                  gpointer      source_object,
+                                  gpointer      task_data,
+                                  GCancellable *cancellable)
+{
+  TerminalWidget  *widget = TERMINAL_WIDGET (source_object);
+  GString         *batch;
+  gchar          **uris;
+  gchar           *filename;
+  gchar           *quoted;
+  guint            n;
+
+  g_mutex_lock (&widget->drop_lock);
+
+  /* split the text/uri-list */
+  uris = g_uri_list_extract_uris (task_data);
+  batch = g_string_sized_new (DROP_BATCH_SIZE + 256);
+
+  /* translate all file:-URIs to quoted file names */
+  for (n = 0; uris[n] != NULL && !g_cancellable_is_cancelled (cancellable); ++n)
+    {
+      /* check if we have a local file here */
+      filename = g_filename_from_uri (uris[n], NULL, NULL);
+      if (G_LIKELY (filename != NULL))
+        {
+          /* quote the file name (for the shell) */
+          quoted = g_shell_quote (filename);
+          g_string_append (batch, quoted);
+          g_free (quoted);
+          g_free (filename);
+        }
+      else
+        {
+          g_string_append (batch, uris[n]);
+        }
+      g_string_append_c (batch, ' ');
+
+      if (batch->len >= DROP_BATCH_SIZE)
+        {
+          terminal_widget_drop_push (widget, batch, FALSE, cancellable);
+          batch = g_string_sized_new (DROP_BATCH_SIZE + 256);
+        }
+    }
+
+  /* always sent, it releases the writer */
+  terminal_widget_drop_push (widget, batch, TRUE, cancellable);
+
+  g_strfreev (uris);
+
+  g_mutex_unlock (&widget->drop_lock);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+
+
+static void
+terminal_widget_drop_push (TerminalWidget *widget,
+                           GString        *text,
+                           gboolean        last,
+                           GCancellable   *cancellable)
+{
+  DropBatch *batch;
+
+  /* hand the batch over to the writer in the main loop, in order */
+  batch = g_slice_new (DropBatch);
+  batch->widget = g_object_ref (widget);
+  batch->cancellable = g_object_ref (cancellable);
+  batch->text = text;
+  batch->last = last;
+
+  g_main_context_invoke (NULL, terminal_widget_drop_push_idle, batch);
+}
+
+
+
+static gboolean
+terminal_widget_drop_push_idle (gpointer user_data)
+{
+  DropBatch           *batch = user_data;
+  TerminalChildWriter *writer = terminal_widget_get_writer (batch->widget);
+  gsize                length = batch->text->len;
+
+  if (length > 0 && !g_cancellable_is_cancelled (batch->cancellable))
+    terminal_child_writer_push (writer, g_string_free (batch->text, FALSE), length, FALSE);
+  else
+    g_string_free (batch->text, TRUE);
+
+  if (batch->last)
+    terminal_child_writer_release (writer);
+
+  g_object_unref (G_OBJECT (batch->cancellable));
+  g_object_unref (G_OBJECT (batch->widget));
+  g_slice_free (DropBatch, batch);
+
+  return FALSE;
+}
+
+
+
+static void
+terminal_widget_writer_finished (TerminalChildWriter *writer,
+                                 gboolean             cancelled,
+                                 TerminalWidget      *widget)
+{
+  /* cancelling the writer also stops the drops still being quoted */
+  if (cancelled && widget->drop_cancellable != NULL)
+    {
+      g_cancellable_cancel (widget->drop_cancellable);
+      g_object_unref (G_OBJECT (widget->drop_cancellable));
+      widget->drop_cancellable = NULL;
+    }
+}
+
+
+
 static gboolean
 terminal_widget_key_press_event (GtkWidget    *widget,
                                  GdkEventKey  *event)
@@ -728,14 +876,92 @@ terminal_widget_open_uri (TerminalWidget *widget,
 
 
 
-static void
-terminal_widget_update_highlight_urls (TerminalWidget *widget)
+static GRegex **
+terminal_widget_regex_cache_ref (void)
 {
-  guint                       i;
-  gboolean                    highlight_urls;
-  GRegex                     *regex;
   const TerminalRegexPattern *pattern;
   GError                     *error;
+  guint                       i;
+#ifdef G_ENABLE_DEBUG
+  gint64                      timer;
+#endif
+
+  if (regex_cache_users++ > 0)
+    return regex_cache;
+
+  regex_cache_builds++;
+
+#ifdef G_ENABLE_DEBUG
+  timer = g_get_monotonic_time ();
+#endif
+
+  /* compile and jit the patterns once for all terminals, vte takes
+   * a reference when the regex is added to a widget */
+  for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
+    {
+      pattern = &regex_patterns[i];
+
+      /* build the regex */
+      error = NULL;
+#if VTE_CHECK_VERSION (0, 45, 90)
+      regex_cache[i] = vte_regex_new_for_match (pattern->pattern, -1, REGEX_MATCH_FLAGS, &error);
+
+      if (error == NULL && (!vte_regex_jit (regex_cache[i], PCRE2_JIT_COMPLETE, &error) ||
+                            !vte_regex_jit (regex_cache[i], PCRE2_JIT_PARTIAL_SOFT, &error)))
+        {
+          g_critical ("Failed to JIT regular expression '%s': %s\n", pattern->pattern, error->message);
+          g_clear_error (&error);
+        }
+#else
+      regex_cache[i] = g_regex_new (pattern->pattern, REGEX_MATCH_FLAGS, 0, &error);
+#endif
+      if (G_UNLIKELY (error != NULL))
+        {
+          g_critical ("Failed to parse regular expression pattern %d: %s", i, error->message);
+          g_error_free (error);
+          regex_cache[i] = NULL;
+        }
+    }
+
+#ifdef G_ENABLE_DEBUG
+  /* this is the cost every new tab paid before the cache */
+  g_debug ("compiled %u url patterns in %.2f ms",
+           (guint) G_N_ELEMENTS (regex_patterns),
+           (g_get_monotonic_time () - timer) / 1000.0);
+#endif
+
+  return regex_cache;
+}
+
+
+
+static void
+terminal_widget_regex_cache_unref (void)
+{
+  guint i;
+
+  terminal_return_if_fail (regex_cache_users > 0);
+
+  if (--regex_cache_users > 0)
+    return;
+
+  /* no widget highlights urls anymore */
+  for (i = 0; i < G_N_ELEMENTS (regex_cache); i++)
+    if (regex_cache[i] != NULL)
+      {
+        g_regex_unref (regex_cache[i]);
+        regex_cache[i] = NULL;
+      }
+}
+
+
+
+static void
+terminal_widget_update_highlight_urls (TerminalWidget *widget)
+{
+  guint    i;
+  gboolean highlight_urls;
+  GRegex **regexes;
 
   g_object_get (G_OBJECT (widget->preferences),
                 "misc-highlight-urls", &highlight_urls, NULL);
@@ -749,53 +975,83 @@ terminal_widget_update_highlight_urls (TerminalWidget *widget)
             vte_terminal_match_remove (VTE_TERMINAL (widget), widget->regex_tags[i]);
             widget->regex_tags[i] = -1;
           }
+
+      if (widget->has_regex_cache)
+        {
+          widget->has_regex_cache = FALSE;
+          terminal_widget_regex_cache_unref ();
+        }
     }
-  else
+  else if (!widget->has_regex_cache)
     {
+      widget->has_regex_cache = TRUE;
+      regexes = terminal_widget_regex_cache_ref ();
+
       /* set all our patterns */
       for (i = 0; i < G_N_ELEMENTS (regex_patterns); i++)
         {
-          /* continue if already set */
-          if (G_UNLIKELY (widget->regex_tags[i] != -1))
+          /* skip patterns that failed to compile */
+          if (G_UNLIKELY (regexes[i] == NULL))
             continue;
 
-          /* get the pattern */
-          pattern = &regex_patterns[i];
-
-          /* build the regex */
-          error = NULL;
-#if VTE_CHECK_VERSION (0, 45, 90)
-          regex = vte_regex_new_for_match (pattern->pattern, -1,
-                                           PCRE2_CASELESS | PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE,
-                                           &error);
-
-          if (error == NULL && (!vte_regex_jit (regex, PCRE2_JIT_COMPLETE, &error) ||
-                                !vte_regex_jit (regex, PCRE2_JIT_PARTIAL_SOFT, &error)))
-            {
-              g_critical ("Failed to JIT regular expression '%s': %s\n", pattern->pattern, error->message);
-              g_clear_error (&error);
-            }
-#else
-          regex = g_regex_new (pattern->pattern,
-                               G_REGEX_CASELESS | G_REGEX_OPTIMIZE | G_REGEX_MULTILINE,
-                               0, &error);
-#endif
-          if (G_UNLIKELY (error != NULL))
-            {
-              g_critical ("Failed to parse regular expression pattern %d: %s", i, error->message);
-              g_error_free (error);
-              continue;
-            }
-
-          /* set the new regular expression */
-          widget->regex_tags[i] = vte_terminal_match_add_gregex (VTE_TERMINAL (widget), regex, 0);
+          /* set the shared regular expression */
+          widget->regex_tags[i] = vte_terminal_match_add_gregex (VTE_TERMINAL (widget), regexes[i], 0);
 #if VTE_CHECK_VERSION (0, 53, 0)
           vte_terminal_match_set_cursor_name (VTE_TERMINAL (widget), widget->regex_tags[i], "hand2");
 #else
           vte_terminal_match_set_cursor_type (VTE_TERMINAL (widget), widget->regex_tags[i], GDK_HAND2);
 #endif
-          /* release the regex owned by vte now */
-          g_regex_unref (regex);
         }
     }
 }
+
+
+
+/**
+ * terminal_widget_get_writer:
+ * @widget : A #TerminalWidget.
+ *
+ * Returns the writer that sends drops and large pastes to the child
+ * of @widget, so everything arrives in order.
+ *
+ * Return value: The #TerminalChildWriter of @widget.
+ **/
+TerminalChildWriter*
+terminal_widget_get_writer (TerminalWidget *widget)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_WIDGET (widget), NULL);
+
+  if (G_UNLIKELY (widget->writer == NULL))
+    {
+      widget->writer = terminal_child_writer_new (VTE_TERMINAL (widget));
+      g_signal_connect (G_OBJECT (widget->writer), "finished",
+          G_CALLBACK (terminal_widget_writer_finished), widget);
+    }
+
+  return widget->writer;
+}
+
+
+
+/**
+ * terminal_widget_get_regex_stats:
+ * @n_patterns : Return location for the compiled url patterns.
+ * @n_users    : Return location for the widgets sharing them.
+ * @n_builds   : Return location for how often the patterns were
+ *               compiled since the start.
+ **/
+void
+terminal_widget_get_regex_stats (guint *n_patterns,
+                                 guint *n_users,
+                                 guint *n_builds)
+{
+  guint i;
+
+  *n_patterns = 0;
+  for (i = 0; i < G_N_ELEMENTS (regex_cache); i++)
+    if (regex_cache[i] != NULL)
+      *n_patterns += 1;
+
+  *n_users = regex_cache_users;
+  *n_builds = regex_cache_builds;
+}
@@ -21,6 +21,7 @@
 #define TERMINAL_WIDGET_H
 
 #include <vte/vte.h>
+#include <terminal/terminal-child-writer.h>
 
 G_BEGIN_DECLS
 
@@ -47,7 +48,13 @@ enum
 typedef struct _TerminalWidget      TerminalWidget;
 typedef struct _TerminalWidgetClass TerminalWidgetClass;
 
-GType      terminal_widget_get_type (void) G_GNUC_CONST;
+GType                terminal_widget_get_type        (void) G_GNUC_CONST;
+
+TerminalChildWriter *terminal_widget_get_writer      (TerminalWidget *widget);
+
+void                 terminal_widget_get_regex_stats (guint          *n_patterns,
+                                                      guint          *n_users,
+                                                      guint          *n_builds);
 
 G_END_DECLS
 
@@ -35,16 +35,16 @@
 
 #include <libxfce4ui/libxfce4ui.h>
 
+#ifdef GDK_WINDOWING_X11
+#include <gdk/gdkx.h>
+#endif
+
+#include <terminal/terminal-gdbus.h>
 #include <terminal/terminal-private.h>
 #include <terminal/terminal-window.h>
 #include <terminal/terminal-util.h>
 #include <terminal/terminal-window-dropdown.h>
 
-/* animation fps */
-#define ANIMATION_FPS (1000 / 20)
-
-
-
 enum
 {
   PROP_0,
@@ -81,11 +81,15 @@ static void     terminal_window_dropdown_status_icon_popup_menu  (GtkStatusIcon
                                                                   TerminalWindowDropdown *dropdown);
 static gboolean terminal_window_dropdown_can_grab                (gpointer                data);
 static void     terminal_window_dropdown_can_grab_destroyed      (gpointer                data);
-static void     terminal_window_dropdown_get_monitor_geometry    (GdkScreen              *screen,
+static void     terminal_window_dropdown_get_monitor_geometry    (TerminalWindowDropdown *dropdown,
+                                                                  GdkScreen              *screen,
                                                                   gint                    monitor_num,
                                                                   GdkRectangle           *geometry);
-static gboolean terminal_window_dropdown_animate_down            (gpointer                data);
-static gboolean terminal_window_dropdown_animate_up              (gpointer                data);
+static void     terminal_window_dropdown_clip                    (TerminalWindowDropdown *dropdown,
+                                                                  gdouble                 fraction);
+static gboolean terminal_window_dropdown_animate                 (GtkWidget              *widget,
+                                                                  GdkFrameClock          *frame_clock,
+                                                                  gpointer                user_data);
 static void     terminal_window_dropdown_animate_destroyed       (gpointer                data);
 static void     terminal_window_dropdown_hide                    (TerminalWindowDropdown *dropdown);
 static void     terminal_window_dropdown_show                    (TerminalWindowDropdown *dropdown,
@@ -97,6 +101,10 @@ static void     terminal_window_dropdown_toggle_real             (TerminalWindow
 static guint32  terminal_window_dropdown_get_timestamp           (const gchar            *startup_id);
 static void     terminal_dropdown_window_screen_size_changed     (GdkScreen              *screen,
                                                                   TerminalWindowDropdown *dropdown);
+#ifdef G_ENABLE_DEBUG
+static void     terminal_window_dropdown_after_paint             (GdkFrameClock          *frame_clock,
+                                                                  TerminalWindowDropdown *dropdown);
+#endif
 
 
 
@@ -116,10 +124,19 @@ struct _TerminalWindowDropdown
 {
   TerminalWindow     parent_instance;
 
-  /* timeout for animation */
-  guint              animation_timeout_id;
+  /* frame clock callback for animation */
+  guint              animation_tick_id;
   guint              animation_time;
   TerminalDirection  animation_dir;
+  gdouble            animation_fraction;
+  gint64             animation_frame_time;
+
+  /* measurements of the last animation */
+  gint64             animation_start_time;
+  guint              animation_n_frames;
+  guint              animation_n_resizes;
+  glong              animation_columns;
+  glong              animation_rows;
 
   /* ui widgets */
   GtkWidget         *keep_open;
@@ -139,6 +156,15 @@ struct _TerminalWindowDropdown
   GdkScreen         *screen;
   gint               monitor_num;
 
+  /* monitor geometries of the screen, until its size changes */
+  GArray            *monitor_geometries;
+
+#ifdef G_ENABLE_DEBUG
+  /* when the toggle was requested, for the latency measurement */
+  gint64             toggle_time;
+  gulong             after_paint_id;
+#endif
+
   /* server time of focus out with grab */
   gint64             focus_out_time;
 };
@@ -250,6 +276,7 @@ terminal_window_dropdown_init (TerminalWindowDropdown *dropdown)
   dropdown->rel_position = 0.50;
   dropdown->rel_position_vertical = 0.0;
   dropdown->animation_dir = ANIMATION_DIR_NONE;
+  dropdown->monitor_geometries = g_array_new (FALSE, TRUE, sizeof (GdkRectangle));
 
   /* shared setting to disable some functionality in TerminalWindow */
   terminal_window_set_drop_down (window, TRUE);
@@ -339,9 +366,6 @@ terminal_window_dropdown_finalize (GObject *object)
   if (dropdown->grab_timeout_id != 0)
     g_source_remove (dropdown->grab_timeout_id);
 
-  if (dropdown->animation_timeout_id != 0)
-    g_source_remove (dropdown->animation_timeout_id);
-
   if (dropdown->status_icon != NULL)
     g_object_unref (G_OBJECT (dropdown->status_icon));
 
@@ -350,6 +374,8 @@ terminal_window_dropdown_finalize (GObject *object)
                                           G_CALLBACK (terminal_dropdown_window_screen_size_changed),
                                           dropdown);
 
+  g_array_free (dropdown->monitor_geometries, TRUE);
+
   (*G_OBJECT_CLASS (terminal_window_dropdown_parent_class)->finalize) (object);
 }
 
@@ -606,123 +632,175 @@ terminal_window_dropdown_can_grab_destroyed (gpointer data)
 
 
 static void
-terminal_window_dropdown_get_monitor_geometry (GdkScreen    *screen,
-                                               gint          monitor_num,
-                                               GdkRectangle *geometry)
+terminal_window_dropdown_get_monitor_geometry (TerminalWindowDropdown *dropdown,
+                                               GdkScreen              *screen,
+                                               gint                    monitor_num,
+                                               GdkRectangle           *geometry)
 {
+  GArray       *cache = dropdown->monitor_geometries;
 #if GTK_CHECK_VERSION (3, 22, 0)
-  GdkDisplay *display = gdk_screen_get_display (screen);
-  GdkMonitor *monitor = gdk_display_get_monitor (display, monitor_num);
+  GdkDisplay   *display;
+  GdkMonitor   *monitor;
+#endif
+
+  /* geometries of the screen the window is on are kept until the
+   * screen reports a size change */
+  if (screen == dropdown->screen
+      && monitor_num >= 0
+      && (guint) monitor_num < cache->len
+      && g_array_index (cache, GdkRectangle, monitor_num).width > 0)
+    {
+      *geometry = g_array_index (cache, GdkRectangle, monitor_num);
+      return;
+    }
+
+#if GTK_CHECK_VERSION (3, 22, 0)
+  display = gdk_screen_get_display (screen);
+  monitor = gdk_display_get_monitor (display, monitor_num);
   gdk_monitor_get_geometry (monitor, geometry);
 #else
   gdk_screen_get_monitor_geometry (screen, monitor_num, geometry);
 #endif
+
+  if (screen == dropdown->screen && monitor_num >= 0)
+    {
+      if ((guint) monitor_num >= cache->len)
+        g_array_set_size (cache, monitor_num + 1);
+      g_array_index (cache, GdkRectangle, monitor_num) = *geometry;
+    }
 }
 
 
 
-static gboolean
-terminal_window_dropdown_animate_down (gpointer data)
+static void
+terminal_window_dropdown_clip (TerminalWindowDropdown *dropdown,
+                               gdouble                 fraction)
 {
-  TerminalWindowDropdown *dropdown = TERMINAL_WINDOW_DROPDOWN (data);
-  TerminalWindow         *window = TERMINAL_WINDOW (data);
-  GtkRequisition          req1;
-  GdkRectangle            rect;
-  gint                    step_size, vbox_h;
-  gboolean                fullscreen;
-
-  /* get window size */
-  terminal_window_dropdown_get_monitor_geometry (dropdown->screen, dropdown->monitor_num, &rect);
+  GtkWidget             *widget = GTK_WIDGET (dropdown);
+  cairo_region_t        *region;
+  cairo_rectangle_int_t  rect;
+  gdouble                remaining;
+  gboolean               shape = FALSE;
+  gint                   height;
+
+#ifdef GDK_WINDOWING_X11
+  /* window shapes are an x11 extension */
+  shape = GDK_IS_X11_DISPLAY (gtk_widget_get_display (widget));
+#endif
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  fullscreen = gtk_toggle_action_get_active (GTK_TOGGLE_ACTION (terminal_window_get_action (window, "fullscreen")));
-G_GNUC_END_IGNORE_DEPRECATIONS
-  if (!fullscreen)
+  if (fraction >= 1.0)
     {
-      /* calculate width/height if not fullscreen */
-      rect.width *= dropdown->rel_width;
-      rect.height *= dropdown->rel_height;
+      /* fully shown, drop the shape */
+      if (shape)
+        {
+          gtk_widget_shape_combine_region (widget, NULL);
+          gtk_widget_input_shape_combine_region (widget, NULL);
+        }
+      else
+        {
+          gtk_widget_set_opacity (widget, 1.0);
+        }
+      return;
     }
 
-  /* decrease each interval */
-  step_size = rect.height * ANIMATION_FPS / dropdown->animation_time;
-  if (step_size < 1)
-    step_size = 1;
-
-  /* new vbox size */
-  gtk_widget_get_preferred_size (terminal_window_get_vbox (window), &req1, NULL);
-  vbox_h = req1.height + step_size;
-  if (vbox_h > rect.height)
-    vbox_h = rect.height;
+  /* ease out (cubic), fast at the start and slow near the end */
+  remaining = 1.0 - CLAMP (fraction, 0.0, 1.0);
 
-  /* resize */
-  gtk_widget_set_size_request (terminal_window_get_vbox (window), req1.width, vbox_h);
-  gtk_window_resize (GTK_WINDOW (window), req1.width, vbox_h);
-
-  /* continue the animation */
-  if (vbox_h < rect.height)
-    return TRUE;
-
-  /* restore the fullscreen state */
-  if (fullscreen)
-    gtk_window_fullscreen (GTK_WINDOW (window));
+  if (!shape)
+    {
+      /* elsewhere the window fades in and out instead */
+      gtk_widget_set_opacity (widget, 1.0 - remaining * remaining * remaining);
+      return;
+    }
 
-  /* animation complete */
-  return FALSE;
+  /* the window keeps its full size, only the part that is shown changes,
+   * so the terminals are not resized and their children get no SIGWINCH;
+   * it is revealed from the screen edge it is closest to */
+  height = gtk_widget_get_allocated_height (widget);
+  rect.x = 0;
+  rect.width = gtk_widget_get_allocated_width (widget);
+  rect.height = height * (1.0 - remaining * remaining * remaining);
+  rect.y = dropdown->rel_position_vertical > 0.5 ? height - rect.height : 0;
+
+  region = cairo_region_create_rectangle (&rect);
+  gtk_widget_shape_combine_region (widget, region);
+  gtk_widget_input_shape_combine_region (widget, region);
+  cairo_region_destroy (region);
 }
 
 
 
 static gboolean
-terminal_window_dropdown_animate_up (gpointer data)
+terminal_window_dropdown_animate (GtkWidget     *widget,
+                                  GdkFrameClock *frame_clock,
+                                  gpointer       user_data)
 {
-  TerminalWindowDropdown *dropdown = TERMINAL_WINDOW_DROPDOWN (data);
-  TerminalWindow         *window = TERMINAL_WINDOW (data);
-  GtkRequisition          req1;
-  GdkRectangle            rect;
-  gint                    step_size, vbox_h, min_size;
-  gboolean                fullscreen;
-
-  /* get window size */
-  terminal_window_dropdown_get_monitor_geometry (dropdown->screen, dropdown->monitor_num, &rect);
+  TerminalWindowDropdown *dropdown = TERMINAL_WINDOW_DROPDOWN (widget);
+  TerminalScreen         *screen;
+  gint64                  now;
+  gdouble                 step;
+  glong                   columns, rows;
+  gboolean                done;
+  gboolean                keep_above;
+
+  now = gdk_frame_clock_get_frame_time (frame_clock);
+  if (dropdown->animation_frame_time == 0)
+    dropdown->animation_frame_time = now;
+
+  /* advance by the time since the last frame, so a slow frame does
+   * not make the animation take longer */
+  step = (now - dropdown->animation_frame_time) / (dropdown->animation_time * 1000.0);
+  dropdown->animation_frame_time = now;
+  dropdown->animation_n_frames++;
+
+  if (dropdown->animation_dir == ANIMATION_DIR_DOWN)
+    dropdown->animation_fraction = MIN (dropdown->animation_fraction + step, 1.0);
+  else
+    dropdown->animation_fraction = MAX (dropdown->animation_fraction - step, 0.0);
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  fullscreen = gtk_toggle_action_get_active (GTK_TOGGLE_ACTION (terminal_window_get_action (window, "fullscreen")));
-G_GNUC_END_IGNORE_DEPRECATIONS
-  if (!fullscreen)
+  screen = terminal_window_get_active (TERMINAL_WINDOW (dropdown));
+  if (screen != NULL)
     {
-      /* calculate width/height if not fullscreen */
-      rect.width *= dropdown->rel_width;
-      rect.height *= dropdown->rel_height;
+      terminal_screen_get_size (screen, &columns, &rows);
+      if (dropdown->animation_columns != columns || dropdown->animation_rows != rows)
+        dropdown->animation_n_resizes++;
+      dropdown->animation_columns = columns;
+      dropdown->animation_rows = rows;
     }
 
-  /* decrease each interval */
-  step_size = rect.height * ANIMATION_FPS / dropdown->animation_time;
-  if (step_size < 1)
-    step_size = 1;
+  if (dropdown->animation_dir == ANIMATION_DIR_DOWN)
+    done = dropdown->animation_fraction >= 1.0;
+  else
+    done = dropdown->animation_fraction <= 0.0;
 
-  /* new vbox size */
-  gtk_widget_get_preferred_size (terminal_window_get_vbox (window), &req1, NULL);
-  vbox_h = req1.height - step_size;
+  if (!done)
+    {
+      terminal_window_dropdown_clip (dropdown, dropdown->animation_fraction);
+      return G_SOURCE_CONTINUE;
+    }
 
-  /* sizes of the widgets that cannot be shrunk */
-  gtk_widget_get_preferred_size (terminal_window_get_notebook (window), &req1, NULL);
-  min_size = req1.height;
-  min_size += terminal_window_get_menubar_height (window);
-  min_size += terminal_window_get_toolbar_height (window);
+#ifdef G_ENABLE_DEBUG
+  g_debug ("drop-down animation: %u frames, %.1f ms, %u terminal resizes",
+           dropdown->animation_n_frames,
+           (now - dropdown->animation_start_time) / 1000.0,
+           dropdown->animation_n_resizes);
+#endif
 
-  if (vbox_h < min_size)
+  /* animation complete */
+  terminal_window_dropdown_clip (dropdown, 1.0);
+  if (dropdown->animation_dir == ANIMATION_DIR_UP)
     {
-      /* animation complete */
-      gtk_widget_hide (GTK_WIDGET (dropdown));
-      return FALSE;
+      gtk_widget_hide (widget);
+    }
+  else
+    {
+      g_object_get (terminal_window_get_preferences (TERMINAL_WINDOW (dropdown)),
+                    "dropdown-keep-above", &keep_above,
+                    NULL);
+      gtk_window_set_keep_above (GTK_WINDOW (dropdown), keep_above);
     }
 
-  /* resize window */
-  gtk_widget_set_size_request (terminal_window_get_vbox (window), rect.width, vbox_h);
-  gtk_window_resize (GTK_WINDOW (window), rect.width, vbox_h);
-
-  return TRUE;
+  return G_SOURCE_REMOVE;
 }
 
 
@@ -730,28 +808,70 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 static void
 terminal_window_dropdown_animate_destroyed (gpointer data)
 {
-  TERMINAL_WINDOW_DROPDOWN (data)->animation_timeout_id = 0;
+  TERMINAL_WINDOW_DROPDOWN (data)->animation_tick_id = 0;
   TERMINAL_WINDOW_DROPDOWN (data)->animation_dir = ANIMATION_DIR_NONE;
 }
 
 
 
 static void
-terminal_window_dropdown_hide (TerminalWindowDropdown *dropdown)
+terminal_window_dropdown_animate_start (TerminalWindowDropdown *dropdown,
+                                        TerminalDirection       direction)
 {
-  if (dropdown->animation_timeout_id != 0)
-    g_source_remove (dropdown->animation_timeout_id);
+  TerminalScreen *screen;
+
+  dropdown->animation_dir = direction;
+
+  /* an animation in the other direction continues from where it is */
+  if (dropdown->animation_tick_id != 0)
+    return;
+
+  dropdown->animation_frame_time = 0;
+  dropdown->animation_start_time = g_get_monotonic_time ();
+  dropdown->animation_n_frames = 0;
+  dropdown->animation_n_resizes = 0;
+
+  screen = terminal_window_get_active (TERMINAL_WINDOW (dropdown));
+  if (screen != NULL)
+    terminal_screen_get_size (screen, &dropdown->animation_columns, &dropdown->animation_rows);
+
+  terminal_window_dropdown_clip (dropdown, dropdown->animation_fraction);
+
+  /* driven by the frame clock, so there is one step per frame the
+   * compositor shows and none while the window is not mapped */
+  dropdown->animation_tick_id =
+      gtk_widget_add_tick_callback (GTK_WIDGET (dropdown),
+                                    terminal_window_dropdown_animate,
+                                    dropdown,
+                                    terminal_window_dropdown_animate_destroyed);
+}
 
+
+
+static void
+terminal_window_dropdown_animate_stop (TerminalWindowDropdown *dropdown)
+{
+  if (dropdown->animation_tick_id != 0)
+    gtk_widget_remove_tick_callback (GTK_WIDGET (dropdown), dropdown->animation_tick_id);
+
+  terminal_window_dropdown_clip (dropdown, 1.0);
+}
+
+
+
+static void
+terminal_window_dropdown_hide (TerminalWindowDropdown *dropdown)
+{
   if (dropdown->animation_time > 0)
     {
-      dropdown->animation_dir = ANIMATION_DIR_UP;
-      dropdown->animation_timeout_id =
-          gdk_threads_add_timeout_full (G_PRIORITY_DEFAULT_IDLE, ANIMATION_FPS,
-                                        terminal_window_dropdown_animate_up, dropdown,
-                                        terminal_window_dropdown_animate_destroyed);
+      if (dropdown->animation_dir == ANIMATION_DIR_NONE)
+        dropdown->animation_fraction = 1.0;
+      terminal_window_dropdown_animate_start (dropdown, ANIMATION_DIR_UP);
     }
   else
     {
+      terminal_window_dropdown_animate_stop (dropdown);
+
       /* it seems that xfwm4 wants the window unmaximized when it's hidden (bug #15681) */
       if (gtk_window_is_maximized (GTK_WINDOW (dropdown)))
         gtk_window_unmaximize (GTK_WINDOW (dropdown));
@@ -767,25 +887,21 @@ terminal_window_dropdown_show (TerminalWindowDropdown *dropdown,
                                gboolean                activate)
 {
   TerminalWindow    *window = TERMINAL_WINDOW (dropdown);
-  TerminalDirection  old_animation_dir = ANIMATION_DIR_NONE;
+  GdkScreen         *screen;
   GdkRectangle       monitor_geo;
-  GtkRequisition     req1;
   gint               w, h;
   gint               x, y;
   gboolean           move_to_active;
   gboolean           keep_above;
   gboolean           visible;
-  gint               vbox_h;
   gboolean           fullscreen;
+  gboolean           same_geometry;
+  gint               cur_w, cur_h;
+  gint               cur_x, cur_y;
+  gint               req_w, req_h;
 
   visible = gdk_window_is_visible (gtk_widget_get_window (GTK_WIDGET (dropdown)));
 
-  if (dropdown->animation_timeout_id != 0)
-    {
-      old_animation_dir = dropdown->animation_dir;
-      g_source_remove (dropdown->animation_timeout_id);
-    }
-
   g_object_get (terminal_window_get_preferences (window),
                 "dropdown-move-to-active", &move_to_active,
                 NULL);
@@ -795,20 +911,27 @@ terminal_window_dropdown_show (TerminalWindowDropdown *dropdown,
       || dropdown->screen == NULL
       || dropdown->monitor_num == -1)
     {
-      if (dropdown->screen != NULL)
-        g_signal_handlers_disconnect_by_func (G_OBJECT (dropdown->screen),
-                                              G_CALLBACK (terminal_dropdown_window_screen_size_changed),
-                                              dropdown);
-
-      dropdown->screen = xfce_gdk_screen_get_active (&dropdown->monitor_num);
-
-      /* watch for screen size changes to update terminal geometry accordingly*/
-      g_signal_connect (G_OBJECT (dropdown->screen), "size-changed",
-                        G_CALLBACK (terminal_dropdown_window_screen_size_changed), dropdown);
+      screen = xfce_gdk_screen_get_active (&dropdown->monitor_num);
+      if (screen != dropdown->screen)
+        {
+          if (dropdown->screen != NULL)
+            g_signal_handlers_disconnect_by_func (G_OBJECT (dropdown->screen),
+                                                  G_CALLBACK (terminal_dropdown_window_screen_size_changed),
+                                                  dropdown);
+
+          dropdown->screen = screen;
+          g_array_set_size (dropdown->monitor_geometries, 0);
+
+          /* watch for screen size changes to update terminal geometry accordingly*/
+          g_signal_connect (G_OBJECT (dropdown->screen), "size-changed",
+                            G_CALLBACK (terminal_dropdown_window_screen_size_changed), dropdown);
+          g_signal_connect (G_OBJECT (dropdown->screen), "monitors-changed",
+                            G_CALLBACK (terminal_dropdown_window_screen_size_changed), dropdown);
+        }
     }
 
   /* get the active monitor size */
-  terminal_window_dropdown_get_monitor_geometry (dropdown->screen, dropdown->monitor_num, &monitor_geo);
+  terminal_window_dropdown_get_monitor_geometry (dropdown, dropdown->screen, dropdown->monitor_num, &monitor_geo);
 
   /* move window to correct screen */
   gtk_window_set_screen (GTK_WINDOW (dropdown), dropdown->screen);
@@ -819,10 +942,6 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 G_GNUC_END_IGNORE_DEPRECATIONS
   if (fullscreen)
     {
-      /* don't fullscreen during animation*/
-      if (dropdown->animation_time > 0)
-        gtk_window_unfullscreen (GTK_WINDOW (window));
-
       /* use monitor geometry */
       w = monitor_geo.width;
       h = monitor_geo.height;
@@ -834,65 +953,68 @@ G_GNUC_END_IGNORE_DEPRECATIONS
       h = monitor_geo.height * dropdown->rel_height;
     }
 
-  /* vbox size if not animated */
-  vbox_h = h;
-
-  /* vbox start height for animation */
-  if (dropdown->animation_time > 0)
-    {
-      if (!visible)
-        {
-          /* start animation collapsed */
-          vbox_h = 0;
-        }
-      else if (old_animation_dir == ANIMATION_DIR_UP)
-        {
-          /* pick up where we aborted */
-          gtk_widget_get_preferred_size (terminal_window_get_vbox (window), &req1, NULL);
-          vbox_h = req1.height;
-        }
-    }
-
-  /* resize */
-  gtk_widget_set_size_request (terminal_window_get_vbox (window), w, vbox_h);
-
   /* calc position */
   x = monitor_geo.x + (monitor_geo.width - w) * dropdown->rel_position;
   y = monitor_geo.y + (monitor_geo.height - h) * dropdown->rel_position_vertical;
 
-  /* move */
-  gtk_window_move (GTK_WINDOW (dropdown), x, y);
-
-  /* show window */
-  if (!visible)
-    gtk_window_present_with_time (GTK_WINDOW (dropdown), timestamp);
+  /* the hidden window is still realized, if it is where it belongs
+   * showing it is only a map; the user or the window manager may
+   * have moved or resized it since, so compare with where it is */
+  gtk_window_get_position (GTK_WINDOW (dropdown), &cur_x, &cur_y);
+  gtk_window_get_size (GTK_WINDOW (dropdown), &cur_w, &cur_h);
+  gtk_widget_get_size_request (terminal_window_get_vbox (window), &req_w, &req_h);
+  same_geometry = (cur_x == x && cur_y == y && cur_w == w && cur_h == h
+                   && req_w == w && req_h == h);
 
-  /* move window after showing: https://bugzilla.xfce.org/show_bug.cgi?id=10713 */
-  gtk_window_move (GTK_WINDOW (dropdown), x, y);
+  if (!same_geometry)
+    {
+      /* the window always gets its full size, the animation only clips it */
+      gtk_widget_set_size_request (terminal_window_get_vbox (window), w, h);
 
-  /* force focus to the window */
-  if (activate)
-    terminal_util_activate_window (GTK_WINDOW (dropdown));
+      /* move */
+      gtk_window_move (GTK_WINDOW (dropdown), x, y);
+    }
 
+  /* start the animation collapsed, or pick up where it was aborted */
   if (dropdown->animation_time > 0
-      && vbox_h < h)
+      && (!visible || dropdown->animation_dir == ANIMATION_DIR_UP))
     {
-      dropdown->animation_dir = ANIMATION_DIR_DOWN;
-      dropdown->animation_timeout_id =
-          gdk_threads_add_timeout_full (G_PRIORITY_DEFAULT_IDLE, ANIMATION_FPS,
-                                        terminal_window_dropdown_animate_down, dropdown,
-                                        terminal_window_dropdown_animate_destroyed);
+      if (!visible)
+        dropdown->animation_fraction = 0.0;
+      terminal_window_dropdown_animate_start (dropdown, ANIMATION_DIR_DOWN);
     }
-  else
+  else if (dropdown->animation_dir == ANIMATION_DIR_NONE)
     {
       g_object_get (terminal_window_get_preferences (window),
                     "dropdown-keep-above", &keep_above,
                     NULL);
       gtk_window_set_keep_above (GTK_WINDOW (dropdown), keep_above);
+    }
 
-      /* make sure all the content fits */
-      gtk_window_resize (GTK_WINDOW (dropdown), w, h);
+  /* show window */
+  if (!visible)
+    {
+#ifdef G_ENABLE_DEBUG
+      /* measure the time until the first frame is painted */
+      if (dropdown->toggle_time != 0 && dropdown->after_paint_id == 0)
+        dropdown->after_paint_id =
+            g_signal_connect (G_OBJECT (gtk_widget_get_frame_clock (GTK_WIDGET (dropdown))), "after-paint",
+                              G_CALLBACK (terminal_window_dropdown_after_paint), dropdown);
+#endif
+
+      gtk_window_present_with_time (GTK_WINDOW (dropdown), timestamp);
     }
+
+  /* move window after showing: https://bugzilla.xfce.org/show_bug.cgi?id=10713 */
+  gtk_window_move (GTK_WINDOW (dropdown), x, y);
+
+  /* force focus to the window */
+  if (activate)
+    terminal_util_activate_window (GTK_WINDOW (dropdown));
+
+  /* make sure all the content fits */
+  if (!same_geometry)
+    gtk_window_resize (GTK_WINDOW (dropdown), w, h);
 }
 
 
@@ -968,6 +1090,9 @@ static void
 terminal_dropdown_window_screen_size_changed (GdkScreen              *screen,
                                               TerminalWindowDropdown *dropdown)
 {
+  /* forget the cached geometries */
+  g_array_set_size (dropdown->monitor_geometries, 0);
+
   /* resize/move terminal window due to a screen size change */
   if (gtk_widget_get_visible (GTK_WIDGET (dropdown)))
     terminal_window_dropdown_show (dropdown, 0, FALSE);
@@ -975,6 +1100,22 @@ terminal_dropdown_window_screen_size_changed (GdkScreen              *screen,
 
 
 
+#ifdef G_ENABLE_DEBUG
+static void
+terminal_window_dropdown_after_paint (GdkFrameClock          *frame_clock,
+                                      TerminalWindowDropdown *dropdown)
+{
+  g_signal_handler_disconnect (G_OBJECT (frame_clock), dropdown->after_paint_id);
+  dropdown->after_paint_id = 0;
+
+  g_debug ("drop-down toggle latency: %.1f ms to the first frame",
+           (g_get_monotonic_time () - dropdown->toggle_time) / 1000.0);
+  dropdown->toggle_time = 0;
+}
+#endif
+
+
+
 GtkWidget *
 terminal_window_dropdown_new (const gchar        *role,
                               const gchar        *icon,
@@ -1034,6 +1175,9 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
       G_CALLBACK (terminal_window_dropdown_update_geometry), window);
 G_GNUC_END_IGNORE_DEPRECATIONS
 
+  /* create the window now, so the first toggle only has to map it */
+  gtk_widget_realize (GTK_WIDGET (window));
+
   return GTK_WIDGET (window);
 }
 
@@ -1046,6 +1190,13 @@ terminal_window_dropdown_toggle (TerminalWindowDropdown *dropdown,
 {
   guint32 timestamp;
 
+#ifdef G_ENABLE_DEBUG
+  /* start of the toggle latency, the d-bus request if there is one */
+  dropdown->toggle_time = terminal_gdbus_get_request_time ();
+  if (dropdown->toggle_time == 0)
+    dropdown->toggle_time = g_get_monotonic_time ();
+#endif
+
   /* toggle window */
   timestamp = terminal_window_dropdown_get_timestamp (startup_id);
   terminal_window_dropdown_toggle_real (dropdown, timestamp, force_show);
@@ -1072,7 +1223,7 @@ terminal_window_dropdown_get_size (TerminalWindowDropdown *dropdown,
 
   /* get the active monitor size */
   gdkscreen = xfce_gdk_screen_get_active (&monitor_num);
-  terminal_window_dropdown_get_monitor_geometry (gdkscreen, monitor_num, &monitor_geo);
+  terminal_window_dropdown_get_monitor_geometry (dropdown, gdkscreen, monitor_num, &monitor_geo);
 
   /* get terminal size */
   terminal_screen_get_geometry (screen, &char_width, &char_height, &xpad, &ypad);
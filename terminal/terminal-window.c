@@ -25,6 +25,9 @@
 #include <sys/types.h>
 #endif
 
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
 #ifdef HAVE_TIME_H
 #include <time.h>
 #endif
@@ -43,14 +46,21 @@
 #include <terminal/terminal-options.h>
 #include <terminal/terminal-preferences-dialog.h>
 #include <terminal/terminal-search-dialog.h>
+#include <terminal/terminal-tab-switcher.h>
 #include <terminal/terminal-private.h>
 #include <terminal/terminal-marshal.h>
+#include <terminal/terminal-scrollback.h>
 #include <terminal/terminal-encoding-action.h>
 #include <terminal/terminal-window.h>
 #include <terminal/terminal-window-dropdown.h>
 #include <terminal/terminal-window-ui.h>
 #include <terminal/terminal-widget.h>
 
+/* limits of the undo-close-tab queue and its scrollback snapshots */
+#define CLOSED_TABS_MAX             (50)
+#define CLOSED_TABS_SNAPSHOT_BUDGET (16 * 1024 * 1024)
+#define CLOSED_TABS_SNAPSHOT_AGE    (G_USEC_PER_SEC * 60 * 30)
+
 
 
 /* Signal identifiers */
@@ -69,6 +79,36 @@ enum
   CONFIRMED_CLOSE_WINDOW
 };
 
+/* An entry of the "Go" menu, for the tab at its position */
+typedef struct
+{
+  GtkRadioAction *action;
+  GtkWidget      *page;
+  GBinding       *binding;
+  guint           merge_id;
+  guint           tab_merge_id;
+} TabsMenuItem;
+
+/* An element of terminal-window-ui.xml, parsed once for all windows */
+typedef struct
+{
+  /* the part of the ui it is merged with, 0 for the part merged by
+   * every window, the others when the menu or toolbar is first used */
+  guint                 block;
+  const gchar          *path;
+  const gchar          *name;
+  const gchar          *action;
+  GtkUIManagerItemType  type;
+} WindowUiItem;
+
+/* An element of terminal-window-ui.xml while it is parsed */
+typedef struct
+{
+  const gchar          *path;
+  guint                 block;
+  GtkUIManagerItemType  type;
+} WindowUiParent;
+
 /* CSS for slim notebook tabs style */
 #define NOTEBOOK_NAME PACKAGE_NAME "-notebook"
 const gchar *CSS_SLIM_TABS =
@@ -110,6 +150,25 @@ const gchar *CSS_SLIM_TABS =
 
 
 static void         terminal_window_finalize                      (GObject             *object);
+static void         terminal_window_ui_start_element              (GMarkupParseContext *context,
+                                                                   const gchar         *element_name,
+                                                                   const gchar        **attribute_names,
+                                                                   const gchar        **attribute_values,
+                                                                   gpointer             user_data,
+                                                                   GError             **error);
+static void         terminal_window_ui_end_element                (GMarkupParseContext *context,
+                                                                   const gchar         *element_name,
+                                                                   gpointer             user_data,
+                                                                   GError             **error);
+static void         terminal_window_ui_parse                      (void);
+static gchar       *terminal_window_ui_item_path                  (const WindowUiItem  *item);
+static guint        terminal_window_ui_block                      (const gchar         *path);
+static void         terminal_window_ui_merge                      (TerminalWindow      *window,
+                                                                   const gchar         *path);
+static gboolean     terminal_window_ui_is_merged                  (TerminalWindow      *window,
+                                                                   const gchar         *path);
+static void         terminal_window_menu_show                     (GtkWidget           *menu,
+                                                                   TerminalWindow      *window);
 static gboolean     terminal_window_delete_event                  (GtkWidget           *widget,
                                                                    GdkEventAny         *event);
 static gboolean     terminal_window_state_event                   (GtkWidget           *widget,
@@ -132,6 +191,22 @@ static void         terminal_window_set_size_force_grid           (TerminalWindo
                                                                    TerminalScreen      *screen,
                                                                    glong                force_grid_width,
                                                                    glong                force_grid_height);
+static void         terminal_window_resize_schedule               (TerminalWindow      *window);
+static gboolean     terminal_window_resize_tick                   (GtkWidget           *widget,
+                                                                   GdkFrameClock       *frame_clock,
+                                                                   gpointer             user_data);
+static void         terminal_window_resize_flush                  (TerminalWindow      *window);
+static void         terminal_window_update_tabs_menu              (TerminalWindow      *window);
+static TabsMenuItem *terminal_window_tabs_menu_item_new           (TerminalWindow      *window,
+                                                                   guint                position);
+static void         terminal_window_tabs_menu_item_remove         (TerminalWindow      *window,
+                                                                   TabsMenuItem        *item);
+static void         terminal_window_tabs_menu_item_set_accel      (TabsMenuItem        *item);
+static void         terminal_window_tabs_menu_item_free           (gpointer             data);
+static gboolean     terminal_window_tabs_menu_label               (GBinding            *binding,
+                                                                   const GValue        *from_value,
+                                                                   GValue              *to_value,
+                                                                   gpointer             user_data);
 static void         terminal_window_update_actions                (TerminalWindow      *window);
 static void         terminal_window_update_slim_tabs              (TerminalWindow      *window);
 static void         terminal_window_update_scroll_on_output       (TerminalWindow      *window);
@@ -225,6 +300,8 @@ static void         terminal_window_action_readonly               (GtkToggleActi
                                                                    TerminalWindow      *window);
 static void         terminal_window_action_scroll_on_output       (GtkToggleAction     *action,
                                                                    TerminalWindow      *window);
+static void         terminal_window_action_perf_hud               (GtkToggleAction     *action,
+                                                                   TerminalWindow      *window);
 static void         terminal_window_action_zoom_in                (GtkAction           *action,
                                                                    TerminalWindow      *window);
 static void         terminal_window_action_zoom_out               (GtkAction           *action,
@@ -243,6 +320,13 @@ static void         terminal_window_action_move_tab_right         (GtkAction
                                                                    TerminalWindow      *window);
 static void         terminal_window_action_goto_tab               (GtkRadioAction      *action,
                                                                    GtkNotebook         *notebook);
+static void         terminal_window_action_switch_tab             (GtkAction           *action,
+                                                                   TerminalWindow      *window);
+static void         terminal_window_tab_switcher_activated        (GtkWidget           *switcher,
+                                                                   gpointer             page,
+                                                                   TerminalWindow      *window);
+static void         terminal_window_tab_switcher_closed           (GtkWidget           *switcher,
+                                                                   TerminalWindow      *window);
 static void         terminal_window_action_set_title              (GtkAction           *action,
                                                                    TerminalWindow      *window);
 static void         terminal_window_action_set_title_color        (GtkAction           *action,
@@ -253,6 +337,9 @@ static void         terminal_window_action_search_next            (GtkAction
                                                                    TerminalWindow      *window);
 static void         terminal_window_action_search_prev            (GtkAction           *action,
                                                                    TerminalWindow      *window);
+static void         terminal_window_search_index_changed          (TerminalSearchIndex *index,
+                                                                   TerminalWindow      *window);
+static void         terminal_window_search_update_index           (TerminalWindow      *window);
 static void         terminal_window_action_save_contents          (GtkAction           *action,
                                                                    TerminalWindow      *window);
 static void         terminal_window_action_reset                  (GtkAction           *action,
@@ -276,12 +363,22 @@ static void         title_popover_close                           (GtkWidget
                                                                    TerminalWindow      *window);
 static void         terminal_window_do_close_tab                  (TerminalScreen      *screen,
                                                                    TerminalWindow      *window);
+static void         terminal_window_closed_tab_captured           (GObject             *object,
+                                                                   GAsyncResult        *result,
+                                                                   gpointer             user_data);
+static gboolean     terminal_window_closed_tabs_expire            (TerminalWindow      *window);
+static gboolean     terminal_window_closed_tabs_expire_timeout    (gpointer             user_data);
 
 
 
 struct _TerminalWindowPrivate
 {
+  /* stable number for the metrics on d-bus */
+  guint                id;
+
   GtkUIManager        *ui_manager;
+  guint                ui_merge_id;
+  guint                ui_merged;
 
   GtkWidget           *vbox;
   GtkWidget           *notebook;
@@ -291,8 +388,8 @@ struct _TerminalWindowPrivate
   /* for the drop-down to keep open with dialogs */
   guint                n_child_windows;
 
-  guint                tabs_menu_merge_id;
-  GSList              *tabs_menu_actions;
+  /* TabsMenuItems of the "Go" menu, by position */
+  GPtrArray           *tabs_menu;
 
   TerminalPreferences *preferences;
   GtkWidget           *preferences_dialog;
@@ -300,12 +397,30 @@ struct _TerminalWindowPrivate
   GtkActionGroup      *action_group;
 
   GtkWidget           *search_dialog;
+  TerminalSearchIndex *search_index;
   GtkWidget           *title_popover;
 
+  /* titles, directories and commands of the tabs */
+  TerminalTabIndex    *tab_index;
+  GtkWidget           *tab_switcher;
+
   /* pushed size of screen */
   glong                grid_width;
   glong                grid_height;
 
+  /* geometry requests applied on the next frame */
+  guint                resize_tick_id;
+  GHashTable          *resize_screens;
+  TerminalScreen      *resize_screen;
+  glong                resize_columns;
+  glong                resize_rows;
+
+  /* geometry requests, the ones merged into a pending
+   * frame and the number of frames they resulted in */
+  guint                resize_n_requests;
+  guint                resize_n_merged;
+  guint                resize_n_frames;
+
   GtkAction           *encoding_action;
 
   TerminalScreen      *active;
@@ -326,6 +441,7 @@ struct _TerminalWindowPrivate
   GtkAction           *action_fullscreen;
 
   GQueue              *closed_tabs_list;
+  guint                closed_tabs_expire_id;
 
   gchar               *font;
 
@@ -341,6 +457,14 @@ struct _TerminalWindowPrivate
 static guint   window_signals[LAST_SIGNAL];
 static gchar  *window_notebook_group = PACKAGE_NAME;
 static GQuark  tabs_menu_action_quark = 0;
+static guint   window_last_id = 0;
+
+/* the parsed ui description and the translated actions, shared by all windows */
+static GArray               *window_ui_items = NULL;
+static GPtrArray            *window_ui_blocks = NULL;
+static GQuark                window_ui_block_quark = 0;
+static GtkActionEntry       *window_action_entries = NULL;
+static GtkToggleActionEntry *window_toggle_action_entries = NULL;
 
 
 
@@ -381,6 +505,7 @@ static const GtkActionEntry action_entries[] =
     { "prev-tab", "go-previous", N_ ("_Previous Tab"), "<control>Page_Up", N_ ("Switch to previous tab"), G_CALLBACK (terminal_window_action_prev_tab), },
     { "next-tab", "go-next", N_ ("_Next Tab"), "<control>Page_Down", N_ ("Switch to next tab"), G_CALLBACK (terminal_window_action_next_tab), },
     { "last-active-tab", NULL, N_ ("Last _Active Tab"), NULL, N_ ("Switch to last active tab"), G_CALLBACK (terminal_window_action_last_active_tab), },
+    { "switch-tab", NULL, N_ ("S_witch to Tab..."), "<control><shift>g", N_ ("Find a tab by its title, directory or command"), G_CALLBACK (terminal_window_action_switch_tab), },
     { "move-tab-left", NULL, N_ ("Move Tab _Left"), "<control><shift>Page_Up", NULL, G_CALLBACK (terminal_window_action_move_tab_left), },
     { "move-tab-right", NULL, N_ ("Move Tab _Right"), "<control><shift>Page_Down", NULL, G_CALLBACK (terminal_window_action_move_tab_right), },
   { "help-menu", NULL, N_ ("_Help"), NULL, NULL, NULL, },
@@ -397,6 +522,7 @@ static const GtkToggleActionEntry toggle_action_entries[] =
   { "fullscreen", "view-fullscreen", N_ ("_Fullscreen"), "F11", N_ ("Toggle fullscreen mode"), G_CALLBACK (terminal_window_action_fullscreen), FALSE, },
   { "read-only", NULL, N_ ("_Read-Only"), NULL, N_ ("Toggle read-only mode"), G_CALLBACK (terminal_window_action_readonly), FALSE, },
   { "scroll-on-output", NULL, N_ ("Scroll on _Output"), NULL, N_ ("Toggle scroll on output"), G_CALLBACK (terminal_window_action_scroll_on_output), FALSE, },
+  { "perf-hud", NULL, N_ ("_Performance Overlay"), NULL, N_ ("Show live performance numbers of the terminal"), G_CALLBACK (terminal_window_action_perf_hud), FALSE, },
 };
 
 
@@ -410,6 +536,7 @@ terminal_window_class_init (TerminalWindowClass *klass)
 {
   GtkWidgetClass *gtkwidget_class;
   GObjectClass   *gobject_class;
+  guint           n;
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->finalize = terminal_window_finalize;
@@ -448,8 +575,31 @@ terminal_window_class_init (TerminalWindowClass *klass)
                   G_TYPE_OBJECT,
                   G_TYPE_INT, G_TYPE_INT);
 
-  /* initialize quark */
+  /* initialize quarks */
   tabs_menu_action_quark = g_quark_from_static_string ("tabs-menu-item");
+  window_ui_block_quark = g_quark_from_static_string ("terminal-window-ui-block");
+
+  /* translate the actions once, the action groups take them as they are */
+  window_action_entries = g_new (GtkActionEntry, G_N_ELEMENTS (action_entries));
+  for (n = 0; n < G_N_ELEMENTS (action_entries); n++)
+    {
+      window_action_entries[n] = action_entries[n];
+      window_action_entries[n].label = g_dgettext (GETTEXT_PACKAGE, action_entries[n].label);
+      if (action_entries[n].tooltip != NULL)
+        window_action_entries[n].tooltip = g_dgettext (GETTEXT_PACKAGE, action_entries[n].tooltip);
+    }
+
+  window_toggle_action_entries = g_new (GtkToggleActionEntry, G_N_ELEMENTS (toggle_action_entries));
+  for (n = 0; n < G_N_ELEMENTS (toggle_action_entries); n++)
+    {
+      window_toggle_action_entries[n] = toggle_action_entries[n];
+      window_toggle_action_entries[n].label = g_dgettext (GETTEXT_PACKAGE, toggle_action_entries[n].label);
+      if (toggle_action_entries[n].tooltip != NULL)
+        window_toggle_action_entries[n].tooltip = g_dgettext (GETTEXT_PACKAGE, toggle_action_entries[n].tooltip);
+    }
+
+  /* the menus and the toolbar are parsed once, windows merge the items */
+  terminal_window_ui_parse ();
 }
 
 
@@ -462,6 +612,11 @@ terminal_window_init (TerminalWindow *window)
   GdkScreen       *screen;
   GdkVisual       *visual;
   GtkStyleContext *context;
+  GList           *actions, *lp;
+  WindowUiItem    *item;
+  GtkWidget       *menu;
+  gchar           *path;
+  guint            n;
 
   GClosure *toggle_menubar_closure = g_cclosure_new (G_CALLBACK (terminal_window_toggle_menubar), window, NULL);
 
@@ -469,9 +624,13 @@ terminal_window_init (TerminalWindow *window)
 
   window->priv->preferences = terminal_preferences_get ();
 
+  window->priv->id = ++window_last_id;
   window->priv->font = NULL;
   window->priv->zoom = TERMINAL_ZOOM_LEVEL_DEFAULT;
   window->priv->closed_tabs_list = g_queue_new ();
+  window->priv->resize_screens = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+  window->priv->tabs_menu = g_ptr_array_new_with_free_func (terminal_window_tabs_menu_item_free);
+  window->priv->tab_index = terminal_tab_index_new ();
 
   /* try to set the rgba colormap so vte can use real transparency */
   screen = gtk_window_get_screen (GTK_WINDOW (window));
@@ -484,39 +643,44 @@ terminal_window_init (TerminalWindow *window)
 
 G_GNUC_BEGIN_IGNORE_DEPRECATIONS
   window->priv->action_group = gtk_action_group_new ("terminal-window");
-  gtk_action_group_set_translation_domain (window->priv->action_group,
-                                           GETTEXT_PACKAGE);
   gtk_action_group_add_actions (window->priv->action_group,
-                                action_entries,
+                                window_action_entries,
                                 G_N_ELEMENTS (action_entries),
                                 GTK_WIDGET (window));
   gtk_action_group_add_toggle_actions (window->priv->action_group,
-                                       toggle_action_entries,
+                                       window_toggle_action_entries,
                                        G_N_ELEMENTS (toggle_action_entries),
                                        GTK_WIDGET (window));
 
   window->priv->ui_manager = gtk_ui_manager_new ();
   gtk_ui_manager_insert_action_group (window->priv->ui_manager, window->priv->action_group, 0);
-#if VTE_CHECK_VERSION (0, 49, 2)
-  {
-    /* add "Copy as HTML" to Edit and context menus */
-    const gchar *p1 = strstr (terminal_window_ui, "<menuitem action=\"paste\"/>"); // Edit menu
-    const gchar *p2 = strstr (p1 + 1, "<menuitem action=\"paste\"/>"); // context menu
-    const guint length_new = terminal_window_ui_length + 2 * strlen ("<menuitem action=\"copy-html\"/>");
-    gchar *ui_new = g_new0 (gchar, length_new + 1);
-    memcpy (ui_new, terminal_window_ui, p1 - terminal_window_ui);
-    strcat (ui_new, "<menuitem action=\"copy-html\"/>");
-    memcpy (ui_new + strlen (ui_new), p1, p2 - p1);
-    strcat (ui_new, "<menuitem action=\"copy-html\"/>");
-    strcat (ui_new, p2);
-    gtk_ui_manager_add_ui_from_string (window->priv->ui_manager, ui_new, length_new, NULL);
-    g_free (ui_new);
-  }
-#else
-  gtk_ui_manager_add_ui_from_string (window->priv->ui_manager, terminal_window_ui, terminal_window_ui_length, NULL);
-#endif
-
   accel_group = gtk_ui_manager_get_accel_group (window->priv->ui_manager);
+
+  /* the accelerators work before the menus are built */
+  actions = gtk_action_group_list_actions (window->priv->action_group);
+  for (lp = actions; lp != NULL; lp = lp->next)
+    {
+      gtk_action_set_accel_group (GTK_ACTION (lp->data), accel_group);
+      gtk_action_connect_accelerator (GTK_ACTION (lp->data));
+    }
+  g_list_free (actions);
+
+  /* only the menubar and its menus, the items are merged when opened */
+  window->priv->ui_merge_id = gtk_ui_manager_new_merge_id (window->priv->ui_manager);
+  for (n = 0; n < window_ui_items->len; n++)
+    {
+      item = &g_array_index (window_ui_items, WindowUiItem, n);
+      if (item->block != 0)
+        continue;
+
+      /* the ui manager hides an empty menu, it would never be opened */
+      if (item->type == GTK_UI_MANAGER_MENU)
+        g_object_set (G_OBJECT (gtk_action_group_get_action (window->priv->action_group, item->action)),
+                      "hide-if-empty", FALSE, NULL);
+
+      gtk_ui_manager_add_ui (window->priv->ui_manager, window->priv->ui_merge_id,
+                             item->path, item->name, item->action, item->type, FALSE);
+    }
 G_GNUC_END_IGNORE_DEPRECATIONS
   gtk_window_add_accel_group (GTK_WINDOW (window), accel_group);
 
@@ -576,6 +740,20 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 
 G_GNUC_BEGIN_IGNORE_DEPRECATIONS
   window->priv->menubar = gtk_ui_manager_get_widget (window->priv->ui_manager, "/main-menu");
+
+  for (n = 0; n < window_ui_items->len; n++)
+    {
+      item = &g_array_index (window_ui_items, WindowUiItem, n);
+      if (item->block == 0 && item->type == GTK_UI_MANAGER_MENU)
+        {
+          path = terminal_window_ui_item_path (item);
+          menu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (gtk_ui_manager_get_widget (window->priv->ui_manager, path)));
+          g_object_set_qdata (G_OBJECT (menu), window_ui_block_quark, (gpointer) g_intern_string (path));
+          g_signal_connect (G_OBJECT (menu), "show",
+              G_CALLBACK (terminal_window_menu_show), window);
+          g_free (path);
+        }
+    }
 G_GNUC_END_IGNORE_DEPRECATIONS
   gtk_box_pack_start (GTK_BOX (window->priv->vbox), window->priv->menubar, FALSE, FALSE, 0);
   gtk_box_reorder_child (GTK_BOX (window->priv->vbox), window->priv->menubar, 0);
@@ -642,8 +820,22 @@ terminal_window_finalize (GObject *object)
   g_object_unref (G_OBJECT (window->priv->ui_manager));
   g_object_unref (G_OBJECT (window->priv->encoding_action));
 
-  g_slist_free (window->priv->tabs_menu_actions);
+  if (window->priv->search_index != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (window->priv->search_index),
+                                            G_CALLBACK (terminal_window_search_index_changed), window);
+      g_object_unref (G_OBJECT (window->priv->search_index));
+    }
+
+  if (window->priv->resize_tick_id != 0)
+    gtk_widget_remove_tick_callback (GTK_WIDGET (window), window->priv->resize_tick_id);
+  g_hash_table_destroy (window->priv->resize_screens);
+
+  g_ptr_array_free (window->priv->tabs_menu, TRUE);
+  terminal_tab_index_free (window->priv->tab_index);
   g_free (window->priv->font);
+  if (window->priv->closed_tabs_expire_id != 0)
+    g_source_remove (window->priv->closed_tabs_expire_id);
   g_queue_free_full (window->priv->closed_tabs_list, (GDestroyNotify) terminal_tab_attr_free);
 
   (*G_OBJECT_CLASS (terminal_window_parent_class)->finalize) (object);
@@ -651,6 +843,241 @@ terminal_window_finalize (GObject *object)
 
 
 
+static void
+terminal_window_ui_start_element (GMarkupParseContext  *context,
+                                  const gchar          *element_name,
+                                  const gchar         **attribute_names,
+                                  const gchar         **attribute_values,
+                                  gpointer              user_data,
+                                  GError              **error)
+{
+  GArray         *parents = user_data;
+  WindowUiParent *parent;
+  WindowUiParent  child;
+  WindowUiItem    item;
+  const gchar    *name = NULL, *action = NULL;
+  gchar          *path;
+  guint           n;
+  static const struct
+  {
+    const gchar          *element;
+    GtkUIManagerItemType  type;
+  } types[] =
+  {
+    { "menubar", GTK_UI_MANAGER_MENUBAR },
+    { "menu", GTK_UI_MANAGER_MENU },
+    { "menuitem", GTK_UI_MANAGER_MENUITEM },
+    { "popup", GTK_UI_MANAGER_POPUP },
+    { "toolbar", GTK_UI_MANAGER_TOOLBAR },
+    { "toolitem", GTK_UI_MANAGER_TOOLITEM },
+    { "separator", GTK_UI_MANAGER_SEPARATOR },
+    { "placeholder", GTK_UI_MANAGER_PLACEHOLDER },
+    { "accelerator", GTK_UI_MANAGER_ACCELERATOR },
+  };
+
+  if (parents->len == 0 && strcmp (element_name, "ui") == 0)
+    {
+      child.path = "/";
+      child.block = 0;
+      child.type = GTK_UI_MANAGER_AUTO;
+      g_array_append_val (parents, child);
+      return;
+    }
+
+  for (n = 0; n < G_N_ELEMENTS (types); n++)
+    if (strcmp (element_name, types[n].element) == 0)
+      break;
+
+  if (parents->len == 0 || n == G_N_ELEMENTS (types))
+    {
+      g_set_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_UNKNOWN_ELEMENT,
+                   "Unexpected element <%s>", element_name);
+      return;
+    }
+
+  for (; *attribute_names != NULL; attribute_names++, attribute_values++)
+    {
+      if (strcmp (*attribute_names, "name") == 0)
+        name = *attribute_values;
+      else if (strcmp (*attribute_names, "action") == 0)
+        action = *attribute_values;
+    }
+
+  parent = &g_array_index (parents, WindowUiParent, parents->len - 1);
+
+  item.block = parent->block;
+  item.path = parent->path;
+  item.name = g_intern_string (name != NULL ? name : action);
+  item.action = g_intern_string (action);
+  item.type = types[n].type;
+
+#if VTE_CHECK_VERSION (0, 49, 2)
+  /* add "Copy as HTML" to Edit and context menus */
+  if (item.type == GTK_UI_MANAGER_MENUITEM && g_strcmp0 (action, "paste") == 0
+      && (strcmp (item.path, "/main-menu/edit-menu") == 0 || strcmp (item.path, "/popup-menu") == 0))
+    {
+      WindowUiItem copy_html = item;
+      copy_html.name = copy_html.action = g_intern_static_string ("copy-html");
+      g_array_append_val (window_ui_items, copy_html);
+    }
+#endif
+
+  child.type = item.type;
+  child.block = item.block;
+  child.path = parent->path;
+  if (item.name != NULL)
+    {
+      path = terminal_window_ui_item_path (&item);
+      child.path = g_intern_string (path);
+      g_free (path);
+    }
+
+  if (item.type == GTK_UI_MANAGER_POPUP || item.type == GTK_UI_MANAGER_TOOLBAR)
+    {
+      /* built when it is first used */
+      g_ptr_array_add (window_ui_blocks, (gpointer) child.path);
+      item.block = child.block = window_ui_blocks->len - 1;
+    }
+  else if (item.type == GTK_UI_MANAGER_MENU && parent->type == GTK_UI_MANAGER_MENUBAR)
+    {
+      /* the menu is in the menubar, its items are merged when it opens */
+      g_ptr_array_add (window_ui_blocks, (gpointer) child.path);
+      child.block = window_ui_blocks->len - 1;
+    }
+
+  g_array_append_val (window_ui_items, item);
+  g_array_append_val (parents, child);
+}
+
+
+
+static void
+terminal_window_ui_end_element (GMarkupParseContext  *context,
+                                const gchar          *element_name,
+                                gpointer              user_data,
+                                GError              **error)
+{
+  GArray *parents = user_data;
+
+  g_array_set_size (parents, parents->len - 1);
+}
+
+
+
+static void
+terminal_window_ui_parse (void)
+{
+  GMarkupParseContext *context;
+  GArray              *parents;
+  GError              *error = NULL;
+  const GMarkupParser  parser =
+  {
+    terminal_window_ui_start_element,
+    terminal_window_ui_end_element,
+    NULL, NULL, NULL
+  };
+
+  window_ui_items = g_array_new (FALSE, FALSE, sizeof (WindowUiItem));
+  window_ui_blocks = g_ptr_array_new ();
+
+  /* the part every window builds */
+  g_ptr_array_add (window_ui_blocks, NULL);
+
+  parents = g_array_new (FALSE, FALSE, sizeof (WindowUiParent));
+  context = g_markup_parse_context_new (&parser, 0, parents, NULL);
+  if (!g_markup_parse_context_parse (context, terminal_window_ui, terminal_window_ui_length, &error)
+      || !g_markup_parse_context_end_parse (context, &error))
+    {
+      g_critical ("Error loading UI: %s", error->message);
+      g_error_free (error);
+    }
+  g_markup_parse_context_free (context);
+  g_array_free (parents, TRUE);
+
+  /* the merged blocks of a window are bits of an integer */
+  terminal_assert (window_ui_blocks->len <= sizeof (guint) * 8);
+}
+
+
+
+static gchar *
+terminal_window_ui_item_path (const WindowUiItem *item)
+{
+  return g_strconcat (item->path, item->path[1] != '\0' ? "/" : "", item->name, NULL);
+}
+
+
+
+static guint
+terminal_window_ui_block (const gchar *path)
+{
+  guint block;
+
+  for (block = 1; block < window_ui_blocks->len; block++)
+    if (strcmp (g_ptr_array_index (window_ui_blocks, block), path) == 0)
+      return block;
+
+  return 0;
+}
+
+
+
+static void
+terminal_window_ui_merge (TerminalWindow *window,
+                          const gchar    *path)
+{
+  WindowUiItem *item;
+  guint         block, n;
+
+  block = terminal_window_ui_block (path);
+  terminal_return_if_fail (block != 0);
+
+  if ((window->priv->ui_merged & (1u << block)) != 0)
+    return;
+  window->priv->ui_merged |= 1u << block;
+
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  for (n = 0; n < window_ui_items->len; n++)
+    {
+      item = &g_array_index (window_ui_items, WindowUiItem, n);
+      if (item->block == block)
+        gtk_ui_manager_add_ui (window->priv->ui_manager, window->priv->ui_merge_id,
+                               item->path, item->name, item->action, item->type, FALSE);
+    }
+G_GNUC_END_IGNORE_DEPRECATIONS
+
+  /* the menus with the tabs got their placeholder */
+  terminal_window_update_tabs_menu (window);
+
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  gtk_ui_manager_ensure_update (window->priv->ui_manager);
+G_GNUC_END_IGNORE_DEPRECATIONS
+}
+
+
+
+static gboolean
+terminal_window_ui_is_merged (TerminalWindow *window,
+                              const gchar    *path)
+{
+  return (window->priv->ui_merged & (1u << terminal_window_ui_block (path))) != 0;
+}
+
+
+
+static void
+terminal_window_menu_show (GtkWidget      *menu,
+                           TerminalWindow *window)
+{
+  g_signal_handlers_disconnect_by_func (G_OBJECT (menu),
+      G_CALLBACK (terminal_window_menu_show), window);
+
+  /* build the items before the menu is sized */
+  terminal_window_ui_merge (window, g_object_get_qdata (G_OBJECT (menu), window_ui_block_quark));
+}
+
+
+
 static gboolean
 terminal_window_delete_event (GtkWidget   *widget,
                               GdkEventAny *event)
@@ -1008,9 +1435,18 @@ terminal_window_size_push (TerminalWindow *window)
 
   if (window->priv->active != NULL)
     {
-      terminal_screen_get_size (window->priv->active,
-                                &window->priv->grid_width,
-                                &window->priv->grid_height);
+      if (window->priv->resize_screen == window->priv->active)
+        {
+          /* the screen did not get its pending size yet */
+          window->priv->grid_width = window->priv->resize_columns;
+          window->priv->grid_height = window->priv->resize_rows;
+        }
+      else
+        {
+          terminal_screen_get_size (window->priv->active,
+                                    &window->priv->grid_width,
+                                    &window->priv->grid_height);
+        }
     }
 }
 
@@ -1051,10 +1487,103 @@ terminal_window_set_size_force_grid (TerminalWindow *window,
       && gdk_window != NULL
       && (gdk_window_get_state (gdk_window) & (GDK_WINDOW_STATE_FULLSCREEN | WINDOW_STATE_TILED)) == 0
       && !window->priv->drop_down )
+    {
+      terminal_window_queue_resize (window, screen, force_grid_width, force_grid_height);
+    }
+}
+
+
+
+static void
+terminal_window_resize_schedule (TerminalWindow *window)
+{
+  window->priv->resize_n_requests++;
+
+  if (!gtk_widget_get_mapped (GTK_WIDGET (window)))
+    {
+      /* an unmapped window draws no frames, it only updates its
+       * default size, so there is nothing to merge */
+      if (window->priv->resize_tick_id != 0)
+        {
+          gtk_widget_remove_tick_callback (GTK_WIDGET (window), window->priv->resize_tick_id);
+          window->priv->resize_tick_id = 0;
+        }
+
+      terminal_window_resize_flush (window);
+    }
+  else if (window->priv->resize_tick_id != 0)
+    {
+      window->priv->resize_n_merged++;
+    }
+  else
+    {
+      window->priv->resize_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (window),
+                                                                   terminal_window_resize_tick,
+                                                                   NULL, NULL);
+    }
+}
+
+
+
+static gboolean
+terminal_window_resize_tick (GtkWidget     *widget,
+                             GdkFrameClock *frame_clock,
+                             gpointer       user_data)
+{
+  TerminalWindow *window = TERMINAL_WINDOW (widget);
+
+  /* runs in the update phase, so the window resize is part of
+   * the layout of the same frame */
+  window->priv->resize_tick_id = 0;
+  terminal_window_resize_flush (window);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+terminal_window_resize_flush (TerminalWindow *window)
+{
+  GtkNotebook    *notebook = GTK_NOTEBOOK (window->priv->notebook);
+  GHashTableIter  iter;
+  gpointer        key, value;
+  TerminalScreen *screen;
+  glong          *grid;
+  glong           columns, rows;
+
+  g_hash_table_iter_init (&iter, window->priv->resize_screens);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      screen = key;
+      grid = value;
+
+      if (gtk_notebook_page_num (notebook, GTK_WIDGET (screen)) == -1)
+        continue;
+
+      terminal_screen_get_size (screen, &columns, &rows);
+      if (columns != grid[0] || rows != grid[1])
+        terminal_screen_set_size (screen, grid[0], grid[1]);
+    }
+  g_hash_table_remove_all (window->priv->resize_screens);
+
+  screen = window->priv->resize_screen;
+  window->priv->resize_screen = NULL;
+  if (screen != NULL
+      && gtk_notebook_page_num (notebook, GTK_WIDGET (screen)) != -1)
     {
       terminal_screen_force_resize_window (screen, GTK_WINDOW (window),
-                                           force_grid_width, force_grid_height);
+                                           window->priv->resize_columns,
+                                           window->priv->resize_rows);
     }
+
+  window->priv->resize_n_frames++;
+
+#ifdef G_ENABLE_DEBUG
+  g_debug ("%u geometry requests resulted in %u resizes, %u merged",
+           window->priv->resize_n_requests, window->priv->resize_n_frames,
+           window->priv->resize_n_merged);
+#endif
 }
 
 
@@ -1128,6 +1657,11 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
       gtk_toggle_action_set_active (GTK_TOGGLE_ACTION (action),
                                     terminal_screen_get_scroll_on_output (window->priv->active));
 
+      /* update the performance overlay */
+      action = terminal_window_get_action (window, "perf-hud");
+      gtk_toggle_action_set_active (GTK_TOGGLE_ACTION (action),
+                                    terminal_screen_get_perf_hud (window->priv->active));
+
       /* update the "Go" menu */
       action = g_object_get_qdata (G_OBJECT (window->priv->active), tabs_menu_action_quark);
       if (G_LIKELY (action != NULL))
@@ -1138,6 +1672,225 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 
 
 
+static void
+terminal_window_update_tabs_menu (TerminalWindow *window)
+{
+  GtkNotebook  *notebook = GTK_NOTEBOOK (window->priv->notebook);
+  GtkAction    *action;
+  GtkWidget    *page;
+  TabsMenuItem *item;
+  gboolean      multiple;
+  guint         npages, n;
+
+  npages = gtk_notebook_get_n_pages (notebook);
+  multiple = npages > 1;
+
+  /* the entries belong to positions, so only the ones at the
+   * end are added or removed when the number of tabs changes */
+  while (window->priv->tabs_menu->len > npages)
+    {
+      item = g_ptr_array_index (window->priv->tabs_menu, window->priv->tabs_menu->len - 1);
+      terminal_window_tabs_menu_item_remove (window, item);
+      g_ptr_array_remove_index (window->priv->tabs_menu, window->priv->tabs_menu->len - 1);
+    }
+
+  while (window->priv->tabs_menu->len < npages)
+    {
+      item = terminal_window_tabs_menu_item_new (window, window->priv->tabs_menu->len);
+      g_ptr_array_add (window->priv->tabs_menu, item);
+    }
+
+  for (n = 0; n < npages; n++)
+    {
+      page = gtk_notebook_get_nth_page (notebook, n);
+      item = g_ptr_array_index (window->priv->tabs_menu, n);
+
+      /* follow the page that moved into this position */
+      if (item->page != page)
+        {
+          if (item->binding != NULL)
+            g_binding_unbind (item->binding);
+          item->binding = g_object_bind_property_full (G_OBJECT (page), "title",
+                                                       G_OBJECT (item->action), "label",
+                                                       G_BINDING_SYNC_CREATE,
+                                                       terminal_window_tabs_menu_label,
+                                                       NULL, NULL, NULL);
+          item->page = page;
+
+          /* connect action to the page so we can active it when a tab is switched */
+          g_object_set_qdata_full (G_OBJECT (page), tabs_menu_action_quark,
+                                   g_object_ref (G_OBJECT (item->action)), g_object_unref);
+        }
+
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+      /* a single tab has no tab to go to */
+      if (gtk_action_get_sensitive (GTK_ACTION (item->action)) != multiple)
+        gtk_action_set_sensitive (GTK_ACTION (item->action), multiple);
+
+      if (item->merge_id == 0 && terminal_window_ui_is_merged (window, "/main-menu/tabs-menu"))
+        {
+          /* add to the "Go" menu once it has been opened */
+          item->merge_id = gtk_ui_manager_new_merge_id (window->priv->ui_manager);
+          gtk_ui_manager_add_ui (window->priv->ui_manager, item->merge_id,
+                                 "/main-menu/tabs-menu/placeholder-tab-items",
+                                 gtk_action_get_name (GTK_ACTION (item->action)),
+                                 gtk_action_get_name (GTK_ACTION (item->action)),
+                                 GTK_UI_MANAGER_MENUITEM, FALSE);
+        }
+
+      if (multiple && item->tab_merge_id == 0 && terminal_window_ui_is_merged (window, "/tab-menu"))
+        {
+          /* add to right-click tab menu */
+          item->tab_merge_id = gtk_ui_manager_new_merge_id (window->priv->ui_manager);
+          gtk_ui_manager_add_ui (window->priv->ui_manager, item->tab_merge_id,
+                                 "/tab-menu/tabs-menu/placeholder-tab-items",
+                                 gtk_action_get_name (GTK_ACTION (item->action)),
+                                 gtk_action_get_name (GTK_ACTION (item->action)),
+                                 GTK_UI_MANAGER_MENUITEM, FALSE);
+        }
+      else if (!multiple && item->tab_merge_id != 0)
+        {
+          gtk_ui_manager_remove_ui (window->priv->ui_manager, item->tab_merge_id);
+          item->tab_merge_id = 0;
+        }
+G_GNUC_END_IGNORE_DEPRECATIONS
+    }
+
+  /* the active tab may have moved to another position */
+  if (G_LIKELY (window->priv->active != NULL))
+    {
+      action = g_object_get_qdata (G_OBJECT (window->priv->active), tabs_menu_action_quark);
+      if (G_LIKELY (action != NULL))
+        {
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+          gtk_toggle_action_set_active (GTK_TOGGLE_ACTION (action), TRUE);
+G_GNUC_END_IGNORE_DEPRECATIONS
+        }
+    }
+}
+
+
+
+static TabsMenuItem *
+terminal_window_tabs_menu_item_new (TerminalWindow *window,
+                                    guint           position)
+{
+  TabsMenuItem *item;
+  TabsMenuItem *first;
+  gchar         name[50];
+
+  g_snprintf (name, sizeof (name), "goto-tab-%u", position + 1);
+
+  item = g_slice_new0 (TabsMenuItem);
+
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  /* create action */
+  item->action = gtk_radio_action_new (name, NULL, NULL, NULL, position);
+  if (position > 0)
+    {
+      first = g_ptr_array_index (window->priv->tabs_menu, 0);
+      gtk_radio_action_set_group (item->action, gtk_radio_action_get_group (first->action));
+    }
+  gtk_action_group_add_action (window->priv->action_group, GTK_ACTION (item->action));
+  gtk_action_set_accel_group (GTK_ACTION (item->action),
+                              gtk_ui_manager_get_accel_group (window->priv->ui_manager));
+G_GNUC_END_IGNORE_DEPRECATIONS
+  g_signal_connect (G_OBJECT (item->action), "activate",
+      G_CALLBACK (terminal_window_action_goto_tab), window->priv->notebook);
+
+  terminal_window_tabs_menu_item_set_accel (item);
+
+  return item;
+}
+
+
+
+static void
+terminal_window_tabs_menu_item_remove (TerminalWindow *window,
+                                       TabsMenuItem   *item)
+{
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  if (item->merge_id != 0)
+    gtk_ui_manager_remove_ui (window->priv->ui_manager, item->merge_id);
+  if (item->tab_merge_id != 0)
+    gtk_ui_manager_remove_ui (window->priv->ui_manager, item->tab_merge_id);
+
+  if (gtk_action_get_accel_path (GTK_ACTION (item->action)) != NULL)
+    gtk_action_disconnect_accelerator (GTK_ACTION (item->action));
+
+  /* the menu items release the action on the next ui update */
+  gtk_radio_action_set_group (item->action, NULL);
+  gtk_action_group_remove_action (window->priv->action_group, GTK_ACTION (item->action));
+G_GNUC_END_IGNORE_DEPRECATIONS
+
+  if (item->binding != NULL)
+    g_binding_unbind (item->binding);
+  item->binding = NULL;
+}
+
+
+
+static void
+terminal_window_tabs_menu_item_set_accel (TabsMenuItem *item)
+{
+  gchar       buf[100];
+  GtkAccelKey key = {0};
+
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  /* set an accelerator path */
+  g_snprintf (buf, sizeof (buf), "<Actions>/terminal-window/%s",
+              gtk_action_get_name (GTK_ACTION (item->action)));
+  if (gtk_accel_map_lookup_entry (buf, &key) && key.accel_key != 0
+      && gtk_action_get_accel_path (GTK_ACTION (item->action)) == NULL)
+    {
+      /* the accelerator works without the menu item */
+      gtk_action_set_accel_path (GTK_ACTION (item->action), buf);
+      gtk_action_connect_accelerator (GTK_ACTION (item->action));
+    }
+G_GNUC_END_IGNORE_DEPRECATIONS
+}
+
+
+
+static void
+terminal_window_tabs_menu_item_free (gpointer data)
+{
+  TabsMenuItem *item = data;
+
+  /* a binding left at this point goes away with the action */
+  g_object_unref (G_OBJECT (item->action));
+  g_slice_free (TabsMenuItem, item);
+}
+
+
+
+static gboolean
+terminal_window_tabs_menu_label (GBinding     *binding,
+                                 const GValue *from_value,
+                                 GValue       *to_value,
+                                 gpointer      user_data)
+{
+  const gchar  *title = g_value_get_string (from_value);
+  gchar       **parts;
+
+  /* menu items use the label as mnemonic, so escape the
+   * underscores instead of looking up each menu item */
+  if (title == NULL || strchr (title, '_') == NULL)
+    {
+      g_value_set_string (to_value, title);
+    }
+  else
+    {
+      parts = g_strsplit (title, "_", -1);
+      g_value_take_string (to_value, g_strjoinv ("__", parts));
+      g_strfreev (parts);
+    }
+
+  return TRUE;
+}
+
+
+
 static void
 terminal_window_update_slim_tabs (TerminalWindow *window)
 {
@@ -1222,6 +1975,10 @@ terminal_window_notebook_page_switched (GtkNotebook     *notebook,
       /* set charset for menu */
       encoding = terminal_screen_get_encoding (window->priv->active);
       terminal_encoding_action_set_charset (window->priv->encoding_action, encoding);
+
+      /* move the search highlights to the new tab */
+      if (window->priv->search_dialog != NULL)
+        terminal_window_search_update_index (window);
     }
 
   /* update actions in the window */
@@ -1236,8 +1993,8 @@ terminal_window_notebook_page_reordered (GtkNotebook     *notebook,
                                          guint            page_num,
                                          TerminalWindow  *window)
 {
-  /* Regenerate the "Go" menu and update actions */
-  terminal_window_rebuild_tabs_menu (window);
+  /* update the "Go" menu and actions */
+  terminal_window_update_tabs_menu (window);
   terminal_window_update_actions (window);
 }
 
@@ -1260,6 +2017,7 @@ terminal_window_notebook_page_added (GtkNotebook    *notebook,
                                      TerminalWindow *window)
 {
   TerminalScreen *screen = TERMINAL_SCREEN (child);
+  gchar          *title;
   glong           w, h;
 
   terminal_return_if_fail (TERMINAL_IS_SCREEN (child));
@@ -1279,6 +2037,11 @@ terminal_window_notebook_page_added (GtkNotebook    *notebook,
   g_signal_connect (G_OBJECT (screen), "drag-data-received",
       G_CALLBACK (terminal_window_notebook_drag_data_received), window);
 
+  /* add to the tab switcher */
+  title = terminal_screen_get_title (screen);
+  terminal_tab_index_set (window->priv->tab_index, screen, TERMINAL_TAB_INDEX_TITLE, title);
+  g_free (title);
+
   /* release to the grid size applies */
   gtk_widget_realize (GTK_WIDGET (screen));
 
@@ -1302,8 +2065,8 @@ terminal_window_notebook_page_added (GtkNotebook    *notebook,
       terminal_screen_set_size (screen, w, h);
     }
 
-  /* regenerate the "Go" menu */
-  terminal_window_rebuild_tabs_menu (window);
+  /* update the "Go" menu */
+  terminal_window_update_tabs_menu (window);
 }
 
 
@@ -1324,6 +2087,14 @@ terminal_window_notebook_page_removed (GtkNotebook    *notebook,
   /* unset the go menu item */
   g_object_set_qdata (G_OBJECT (child), tabs_menu_action_quark, NULL);
 
+  /* remove from the tab switcher */
+  terminal_tab_index_remove (window->priv->tab_index, child);
+
+  /* drop pending geometry requests */
+  g_hash_table_remove (window->priv->resize_screens, child);
+  if (window->priv->resize_screen == TERMINAL_SCREEN (child))
+    window->priv->resize_screen = NULL;
+
   /* disconnect signals */
   g_signal_handlers_disconnect_by_func (G_OBJECT (child),
       terminal_window_get_context_menu, window);
@@ -1352,8 +2123,8 @@ terminal_window_notebook_page_removed (GtkNotebook    *notebook,
   /* show the tabs when needed */
   terminal_window_notebook_show_tabs (window);
 
-  /* regenerate the "Go" menu */
-  terminal_window_rebuild_tabs_menu (window);
+  /* update the "Go" menu */
+  terminal_window_update_tabs_menu (window);
 
   /* send a signal about switching to another tab */
   new_page_num = gtk_notebook_get_current_page (GTK_NOTEBOOK (window->priv->notebook));
@@ -1442,6 +2213,7 @@ terminal_window_notebook_button_press_event (GtkNotebook    *notebook,
           gtk_notebook_set_current_page (notebook, page_num);
 
           /* show the tab menu */
+          terminal_window_ui_merge (window, "/tab-menu");
 G_GNUC_BEGIN_IGNORE_DEPRECATIONS
           menu = gtk_ui_manager_get_widget (window->priv->ui_manager, "/tab-menu");
 G_GNUC_END_IGNORE_DEPRECATIONS
@@ -1651,10 +2423,13 @@ terminal_window_get_context_menu (TerminalScreen  *screen,
 {
   GtkWidget *popup = NULL;
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
   if (G_LIKELY (screen == window->priv->active))
-    popup = gtk_ui_manager_get_widget (window->priv->ui_manager, "/popup-menu");
+    {
+      terminal_window_ui_merge (window, "/popup-menu");
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+      popup = gtk_ui_manager_get_widget (window->priv->ui_manager, "/popup-menu");
 G_GNUC_END_IGNORE_DEPRECATIONS
+    }
 
   return popup;
 }
@@ -1668,6 +2443,14 @@ terminal_window_notify_title (TerminalScreen *screen,
 {
   gchar *title;
 
+  /* the directory and command are looked up when the switcher opens */
+  if (pspec != NULL)
+    {
+      title = terminal_screen_get_title (screen);
+      terminal_tab_index_set (window->priv->tab_index, screen, TERMINAL_TAB_INDEX_TITLE, title);
+      g_free (title);
+    }
+
   /* update window title */
   if (screen == window->priv->active)
     {
@@ -2026,6 +2809,7 @@ G_GNUC_END_IGNORE_DEPRECATIONS
     {
       if (window->priv->toolbar == NULL)
         {
+          terminal_window_ui_merge (window, "/main-toolbar");
 G_GNUC_BEGIN_IGNORE_DEPRECATIONS
           window->priv->toolbar = gtk_ui_manager_get_widget (window->priv->ui_manager, "/main-toolbar");
 G_GNUC_END_IGNORE_DEPRECATIONS
@@ -2120,6 +2904,23 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 
 
 
+static void
+terminal_window_action_perf_hud (GtkToggleAction *action,
+                                 TerminalWindow  *window)
+{
+  gboolean show;
+
+  terminal_return_if_fail (window->priv->active != NULL);
+
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  show = gtk_toggle_action_get_active (action);
+  if (terminal_screen_get_perf_hud (window->priv->active) != show)
+    terminal_screen_set_perf_hud (window->priv->active, show);
+G_GNUC_END_IGNORE_DEPRECATIONS
+}
+
+
+
 static void
 terminal_window_action_zoom_in (GtkAction     *action,
                                TerminalWindow *window)
@@ -2241,6 +3042,87 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 
 
 
+static void
+terminal_window_action_switch_tab (GtkAction      *action,
+                                   TerminalWindow *window)
+{
+  GtkNotebook  *notebook = GTK_NOTEBOOK (window->priv->notebook);
+  GtkWidget    *page;
+  GdkRectangle  rect;
+  gchar        *command;
+  gint          n, npages;
+
+  if (window->priv->tab_switcher != NULL)
+    return;
+
+  /* a directory or command can change without a new title, so look
+   * them up for every tab; the screens only read /proc again when the
+   * foreground process changed, the index only when the text did */
+  npages = gtk_notebook_get_n_pages (notebook);
+  for (n = 0; n < npages; n++)
+    {
+      page = gtk_notebook_get_nth_page (notebook, n);
+      command = terminal_screen_get_foreground_command (TERMINAL_SCREEN (page));
+      terminal_tab_index_set (window->priv->tab_index, page, TERMINAL_TAB_INDEX_DIRECTORY,
+                              terminal_screen_get_working_directory (TERMINAL_SCREEN (page)));
+      terminal_tab_index_set (window->priv->tab_index, page, TERMINAL_TAB_INDEX_COMMAND, command);
+      g_free (command);
+    }
+
+  window->priv->tab_switcher = terminal_tab_switcher_new (window->priv->notebook, window->priv->tab_index);
+  g_signal_connect (G_OBJECT (window->priv->tab_switcher), "tab-activated",
+                    G_CALLBACK (terminal_window_tab_switcher_activated), window);
+  g_signal_connect (G_OBJECT (window->priv->tab_switcher), "closed",
+                    G_CALLBACK (terminal_window_tab_switcher_closed), window);
+
+  /* point at the top center of the terminals */
+  rect.x = gtk_widget_get_allocated_width (window->priv->notebook) / 2;
+  rect.y = 0;
+  rect.width = rect.height = 1;
+  gtk_popover_set_pointing_to (GTK_POPOVER (window->priv->tab_switcher), &rect);
+  gtk_popover_set_position (GTK_POPOVER (window->priv->tab_switcher), GTK_POS_BOTTOM);
+
+  gtk_widget_show (window->priv->tab_switcher);
+}
+
+
+
+static void
+terminal_window_tab_switcher_activated (GtkWidget      *switcher,
+                                        gpointer        page,
+                                        TerminalWindow *window)
+{
+  gint page_num;
+
+  /* the tab may have been closed in the meantime */
+  page_num = gtk_notebook_page_num (GTK_NOTEBOOK (window->priv->notebook), page);
+  if (page_num != -1)
+    gtk_notebook_set_current_page (GTK_NOTEBOOK (window->priv->notebook), page_num);
+
+  gtk_widget_hide (switcher);
+}
+
+
+
+static void
+terminal_window_tab_switcher_closed (GtkWidget      *switcher,
+                                     TerminalWindow *window)
+{
+  terminal_return_if_fail (window->priv->tab_switcher == switcher);
+
+  /* need for hiding on focus */
+  if (window->priv->drop_down)
+    terminal_util_activate_window (GTK_WINDOW (window));
+
+  gtk_widget_destroy (window->priv->tab_switcher);
+  window->priv->tab_switcher = NULL;
+
+  if (TERMINAL_IS_SCREEN (window->priv->active))
+    terminal_screen_focus (window->priv->active);
+}
+
+
+
 static void
 title_popover_close (GtkWidget      *popover,
                      TerminalWindow *window)
@@ -2425,6 +3307,12 @@ terminal_window_action_search (GtkAction      *action,
           G_CALLBACK (terminal_window_action_search_response), window);
       g_signal_connect (G_OBJECT (window->priv->search_dialog), "delete-event",
           G_CALLBACK (gtk_widget_hide_on_delete), NULL);
+      g_signal_connect_swapped (G_OBJECT (window->priv->search_dialog), "pattern-changed",
+          G_CALLBACK (terminal_window_search_update_index), window);
+      g_signal_connect_swapped (G_OBJECT (window->priv->search_dialog), "show",
+          G_CALLBACK (terminal_window_search_update_index), window);
+      g_signal_connect_swapped (G_OBJECT (window->priv->search_dialog), "hide",
+          G_CALLBACK (terminal_window_search_update_index), window);
     }
 
   /* increase child counter */
@@ -2463,12 +3351,96 @@ prepare_regex (TerminalWindow *window)
 
 
 
+static void
+terminal_window_search_index_changed (TerminalSearchIndex *index,
+                                      TerminalWindow      *window)
+{
+  TerminalSearchDialog *dialog = TERMINAL_SEARCH_DIALOG (window->priv->search_dialog);
+
+  terminal_return_if_fail (TERMINAL_IS_SEARCH_INDEX (index));
+  terminal_return_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog));
+
+  if (terminal_search_index_is_ready (index))
+    terminal_search_dialog_set_match_count (dialog,
+                                            terminal_search_index_get_current (index),
+                                            terminal_search_index_get_n_matches (index));
+  else
+    terminal_search_dialog_set_match_count (dialog, -1, -1);
+}
+
+
+
+static void
+terminal_window_search_update_index (TerminalWindow *window)
+{
+  TerminalSearchDialog *dialog = TERMINAL_SEARCH_DIALOG (window->priv->search_dialog);
+  TerminalSearchIndex  *index = NULL;
+  gchar                *pattern;
+  gboolean              caseless = FALSE;
+
+  terminal_return_if_fail (TERMINAL_IS_SEARCH_DIALOG (dialog));
+
+  /* only index the active tab while the dialog is shown */
+  if (window->priv->active != NULL
+      && gtk_widget_get_visible (GTK_WIDGET (dialog))
+      && !gtk_widget_in_destruction (GTK_WIDGET (window)))
+    index = terminal_screen_get_search_index (window->priv->active);
+
+  if (index != window->priv->search_index)
+    {
+      if (window->priv->search_index != NULL)
+        {
+          g_signal_handlers_disconnect_by_func (G_OBJECT (window->priv->search_index),
+                                                G_CALLBACK (terminal_window_search_index_changed), window);
+          terminal_search_index_set_pattern (window->priv->search_index, NULL, FALSE, NULL);
+          g_object_unref (G_OBJECT (window->priv->search_index));
+        }
+
+      window->priv->search_index = index;
+
+      if (index != NULL)
+        {
+          g_object_ref (G_OBJECT (index));
+          g_signal_connect (G_OBJECT (index), "changed",
+                            G_CALLBACK (terminal_window_search_index_changed), window);
+        }
+    }
+
+  if (index != NULL)
+    {
+      /* an invalid pattern (while typing) only clears the matches,
+       * the error is shown when searching with the buttons */
+      pattern = terminal_search_dialog_get_pattern (dialog, &caseless);
+      terminal_search_index_set_pattern (index, pattern, caseless, NULL);
+      terminal_search_index_set_highlight (index, terminal_search_dialog_get_highlight_all (dialog));
+      g_free (pattern);
+    }
+  else
+    {
+      terminal_search_dialog_set_match_count (dialog, -1, -1);
+    }
+}
+
+
+
 static void
 terminal_window_action_search_next (GtkAction      *action,
                                     TerminalWindow *window)
 {
+  gboolean wrap_around;
+
   if (prepare_regex (window))
-    terminal_screen_search_find_next (window->priv->active);
+    {
+      /* jump in the match index if the scrollback was searched */
+      if (window->priv->search_index != NULL
+          && terminal_search_index_is_ready (window->priv->search_index))
+        {
+          wrap_around = terminal_search_dialog_get_wrap_around (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog));
+          terminal_search_index_find_next (window->priv->search_index, wrap_around);
+        }
+      else
+        terminal_screen_search_find_next (window->priv->active);
+    }
 }
 
 
@@ -2477,8 +3449,19 @@ static void
 terminal_window_action_search_prev (GtkAction      *action,
                                     TerminalWindow *window)
 {
+  gboolean wrap_around;
+
   if (prepare_regex (window))
-    terminal_screen_search_find_previous (window->priv->active);
+    {
+      if (window->priv->search_index != NULL
+          && terminal_search_index_is_ready (window->priv->search_index))
+        {
+          wrap_around = terminal_search_dialog_get_wrap_around (TERMINAL_SEARCH_DIALOG (window->priv->search_dialog));
+          terminal_search_index_find_previous (window->priv->search_index, wrap_around);
+        }
+      else
+        terminal_screen_search_find_previous (window->priv->active);
+    }
 }
 
 
@@ -2699,20 +3682,27 @@ terminal_window_do_close_tab (TerminalScreen *screen,
   GtkNotebook *notebook = GTK_NOTEBOOK (window->priv->notebook);
 
   /* store attrs of the tab being closed */
-  TerminalTabAttr *tab_attr = terminal_tab_attr_new ();
+  TerminalTabAttr *tab_attr = terminal_screen_get_tab_attr (screen, FALSE);
   tab_attr->active = (screen == window->priv->active);
   tab_attr->position = gtk_notebook_page_num (notebook, GTK_WIDGET (screen));
-  tab_attr->directory = g_strdup (terminal_screen_get_working_directory (screen));
-  if (IS_STRING (terminal_screen_get_custom_title (screen)))
-    tab_attr->title = g_strdup (terminal_screen_get_custom_title (screen));
-  if (IS_STRING (terminal_screen_get_custom_fg_color (screen)))
-    tab_attr->color_text = g_strdup (terminal_screen_get_custom_fg_color (screen));
-  if (IS_STRING (terminal_screen_get_custom_bg_color (screen)))
-    tab_attr->color_bg = g_strdup (terminal_screen_get_custom_bg_color (screen));
-  if (IS_STRING (terminal_screen_get_custom_title_color (screen)))
-    tab_attr->color_title = g_strdup (terminal_screen_get_custom_title_color (screen));
+  tab_attr->closed_time = g_get_monotonic_time ();
   g_queue_push_tail (window->priv->closed_tabs_list, tab_attr);
 
+  /* compressing a long history would block the close, the snapshot
+   * is added once the worker is done; a tab reopened before that
+   * comes back without its history */
+  tab_attr->scrollback_capture = g_cancellable_new ();
+  terminal_screen_capture_scrollback_async (screen, tab_attr->scrollback_capture,
+                                            terminal_window_closed_tab_captured, tab_attr);
+
+  /* keep the queue within its limits and drop snapshots once they get too old */
+  if (terminal_window_closed_tabs_expire (window)
+      && window->priv->closed_tabs_expire_id == 0)
+    {
+      window->priv->closed_tabs_expire_id =
+          gdk_threads_add_timeout_seconds (60, terminal_window_closed_tabs_expire_timeout, window);
+    }
+
   /* switch to the previously active tab */
   if (screen == window->priv->active && window->priv->last_active != NULL)
     {
@@ -2725,6 +3715,90 @@ terminal_window_do_close_tab (TerminalScreen *screen,
 
 
 
+static void
+terminal_window_closed_tab_captured (GObject      *object,
+                                     GAsyncResult *result,
+                                     gpointer      user_data)
+{
+  TerminalTabAttr *tab_attr = user_data;
+  GBytes          *snapshot;
+  GError          *error = NULL;
+
+  snapshot = terminal_scrollback_capture_finish (result, &error);
+  if (G_UNLIKELY (snapshot == NULL))
+    {
+      /* cancelled when the attr was freed */
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_clear_object (&tab_attr->scrollback_capture);
+      g_error_free (error);
+      return;
+    }
+
+  /* the expire timeout keeps it within the budget */
+  g_clear_object (&tab_attr->scrollback_capture);
+  tab_attr->scrollback = snapshot;
+}
+
+
+
+static gboolean
+terminal_window_closed_tabs_expire (TerminalWindow *window)
+{
+  TerminalTabAttr *tab_attr;
+  GList           *lp;
+  gint64           now = g_get_monotonic_time ();
+  gsize            size, total = 0;
+  gboolean         has_snapshots = FALSE;
+
+  while (g_queue_get_length (window->priv->closed_tabs_list) > CLOSED_TABS_MAX)
+    terminal_tab_attr_free (g_queue_pop_head (window->priv->closed_tabs_list));
+
+  /* walk from the most recently closed tab, so the snapshots that are
+   * most likely to be restored stay within the budget; a tab without
+   * its snapshot can still be reopened */
+  for (lp = window->priv->closed_tabs_list->tail; lp != NULL; lp = lp->prev)
+    {
+      tab_attr = lp->data;
+
+      /* check again once the snapshot is there */
+      if (tab_attr->scrollback_capture != NULL)
+        has_snapshots = TRUE;
+
+      if (tab_attr->scrollback == NULL)
+        continue;
+
+      size = g_bytes_get_size (tab_attr->scrollback);
+      if (total + size > CLOSED_TABS_SNAPSHOT_BUDGET
+          || now - tab_attr->closed_time > CLOSED_TABS_SNAPSHOT_AGE)
+        {
+          g_bytes_unref (tab_attr->scrollback);
+          tab_attr->scrollback = NULL;
+          continue;
+        }
+
+      total += size;
+      has_snapshots = TRUE;
+    }
+
+  return has_snapshots;
+}
+
+
+
+static gboolean
+terminal_window_closed_tabs_expire_timeout (gpointer user_data)
+{
+  TerminalWindow *window = TERMINAL_WINDOW (user_data);
+
+  if (terminal_window_closed_tabs_expire (window))
+    return TRUE;
+
+  window->priv->closed_tabs_expire_id = 0;
+  return FALSE;
+}
+
+
+
 /**
  * terminal_window_new:
  * @fullscreen: Whether to set the window to fullscreen.
@@ -2857,6 +3931,22 @@ terminal_window_get_active (TerminalWindow *window)
 
 
 
+/**
+ * terminal_window_get_id:
+ * @window : a #TerminalWindow.
+ *
+ * Return value: a number identifying @window for the lifetime
+ *               of the process, never 0.
+ **/
+guint
+terminal_window_get_id (TerminalWindow *window)
+{
+  terminal_return_val_if_fail (TERMINAL_IS_WINDOW (window), 0);
+  return window->priv->id;
+}
+
+
+
 /**
  * terminal_window_notebook_show_tabs:
  * @window  : A #TerminalWindow.
@@ -2979,6 +4069,145 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 
 
 
+/**
+ * terminal_window_get_session_attr:
+ * @window  : A #TerminalWindow.
+ *
+ * Collects the state of @window and its tabs, including the scrollback,
+ * for the session file.
+ *
+ * Return value: A new #TerminalWindowAttr, free with
+ *               terminal_window_attr_free().
+ **/
+TerminalWindowAttr *
+terminal_window_get_session_attr (TerminalWindow *window)
+{
+  TerminalWindowAttr *win_attr;
+  TerminalTabAttr    *tab_attr;
+  GtkAction          *action;
+  GdkScreen          *gscreen;
+  GList              *children, *lp;
+  glong               w, h;
+
+  terminal_return_val_if_fail (TERMINAL_IS_WINDOW (window), NULL);
+
+  win_attr = terminal_window_attr_new ();
+  g_slist_free_full (win_attr->tabs, (GDestroyNotify) terminal_tab_attr_free);
+  win_attr->tabs = NULL;
+
+  if (G_LIKELY (window->priv->active != NULL))
+    {
+      terminal_screen_get_size (window->priv->active, &w, &h);
+      win_attr->geometry = g_strdup_printf ("%ldx%ld", w, h);
+    }
+
+  gscreen = gtk_window_get_screen (GTK_WINDOW (window));
+  if (G_LIKELY (gscreen != NULL))
+    win_attr->display = g_strdup (gdk_display_get_name (gdk_screen_get_display (gscreen)));
+
+  win_attr->role = g_strdup (gtk_window_get_role (GTK_WINDOW (window)));
+  win_attr->font = g_strdup (window->priv->font);
+  win_attr->zoom = window->priv->zoom;
+  win_attr->scrollbar = window->priv->scrollbar_visibility;
+  win_attr->maximize = gtk_window_is_maximized (GTK_WINDOW (window));
+
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  win_attr->fullscreen = gtk_toggle_action_get_active (GTK_TOGGLE_ACTION (window->priv->action_fullscreen));
+
+  action = terminal_window_get_action (window, "show-menubar");
+  win_attr->menubar = gtk_toggle_action_get_active (GTK_TOGGLE_ACTION (action))
+                      ? TERMINAL_VISIBILITY_SHOW : TERMINAL_VISIBILITY_HIDE;
+
+  action = terminal_window_get_action (window, "show-borders");
+  win_attr->borders = gtk_toggle_action_get_active (GTK_TOGGLE_ACTION (action))
+                      ? TERMINAL_VISIBILITY_SHOW : TERMINAL_VISIBILITY_HIDE;
+
+  action = terminal_window_get_action (window, "show-toolbar");
+  win_attr->toolbar = gtk_toggle_action_get_active (GTK_TOGGLE_ACTION (action))
+                      ? TERMINAL_VISIBILITY_SHOW : TERMINAL_VISIBILITY_HIDE;
+G_GNUC_END_IGNORE_DEPRECATIONS
+
+  children = gtk_container_get_children (GTK_CONTAINER (window->priv->notebook));
+  for (lp = children; lp != NULL; lp = lp->next)
+    {
+      tab_attr = terminal_screen_get_tab_attr (lp->data, TRUE);
+      tab_attr->active = (window->priv->active == lp->data);
+      win_attr->tabs = g_slist_prepend (win_attr->tabs, tab_attr);
+    }
+  g_list_free (children);
+
+  win_attr->tabs = g_slist_reverse (win_attr->tabs);
+
+  return win_attr;
+}
+
+
+
+/**
+ * terminal_window_queue_resize:
+ * @window  : A #TerminalWindow.
+ * @screen  : A #TerminalScreen in @window.
+ * @columns : Number of columns, or 0 to keep the current number.
+ * @rows    : Number of rows, or 0 to keep the current number.
+ *
+ * Resizes @window to fit @columns and @rows of @screen on the next
+ * frame. All requests made before that frame result in a single
+ * resize for the last one.
+ **/
+void
+terminal_window_queue_resize (TerminalWindow *window,
+                              TerminalScreen *screen,
+                              glong           columns,
+                              glong           rows)
+{
+  terminal_return_if_fail (TERMINAL_IS_WINDOW (window));
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  window->priv->resize_screen = screen;
+  window->priv->resize_columns = columns;
+  window->priv->resize_rows = rows;
+
+  terminal_window_resize_schedule (window);
+}
+
+
+
+/**
+ * terminal_window_queue_screen_size:
+ * @window  : A #TerminalWindow.
+ * @screen  : A #TerminalScreen in @window.
+ * @columns : Number of columns.
+ * @rows    : Number of rows.
+ *
+ * Sets the size of @screen on the next frame, so the child is
+ * resized once for all requests made before that frame.
+ **/
+void
+terminal_window_queue_screen_size (TerminalWindow *window,
+                                   TerminalScreen *screen,
+                                   glong           columns,
+                                   glong           rows)
+{
+  glong *grid;
+
+  terminal_return_if_fail (TERMINAL_IS_WINDOW (window));
+  terminal_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  grid = g_hash_table_lookup (window->priv->resize_screens, screen);
+  if (grid == NULL)
+    {
+      grid = g_new (glong, 2);
+      g_hash_table_insert (window->priv->resize_screens, screen, grid);
+    }
+
+  grid[0] = columns;
+  grid[1] = rows;
+
+  terminal_window_resize_schedule (window);
+}
+
+
+
 /**
  * terminal_window_set_grid_size:
  * @window  : A #TerminalWindow.
@@ -3216,106 +4445,20 @@ terminal_window_get_toolbar_height (TerminalWindow *window)
 
 
 /**
- * terminal_window_rebuild_tabs_menu:
+ * terminal_window_update_tabs_menu_accels:
  * @window  : A #TerminalWindow.
+ *
+ * Applies the accelerators of the accel map to the "Go" menu.
  **/
 void
-terminal_window_rebuild_tabs_menu (TerminalWindow *window)
+terminal_window_update_tabs_menu_accels (TerminalWindow *window)
 {
-  gint            npages, n;
-  GtkWidget      *page;
-  GSList         *group = NULL;
-  GtkRadioAction *radio_action;
-  gchar           name[50], buf[100];
-  GSList         *lp;
-  GtkAccelKey     key = {0};
-
-  if (window->priv->tabs_menu_merge_id != 0)
-    {
-      /* remove merge id */
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-      gtk_ui_manager_remove_ui (window->priv->ui_manager, window->priv->tabs_menu_merge_id);
-G_GNUC_END_IGNORE_DEPRECATIONS
-
-      /* drop all the old accels from the action group */
-      for (lp = window->priv->tabs_menu_actions; lp != NULL; lp = lp->next)
-        {
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-          gtk_action_group_remove_action (window->priv->action_group, GTK_ACTION (lp->data));
-G_GNUC_END_IGNORE_DEPRECATIONS
-        }
+  guint n;
 
-      g_slist_free (window->priv->tabs_menu_actions);
-      window->priv->tabs_menu_actions = NULL;
-    }
-
-  /* create a new merge id */
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  window->priv->tabs_menu_merge_id = gtk_ui_manager_new_merge_id (window->priv->ui_manager);
-G_GNUC_END_IGNORE_DEPRECATIONS
-  terminal_assert (window->priv->tabs_menu_actions == NULL);
-
-  /* walk the tabs */
-  npages = gtk_notebook_get_n_pages (GTK_NOTEBOOK (window->priv->notebook));
-  for (n = 0; n < npages; n++)
-    {
-      page = gtk_notebook_get_nth_page (GTK_NOTEBOOK (window->priv->notebook), n);
-
-      g_snprintf (name, sizeof (name), "goto-tab-%d", n + 1);
-
-      /* create action */
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-      radio_action = gtk_radio_action_new (name, NULL, NULL, NULL, n);
-      gtk_action_set_sensitive (GTK_ACTION (radio_action), npages > 1);
-      g_object_bind_property (G_OBJECT (page), "title",
-                              G_OBJECT (radio_action), "label",
-                              G_BINDING_SYNC_CREATE);
-      gtk_radio_action_set_group (radio_action, group);
-      group = gtk_radio_action_get_group (radio_action);
-      gtk_action_group_add_action (window->priv->action_group, GTK_ACTION (radio_action));
-G_GNUC_END_IGNORE_DEPRECATIONS
-      g_signal_connect (G_OBJECT (radio_action), "activate",
-          G_CALLBACK (terminal_window_action_goto_tab), window->priv->notebook);
-
-      /* connect action to the page so we can active it when a tab is switched */
-      g_object_set_qdata_full (G_OBJECT (page), tabs_menu_action_quark,
-                               radio_action, g_object_unref);
-
-      /* set an accelerator path */
-      g_snprintf (buf, sizeof (buf), "<Actions>/terminal-window/%s", name);
-      if (gtk_accel_map_lookup_entry (buf, &key) && key.accel_key != 0)
-        {
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-          gtk_action_set_accel_path (GTK_ACTION (radio_action), buf);
-G_GNUC_END_IGNORE_DEPRECATIONS
-        }
-
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-      /* add action in the menu */
-      gtk_ui_manager_add_ui (window->priv->ui_manager, window->priv->tabs_menu_merge_id,
-                             "/main-menu/tabs-menu/placeholder-tab-items",
-                             name, name, GTK_UI_MANAGER_MENUITEM, FALSE);
-      /* allow underscore to be shown */
-      g_snprintf (buf, sizeof (buf), "/main-menu/tabs-menu/placeholder-tab-items/%s", name);
-      gtk_menu_item_set_use_underline (GTK_MENU_ITEM (gtk_ui_manager_get_widget (window->priv->ui_manager, buf)), FALSE);
-G_GNUC_END_IGNORE_DEPRECATIONS
-
-      if (npages > 1)
-        {
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-          /* add to right-click tab menu */
-          gtk_ui_manager_add_ui (window->priv->ui_manager, window->priv->tabs_menu_merge_id,
-                                 "/tab-menu/tabs-menu/placeholder-tab-items",
-                                 name, name, GTK_UI_MANAGER_MENUITEM, FALSE);
-          /* allow underscore to be shown */
-          g_snprintf (buf, sizeof (buf), "/tab-menu/tabs-menu/placeholder-tab-items/%s", name);
-          gtk_menu_item_set_use_underline (GTK_MENU_ITEM (gtk_ui_manager_get_widget (window->priv->ui_manager, buf)), FALSE);
-G_GNUC_END_IGNORE_DEPRECATIONS
-        }
+  terminal_return_if_fail (TERMINAL_IS_WINDOW (window));
 
-      /* store */
-      window->priv->tabs_menu_actions = g_slist_prepend (window->priv->tabs_menu_actions, radio_action);
-    }
+  for (n = 0; n < window->priv->tabs_menu->len; n++)
+    terminal_window_tabs_menu_item_set_accel (g_ptr_array_index (window->priv->tabs_menu, n));
 }
 
 
@@ -3360,3 +4503,4 @@ terminal_window_update_tab_key_accels (TerminalWindow *window,
 {
   window->priv->tab_key_accels = tab_key_accels;
 }
+
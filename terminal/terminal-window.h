@@ -66,14 +66,28 @@ void               terminal_window_add                      (TerminalWindow
 
 TerminalScreen    *terminal_window_get_active               (TerminalWindow     *window);
 
+guint              terminal_window_get_id                   (TerminalWindow     *window);
+
 void               terminal_window_notebook_show_tabs       (TerminalWindow     *window);
 
 GSList            *terminal_window_get_restart_command      (TerminalWindow     *window);
 
+TerminalWindowAttr *terminal_window_get_session_attr        (TerminalWindow     *window);
+
 void               terminal_window_set_grid_size            (TerminalWindow     *window,
                                                              glong               width,
                                                              glong               height);
 
+void               terminal_window_queue_resize             (TerminalWindow     *window,
+                                                             TerminalScreen     *screen,
+                                                             glong               columns,
+                                                             glong               rows);
+
+void               terminal_window_queue_screen_size        (TerminalWindow     *window,
+                                                             TerminalScreen     *screen,
+                                                             glong               columns,
+                                                             glong               rows);
+
 gboolean           terminal_window_has_children             (TerminalWindow     *window);
 
 GObject           *terminal_window_get_preferences          (TerminalWindow     *window);
@@ -107,7 +121,7 @@ gint               terminal_window_get_menubar_height       (TerminalWindow
 
 gint               terminal_window_get_toolbar_height       (TerminalWindow     *window);
 
-void               terminal_window_rebuild_tabs_menu        (TerminalWindow     *window);
+void               terminal_window_update_tabs_menu_accels  (TerminalWindow     *window);
 
 void               terminal_window_action_show_menubar      (GtkToggleAction    *action,
                                                              TerminalWindow     *window);
@@ -0,0 +1,376 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Feeds output into a background tab of a terminal window and checks
+ * what terminal-screen.c does with it. The tab may not blink or draw
+ * while it is hidden and is repainted once when it is shown. Its label
+ * gets the activity color on output, keeps it while the output goes on
+ * and loses it one tab-activity-timeout after the last output.
+ *
+ * With --benchmark, counts main loop wakeups and CPU time of a window
+ * with 100 idle and 10 busy tabs in the background.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+#include <gtk/gtk.h>
+
+#include <terminal/terminal-private.h>
+#include <terminal/terminal-options.h>
+#include <terminal/terminal-preferences.h>
+#include <terminal/terminal-screen.h>
+#include <terminal/terminal-window.h>
+
+/* automake treats this exit status as a skipped test */
+#define EXIT_SKIP (77)
+
+/* lines fed into the background tab at once */
+#define N_LINES          (100)
+/* the repaint of the output, plus what showing the page and starting
+ * the cursor blink may draw */
+#define MAX_SHOW_FRAMES  (3)
+
+/* seconds the benchmark takes, the busy tabs print every
+ * OUTPUT_INTERVAL milliseconds in the meantime */
+#define RUN_TIME         (5)
+#define OUTPUT_INTERVAL  (20)
+#define N_IDLE_TABS      (100)
+#define N_BUSY_TABS      (10)
+
+
+
+static GPollFunc test_poll_default = NULL;
+static guint     test_n_wakeups = 0;
+
+
+
+static gint
+test_activity_poll (GPollFD *ufds,
+                    guint    nfds,
+                    gint     timeout)
+{
+  test_n_wakeups++;
+
+  return (*test_poll_default) (ufds, nfds, timeout);
+}
+
+
+
+static gint64
+test_activity_cpu_time (void)
+{
+#ifdef HAVE_SYS_RESOURCE_H
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    return (gint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC
+           + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#endif
+
+  return 0;
+}
+
+
+
+static gboolean
+test_activity_quit (gpointer user_data)
+{
+  g_main_loop_quit (user_data);
+  return FALSE;
+}
+
+
+
+static void
+test_activity_wait (guint milliseconds)
+{
+  GMainLoop *loop;
+
+  loop = g_main_loop_new (NULL, FALSE);
+  g_timeout_add (milliseconds, test_activity_quit, loop);
+  g_main_loop_run (loop);
+  g_main_loop_unref (loop);
+}
+
+
+
+static VteTerminal *
+test_activity_find_terminal (GtkWidget *widget)
+{
+  VteTerminal *terminal = NULL;
+  GList       *children, *li;
+
+  if (VTE_IS_TERMINAL (widget))
+    return VTE_TERMINAL (widget);
+
+  if (!GTK_IS_CONTAINER (widget))
+    return NULL;
+
+  children = gtk_container_get_children (GTK_CONTAINER (widget));
+  for (li = children; terminal == NULL && li != NULL; li = li->next)
+    terminal = test_activity_find_terminal (li->data);
+  g_list_free (children);
+
+  return terminal;
+}
+
+
+
+static gboolean
+test_activity_is_colored (GtkNotebook    *notebook,
+                          TerminalScreen *screen)
+{
+  GtkWidget *tab;
+  GList     *children;
+  gboolean   colored;
+
+  /* the title label is the first child of the tab */
+  tab = gtk_notebook_get_tab_label (notebook, GTK_WIDGET (screen));
+  children = gtk_container_get_children (GTK_CONTAINER (tab));
+  colored = gtk_label_get_attributes (GTK_LABEL (children->data)) != NULL;
+  g_list_free (children);
+
+  return colored;
+}
+
+
+
+static gboolean
+test_activity_output (gpointer user_data)
+{
+  static guint  n_line = 0;
+  GPtrArray    *terminals = user_data;
+  gchar        *line;
+  guint         n;
+
+  /* a build log with a blinking marker, like a prompt might have */
+  line = g_strdup_printf ("\033[5m*\033[0m %u make[2]: Entering directory '/home/user/src/module-%u'\r\n",
+                          n_line, n_line % 17);
+  for (n = 0; n < terminals->len; n++)
+    vte_terminal_feed (g_ptr_array_index (terminals, n), line, -1);
+  g_free (line);
+  n_line++;
+
+  return TRUE;
+}
+
+
+
+static GtkWidget *
+test_activity_window_new (guint            n_tabs,
+                          TerminalScreen **screens)
+{
+  TerminalTabAttr *attr;
+  GtkWidget       *window;
+  guint            n;
+
+  window = terminal_window_new (NULL, FALSE, TERMINAL_VISIBILITY_DEFAULT,
+                                TERMINAL_VISIBILITY_DEFAULT, TERMINAL_VISIBILITY_DEFAULT);
+
+  attr = terminal_tab_attr_new ();
+  for (n = 0; n < n_tabs; n++)
+    {
+      screens[n] = terminal_screen_new (attr, 80, 24);
+      terminal_window_add (TERMINAL_WINDOW (window), screens[n]);
+    }
+  terminal_tab_attr_free (attr);
+
+  /* the first tab is shown, all others are in the background */
+  gtk_notebook_set_current_page (GTK_NOTEBOOK (terminal_window_get_notebook (TERMINAL_WINDOW (window))), 0);
+  gtk_widget_show (window);
+
+  return window;
+}
+
+
+
+static gboolean
+test_activity_check (void)
+{
+  TerminalPreferences *preferences;
+  TerminalScreenStats  stats;
+  TerminalScreen      *screens[2];
+  GtkNotebook         *notebook;
+  VteTerminal         *terminal;
+  GPtrArray           *terminals;
+  GtkWidget           *window;
+  GdkRGBA              color;
+  guint64              n_frames;
+  guint                timeout, n, output_id;
+  gboolean             check_color;
+  gboolean             succeed = TRUE;
+
+  window = test_activity_window_new (G_N_ELEMENTS (screens), screens);
+  notebook = GTK_NOTEBOOK (terminal_window_get_notebook (TERMINAL_WINDOW (window)));
+  terminal = test_activity_find_terminal (GTK_WIDGET (screens[1]));
+
+  /* changes within a second of a resize are not activity */
+  test_activity_wait (2100);
+
+  if (vte_terminal_get_cursor_blink_mode (terminal) != VTE_CURSOR_BLINK_OFF)
+    {
+      g_printerr ("the cursor of the background tab blinks\n");
+      succeed = FALSE;
+    }
+#if VTE_CHECK_VERSION (0, 51, 3)
+  if (vte_terminal_get_text_blink_mode (terminal) != VTE_TEXT_BLINK_NEVER)
+    {
+      g_printerr ("the text of the background tab blinks\n");
+      succeed = FALSE;
+    }
+#endif
+
+  terminal_screen_get_stats (screens[1], &stats);
+  n_frames = stats.n_frames;
+
+  terminals = g_ptr_array_new ();
+  g_ptr_array_add (terminals, terminal);
+  for (n = 0; n < N_LINES; n++)
+    test_activity_output (terminals);
+  test_activity_wait (200);
+
+  /* the label only changes if the preferences color it */
+  preferences = terminal_preferences_get ();
+  g_object_get (G_OBJECT (preferences), "tab-activity-timeout", &timeout, NULL);
+  check_color = timeout > 0 && timeout <= 5
+                && terminal_preferences_get_color (preferences, "tab-activity-color", &color);
+  g_object_unref (G_OBJECT (preferences));
+
+  if (check_color)
+    {
+      if (!test_activity_is_colored (notebook, screens[1]))
+        {
+          g_printerr ("the label of the background tab shows no activity\n");
+          succeed = FALSE;
+        }
+
+      /* output for longer than the timeout keeps the color */
+      output_id = g_timeout_add (250, test_activity_output, terminals);
+      test_activity_wait ((timeout + 1) * 1000);
+      g_source_remove (output_id);
+      if (!test_activity_is_colored (notebook, screens[1]))
+        {
+          g_printerr ("the activity color was dropped during output\n");
+          succeed = FALSE;
+        }
+
+      /* and it goes one timeout after the last output */
+      test_activity_wait (timeout * 1000 + 1500);
+      if (test_activity_is_colored (notebook, screens[1]))
+        {
+          g_printerr ("the activity color stayed after the output\n");
+          succeed = FALSE;
+        }
+    }
+
+  g_ptr_array_free (terminals, TRUE);
+
+  terminal_screen_get_stats (screens[1], &stats);
+  if (stats.n_frames != n_frames)
+    {
+      g_printerr ("the background tab drew %" G_GUINT64_FORMAT " frames\n", stats.n_frames - n_frames);
+      succeed = FALSE;
+    }
+
+  /* all of the output is repainted at once */
+  gtk_notebook_set_current_page (notebook, 1);
+  test_activity_wait (200);
+  terminal_screen_get_stats (screens[1], &stats);
+  if (stats.n_frames == n_frames || stats.n_frames - n_frames > MAX_SHOW_FRAMES)
+    {
+      g_printerr ("showing the tab drew %" G_GUINT64_FORMAT " frames\n", stats.n_frames - n_frames);
+      succeed = FALSE;
+    }
+
+  gtk_widget_destroy (window);
+
+  return succeed;
+}
+
+
+
+static gboolean
+test_activity_benchmark (void)
+{
+  TerminalScreen *screens[1 + N_IDLE_TABS + N_BUSY_TABS];
+  GPtrArray      *terminals;
+  GtkWidget      *window;
+  guint           n, output_id, n_wakeups;
+  gint64          cpu_time;
+
+  window = test_activity_window_new (G_N_ELEMENTS (screens), screens);
+  test_activity_wait (500);
+
+  terminals = g_ptr_array_new ();
+  for (n = 1 + N_IDLE_TABS; n < G_N_ELEMENTS (screens); n++)
+    g_ptr_array_add (terminals, test_activity_find_terminal (GTK_WIDGET (screens[n])));
+
+  test_poll_default = g_main_context_get_poll_func (NULL);
+  g_main_context_set_poll_func (NULL, test_activity_poll);
+
+  output_id = g_timeout_add (OUTPUT_INTERVAL, test_activity_output, terminals);
+  test_n_wakeups = 0;
+  cpu_time = test_activity_cpu_time ();
+  test_activity_wait (RUN_TIME * 1000);
+  cpu_time = test_activity_cpu_time () - cpu_time;
+  n_wakeups = test_n_wakeups;
+  g_source_remove (output_id);
+
+  g_main_context_set_poll_func (NULL, test_poll_default);
+  g_ptr_array_free (terminals, TRUE);
+  gtk_widget_destroy (window);
+
+  g_print ("%d s, %d idle and %d busy background tabs, output every %d ms\n",
+           RUN_TIME, N_IDLE_TABS, N_BUSY_TABS, OUTPUT_INTERVAL);
+  g_print ("%-28s %10.1f\n", "wakeups/s", n_wakeups / (gdouble) RUN_TIME);
+  g_print ("%-28s %10.1f\n", "cpu ms", cpu_time / 1000.0);
+
+  return TRUE;
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  gboolean succeed;
+
+  if (!gtk_init_check (&argc, &argv))
+    {
+      g_printerr ("No display to create a terminal window on.\n");
+      return EXIT_SKIP;
+    }
+
+  /* "make check" only runs the check, timings depend on the machine */
+  if (argc > 1 && strcmp (argv[1], "--benchmark") == 0)
+    succeed = test_activity_benchmark ();
+  else
+    succeed = test_activity_check ();
+
+  return succeed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
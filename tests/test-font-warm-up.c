@@ -0,0 +1,221 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Times the first frame of a second terminal window, with and without
+ * the font warm-up between the first and the second window, like the
+ * server does after it opened its first windows. The font caches are
+ * per process, so every run is a fresh process.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <gtk/gtk.h>
+
+#include <terminal/terminal-font-warm-up.h>
+#include <terminal/terminal-private.h>
+
+/* automake treats this exit status as a skipped test */
+#define EXIT_SKIP (77)
+
+/* runs of each kind, the median is reported */
+#define N_RUNS (7)
+
+/* what the second window shows: all faces and a few fallback fonts */
+#define SAMPLE_TEXT \
+  "ls -la /usr/lib \033[1mbold\033[0m \033[3mitalic\033[0m \033[1;3mboth\033[0m\r\n" \
+  "\346\227\245\346\234\254\350\252\236 \344\270\255\346\226\207 \355\225\234\352\265\255\354\226\264 " \
+  "\342\224\200\342\224\202\342\224\214\342\226\210 \342\206\222 \316\273 \320\226 \360\237\230\200\r\n"
+
+#define SAMPLE_FONT "Monospace 12"
+
+
+
+static gboolean
+test_warm_up_drawn (GtkWidget *terminal,
+                    cairo_t   *cr,
+                    gboolean  *drawn)
+{
+  *drawn = TRUE;
+  return FALSE;
+}
+
+
+
+static GtkWidget *
+test_warm_up_window (const PangoFontDescription *font_desc,
+                     const gchar                *text,
+                     gint64                     *first_frame)
+{
+  GtkWidget *window;
+  GtkWidget *terminal;
+  gboolean   drawn = FALSE;
+  gint64     start = g_get_monotonic_time ();
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  terminal = vte_terminal_new ();
+  vte_terminal_set_font (VTE_TERMINAL (terminal), font_desc);
+  vte_terminal_feed (VTE_TERMINAL (terminal), text, -1);
+  g_signal_connect_after (G_OBJECT (terminal), "draw", G_CALLBACK (test_warm_up_drawn), &drawn);
+  gtk_container_add (GTK_CONTAINER (window), terminal);
+  gtk_widget_show_all (window);
+
+  while (!drawn)
+    g_main_context_iteration (NULL, TRUE);
+
+  *first_frame = g_get_monotonic_time () - start;
+  g_signal_handlers_disconnect_by_func (G_OBJECT (terminal), G_CALLBACK (test_warm_up_drawn), &drawn);
+
+  return window;
+}
+
+
+
+static void
+test_warm_up_finished (gpointer user_data)
+{
+  *((gboolean *) user_data) = TRUE;
+}
+
+
+
+static gint
+test_warm_up_run (gboolean warm_up,
+                  gint64  *first_frame)
+{
+  PangoFontDescription *font_desc;
+  GtkWidget            *first, *second;
+  gboolean              finished = FALSE;
+  gint64                elapsed;
+
+  if (!gtk_init_check (NULL, NULL))
+    return EXIT_SKIP;
+
+  font_desc = pango_font_description_from_string (SAMPLE_FONT);
+
+  /* the window the server opened first, it shows plain text */
+  first = test_warm_up_window (font_desc, "$ ", &elapsed);
+
+  if (warm_up)
+    {
+      if (terminal_font_warm_up (first, font_desc, test_warm_up_finished, &finished) == 0)
+        return EXIT_FAILURE;
+      while (!finished)
+        g_main_context_iteration (NULL, TRUE);
+    }
+
+  second = test_warm_up_window (font_desc, SAMPLE_TEXT, first_frame);
+
+  gtk_widget_destroy (second);
+  gtk_widget_destroy (first);
+  pango_font_description_free (font_desc);
+
+  return EXIT_SUCCESS;
+}
+
+
+
+static gint
+test_warm_up_fork (gboolean warm_up,
+                   gint64  *first_frame)
+{
+  gint   fds[2];
+  gint   status;
+  pid_t  pid;
+
+  if (pipe (fds) != 0)
+    return EXIT_FAILURE;
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      close (fds[0]);
+      status = test_warm_up_run (warm_up, first_frame);
+      if (status == EXIT_SUCCESS && write (fds[1], first_frame, sizeof (*first_frame)) != sizeof (*first_frame))
+        status = EXIT_FAILURE;
+      _exit (status);
+    }
+
+  close (fds[1]);
+  if (pid < 0 || read (fds[0], first_frame, sizeof (*first_frame)) != sizeof (*first_frame))
+    *first_frame = -1;
+  close (fds[0]);
+
+  if (pid < 0 || waitpid (pid, &status, 0) != pid || !WIFEXITED (status))
+    return EXIT_FAILURE;
+
+  return WEXITSTATUS (status);
+}
+
+
+
+static gint
+test_warm_up_compare (gconstpointer a,
+                      gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+  return x < y ? -1 : x > y;
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  gint64 first_frames[2][N_RUNS];
+  guint  kind, n;
+  gint   status;
+
+  /* fork before gtk is initialized, every run starts cold */
+  for (n = 0; n < N_RUNS; n++)
+    for (kind = 0; kind < 2; kind++)
+      {
+        status = test_warm_up_fork (kind == 1, &first_frames[kind][n]);
+        if (status == EXIT_SKIP)
+          {
+            g_printerr ("No display to create a terminal on.\n");
+            return EXIT_SKIP;
+          }
+        else if (status != EXIT_SUCCESS)
+          {
+            g_printerr ("Run %u failed.\n", n);
+            return EXIT_FAILURE;
+          }
+      }
+
+  g_print ("%-10s %12s %12s %12s\n", "warm-up", "min ms", "median ms", "max ms");
+  for (kind = 0; kind < 2; kind++)
+    {
+      qsort (first_frames[kind], N_RUNS, sizeof (gint64), test_warm_up_compare);
+      g_print ("%-10s %12.1f %12.1f %12.1f\n", kind == 1 ? "yes" : "no",
+               first_frames[kind][0] / 1000.0,
+               first_frames[kind][N_RUNS / 2] / 1000.0,
+               first_frames[kind][N_RUNS - 1] / 1000.0);
+    }
+
+  return EXIT_SUCCESS;
+}
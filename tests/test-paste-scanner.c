@@ -0,0 +1,284 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Checks that the paste scanner implementations agree with each other
+ * and with a plain byte-by-byte reference, and times them. The scanner
+ * is included, so its static implementations can be called one by one.
+ *
+ * All scanners are timed on the same input with the same semantics:
+ * "libc" finds the next special byte with strcspn(), like the strchr()
+ * test the unsafe paste check did before, but for every byte the other
+ * scanners look for. Each row is a complete scan of the text, and the
+ * "first" column is the early exit the unsafe paste check needs.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <terminal/terminal-paste-scanner.c>
+
+/* size of the generated corpora and the number of timed runs */
+#define CORPUS_LENGTH (16 * 1024 * 1024)
+#define N_RUNS        (5)
+
+
+
+typedef struct
+{
+  const gchar       *name;
+  PasteScanFindFunc  find;
+} TestImpl;
+
+
+
+/* the bytes paste_scan_is_special() matches, for strcspn() */
+static gchar libc_specials[0x20 + 2];
+
+
+
+static gsize
+test_paste_find_libc (const guchar *text,
+                      gsize         offset,
+                      gsize         length)
+{
+  /* the corpora are nul-terminated and contain no nul */
+  return MIN (offset + strcspn ((const gchar *) text + offset, libc_specials), length);
+}
+
+
+
+static const TestImpl impls[] =
+{
+  { "libc", test_paste_find_libc },
+  { "scalar", paste_scan_find_scalar },
+#ifdef PASTE_SCAN_SSE2
+  { "sse2", paste_scan_find_sse2 },
+#endif
+#ifdef PASTE_SCAN_AVX2
+  { "avx2", paste_scan_find_avx2 },
+#endif
+};
+
+
+
+static gboolean
+test_paste_supported (const TestImpl *impl)
+{
+#ifdef PASTE_SCAN_AVX2
+  if (impl->find == paste_scan_find_avx2)
+    return __builtin_cpu_supports ("avx2");
+#endif
+  return TRUE;
+}
+
+
+
+static gchar *
+test_paste_corpus (GRand *rand,
+                   gsize  length,
+                   gint   special_ratio)
+{
+  static const gchar *words[] = { "grep", "-rn", "sudo", "apt", "Grüße", "日本語", "naïve", "/usr/lib" };
+  static const gchar  specials[] = { '\n', '\t', '\r', '\033', '\a', 0x7f };
+  GString            *corpus;
+
+  corpus = g_string_sized_new (length + 32);
+  while (corpus->len < length)
+    {
+      if (special_ratio > 0 && g_rand_int_range (rand, 0, special_ratio) == 0)
+        {
+          if (g_rand_boolean (rand))
+            g_string_append (corpus, PASTE_TERMINATOR);
+          else if (g_rand_boolean (rand))
+            g_string_append (corpus, "\302\233");
+          else
+            g_string_append_c (corpus, specials[g_rand_int_range (rand, 0, G_N_ELEMENTS (specials))]);
+        }
+      else
+        {
+          g_string_append (corpus, words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+          g_string_append_c (corpus, ' ');
+        }
+    }
+
+  return g_string_free (corpus, FALSE);
+}
+
+
+
+static gboolean
+test_paste_reference_is_unsafe (const gchar *text)
+{
+  const guchar *p;
+
+  /* what the scanner has to report, byte by byte */
+  for (p = (const guchar *) text; *p != '\0'; p++)
+    {
+      if (*p == '\t')
+        continue;
+      if (*p < 0x20 || *p == 0x7f)
+        return TRUE;
+      if (*p == 0xc2 && p[1] >= 0x80 && p[1] <= 0x9f)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+
+
+static gboolean
+test_paste_checks (void)
+{
+  TerminalPasteScan  reference, scan;
+  GRand             *rand;
+  gchar             *corpus;
+  gboolean           succeed = TRUE;
+  guint              i, n;
+  gsize              len;
+
+  /* short inputs, to cover the unaligned tails */
+  rand = g_rand_new_with_seed (1);
+  for (n = 0; n < 10000; n++)
+    {
+      corpus = test_paste_corpus (rand, g_rand_int_range (rand, 0, 200), 4);
+      len = strlen (corpus);
+      paste_scan_run (paste_scan_find_scalar, (const guchar *) corpus, len, &reference);
+
+      if (terminal_paste_scan_is_unsafe (&reference) != test_paste_reference_is_unsafe (corpus))
+        {
+          g_printerr ("scalar: unsafe verdict differs from the reference for input %u\n", n);
+          succeed = FALSE;
+        }
+
+      for (i = 0; i < G_N_ELEMENTS (impls); i++)
+        {
+          if (!test_paste_supported (&impls[i]))
+            continue;
+
+          paste_scan_run (impls[i].find, (const guchar *) corpus, len, &scan);
+          if (memcmp (&reference, &scan, sizeof (scan)) != 0)
+            {
+              g_printerr ("%s: result differs from the scalar scanner for input %u\n",
+                          impls[i].name, n);
+              succeed = FALSE;
+            }
+        }
+
+      /* only tabs and line breaks survive sanitizing */
+      len = terminal_paste_sanitize (corpus, len);
+      terminal_paste_scan (corpus, len, &scan);
+      if (scan.n_controls > 0 || scan.n_terminators > 0)
+        {
+          g_printerr ("sanitized input %u still has control characters\n", n);
+          succeed = FALSE;
+        }
+
+      g_free (corpus);
+    }
+  g_rand_free (rand);
+
+  return succeed;
+}
+
+
+
+static void
+test_paste_benchmark (void)
+{
+  static const struct
+  {
+    const gchar *name;
+    gint         special_ratio;
+  }
+  corpora[] =
+  {
+    { "clean", 0 },
+    { "script", 40 },
+    { "binary", 3 }
+  };
+  TerminalPasteScan  scan;
+  GRand             *rand;
+  gchar             *corpus;
+  gint64             start, best, best_first;
+  volatile gsize     first;
+  guint              c, i, r;
+  gsize              len;
+
+  g_print ("%-8s %-8s %10s %12s\n", "scanner", "corpus", "MB/s", "first (us)");
+  for (c = 0; c < G_N_ELEMENTS (corpora); c++)
+    {
+      rand = g_rand_new_with_seed (c + 1);
+      corpus = test_paste_corpus (rand, CORPUS_LENGTH, corpora[c].special_ratio);
+      len = strlen (corpus);
+      g_rand_free (rand);
+
+      for (i = 0; i < G_N_ELEMENTS (impls); i++)
+        {
+          if (!test_paste_supported (&impls[i]))
+            continue;
+
+          best = best_first = G_MAXINT64;
+          for (r = 0; r < N_RUNS; r++)
+            {
+              start = g_get_monotonic_time ();
+              paste_scan_run (impls[i].find, (const guchar *) corpus, len, &scan);
+              best = MIN (best, g_get_monotonic_time () - start);
+
+              start = g_get_monotonic_time ();
+              first = impls[i].find ((const guchar *) corpus, 0, len);
+              best_first = MIN (best_first, g_get_monotonic_time () - start);
+            }
+
+          g_print ("%-8s %-8s %10.0f %12" G_GINT64_FORMAT "%s\n",
+                   impls[i].name, corpora[c].name, (gdouble) len / MAX (best, 1),
+                   best_first, first == len ? "  (whole text)" : "");
+        }
+
+      g_free (corpus);
+    }
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  gboolean succeed;
+  guint    i, n = 0;
+
+  for (i = 1; i < 0x20; i++)
+    libc_specials[n++] = i;
+  libc_specials[n++] = 0x7f;
+  libc_specials[n++] = (gchar) 0xc2;
+
+#ifdef PASTE_SCAN_AVX2
+  __builtin_cpu_init ();
+#endif
+
+  succeed = test_paste_checks ();
+  test_paste_benchmark ();
+
+  return succeed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
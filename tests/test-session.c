@@ -0,0 +1,293 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Saves a session of 10 windows with 10 tabs each and 2000 lines of
+ * scrollback per tab, checks that it loads back unchanged and times
+ * restoring it into windows: loading the file, creating the windows
+ * and terminals, feeding the scrollback of every tab and waiting until
+ * vte processed it and the windows were drawn.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+#include <terminal/terminal-private.h>
+#include <terminal/terminal-scrollback.h>
+#include <terminal/terminal-session.h>
+
+#define N_WINDOWS (10)
+#define N_TABS    (10)
+#define N_LINES   (2000)
+#define N_RUNS    (5)
+
+/* size of the restored terminals and their history, the defaults */
+#define TEST_COLUMNS         (120)
+#define TEST_ROWS            (40)
+#define TEST_SCROLLING_LINES (1000)
+
+
+
+static GSList *
+test_session_new (void)
+{
+  TerminalWindowAttr *win_attr;
+  TerminalTabAttr    *tab_attr;
+  GSList             *window_attrs = NULL;
+  GString            *text;
+  GBytes             *bytes;
+  guint               w, t, n;
+
+  for (w = 0; w < N_WINDOWS; w++)
+    {
+      win_attr = terminal_window_attr_new ();
+      win_attr->geometry = g_strdup_printf ("%ux%u", TEST_COLUMNS, TEST_ROWS);
+      g_slist_free_full (win_attr->tabs, (GDestroyNotify) terminal_tab_attr_free);
+      win_attr->tabs = NULL;
+
+      for (t = 0; t < N_TABS; t++)
+        {
+          tab_attr = terminal_tab_attr_new ();
+          tab_attr->title = g_strdup_printf ("user@host: ~/src/project-%u", w * N_TABS + t);
+          tab_attr->directory = g_strdup_printf ("/home/user/src/project-%u", w * N_TABS + t);
+          tab_attr->active = (t == 0);
+
+          text = g_string_new (NULL);
+          for (n = 0; n < N_LINES; n++)
+            g_string_append_printf (text, "%5u make[2]: Entering directory '/home/user/src/project-%u/module-%u'\n",
+                                    n, w * N_TABS + t, n % 17);
+          bytes = g_string_free_to_bytes (text);
+          tab_attr->scrollback = terminal_scrollback_compress (bytes, NULL);
+          g_bytes_unref (bytes);
+
+          win_attr->tabs = g_slist_append (win_attr->tabs, tab_attr);
+        }
+
+      window_attrs = g_slist_append (window_attrs, win_attr);
+    }
+
+  return window_attrs;
+}
+
+
+
+static gboolean
+test_session_equal (GSList *saved,
+                    GSList *loaded)
+{
+  TerminalWindowAttr *wa, *wb;
+  TerminalTabAttr    *ta, *tb;
+  GSList             *a, *b;
+
+  for (; saved != NULL && loaded != NULL; saved = saved->next, loaded = loaded->next)
+    {
+      wa = saved->data;
+      wb = loaded->data;
+      if (g_strcmp0 (wa->geometry, wb->geometry) != 0)
+        return FALSE;
+
+      for (a = wa->tabs, b = wb->tabs; a != NULL && b != NULL; a = a->next, b = b->next)
+        {
+          ta = a->data;
+          tb = b->data;
+          if (g_strcmp0 (ta->title, tb->title) != 0
+              || g_strcmp0 (ta->directory, tb->directory) != 0
+              || ta->active != tb->active
+              || tb->scrollback == NULL
+              || !g_bytes_equal (ta->scrollback, tb->scrollback))
+            return FALSE;
+        }
+
+      if (a != NULL || b != NULL)
+        return FALSE;
+    }
+
+  return saved == NULL && loaded == NULL;
+}
+
+
+
+static gboolean
+test_session_drawn (GtkWidget *terminal,
+                    cairo_t   *cr,
+                    guint     *n_drawn)
+{
+  (*n_drawn)++;
+  g_signal_handlers_disconnect_by_func (G_OBJECT (terminal), G_CALLBACK (test_session_drawn), n_drawn);
+  return FALSE;
+}
+
+
+
+static gboolean
+test_session_restored (GSList *terminals)
+{
+  glong column, row;
+
+  /* vte parses the fed text from the main loop, the cursor ends up
+   * on the last line of the history */
+  for (; terminals != NULL; terminals = terminals->next)
+    {
+      vte_terminal_get_cursor_position (terminals->data, &column, &row);
+      if (row < N_LINES - 1)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+static gint64
+test_session_restore (const gchar *filename)
+{
+  TerminalWindowAttr *win_attr;
+  TerminalTabAttr    *tab_attr;
+  GtkWidget          *notebook;
+  GtkWidget          *terminal;
+  GSList             *window_attrs, *wp, *tp;
+  GSList             *windows = NULL, *terminals = NULL;
+  gint64              start, elapsed;
+  guint               n_drawn = 0;
+
+  start = g_get_monotonic_time ();
+
+  window_attrs = terminal_session_load (filename, NULL);
+  if (window_attrs == NULL)
+    return -1;
+
+  for (wp = window_attrs; wp != NULL; wp = wp->next)
+    {
+      win_attr = wp->data;
+      windows = g_slist_prepend (windows, gtk_window_new (GTK_WINDOW_TOPLEVEL));
+      notebook = gtk_notebook_new ();
+      gtk_container_add (GTK_CONTAINER (windows->data), notebook);
+
+      for (tp = win_attr->tabs; tp != NULL; tp = tp->next)
+        {
+          tab_attr = tp->data;
+
+          /* what terminal_screen_launch_child() does for every tab */
+          terminal = vte_terminal_new ();
+          vte_terminal_set_size (VTE_TERMINAL (terminal), TEST_COLUMNS, TEST_ROWS);
+          vte_terminal_set_scrollback_lines (VTE_TERMINAL (terminal), TEST_SCROLLING_LINES);
+          terminal_scrollback_restore (VTE_TERMINAL (terminal), tab_attr->scrollback, NULL);
+          gtk_notebook_append_page (GTK_NOTEBOOK (notebook), terminal, gtk_label_new (tab_attr->title));
+          terminals = g_slist_prepend (terminals, terminal);
+
+          if (tab_attr->active)
+            g_signal_connect_after (G_OBJECT (terminal), "draw", G_CALLBACK (test_session_drawn), &n_drawn);
+        }
+
+      gtk_widget_show_all (windows->data);
+    }
+
+  while (n_drawn < N_WINDOWS || !test_session_restored (terminals))
+    g_main_context_iteration (NULL, TRUE);
+
+  elapsed = g_get_monotonic_time () - start;
+
+  g_slist_free_full (windows, (GDestroyNotify) gtk_widget_destroy);
+  g_slist_free (terminals);
+  g_slist_free_full (window_attrs, (GDestroyNotify) terminal_window_attr_free);
+
+  while (g_main_context_iteration (NULL, FALSE));
+
+  return elapsed;
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  GSList   *window_attrs, *loaded;
+  GError   *error = NULL;
+  gchar    *filename = NULL;
+  gint64    elapsed, best = G_MAXINT64;
+  gint      fd;
+  guint     n;
+  gboolean  succeed = TRUE;
+
+  window_attrs = test_session_new ();
+
+  fd = g_file_open_tmp ("xfce4-terminal-session-XXXXXX", &filename, &error);
+  if (fd == -1)
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return EXIT_FAILURE;
+    }
+  close (fd);
+
+  if (!terminal_session_save (window_attrs, filename, &error))
+    {
+      g_printerr ("Failed to save the session: %s\n", error->message);
+      g_error_free (error);
+      succeed = FALSE;
+    }
+  else
+    {
+      loaded = terminal_session_load (filename, &error);
+      if (loaded == NULL)
+        {
+          g_printerr ("Failed to load the session: %s\n", error->message);
+          g_error_free (error);
+          succeed = FALSE;
+        }
+      else if (!test_session_equal (window_attrs, loaded))
+        {
+          g_printerr ("The loaded session differs from the saved one.\n");
+          succeed = FALSE;
+        }
+      g_slist_free_full (loaded, (GDestroyNotify) terminal_window_attr_free);
+    }
+
+  if (succeed && gtk_init_check (&argc, &argv))
+    {
+      for (n = 0; succeed && n < N_RUNS; n++)
+        {
+          elapsed = test_session_restore (filename);
+          if (elapsed < 0)
+            succeed = FALSE;
+          best = MIN (best, elapsed);
+        }
+
+      if (succeed)
+        g_print ("restored %u windows with %u tabs each in %.1f ms\n",
+                 N_WINDOWS, N_TABS, best / 1000.0);
+    }
+  else if (succeed)
+    {
+      g_print ("No display, restoring into windows was not timed.\n");
+    }
+
+  g_slist_free_full (window_attrs, (GDestroyNotify) terminal_window_attr_free);
+  g_unlink (filename);
+  g_free (filename);
+
+  return succeed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,117 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Fills the tab switcher index with 1000 tabs, checks that typical
+ * queries find the tab they describe first and times them.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <terminal/terminal-private.h>
+#include <terminal/terminal-tab-index.h>
+
+#define N_TABS (1000)
+#define N_RUNS (1000)
+
+
+
+static const gchar *commands[] = { "vim", "htop", "make", "ssh", "less", "python3", "git" };
+
+/* expected first tab of a query, or G_MAXUINT for any */
+static const struct
+{
+  const gchar *query;
+  guint        expected;
+}
+queries[] =
+{
+  { "project-742", 742 },
+  { "prj742", 742 },
+  { "module-11 prj74", 742 },
+  { "pyth", G_MAXUINT },
+  { "", 0 },
+  { "no such tab", G_MAXUINT }
+};
+
+
+
+static TerminalTabIndex *
+test_tab_index_fill (void)
+{
+  TerminalTabIndex *index;
+  gchar            *text;
+  guint             n;
+
+  index = terminal_tab_index_new ();
+  for (n = 0; n < N_TABS; n++)
+    {
+      text = g_strdup_printf ("user@host: ~/src/project-%u", n);
+      terminal_tab_index_set (index, GUINT_TO_POINTER (n + 1), TERMINAL_TAB_INDEX_TITLE, text);
+      g_free (text);
+
+      text = g_strdup_printf ("/home/user/src/project-%u/module-%u", n, n % 17);
+      terminal_tab_index_set (index, GUINT_TO_POINTER (n + 1), TERMINAL_TAB_INDEX_DIRECTORY, text);
+      g_free (text);
+
+      terminal_tab_index_set (index, GUINT_TO_POINTER (n + 1), TERMINAL_TAB_INDEX_COMMAND,
+                              commands[n % G_N_ELEMENTS (commands)]);
+    }
+
+  return index;
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  TerminalTabIndex *index;
+  TerminalTabMatch  matches[50];
+  gint64            start, elapsed;
+  gboolean          succeed = TRUE;
+  guint             n, q, n_found = 0;
+
+  index = test_tab_index_fill ();
+
+  g_print ("%-16s %8s %12s\n", "query", "matches", "usec/query");
+  for (q = 0; q < G_N_ELEMENTS (queries); q++)
+    {
+      start = g_get_monotonic_time ();
+      for (n = 0; n < N_RUNS; n++)
+        n_found = terminal_tab_index_match (index, queries[q].query, matches, G_N_ELEMENTS (matches));
+      elapsed = g_get_monotonic_time () - start;
+
+      g_print ("%-16s %8u %12.1f\n", queries[q].query, n_found, (gdouble) elapsed / N_RUNS);
+
+      if (queries[q].expected != G_MAXUINT
+          && (n_found == 0 || GPOINTER_TO_UINT (matches[0].key) != queries[q].expected + 1))
+        {
+          g_printerr ("query \"%s\" did not find tab %u first\n",
+                      queries[q].query, queries[q].expected);
+          succeed = FALSE;
+        }
+    }
+
+  terminal_tab_index_free (index);
+
+  return succeed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
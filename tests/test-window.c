@@ -0,0 +1,240 @@
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Creates a terminal window and opens all of its menus once. Fails if a
+ * top-level menu is hidden before it was opened, or if a menu, popup or
+ * the toolbar misses an item.
+ *
+ * With --benchmark, times creating windows, the first one including the
+ * parsing of the shared ui description, and opening all of their menus.
+ * Building the ui of a window from the xml, as every window did before,
+ * is timed for comparison.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <terminal/terminal-window.c>
+
+/* automake treats this exit status as a skipped test */
+#define EXIT_SKIP (77)
+
+#define N_RUNS (50)
+
+
+
+static gboolean
+test_window_open_menus (TerminalWindow *window)
+{
+  WindowUiItem *item;
+  GtkWidget    *menu_item;
+  GtkWidget    *menu;
+  gchar        *path;
+  guint         n;
+  gboolean      succeed = TRUE;
+
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  for (n = 0; n < window_ui_items->len; n++)
+    {
+      item = &g_array_index (window_ui_items, WindowUiItem, n);
+      if (item->block != 0 || item->type != GTK_UI_MANAGER_MENU)
+        continue;
+
+      /* the menubar shows the menu before its items are merged */
+      path = terminal_window_ui_item_path (item);
+      menu_item = gtk_ui_manager_get_widget (window->priv->ui_manager, path);
+      if (menu_item == NULL || !gtk_widget_get_visible (menu_item))
+        {
+          g_printerr ("%s is hidden in the menubar\n", path);
+          succeed = FALSE;
+        }
+      else
+        {
+          /* what opening the menu does */
+          menu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (menu_item));
+          gtk_widget_show (menu);
+          gtk_widget_hide (menu);
+        }
+      g_free (path);
+    }
+G_GNUC_END_IGNORE_DEPRECATIONS
+
+  /* the popups and the toolbar */
+  for (n = 1; n < window_ui_blocks->len; n++)
+    terminal_window_ui_merge (window, g_ptr_array_index (window_ui_blocks, n));
+
+  return succeed;
+}
+
+
+
+static gboolean
+test_window_check_items (TerminalWindow *window)
+{
+  WindowUiItem *item;
+  gchar        *path;
+  guint         n;
+  gboolean      succeed = TRUE;
+
+  for (n = 0; n < window_ui_items->len; n++)
+    {
+      item = &g_array_index (window_ui_items, WindowUiItem, n);
+      if (item->name == NULL || item->type == GTK_UI_MANAGER_PLACEHOLDER
+          || item->type == GTK_UI_MANAGER_ACCELERATOR)
+        continue;
+
+      path = terminal_window_ui_item_path (item);
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+      if (gtk_ui_manager_get_widget (window->priv->ui_manager, path) == NULL)
+G_GNUC_END_IGNORE_DEPRECATIONS
+        {
+          g_printerr ("%s is missing in the window\n", path);
+          succeed = FALSE;
+        }
+      g_free (path);
+    }
+
+  return succeed;
+}
+
+
+
+static gint64
+test_window_from_xml (void)
+{
+  GtkActionGroup *action_group;
+  GtkAction      *encoding_action;
+  GtkUIManager   *ui_manager;
+  gint64          start, elapsed;
+
+  /* the ui as every window built it before */
+  start = g_get_monotonic_time ();
+  encoding_action = terminal_encoding_action_new ("set-encoding", _("Set _Encoding"));
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  action_group = gtk_action_group_new ("terminal-window");
+  gtk_action_group_set_translation_domain (action_group, GETTEXT_PACKAGE);
+  gtk_action_group_add_actions (action_group, action_entries,
+                                G_N_ELEMENTS (action_entries), NULL);
+  gtk_action_group_add_toggle_actions (action_group, toggle_action_entries,
+                                       G_N_ELEMENTS (toggle_action_entries), NULL);
+  gtk_action_group_add_action (action_group, encoding_action);
+  ui_manager = gtk_ui_manager_new ();
+  gtk_ui_manager_insert_action_group (ui_manager, action_group, 0);
+  gtk_ui_manager_add_ui_from_string (ui_manager, terminal_window_ui, terminal_window_ui_length, NULL);
+  gtk_ui_manager_ensure_update (ui_manager);
+G_GNUC_END_IGNORE_DEPRECATIONS
+  elapsed = g_get_monotonic_time () - start;
+
+  g_object_unref (G_OBJECT (ui_manager));
+  g_object_unref (G_OBJECT (action_group));
+  g_object_unref (G_OBJECT (encoding_action));
+
+  return elapsed;
+}
+
+
+
+static gboolean
+test_window_check (void)
+{
+  GtkWidget *window;
+  gboolean   succeed;
+
+  window = terminal_window_new (NULL, FALSE, TERMINAL_VISIBILITY_DEFAULT,
+                                TERMINAL_VISIBILITY_DEFAULT, TERMINAL_VISIBILITY_DEFAULT);
+  succeed = test_window_open_menus (TERMINAL_WINDOW (window))
+            && test_window_check_items (TERMINAL_WINDOW (window));
+  gtk_widget_destroy (window);
+
+  return succeed;
+}
+
+
+
+static gboolean
+test_window_benchmark (void)
+{
+  GtkWidget *window;
+  gint64     start, elapsed_first, elapsed_new = 0, elapsed_menus = 0, elapsed_xml = 0;
+  guint      run;
+  gboolean   succeed = TRUE;
+
+  start = g_get_monotonic_time ();
+  window = terminal_window_new (NULL, FALSE, TERMINAL_VISIBILITY_DEFAULT,
+                                TERMINAL_VISIBILITY_DEFAULT, TERMINAL_VISIBILITY_DEFAULT);
+  elapsed_first = g_get_monotonic_time () - start;
+  gtk_widget_destroy (window);
+
+  for (run = 0; succeed && run < N_RUNS; run++)
+    {
+      start = g_get_monotonic_time ();
+      window = terminal_window_new (NULL, FALSE, TERMINAL_VISIBILITY_DEFAULT,
+                                    TERMINAL_VISIBILITY_DEFAULT, TERMINAL_VISIBILITY_DEFAULT);
+      elapsed_new += g_get_monotonic_time () - start;
+
+      /* what opening all the menus and the toolbar adds */
+      start = g_get_monotonic_time ();
+      succeed = test_window_open_menus (TERMINAL_WINDOW (window));
+      elapsed_menus += g_get_monotonic_time () - start;
+
+      if (succeed)
+        succeed = test_window_check_items (TERMINAL_WINDOW (window));
+
+      gtk_widget_destroy (window);
+
+      elapsed_xml += test_window_from_xml ();
+    }
+
+  if (succeed)
+    {
+      g_print ("%-28s %10.2f ms\n", "first window", elapsed_first / 1000.0);
+      g_print ("%-28s %10.2f ms\n", "new window", elapsed_new / 1000.0 / N_RUNS);
+      g_print ("%-28s %10.2f ms\n", "open all menus", elapsed_menus / 1000.0 / N_RUNS);
+      g_print ("%-28s %10.2f ms\n", "ui from xml", elapsed_xml / 1000.0 / N_RUNS);
+    }
+
+  return succeed;
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  gboolean succeed;
+
+  if (!gtk_init_check (&argc, &argv))
+    {
+      g_printerr ("No display to create a terminal window on.\n");
+      return EXIT_SKIP;
+    }
+
+  /* "make check" only runs the check, timings depend on the machine */
+  if (argc > 1 && strcmp (argv[1], "--benchmark") == 0)
+    succeed = test_window_benchmark ();
+  else
+    succeed = test_window_check ();
+
+  return succeed ? EXIT_SUCCESS : EXIT_FAILURE;
+}